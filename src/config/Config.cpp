@@ -2,23 +2,46 @@
 
 // ========== MQTT CONFIGURATION ==========
 const char *MQTT_HOST = "broker.hivemq.com";
-const int MQTT_PORT = 1883;
+int MQTT_PORT = 1883;
 const char *MQTT_USERNAME = "";
 const char *MQTT_PASSWORD = "";
-const char *MQTT_CLIENT_ID = "AgroHygra-ESP32";
+const char *MQTT_CLIENT_ID = "";                 // Empty: "agrohygra-<mac>"
+const char *MQTT_TOPIC_PREFIX = "";              // Empty: "agrohygra/<mac>"
 
-// MQTT Topics
-const char *TOPIC_SENSORS = "agrohygra/sensors";
-const char *TOPIC_PUMP_COMMAND = "agrohygra/pump/command";
-const char *TOPIC_PUMP_STATUS = "agrohygra/pump/status";
-const char *TOPIC_SYSTEM_STATUS = "agrohygra/system/status";
-const char *TOPIC_LOGS = "agrohygra/logs";
+// MQTT Topics ("~" is replaced by the topic prefix)
+const char *TOPIC_SENSORS = "~/sensors";
+const char *TOPIC_PUMP_COMMAND = "~/pump/command";
+const char *TOPIC_PUMP_STATUS = "~/pump/status";
+const char *TOPIC_SYSTEM_STATUS = "~/system/status";
+const char *TOPIC_LOGS = "~/logs";
+const char *TOPIC_CONFIG_SET = "~/config/set";
+const char *TOPIC_COMMAND = "~/command";                          // JSON commands
+const char *TOPIC_COMMAND_RESPONSE = "~/command/response";
+const char *TOPIC_PRESENCE = "~/status";                          // Retained online/offline (Last Will)
+const char *TOPIC_STATS = "~/stats";                              // Per-window aggregates
+const char *TOPIC_ALERTS = "~/alerts";                            // Local rule fired/cleared events
+const unsigned long COMMAND_REBOOT_DELAY = 1000;                  // ms, lets the ack go out first
+unsigned long ACTUATION_SLO_MS = 1000;                            // Command sent -> relay switched
+unsigned long COMMAND_MAX_AGE = 30000;                            // ms in transit before a pump command is refused, 0 = never
 
 // ========== SENSOR CONFIGURATION ==========
-const int MOISTURE_THRESHOLD = 30;
-const int MOISTURE_STOP = 70;
-const int MAX_PUMP_TIME = 60;
-const int SENSOR_READ_INTERVAL = 2;
+int MOISTURE_THRESHOLD = 30;
+int MOISTURE_STOP = 70;
+int MAX_PUMP_TIME = 60;
+int SENSOR_READ_INTERVAL = 2;
+
+// Pulse-and-soak irrigation
+int IRRIGATION_MODE = 0;          // 0 = bang-bang, 1 = pulse-and-soak
+int PULSE_MIN_TIME = 3;           // s
+int PULSE_MAX_TIME = 20;          // s (also capped by MAX_PUMP_TIME)
+int SOAK_MIN_TIME = 30;           // s
+int SOAK_MAX_TIME = 600;          // s
+const int PULSE_MAX_PER_CYCLE = 8;
+const int MOISTURE_DEADBAND = 2;  // % below MOISTURE_STOP that counts as on target
+const float PULSE_DEFAULT_GAIN = 0.5;   // % per pump-second until learned
+const float SOAK_DEFAULT_LAG = 60.0;    // s until learned
+const unsigned long IRRIGATION_HISTORY_INTERVAL = 30000;
+const unsigned long OVERSHOOT_WINDOW = 900000;
 
 // RS485 NPK Sensor Configuration
 const byte NPK_SENSOR_ADDRESS = 0x01;
@@ -35,23 +58,98 @@ const uint16_t PHOSPHORUS_REGISTER = 0x0005;
 const uint16_t POTASSIUM_REGISTER = 0x0006;
 
 // Safety configuration
-const unsigned long BOOT_SAFE_DELAY = 15000;
-const int REQUIRED_CONSECUTIVE_DRY = 2;
+unsigned long BOOT_SAFE_DELAY = 15000;
+int REQUIRED_CONSECUTIVE_DRY = 2;
+
+// Sensor health monitoring
+const unsigned long NPK_RESPONSE_TIMEOUT = 1000;  // ms, full register read
+const unsigned long NPK_PROBE_TIMEOUT = 200;      // ms, single-register probe while failing
+bool NPK_BLOCK_READ = false;                      // Read all 7 registers in one Modbus request
+const int HEALTH_FAIL_THRESHOLD = 3;              // Consecutive failures before backing off
+const unsigned long HEALTH_BACKOFF_BASE = 2000;   // ms, doubles per further failure
+const unsigned long HEALTH_BACKOFF_MAX = 300000;  // ms
+const unsigned long HEALTH_STUCK_TIME = 7200000;  // ms one value must persist to be flagged "stuck"
+const int HEALTH_STUCK_MIN_COUNT = 30;            // ...over at least this many identical readings
+const unsigned long HEALTH_STALE_AFTER = 30000;   // ms without a good reading
+const unsigned long HEALTH_PUBLISH_INTERVAL = 30000;
 
 // ========== MQ-135 AIR QUALITY CONFIGURATION ==========
-const int MQ135_CLEAN_AIR_VALUE = 500;
-const int MQ135_POLLUTED_THRESHOLD = 1500;
-const float MQ135_VOLTAGE_REF = 3.3;
+int MQ135_CLEAN_AIR_VALUE = 500;
+int MQ135_POLLUTED_THRESHOLD = 1500;
+float MQ135_VOLTAGE_REF = 3.3;
 const float MQ135_ADC_MAX = 4095.0;
-const float MQ135_RL_VALUE = 20.0;
-const float MQ135_RO_CLEAN_AIR = 3.6;
+float MQ135_RL_VALUE = 20.0;
+float MQ135_RO_CLEAN_AIR = 3.6;
+
+// ========== ADC CALIBRATION ==========
+const uint32_t ADC_DEFAULT_VREF = 1100;   // mV, used only when eFuse holds no calibration
+const int ADC_RAW_MAX = 4095;             // 12-bit full scale, the top rail
 
 // ========== TDS CONFIGURATION ==========
-const float TDS_K = 500.0;
+float TDS_K = 500.0;
 
 // ========== TIMING CONFIGURATION ==========
-const unsigned long MQTT_SENSOR_INTERVAL = 2000;
-const unsigned long MQTT_RECONNECT_INTERVAL = 5000;
-const unsigned long LCD_UPDATE_INTERVAL = 2000;
-const unsigned long NPK_READ_INTERVAL = 1000;
+unsigned long MQTT_SENSOR_INTERVAL = 2000;
+unsigned long MQTT_RECONNECT_INTERVAL = 5000;
+unsigned long LCD_UPDATE_INTERVAL = 2000;
+unsigned long NPK_READ_INTERVAL = 1000;
 const int LCD_PAGES = 5;
+
+// ========== ADAPTIVE SAMPLING ==========
+// Per-sensor rates start at NPK_READ_INTERVAL / SENSOR_READ_INTERVAL and adapt
+// between the min and max below (SAMPLING_ADAPTIVE = false keeps fixed rates)
+bool SAMPLING_ADAPTIVE = true;
+unsigned long SOIL_SAMPLE_MIN = 500;            // ms, soil moisture while the pump runs
+unsigned long SOIL_SAMPLE_MAX = 300000;         // ms, soil moisture when flat
+unsigned long AMBIENT_SAMPLE_MAX = 300000;      // ms, DHT / MQ-135 / TDS when flat
+unsigned long SAMPLING_BUS_BUDGET = 20000;      // ms of RS485 traffic per window
+unsigned long SAMPLING_ENERGY_BUDGET = 30000;   // ms spent reading sensors per window
+const unsigned long SAMPLING_WINDOW = 60000;    // ms, budget accounting window
+const unsigned long SAMPLING_WATCH_INTERVAL = 5000;  // ms, soil cap while soaking
+const int SAMPLING_FLAT_COUNT = 3;              // Flat samples before the interval doubles
+
+// ========== POWER MANAGEMENT CONFIGURATION ==========
+const bool POWER_SAVE_ENABLED = true;
+const unsigned long POWER_MIN_SLEEP_MS = 20;      // Shorter idle gaps just delay()
+const unsigned long POWER_WAKE_GUARD_MS = 2;      // Wake this early before a deadline
+const unsigned long POWER_MAX_SLEEP_MS = 300;     // ~DTIM period, keeps WiFi/MQTT alive
+const unsigned long POWER_REPORT_WINDOW_MS = 60000;
+
+// ========== SAMPLE HISTORY ==========
+unsigned long STORE_INTERVAL = 60;                 // s between stored readings (aligned to the clock)
+const unsigned long STORE_FLUSH_INTERVAL = 3600;   // s, open blocks are written to flash at least this often
+
+// ========== PUMP STATE ==========
+const int PUMP_STATE_WRITES_PER_DAY = 48;          // NVS budget; RTC memory is updated on every change
+const int PUMP_STATE_WRITE_BURST = 6;              // Writes that may go out back to back (start + stop ...)
+const unsigned long PUMP_STATE_COMMIT_DELAY = 900; // s a change without a start/stop may wait for flash
+
+// ========== CONTROLLER TRACE ==========
+bool TRACE_ENABLED = false;                        // Record pump controller inputs for tools/replay
+
+// ========== STATISTICS ==========
+unsigned long STATS_WINDOW = 60;                   // s per published min/max/mean/stddev aggregate
+bool MQTT_RAW_SAMPLES = false;                     // Also publish every sensor snapshot (debugging)
+
+// ========== LOCAL RULES ==========
+// "[name:] <metric> <op> <value> [and|or ...] [for <s>] [hyst <x>] -> alert|pump_on [s]|pump_off"
+const char *RULES[RULE_SLOTS] = {"", "", "", "", "", ""};
+
+// ========== TIME ==========
+const char *NTP_SERVER = "pool.ntp.org";           // Samples and events are stamped in UTC once synced
+unsigned long TIME_SYNC_INTERVAL = 3600;           // s between SNTP polls; drift is corrected in between
+
+// ========== OTA UPDATES ==========
+const unsigned long OTA_HEALTH_TIMEOUT = 180000;  // ms after boot for new firmware to reach WiFi + MQTT
+const int OTA_MAX_BOOT_ATTEMPTS = 3;              // Reboots of an unconfirmed image before rolling back
+const unsigned long OTA_REBOOT_DELAY = 2000;      // ms, lets the HTTP/MQTT reply go out
+const unsigned long OTA_STALL_TIMEOUT = 30000;    // ms without data before an update is aborted
+const unsigned long OTA_PULL_SLICE_MS = 50;       // ms of download per loop pass
+const uint16_t OTA_HTTP_TIMEOUT = 10000;          // ms
+
+// ========== HEAP MONITORING ==========
+const unsigned long HEAP_SAMPLE_INTERVAL = 10000;  // ms
+const uint32_t HEAP_LOW_BLOCK = 8192;              // Warn when the largest free block drops below this
+
+// ========== CONFIG REGISTRY ==========
+const unsigned long CONFIG_COMMIT_DELAY = 5000;   // Coalesce NVS writes for 5 s after the last change
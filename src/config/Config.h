@@ -5,9 +5,9 @@
 
 // ========== PIN CONFIGURATION ==========
 #define DHT_PIN 4           // Temperature/humidity sensor pin (DHT11)
-#define DHT_TYPE DHT11      // DHT sensor type
-#define I2C_SDA 21          // I2C SDA pin for LCD (default ESP32)
-#define I2C_SCL 22          // I2C SCL pin for LCD (default ESP32)
+#define DHT_TYPE DHT_MODEL_11   // DHT_MODEL_11 or DHT_MODEL_22
+#define I2C_SDA 21          // I2C SDA pin, LCD and I2C sensors (default ESP32)
+#define I2C_SCL 22          // I2C SCL pin, LCD and I2C sensors (default ESP32)
 
 // RS485 NPK Sensor 7-in-1 pins
 #define RS485_RX 16         // RO (Receiver Output) from sensor to ESP32 RX2
@@ -23,13 +23,19 @@
 #define RELAY_PIN 27        // Relay pin for water pump (IN pin)
 #define RELAY_ACTIVE_LOW true // Set to true if relay module is active-low
 #define LED_STATUS_PIN 2    // Built-in ESP32 LED pin for status indicator
+#define POWER_WAKE_PIN MQ135_DO_PIN // GPIO that wakes the node from light sleep
+
+// Values declared without `const` below are runtime-tunable: they hold the
+// compile-time default until ConfigRegistry applies overrides from NVS,
+// MQTT or HTTP. Read them directly, they are plain RAM loads.
 
 // ========== MQTT CONFIGURATION ==========
 extern const char *MQTT_HOST;
-extern const int MQTT_PORT;
+extern int MQTT_PORT;
 extern const char *MQTT_USERNAME;
 extern const char *MQTT_PASSWORD;
 extern const char *MQTT_CLIENT_ID;
+extern const char *MQTT_TOPIC_PREFIX;
 
 // MQTT Topics
 extern const char *TOPIC_SENSORS;
@@ -37,13 +43,35 @@ extern const char *TOPIC_PUMP_COMMAND;
 extern const char *TOPIC_PUMP_STATUS;
 extern const char *TOPIC_SYSTEM_STATUS;
 extern const char *TOPIC_LOGS;
+extern const char *TOPIC_CONFIG_SET;
+extern const char *TOPIC_COMMAND;
+extern const char *TOPIC_COMMAND_RESPONSE;
+extern const char *TOPIC_PRESENCE;
+extern const char *TOPIC_STATS;
+extern const char *TOPIC_ALERTS;
+extern const unsigned long COMMAND_REBOOT_DELAY;
+extern unsigned long ACTUATION_SLO_MS;
+extern unsigned long COMMAND_MAX_AGE;
 
 // ========== SENSOR CONFIGURATION ==========
 // Irrigation thresholds
-extern const int MOISTURE_THRESHOLD;
-extern const int MOISTURE_STOP;
-extern const int MAX_PUMP_TIME;
-extern const int SENSOR_READ_INTERVAL;
+extern int MOISTURE_THRESHOLD;
+extern int MOISTURE_STOP;
+extern int MAX_PUMP_TIME;
+extern int SENSOR_READ_INTERVAL;
+
+// Pulse-and-soak irrigation (IRRIGATION_MODE 1)
+extern int IRRIGATION_MODE;
+extern int PULSE_MIN_TIME;
+extern int PULSE_MAX_TIME;
+extern int SOAK_MIN_TIME;
+extern int SOAK_MAX_TIME;
+extern const int PULSE_MAX_PER_CYCLE;
+extern const int MOISTURE_DEADBAND;
+extern const float PULSE_DEFAULT_GAIN;
+extern const float SOAK_DEFAULT_LAG;
+extern const unsigned long IRRIGATION_HISTORY_INTERVAL;
+extern const unsigned long OVERSHOOT_WINDOW;
 
 // RS485 NPK Sensor Configuration
 extern const byte NPK_SENSOR_ADDRESS;
@@ -60,25 +88,98 @@ extern const uint16_t PHOSPHORUS_REGISTER;
 extern const uint16_t POTASSIUM_REGISTER;
 
 // Safety configuration
-extern const unsigned long BOOT_SAFE_DELAY;
-extern const int REQUIRED_CONSECUTIVE_DRY;
+extern unsigned long BOOT_SAFE_DELAY;
+extern int REQUIRED_CONSECUTIVE_DRY;
+
+// Sensor health monitoring
+extern const unsigned long NPK_RESPONSE_TIMEOUT;
+extern const unsigned long NPK_PROBE_TIMEOUT;
+extern bool NPK_BLOCK_READ;
+extern const int HEALTH_FAIL_THRESHOLD;
+extern const unsigned long HEALTH_BACKOFF_BASE;
+extern const unsigned long HEALTH_BACKOFF_MAX;
+extern const unsigned long HEALTH_STUCK_TIME;
+extern const int HEALTH_STUCK_MIN_COUNT;
+extern const unsigned long HEALTH_STALE_AFTER;
+extern const unsigned long HEALTH_PUBLISH_INTERVAL;
 
 // ========== MQ-135 AIR QUALITY CONFIGURATION ==========
-extern const int MQ135_CLEAN_AIR_VALUE;
-extern const int MQ135_POLLUTED_THRESHOLD;
-extern const float MQ135_VOLTAGE_REF;
+extern int MQ135_CLEAN_AIR_VALUE;
+extern int MQ135_POLLUTED_THRESHOLD;
+extern float MQ135_VOLTAGE_REF;
 extern const float MQ135_ADC_MAX;
-extern const float MQ135_RL_VALUE;
-extern const float MQ135_RO_CLEAN_AIR;
+extern float MQ135_RL_VALUE;
+extern float MQ135_RO_CLEAN_AIR;
+
+// ========== ADC CALIBRATION ==========
+extern const uint32_t ADC_DEFAULT_VREF;
+extern const int ADC_RAW_MAX;
 
 // ========== TDS CONFIGURATION ==========
-extern const float TDS_K;
+extern float TDS_K;
 
 // ========== TIMING CONFIGURATION ==========
-extern const unsigned long MQTT_SENSOR_INTERVAL;
-extern const unsigned long MQTT_RECONNECT_INTERVAL;
-extern const unsigned long LCD_UPDATE_INTERVAL;
-extern const unsigned long NPK_READ_INTERVAL;
+extern unsigned long MQTT_SENSOR_INTERVAL;
+extern unsigned long MQTT_RECONNECT_INTERVAL;
+extern unsigned long LCD_UPDATE_INTERVAL;
+extern unsigned long NPK_READ_INTERVAL;
 extern const int LCD_PAGES;
 
+// ========== ADAPTIVE SAMPLING ==========
+extern bool SAMPLING_ADAPTIVE;
+extern unsigned long SOIL_SAMPLE_MIN;
+extern unsigned long SOIL_SAMPLE_MAX;
+extern unsigned long AMBIENT_SAMPLE_MAX;
+extern unsigned long SAMPLING_BUS_BUDGET;
+extern unsigned long SAMPLING_ENERGY_BUDGET;
+extern const unsigned long SAMPLING_WINDOW;
+extern const unsigned long SAMPLING_WATCH_INTERVAL;
+extern const int SAMPLING_FLAT_COUNT;
+
+// ========== POWER MANAGEMENT CONFIGURATION ==========
+extern const bool POWER_SAVE_ENABLED;
+extern const unsigned long POWER_MIN_SLEEP_MS;
+extern const unsigned long POWER_WAKE_GUARD_MS;
+extern const unsigned long POWER_MAX_SLEEP_MS;
+extern const unsigned long POWER_REPORT_WINDOW_MS;
+
+// ========== SAMPLE HISTORY ==========
+extern unsigned long STORE_INTERVAL;
+extern const unsigned long STORE_FLUSH_INTERVAL;
+
+// ========== PUMP STATE ==========
+extern const int PUMP_STATE_WRITES_PER_DAY;
+extern const int PUMP_STATE_WRITE_BURST;
+extern const unsigned long PUMP_STATE_COMMIT_DELAY;
+
+// ========== CONTROLLER TRACE ==========
+extern bool TRACE_ENABLED;
+
+// ========== STATISTICS ==========
+extern unsigned long STATS_WINDOW;
+extern bool MQTT_RAW_SAMPLES;
+
+// ========== LOCAL RULES ==========
+#define RULE_SLOTS 6        // One config key per rule (rule0..rule5)
+extern const char *RULES[RULE_SLOTS];
+
+// ========== TIME ==========
+extern const char *NTP_SERVER;
+extern unsigned long TIME_SYNC_INTERVAL;
+
+// ========== OTA UPDATES ==========
+extern const unsigned long OTA_HEALTH_TIMEOUT;
+extern const int OTA_MAX_BOOT_ATTEMPTS;
+extern const unsigned long OTA_REBOOT_DELAY;
+extern const unsigned long OTA_STALL_TIMEOUT;
+extern const unsigned long OTA_PULL_SLICE_MS;
+extern const uint16_t OTA_HTTP_TIMEOUT;
+
+// ========== HEAP MONITORING ==========
+extern const unsigned long HEAP_SAMPLE_INTERVAL;
+extern const uint32_t HEAP_LOW_BLOCK;
+
+// ========== CONFIG REGISTRY ==========
+extern const unsigned long CONFIG_COMMIT_DELAY;
+
 #endif // CONFIG_H
@@ -0,0 +1,369 @@
+#include "ConfigRegistry.h"
+
+// ========== REGISTRY TABLE ==========
+// Every entry points at the live global in Config.cpp, so hot-path code keeps
+// reading MOISTURE_THRESHOLD etc. directly and sees updates immediately.
+static ConfigEntry entries[] = {
+  // Irrigation
+  {"moisture_thr",  CONFIG_INT,    &MOISTURE_THRESHOLD,       0, 100,     CONFIG_GROUP_IRRIGATION, false},
+  {"moisture_stop", CONFIG_INT,    &MOISTURE_STOP,            0, 100,     CONFIG_GROUP_IRRIGATION, false},
+  {"max_pump_time", CONFIG_INT,    &MAX_PUMP_TIME,            1, 3600,    CONFIG_GROUP_IRRIGATION, false},
+  {"dry_count",     CONFIG_INT,    &REQUIRED_CONSECUTIVE_DRY, 1, 20,      CONFIG_GROUP_IRRIGATION, false},
+  {"boot_delay",    CONFIG_ULONG,  &BOOT_SAFE_DELAY,          0, 600000,  CONFIG_GROUP_IRRIGATION, false},
+  {"irr_mode",      CONFIG_INT,    &IRRIGATION_MODE,          0, 1,       CONFIG_GROUP_IRRIGATION, false},
+  {"pulse_min",     CONFIG_INT,    &PULSE_MIN_TIME,           1, 600,     CONFIG_GROUP_IRRIGATION, false},
+  {"pulse_max",     CONFIG_INT,    &PULSE_MAX_TIME,           1, 600,     CONFIG_GROUP_IRRIGATION, false},
+  {"soak_min",      CONFIG_INT,    &SOAK_MIN_TIME,            5, 3600,    CONFIG_GROUP_IRRIGATION, false},
+  {"soak_max",      CONFIG_INT,    &SOAK_MAX_TIME,            5, 7200,    CONFIG_GROUP_IRRIGATION, false},
+  {"trace",         CONFIG_BOOL,   &TRACE_ENABLED,            0, 1,       CONFIG_GROUP_IRRIGATION, false},
+
+  // Timing
+  {"sensor_intvl",  CONFIG_INT,    &SENSOR_READ_INTERVAL,     1, 3600,    CONFIG_GROUP_TIMING, false},
+  {"npk_intvl",     CONFIG_ULONG,  &NPK_READ_INTERVAL,        200, 3600000, CONFIG_GROUP_TIMING, false},
+  {"mqtt_intvl",    CONFIG_ULONG,  &MQTT_SENSOR_INTERVAL,     500, 3600000, CONFIG_GROUP_TIMING, false},
+  {"mqtt_reconn",   CONFIG_ULONG,  &MQTT_RECONNECT_INTERVAL,  1000, 600000, CONFIG_GROUP_TIMING, false},
+  {"lcd_intvl",     CONFIG_ULONG,  &LCD_UPDATE_INTERVAL,      500, 60000,   CONFIG_GROUP_TIMING, false},
+  {"samp_adapt",    CONFIG_BOOL,   &SAMPLING_ADAPTIVE,        0, 1,       CONFIG_GROUP_TIMING, false},
+  {"soil_min",      CONFIG_ULONG,  &SOIL_SAMPLE_MIN,          200, 60000,   CONFIG_GROUP_TIMING, false},
+  {"soil_max",      CONFIG_ULONG,  &SOIL_SAMPLE_MAX,          1000, 3600000, CONFIG_GROUP_TIMING, false},
+  {"amb_max",       CONFIG_ULONG,  &AMBIENT_SAMPLE_MAX,       2000, 3600000, CONFIG_GROUP_TIMING, false},
+  {"samp_bus",      CONFIG_ULONG,  &SAMPLING_BUS_BUDGET,      1000, 60000,   CONFIG_GROUP_TIMING, false},
+  {"samp_energy",   CONFIG_ULONG,  &SAMPLING_ENERGY_BUDGET,   1000, 60000,   CONFIG_GROUP_TIMING, false},
+  {"slo_ms",        CONFIG_ULONG,  &ACTUATION_SLO_MS,         10, 600000,  CONFIG_GROUP_TIMING, false},
+  {"cmd_max_age",   CONFIG_ULONG,  &COMMAND_MAX_AGE,          0, 3600000, CONFIG_GROUP_TIMING, false},
+  {"store_intvl",   CONFIG_ULONG,  &STORE_INTERVAL,           10, 3600,    CONFIG_GROUP_TIMING, false},
+  {"ntp_intvl",     CONFIG_ULONG,  &TIME_SYNC_INTERVAL,       15, 86400,   CONFIG_GROUP_TIMING, false},
+  {"stats_win",     CONFIG_ULONG,  &STATS_WINDOW,             10, 3600,    CONFIG_GROUP_TIMING, false},
+  {"mqtt_raw",      CONFIG_BOOL,   &MQTT_RAW_SAMPLES,         0, 1,       CONFIG_GROUP_TIMING, false},
+
+  // Sensors
+  {"npk_block",     CONFIG_BOOL,   &NPK_BLOCK_READ,           0, 1,       CONFIG_GROUP_SENSORS, false},
+  {"tds_k",         CONFIG_FLOAT,  &TDS_K,                    0, 5000,    CONFIG_GROUP_SENSORS, false},
+  {"mq_clean",      CONFIG_INT,    &MQ135_CLEAN_AIR_VALUE,    0, 4095,    CONFIG_GROUP_SENSORS, false},
+  {"mq_polluted",   CONFIG_INT,    &MQ135_POLLUTED_THRESHOLD, 0, 4095,    CONFIG_GROUP_SENSORS, false},
+  {"mq_vref",       CONFIG_FLOAT,  &MQ135_VOLTAGE_REF,        1, 5,       CONFIG_GROUP_SENSORS, false},
+  {"mq_rl",         CONFIG_FLOAT,  &MQ135_RL_VALUE,           0.1, 1000,  CONFIG_GROUP_SENSORS, false},
+  {"mq_ro",         CONFIG_FLOAT,  &MQ135_RO_CLEAN_AIR,       0.01, 1000, CONFIG_GROUP_SENSORS, false},
+
+  // MQTT (changes trigger a reconnect)
+  {"mqtt_host",     CONFIG_STRING, &MQTT_HOST,                0, 0,       CONFIG_GROUP_MQTT, false},
+  {"mqtt_port",     CONFIG_INT,    &MQTT_PORT,                1, 65535,   CONFIG_GROUP_MQTT, false},
+  {"mqtt_user",     CONFIG_STRING, &MQTT_USERNAME,            0, 0,       CONFIG_GROUP_MQTT, false},
+  {"mqtt_pass",     CONFIG_STRING, &MQTT_PASSWORD,            0, 0,       CONFIG_GROUP_MQTT, true},
+  {"mqtt_client",   CONFIG_STRING, &MQTT_CLIENT_ID,           0, 0,       CONFIG_GROUP_MQTT, false},
+  {"mqtt_prefix",   CONFIG_STRING, &MQTT_TOPIC_PREFIX,        0, 0,       CONFIG_GROUP_MQTT, false},
+  {"t_sensors",     CONFIG_STRING, &TOPIC_SENSORS,            0, 0,       CONFIG_GROUP_MQTT, false},
+  {"t_pump_cmd",    CONFIG_STRING, &TOPIC_PUMP_COMMAND,       0, 0,       CONFIG_GROUP_MQTT, false},
+  {"t_pump_status", CONFIG_STRING, &TOPIC_PUMP_STATUS,        0, 0,       CONFIG_GROUP_MQTT, false},
+  {"t_system",      CONFIG_STRING, &TOPIC_SYSTEM_STATUS,      0, 0,       CONFIG_GROUP_MQTT, false},
+  {"t_logs",        CONFIG_STRING, &TOPIC_LOGS,               0, 0,       CONFIG_GROUP_MQTT, false},
+  {"t_config",      CONFIG_STRING, &TOPIC_CONFIG_SET,         0, 0,       CONFIG_GROUP_MQTT, false},
+  {"t_command",     CONFIG_STRING, &TOPIC_COMMAND,            0, 0,       CONFIG_GROUP_MQTT, false},
+  {"t_cmd_resp",    CONFIG_STRING, &TOPIC_COMMAND_RESPONSE,   0, 0,       CONFIG_GROUP_MQTT, false},
+  {"t_status",      CONFIG_STRING, &TOPIC_PRESENCE,           0, 0,       CONFIG_GROUP_MQTT, false},
+  {"t_stats",       CONFIG_STRING, &TOPIC_STATS,              0, 0,       CONFIG_GROUP_MQTT, false},
+  {"t_alerts",      CONFIG_STRING, &TOPIC_ALERTS,             0, 0,       CONFIG_GROUP_MQTT, false},
+
+  // Local rules (recompiled on change)
+  {"rule0",         CONFIG_STRING, &RULES[0],                 0, 0,       CONFIG_GROUP_RULES, false},
+  {"rule1",         CONFIG_STRING, &RULES[1],                 0, 0,       CONFIG_GROUP_RULES, false},
+  {"rule2",         CONFIG_STRING, &RULES[2],                 0, 0,       CONFIG_GROUP_RULES, false},
+  {"rule3",         CONFIG_STRING, &RULES[3],                 0, 0,       CONFIG_GROUP_RULES, false},
+  {"rule4",         CONFIG_STRING, &RULES[4],                 0, 0,       CONFIG_GROUP_RULES, false},
+  {"rule5",         CONFIG_STRING, &RULES[5],                 0, 0,       CONFIG_GROUP_RULES, false},
+};
+
+static const int ENTRY_COUNT = sizeof(entries) / sizeof(entries[0]);
+static_assert(sizeof(entries) / sizeof(entries[0]) <= 64, "dirtyMask holds at most 64 entries");
+
+// Cross-field rules, checked once per update so a request can move both ends
+// of a pair together. high must exceed low (or equal it when !strict).
+struct ConfigRule {
+  const char *low;
+  const char *high;
+  bool strict;
+};
+
+static const ConfigRule rules[] = {
+  {"moisture_thr", "moisture_stop", true},   // Pump would stop before it starts
+  {"pulse_min",    "pulse_max",     false},
+  {"soak_min",     "soak_max",      false},
+};
+
+// Compile-time defaults captured in begin(), before NVS overrides
+union DefaultValue {
+  int i;
+  unsigned long ul;
+  float f;
+  bool b;
+  const char *s;
+};
+static DefaultValue defaults[ENTRY_COUNT];
+
+// Values before the update in progress, restored if a rule fails
+static DefaultValue previous[ENTRY_COUNT];
+
+// RAM storage for string values (the globals are repointed here on change)
+static char stringStorage[ENTRY_COUNT][CONFIG_STRING_MAX];
+
+static void captureValue(const ConfigEntry &e, DefaultValue &out) {
+  switch (e.type) {
+    case CONFIG_INT:    out.i = *(int *)e.value; break;
+    case CONFIG_ULONG:  out.ul = *(unsigned long *)e.value; break;
+    case CONFIG_FLOAT:  out.f = *(float *)e.value; break;
+    case CONFIG_BOOL:   out.b = *(bool *)e.value; break;
+    case CONFIG_STRING: out.s = *(const char **)e.value; break;
+  }
+}
+
+static void restoreValue(ConfigEntry &e, const DefaultValue &in) {
+  switch (e.type) {
+    case CONFIG_INT:    *(int *)e.value = in.i; break;
+    case CONFIG_ULONG:  *(unsigned long *)e.value = in.ul; break;
+    case CONFIG_FLOAT:  *(float *)e.value = in.f; break;
+    case CONFIG_BOOL:   *(bool *)e.value = in.b; break;
+    case CONFIG_STRING: *(const char **)e.value = in.s; break;
+  }
+}
+
+static float numericValue(const ConfigEntry &e) {
+  switch (e.type) {
+    case CONFIG_INT:   return *(int *)e.value;
+    case CONFIG_ULONG: return *(unsigned long *)e.value;
+    case CONFIG_FLOAT: return *(float *)e.value;
+    default:           return 0;
+  }
+}
+
+ConfigRegistry::ConfigRegistry()
+  : dirtyMask(0), stagedMask(0), lastChange(0), changeCallback(nullptr) {
+}
+
+void ConfigRegistry::begin() {
+  for (int i = 0; i < ENTRY_COUNT; i++) {
+    captureValue(entries[i], defaults[i]);
+  }
+
+  loadFromNVS();
+  Serial.printf("✅ Config registry initialized (%d entries)\n", ENTRY_COUNT);
+}
+
+void ConfigRegistry::loop() {
+  if (dirtyMask && millis() - lastChange >= CONFIG_COMMIT_DELAY) {
+    commit();
+  }
+}
+
+int ConfigRegistry::findEntry(const char *key) const {
+  for (int i = 0; i < ENTRY_COUNT; i++) {
+    if (strcmp(entries[i].key, key) == 0) return i;
+  }
+  return -1;
+}
+
+bool ConfigRegistry::applyValue(int index, const char *value) {
+  ConfigEntry &e = entries[index];
+  char *end = nullptr;
+
+  switch (e.type) {
+    case CONFIG_INT: {
+      long v = strtol(value, &end, 10);
+      if (end == value || *end != '\0' || v < e.minValue || v > e.maxValue) return false;
+      *(int *)e.value = (int)v;
+      break;
+    }
+    case CONFIG_ULONG: {
+      unsigned long v = strtoul(value, &end, 10);
+      if (end == value || *end != '\0' || v < e.minValue || v > e.maxValue) return false;
+      *(unsigned long *)e.value = v;
+      break;
+    }
+    case CONFIG_FLOAT: {
+      float v = strtof(value, &end);
+      if (end == value || *end != '\0' || isnan(v) || v < e.minValue || v > e.maxValue) return false;
+      *(float *)e.value = v;
+      break;
+    }
+    case CONFIG_BOOL:
+      if (strcmp(value, "1") == 0 || strcmp(value, "true") == 0) {
+        *(bool *)e.value = true;
+      } else if (strcmp(value, "0") == 0 || strcmp(value, "false") == 0) {
+        *(bool *)e.value = false;
+      } else {
+        return false;
+      }
+      break;
+    case CONFIG_STRING:
+      if (strlen(value) >= CONFIG_STRING_MAX) return false;
+      strcpy(stringStorage[index], value);
+      *(const char **)e.value = stringStorage[index];
+      break;
+  }
+  return true;
+}
+
+// Parses and applies one value, keeping the old one for finishUpdate()
+bool ConfigRegistry::stage(const char *key, const char *value) {
+  int index = findEntry(key);
+  if (index < 0) {
+    Serial.printf("❌ Config: rejected %s=%s\n", key, value);
+    return false;
+  }
+
+  DefaultValue old;
+  captureValue(entries[index], old);
+  if (!applyValue(index, value)) {
+    Serial.printf("❌ Config: rejected %s=%s\n", key, value);
+    return false;
+  }
+
+  // A key sent twice keeps the value from before the whole update
+  if (!(stagedMask & (1ULL << index))) previous[index] = old;
+  stagedMask |= (1ULL << index);
+  Serial.printf("⚙️  Config: %s=%s\n", key, entries[index].secret ? "***" : value);
+  return true;
+}
+
+// Checks the rules against the staged values. The staged keys of a failed
+// rule are rolled back; the rest are marked for the NVS commit. Returns the
+// number of keys rolled back.
+int ConfigRegistry::finishUpdate() {
+  uint64_t rejectedMask = 0;
+
+  for (const ConfigRule &rule : rules) {
+    int low = findEntry(rule.low);
+    int high = findEntry(rule.high);
+    uint64_t pair = (1ULL << low) | (1ULL << high);
+    if (!(stagedMask & pair)) continue;
+
+    float lowValue = numericValue(entries[low]);
+    float highValue = numericValue(entries[high]);
+    if (highValue > lowValue || (!rule.strict && highValue == lowValue)) continue;
+
+    Serial.printf("❌ Config: rejected, %s must be %s %s\n", rule.high, rule.strict ? ">" : ">=", rule.low);
+    rejectedMask |= stagedMask & pair;
+  }
+
+  uint8_t groups = 0;
+  for (int i = 0; i < ENTRY_COUNT; i++) {
+    uint64_t bit = 1ULL << i;
+    if (!(stagedMask & bit)) continue;
+    if (rejectedMask & bit) {
+      restoreValue(entries[i], previous[i]);
+    } else {
+      dirtyMask |= bit;
+      groups |= entries[i].group;
+    }
+  }
+  stagedMask = 0;
+
+  if (groups) {
+    lastChange = millis();
+    if (changeCallback) changeCallback(groups);
+  }
+  return __builtin_popcountll(rejectedMask);
+}
+
+bool ConfigRegistry::set(const char *key, const char *value) {
+  bool staged = stage(key, value);
+  return finishUpdate() == 0 && staged;
+}
+
+bool ConfigRegistry::reset(const char *key) {
+  int index = findEntry(key);
+  if (index < 0) return false;
+
+  // The default goes through the same rule check as any other update
+  ConfigEntry &e = entries[index];
+  captureValue(e, previous[index]);
+  restoreValue(e, defaults[index]);
+  stagedMask |= (1ULL << index);
+  if (finishUpdate() > 0) return false;
+
+  // Removal is cheap and immediate; drop the pending write finishUpdate() queued
+  preferences.begin("config", false);
+  preferences.remove(e.key);
+  preferences.end();
+  dirtyMask &= ~(1ULL << index);
+
+  Serial.printf("⚙️  Config: %s reset to default\n", key);
+  return true;
+}
+
+int ConfigRegistry::applyJson(JsonVariant updates) {
+  int applied = 0;
+  char value[CONFIG_STRING_MAX];
+
+  for (JsonPair kv : updates.as<JsonObject>()) {
+    if (kv.value().is<const char *>()) {
+      strncpy(value, kv.value().as<const char *>(), sizeof(value) - 1);
+      value[sizeof(value) - 1] = '\0';
+    } else {
+      serializeJson(kv.value(), value, sizeof(value));
+    }
+    if (stage(kv.key().c_str(), value)) applied++;
+  }
+  return applied - finishUpdate();
+}
+
+void ConfigRegistry::toJson(JsonDocument &doc) const {
+  for (int i = 0; i < ENTRY_COUNT; i++) {
+    const ConfigEntry &e = entries[i];
+    switch (e.type) {
+      case CONFIG_INT:    doc[e.key] = *(int *)e.value; break;
+      case CONFIG_ULONG:  doc[e.key] = *(unsigned long *)e.value; break;
+      case CONFIG_FLOAT:  doc[e.key] = *(float *)e.value; break;
+      case CONFIG_BOOL:   doc[e.key] = *(bool *)e.value; break;
+      case CONFIG_STRING: doc[e.key] = e.secret ? "***" : *(const char **)e.value; break;
+    }
+  }
+}
+
+void ConfigRegistry::loadFromNVS() {
+  int loaded = 0;
+  char value[CONFIG_STRING_MAX];
+
+  preferences.begin("config", true);
+  for (int i = 0; i < ENTRY_COUNT; i++) {
+    ConfigEntry &e = entries[i];
+    if (!preferences.isKey(e.key)) continue;
+
+    switch (e.type) {
+      case CONFIG_INT:   *(int *)e.value = preferences.getInt(e.key, defaults[i].i); break;
+      case CONFIG_ULONG: *(unsigned long *)e.value = preferences.getUInt(e.key, defaults[i].ul); break;
+      case CONFIG_FLOAT: *(float *)e.value = preferences.getFloat(e.key, defaults[i].f); break;
+      case CONFIG_BOOL:  *(bool *)e.value = preferences.getBool(e.key, defaults[i].b); break;
+      case CONFIG_STRING:
+        if (preferences.getString(e.key, value, sizeof(value)) > 0) {
+          applyValue(i, value);
+        }
+        break;
+    }
+    loaded++;
+  }
+  preferences.end();
+
+  if (loaded > 0) {
+    Serial.printf("📥 Config: %d override(s) loaded from flash\n", loaded);
+  }
+}
+
+void ConfigRegistry::commit() {
+  preferences.begin("config", false);
+  for (int i = 0; i < ENTRY_COUNT; i++) {
+    if (!(dirtyMask & (1ULL << i))) continue;
+
+    ConfigEntry &e = entries[i];
+    switch (e.type) {
+      case CONFIG_INT:    preferences.putInt(e.key, *(int *)e.value); break;
+      case CONFIG_ULONG:  preferences.putUInt(e.key, *(unsigned long *)e.value); break;
+      case CONFIG_FLOAT:  preferences.putFloat(e.key, *(float *)e.value); break;
+      case CONFIG_BOOL:   preferences.putBool(e.key, *(bool *)e.value); break;
+      case CONFIG_STRING: preferences.putString(e.key, *(const char **)e.value); break;
+    }
+  }
+  preferences.end();
+
+  Serial.printf("💾 Config: committed %d change(s) to flash\n", __builtin_popcountll(dirtyMask));
+  dirtyMask = 0;
+}
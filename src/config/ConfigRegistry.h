@@ -0,0 +1,76 @@
+#ifndef CONFIG_REGISTRY_H
+#define CONFIG_REGISTRY_H
+
+#include <Arduino.h>
+#include <Preferences.h>
+#include <ArduinoJson.h>
+#include "config/Config.h"
+
+#define CONFIG_STRING_MAX 64
+
+// Change notification groups (bitmask passed to the change callback)
+#define CONFIG_GROUP_IRRIGATION 0x01
+#define CONFIG_GROUP_SENSORS    0x02
+#define CONFIG_GROUP_TIMING     0x04
+#define CONFIG_GROUP_MQTT       0x08
+#define CONFIG_GROUP_RULES      0x10
+
+enum ConfigType {
+  CONFIG_INT,
+  CONFIG_ULONG,
+  CONFIG_FLOAT,
+  CONFIG_BOOL,
+  CONFIG_STRING
+};
+
+// One tunable value. `value` points at the live global from Config.cpp
+// (for strings: at the `const char *` that is repointed to registry storage).
+struct ConfigEntry {
+  const char *key;   // API name and NVS key (max 15 chars)
+  ConfigType type;
+  void *value;
+  float minValue;    // Range check for numeric types
+  float maxValue;
+  uint8_t group;
+  bool secret;       // Masked in JSON output
+};
+
+class ConfigRegistry {
+public:
+  typedef void (*ChangeCallback)(uint8_t groups);
+
+private:
+  Preferences preferences;
+  uint64_t dirtyMask;
+  uint64_t stagedMask;     // Applied by the update in progress, not yet checked
+  unsigned long lastChange;
+  ChangeCallback changeCallback;
+
+  int findEntry(const char *key) const;
+  bool applyValue(int index, const char *value);
+  bool stage(const char *key, const char *value);
+  int finishUpdate();
+  void loadFromNVS();
+  void commit();
+
+public:
+  ConfigRegistry();
+
+  void begin();
+  void loop();
+
+  // Updates are validated, applied live and persisted after CONFIG_COMMIT_DELAY.
+  // applyJson() checks cross-field rules (e.g. moisture_stop > moisture_thr)
+  // after all keys, so related keys can change together; returns keys kept.
+  bool set(const char *key, const char *value);
+  bool reset(const char *key);      // false for unknown keys and for defaults that break a rule
+  bool hasKey(const char *key) const { return findEntry(key) >= 0; }
+  int applyJson(JsonVariant updates);
+
+  void toJson(JsonDocument &doc) const;
+  void setChangeCallback(ChangeCallback callback) { changeCallback = callback; }
+
+  bool hasPendingWrites() const { return dirtyMask != 0; }
+};
+
+#endif // CONFIG_REGISTRY_H
@@ -0,0 +1,95 @@
+#include "ActuationTracker.h"
+#include "controllers/PumpController.h"
+#include "system/TimeService.h"
+
+static const char *const stageNames[STAGE_COUNT] = {"transit", "dispatch", "actuate", "total", "ack"};
+
+ActuationTracker::ActuationTracker() : commands(0), sloMisses(0), expired(0) {
+}
+
+int64_t ActuationTracker::wallClockMs() {
+  // 0 until SNTP has synced
+  return TimeService::stamp().utcMs;
+}
+
+const char *ActuationTracker::getStageName(uint8_t stage) {
+  return stage < STAGE_COUNT ? stageNames[stage] : "";
+}
+
+void ActuationTracker::begin(ActuationTrace &trace, int64_t senderMs) {
+  memset(&trace, 0, sizeof(trace));
+  trace.rxUs = micros();
+  trace.rxMs = wallClockMs();
+  trace.transitUs = -1;
+
+  // Clocks within a few ms of each other; a sender slightly ahead reads as 0
+  if (senderMs > 0 && trace.rxMs > 0) {
+    int64_t transitMs = trace.rxMs - senderMs;
+    trace.transitUs = (int32_t)constrain(transitMs, (int64_t)0, (int64_t)INT32_MAX / 1000) * 1000;
+  }
+}
+
+bool ActuationTracker::isExpired(const ActuationTrace &trace) {
+  if (COMMAND_MAX_AGE == 0 || trace.transitUs < 0) return false;
+  if ((uint32_t)trace.transitUs / 1000 <= COMMAND_MAX_AGE) return false;
+
+  expired++;
+  stages[STAGE_TRANSIT].record(trace.transitUs);
+  return true;
+}
+
+void ActuationTracker::complete(ActuationTrace &trace, const PumpController &pump) {
+  uint32_t entryUs = pump.getLastCallUs();
+  trace.switched = pump.didLastCallSwitch();
+  trace.edgeUs = trace.switched ? pump.getLastEdgeUs() : entryUs;
+  trace.dispatchUs = entryUs - trace.rxUs;
+  trace.actuateUs = trace.edgeUs - entryUs;
+  trace.totalUs = trace.edgeUs - trace.rxUs;
+  if (trace.transitUs > 0) trace.totalUs += trace.transitUs;
+  trace.withinSlo = trace.totalUs <= ACTUATION_SLO_MS * 1000UL;
+
+  commands++;
+  if (trace.transitUs >= 0) stages[STAGE_TRANSIT].record(trace.transitUs);
+  stages[STAGE_DISPATCH].record(trace.dispatchUs);
+  if (trace.switched) stages[STAGE_ACTUATE].record(trace.actuateUs);
+  stages[STAGE_TOTAL].record(trace.totalUs);
+
+  if (!trace.withinSlo) {
+    sloMisses++;
+    Serial.printf("⚠️  Pump command took %lu ms (SLO %lu ms, transit %ld ms)\n",
+                  (unsigned long)(trace.totalUs / 1000), ACTUATION_SLO_MS,
+                  trace.transitUs >= 0 ? (long)(trace.transitUs / 1000) : -1L);
+  }
+}
+
+void ActuationTracker::acknowledged(const ActuationTrace &trace) {
+  stages[STAGE_ACK].record(micros() - trace.edgeUs);
+}
+
+int ActuationTracker::formatAck(char *buffer, size_t size, const ActuationTrace &trace) {
+  char transit[32] = "";
+  if (trace.transitUs >= 0) snprintf(transit, sizeof(transit), "\"transit\":%ld,", (long)trace.transitUs);
+
+  return snprintf(buffer, size,
+                  ",\"rx\":%lld,\"lat\":{%s\"dispatch\":%u,\"actuate\":%u,\"total\":%u,\"ack\":%u},"
+                  "\"edge\":%s,\"slo\":%s",
+                  (long long)trace.rxMs, transit, trace.dispatchUs, trace.actuateUs, trace.totalUs,
+                  (uint32_t)(micros() - trace.edgeUs), trace.switched ? "true" : "false",
+                  trace.withinSlo ? "true" : "false");
+}
+
+void ActuationTracker::summaryJson(JsonVariant obj) const {
+  obj["commands"] = commands;
+  obj["sloMs"] = ACTUATION_SLO_MS;
+  obj["sloMisses"] = sloMisses;
+  obj["sloMet"] = commands ? 1.0f - (float)sloMisses / commands : 1.0f;
+  obj["expired"] = expired;
+  obj["p99"] = stages[STAGE_TOTAL].percentile(0.99f);
+}
+
+void ActuationTracker::toJson(JsonVariant obj) const {
+  summaryJson(obj);
+  for (uint8_t i = 0; i < STAGE_COUNT; i++) {
+    stages[i].toJson(obj[stageNames[i]]);
+  }
+}
@@ -0,0 +1,73 @@
+#ifndef ACTUATION_TRACKER_H
+#define ACTUATION_TRACKER_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "config/Config.h"
+#include "system/LatencyHistogram.h"
+
+class PumpController;
+
+enum ActuationStage {
+  STAGE_TRANSIT,      // Sender timestamp -> received (needs a synced clock)
+  STAGE_DISPATCH,     // Received -> PumpController entry
+  STAGE_ACTUATE,      // PumpController entry -> relay edge
+  STAGE_TOTAL,        // Sender (or receive) -> relay edge: what the SLO applies to
+  STAGE_ACK,          // Relay edge -> acknowledgement published
+  STAGE_COUNT
+};
+
+// Timestamps of one pump command, carried from receipt to its ack
+struct ActuationTrace {
+  uint32_t rxUs;          // micros() on receipt
+  int64_t rxMs;           // Wall clock on receipt, 0 if not synced
+  int32_t transitUs;      // -1 when the sender gave no timestamp
+  uint32_t dispatchUs;
+  uint32_t actuateUs;
+  uint32_t totalUs;
+  uint32_t edgeUs;        // micros() of the relay edge (or entry if already there)
+  bool switched;          // Relay actually changed state
+  bool withinSlo;
+};
+
+// Per-stage latency histograms for pump commands from any source
+// (MQTT JSON, legacy ON/OFF, HTTP) and the ACTUATION_SLO_MS budget.
+class ActuationTracker {
+private:
+  LatencyHistogram stages[STAGE_COUNT];
+  uint32_t commands;
+  uint32_t sloMisses;
+  uint32_t expired;
+
+public:
+  ActuationTracker();
+
+  // On receipt; senderMs is the command's wall-clock timestamp (ms), 0 if none
+  void begin(ActuationTrace &trace, int64_t senderMs);
+
+  // Older than COMMAND_MAX_AGE in transit: refuse rather than actuate late
+  bool isExpired(const ActuationTrace &trace);
+
+  // After the PumpController call: stage latencies and the SLO verdict
+  void complete(ActuationTrace &trace, const PumpController &pump);
+
+  // When the acknowledgement goes out
+  void acknowledged(const ActuationTrace &trace);
+
+  // Appends "lat" and "slo" fields to an ack JSON object under construction
+  static int formatAck(char *buffer, size_t size, const ActuationTrace &trace);
+
+  static int64_t wallClockMs();
+  static const char *getStageName(uint8_t stage);
+
+  // Getters
+  const LatencyHistogram &getStage(ActuationStage stage) const { return stages[stage]; }
+  uint32_t getCommands() const { return commands; }
+  uint32_t getSloMisses() const { return sloMisses; }
+  uint32_t getExpired() const { return expired; }
+
+  void toJson(JsonVariant obj) const;
+  void summaryJson(JsonVariant obj) const;    // SLO figures only, for size-limited MQTT payloads
+};
+
+#endif // ACTUATION_TRACKER_H
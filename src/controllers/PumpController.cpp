@@ -1,9 +1,20 @@
 #include "PumpController.h"
 
-PumpController::PumpController(uint8_t pin, bool activeLow) 
-  : relayPin(pin), activeLow(activeLow), isActive(false), 
-    startTime(0), totalWateringTime(0), wateringCount(0), 
-    consecutiveDryCount(0) {
+PumpController::PumpController(uint8_t pin, bool activeLow)
+  : relayPin(pin), activeLow(activeLow), isActive(false),
+    startTime(0), runLimit(0), totalWateringTime(0), wateringCount(0),
+    consecutiveDryCount(0),
+    historyHead(0), historyCount(0), lastHistory(0),
+    phase(PHASE_IDLE), phaseStart(0), pulseDuration(0), soakDuration(0),
+    pulseMoisture(0), soakPeak(0), soakPeakTime(0), pulsesInCycle(0),
+    dryingRate(0), pulseGain(PULSE_DEFAULT_GAIN), infiltrationLag(SOAK_DEFAULT_LAG),
+    trackingOvershoot(false), overshootStart(0), overshootPeak(0),
+    lastOvershoot(0), avgOvershoot(-1),
+    currentHour(0), lastCallUs(0), lastEdgeUs(0), lastCallSwitched(false),
+    lastStarted{0, TIME_UNSYNCED}, lastStopped{0, TIME_UNSYNCED},
+    tracer(nullptr), callDepth(0) {
+  memset(onSecondsByHour, 0, sizeof(onSecondsByHour));
+  memset(cyclesByHour, 0, sizeof(cyclesByHour));
 }
 
 void PumpController::begin() {
@@ -13,52 +24,150 @@ void PumpController::begin() {
   Serial.println("✅ Pump Controller initialized");
 }
 
+PumpController::Call::Call(PumpController &c, uint8_t call, int32_t arg) : controller(c) {
+  if (controller.callDepth++ == 0 && controller.tracer) controller.tracer->onCall(call, arg);
+}
+
+PumpController::Call::~Call() {
+  if (--controller.callDepth == 0 && controller.tracer) controller.tracer->onReturn();
+}
+
+void PumpController::restoreCounters(int count, unsigned long totalSeconds, int dryCount) {
+  wateringCount = count;
+  totalWateringTime = totalSeconds;
+  consecutiveDryCount = dryCount;
+}
+
+void PumpController::setConsecutiveDryCount(int count) {
+  Call call(*this, PUMP_CALL_DRY_COUNT, count);
+  consecutiveDryCount = count;
+}
+
 void PumpController::start() {
+  Call call(*this, PUMP_CALL_START, 0);
+  lastCallUs = micros();
+  lastCallSwitched = !isActive;
   if (!isActive) {
     digitalWrite(relayPin, activeLow ? LOW : HIGH);
+    lastEdgeUs = micros();
+    if (tracer) tracer->onEdge(true);
+    lastStarted = TimeService::stamp();
     isActive = true;
     startTime = millis();
-    wateringCount++;
+    // Later pulses of a pulse-and-soak cycle continue the same watering
+    if (phase != PHASE_PULSE || pulsesInCycle <= 1) {
+      wateringCount++;
+    }
     consecutiveDryCount = 0;
+
+    rollHour();
+    cyclesByHour[currentHour % 24]++;
+
+    // Watering breaks the drying trend, and ends any overshoot observation
+    historyCount = 0;
+    if (trackingOvershoot) {
+      finishOvershoot();
+    }
+
     Serial.printf("💧 Pump STARTED (count: %d)\n", wateringCount);
   }
 }
 
+void PumpController::startFor(unsigned long seconds) {
+  Call call(*this, PUMP_CALL_START_FOR, (int32_t)seconds);
+  // Also shortens or extends a run that is already in progress
+  runLimit = min(seconds, (unsigned long)MAX_PUMP_TIME) * 1000UL;
+  start();
+}
+
 void PumpController::stop() {
+  Call call(*this, PUMP_CALL_STOP, 0);
+  lastCallUs = micros();
+  lastCallSwitched = isActive;
+  runLimit = 0;
   if (isActive) {
     digitalWrite(relayPin, activeLow ? HIGH : LOW);
+    lastEdgeUs = micros();
+    if (tracer) tracer->onEdge(false);
+    lastStopped = TimeService::stamp();
     unsigned long runtime = millis() - startTime;
     totalWateringTime += runtime / 1000;
     isActive = false;
-    Serial.printf("💧 Pump STOPPED (ran for %lu seconds, total: %lu seconds)\n", 
+
+    rollHour();
+    onSecondsByHour[currentHour % 24] += runtime / 1000;
+
+    // Pulses are followed by a soak; only a finished run starts overshoot tracking
+    if (phase == PHASE_IDLE) {
+      trackingOvershoot = true;
+      overshootStart = millis();
+      overshootPeak = 0;
+    }
+
+    Serial.printf("💧 Pump STOPPED (ran for %lu seconds, total: %lu seconds)\n",
                   runtime / 1000, totalWateringTime);
   }
 }
 
 void PumpController::checkSafety() {
+  Call call(*this, PUMP_CALL_SAFETY, 0);
+  if (!isActive) return;
+
+  // Pulse finished: ends here too, as autoIrrigate() is not called while
+  // soil data is stale; the soak starts with the next fresh reading
+  if (phase == PHASE_PULSE && millis() - phaseStart >= pulseDuration) {
+    stop();
+    Serial.println("💧 Pulse finished");
+    return;
+  }
+
+  // Timed run finished
+  if (runLimit > 0 && (millis() - startTime) >= runLimit) {
+    stop();
+    Serial.println("💧 Pump stopped (timed run finished)");
+    return;
+  }
+
   // Safety: stop pump if running too long
-  if (isActive && (millis() - startTime) >= (MAX_PUMP_TIME * 1000UL)) {
+  if ((millis() - startTime) >= (MAX_PUMP_TIME * 1000UL)) {
     stop();
     Serial.println("⚠️  Pump auto-stopped (max time reached)");
   }
 }
 
 void PumpController::autoIrrigate(int soilMoisture) {
-  // Safety: do not auto-start immediately after boot
-  if (millis() < BOOT_SAFE_DELAY) {
+  Call call(*this, PUMP_CALL_AUTO, soilMoisture);
+  recordSample(soilMoisture);
+  trackOvershoot(soilMoisture);
+
+  // Safety: do not auto-start immediately after boot (limits still apply)
+  if (TimeService::monoMs() < BOOT_SAFE_DELAY) {
+    checkSafety();
     if (soilMoisture <= MOISTURE_THRESHOLD) {
       Serial.println("⏳ Boot delay active, auto-irrigation pending...");
     }
     return;
   }
 
+  if (IRRIGATION_MODE == MODE_PULSE_SOAK) {
+    pulseSoakStep(soilMoisture);
+  } else {
+    phase = PHASE_IDLE;
+    bangBangStep(soilMoisture);
+  }
+
+  // Check safety limits
+  checkSafety();
+}
+
+void PumpController::bangBangStep(int soilMoisture) {
   // Start watering if moisture is low
   if (!isActive && soilMoisture <= MOISTURE_THRESHOLD) {
     consecutiveDryCount++;
     if (consecutiveDryCount >= REQUIRED_CONSECUTIVE_DRY) {
       start();
     } else {
-      Serial.printf("⏳ Waiting for %d more dry readings before starting pump\n", 
+      Serial.printf("⏳ Waiting for %d more dry readings before starting pump\n",
                     REQUIRED_CONSECUTIVE_DRY - consecutiveDryCount);
     }
   }
@@ -67,7 +176,252 @@ void PumpController::autoIrrigate(int soilMoisture) {
   if (isActive && soilMoisture >= MOISTURE_STOP) {
     stop();
   }
+}
 
-  // Check safety limits
-  checkSafety();
+// ========== PULSE-AND-SOAK ==========
+
+void PumpController::pulseSoakStep(int soilMoisture) {
+  unsigned long now = millis();
+
+  switch (phase) {
+    case PHASE_IDLE:
+      if (!isActive && soilMoisture <= MOISTURE_THRESHOLD) {
+        consecutiveDryCount++;
+        if (consecutiveDryCount >= REQUIRED_CONSECUTIVE_DRY) {
+          pulsesInCycle = 0;
+          beginPulse(soilMoisture);
+        } else {
+          Serial.printf("⏳ Waiting for %d more dry readings before starting pump\n",
+                        REQUIRED_CONSECUTIVE_DRY - consecutiveDryCount);
+        }
+      }
+      // Manual runs keep the bang-bang stop rule
+      if (isActive && soilMoisture >= MOISTURE_STOP) {
+        stop();
+      }
+      break;
+
+    case PHASE_PULSE:
+      // Pulse finished, cut short by the safety limit / manual stop, or target reached
+      if (!isActive || now - phaseStart >= pulseDuration || soilMoisture >= MOISTURE_STOP) {
+        pulseDuration = min(pulseDuration, now - phaseStart);
+        stop();
+        phase = PHASE_SOAK;
+        phaseStart = now;
+        soakPeak = soilMoisture;
+        soakPeakTime = now;
+        Serial.printf("🌊 Soaking for %lus after pulse %d\n", soakDuration / 1000, pulsesInCycle);
+      }
+      break;
+
+    case PHASE_SOAK:
+      if (soilMoisture > soakPeak) {
+        soakPeak = soilMoisture;
+        soakPeakTime = now;
+      }
+
+      // A manual start during the soak takes over
+      if (isActive) {
+        phase = PHASE_IDLE;
+        break;
+      }
+
+      if (now - phaseStart >= soakDuration) {
+        learnFromSoak();
+
+        if (soilMoisture >= MOISTURE_STOP - MOISTURE_DEADBAND || pulsesInCycle >= PULSE_MAX_PER_CYCLE) {
+          Serial.printf("✅ Pulse-and-soak cycle done: %d%% after %d pulse(s)\n",
+                        soilMoisture, pulsesInCycle);
+          phase = PHASE_IDLE;
+          trackingOvershoot = true;
+          overshootStart = now;
+          overshootPeak = soilMoisture;
+        } else {
+          beginPulse(soilMoisture);
+        }
+      }
+      break;
+  }
+}
+
+void PumpController::beginPulse(int soilMoisture) {
+  // Soak long enough for the probe to see the water arrive
+  float soakSeconds = constrain(infiltrationLag * 1.5f, (float)SOAK_MIN_TIME, (float)SOAK_MAX_TIME);
+  soakDuration = (unsigned long)(soakSeconds * 1000);
+
+  // Cover the current deficit plus what the soil loses during that soak
+  float deficit = (MOISTURE_STOP - soilMoisture) + dryingRate * soakSeconds / 3600.0f;
+  float pulseSeconds = deficit / pulseGain;
+  pulseSeconds = constrain(pulseSeconds, (float)PULSE_MIN_TIME, (float)min(PULSE_MAX_TIME, MAX_PUMP_TIME));
+  pulseDuration = (unsigned long)(pulseSeconds * 1000);
+
+  pulseMoisture = soilMoisture;
+  pulsesInCycle++;
+  phase = PHASE_PULSE;
+  phaseStart = millis();
+
+  Serial.printf("💧 Pulse %d: %.1fs for %.1f%% deficit (gain %.2f%%/s, lag %.0fs)\n",
+                pulsesInCycle, pulseSeconds, deficit, pulseGain, infiltrationLag);
+  start();
+}
+
+void PumpController::learnFromSoak() {
+  float rise = soakPeak - pulseMoisture;
+  float pulseSeconds = pulseDuration / 1000.0f;
+  if (pulseSeconds <= 0 || rise <= 0) return;
+
+  pulseGain = pulseGain * 0.7f + (rise / pulseSeconds) * 0.3f;
+  infiltrationLag = infiltrationLag * 0.7f + ((soakPeakTime - phaseStart) / 1000.0f) * 0.3f;
+}
+
+// ========== HISTORY & METRICS ==========
+
+void PumpController::recordSample(int soilMoisture) {
+  rollHour();
+
+  // Only idle periods describe how fast the soil dries
+  if (isActive || phase != PHASE_IDLE || trackingOvershoot) return;
+  if (millis() - lastHistory < IRRIGATION_HISTORY_INTERVAL) return;
+  lastHistory = millis();
+
+  history[historyHead].time = TimeService::monoMs() / 1000;
+  history[historyHead].moisture = soilMoisture;
+  historyHead = (historyHead + 1) % IRRIGATION_HISTORY_SIZE;
+  if (historyCount < IRRIGATION_HISTORY_SIZE) historyCount++;
+
+  updateDryingRate();
+}
+
+void PumpController::updateDryingRate() {
+  if (historyCount < 4) return;
+
+  // Least-squares slope of moisture over time
+  uint8_t oldest = (historyHead + IRRIGATION_HISTORY_SIZE - historyCount) % IRRIGATION_HISTORY_SIZE;
+  uint32_t t0 = history[oldest].time;
+  float sumT = 0, sumM = 0, sumTT = 0, sumTM = 0;
+  for (uint8_t i = 0; i < historyCount; i++) {
+    const HistoryPoint &p = history[(oldest + i) % IRRIGATION_HISTORY_SIZE];
+    float t = p.time - t0;
+    sumT += t;
+    sumM += p.moisture;
+    sumTT += t * t;
+    sumTM += t * p.moisture;
+  }
+  float denom = historyCount * sumTT - sumT * sumT;
+  if (denom <= 0) return;
+
+  float slope = (historyCount * sumTM - sumT * sumM) / denom;   // %/s
+  dryingRate = max(0.0f, -slope * 3600.0f);
+}
+
+void PumpController::trackOvershoot(int soilMoisture) {
+  if (!trackingOvershoot) return;
+
+  if (soilMoisture > overshootPeak) overshootPeak = soilMoisture;
+  if (millis() - overshootStart >= OVERSHOOT_WINDOW) {
+    finishOvershoot();
+  }
+}
+
+void PumpController::finishOvershoot() {
+  trackingOvershoot = false;
+  lastOvershoot = max(0, overshootPeak - MOISTURE_STOP);
+  avgOvershoot = avgOvershoot < 0 ? lastOvershoot : avgOvershoot * 0.8f + lastOvershoot * 0.2f;
+  Serial.printf("📈 Irrigation overshoot: %d%% (avg %.1f%%)\n", lastOvershoot, avgOvershoot);
+}
+
+void PumpController::rollHour() {
+  uint32_t hour = TimeService::monoMs() / 3600000UL;
+  for (uint8_t i = 0; currentHour < hour && i < 24; i++) {
+    currentHour++;
+    onSecondsByHour[currentHour % 24] = 0;
+    cyclesByHour[currentHour % 24] = 0;
+  }
+  currentHour = hour;
+}
+
+uint32_t PumpController::getOnTimeLast24h() const {
+  uint32_t total = 0;
+  for (uint8_t i = 0; i < 24; i++) total += onSecondsByHour[i];
+  return total;
+}
+
+uint32_t PumpController::getRelayCyclesLast24h() const {
+  uint32_t total = 0;
+  for (uint8_t i = 0; i < 24; i++) total += cyclesByHour[i];
+  return total;
+}
+
+// ========== RECORD / REPLAY ==========
+
+void PumpController::saveState(PumpSnapshot &state) const {
+  memset(&state, 0, sizeof(state));
+  state.startTime = startTime;
+  state.runLimit = runLimit;
+  state.totalWateringTime = totalWateringTime;
+  state.lastHistory = lastHistory;
+  state.phaseStart = phaseStart;
+  state.pulseDuration = pulseDuration;
+  state.soakDuration = soakDuration;
+  state.soakPeakTime = soakPeakTime;
+  state.overshootStart = overshootStart;
+  state.currentHour = currentHour;
+  for (uint8_t i = 0; i < IRRIGATION_HISTORY_SIZE; i++) {
+    state.historyTime[i] = history[i].time;
+    state.historyMoisture[i] = history[i].moisture;
+  }
+  state.wateringCount = wateringCount;
+  state.consecutiveDryCount = consecutiveDryCount;
+  state.pulseMoisture = pulseMoisture;
+  state.soakPeak = soakPeak;
+  state.pulsesInCycle = pulsesInCycle;
+  state.overshootPeak = overshootPeak;
+  state.lastOvershoot = lastOvershoot;
+  state.dryingRate = dryingRate;
+  state.pulseGain = pulseGain;
+  state.infiltrationLag = infiltrationLag;
+  state.avgOvershoot = avgOvershoot;
+  memcpy(state.onSecondsByHour, onSecondsByHour, sizeof(onSecondsByHour));
+  memcpy(state.cyclesByHour, cyclesByHour, sizeof(cyclesByHour));
+  state.isActive = isActive;
+  state.historyHead = historyHead;
+  state.historyCount = historyCount;
+  state.phase = phase;
+  state.trackingOvershoot = trackingOvershoot;
+}
+
+// Replay only: the relay pin is left alone
+void PumpController::loadState(const PumpSnapshot &state) {
+  startTime = state.startTime;
+  runLimit = state.runLimit;
+  totalWateringTime = state.totalWateringTime;
+  lastHistory = state.lastHistory;
+  phaseStart = state.phaseStart;
+  pulseDuration = state.pulseDuration;
+  soakDuration = state.soakDuration;
+  soakPeakTime = state.soakPeakTime;
+  overshootStart = state.overshootStart;
+  currentHour = state.currentHour;
+  for (uint8_t i = 0; i < IRRIGATION_HISTORY_SIZE; i++) {
+    history[i].time = state.historyTime[i];
+    history[i].moisture = state.historyMoisture[i];
+  }
+  wateringCount = state.wateringCount;
+  consecutiveDryCount = state.consecutiveDryCount;
+  pulseMoisture = state.pulseMoisture;
+  soakPeak = state.soakPeak;
+  pulsesInCycle = state.pulsesInCycle;
+  overshootPeak = state.overshootPeak;
+  lastOvershoot = state.lastOvershoot;
+  dryingRate = state.dryingRate;
+  pulseGain = state.pulseGain;
+  infiltrationLag = state.infiltrationLag;
+  avgOvershoot = state.avgOvershoot;
+  memcpy(onSecondsByHour, state.onSecondsByHour, sizeof(onSecondsByHour));
+  memcpy(cyclesByHour, state.cyclesByHour, sizeof(cyclesByHour));
+  isActive = state.isActive;
+  historyHead = state.historyHead;
+  historyCount = state.historyCount;
+  phase = (IrrigationPhase)state.phase;
+  trackingOvershoot = state.trackingOvershoot;
 }
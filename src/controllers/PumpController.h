@@ -3,6 +3,77 @@
 
 #include <Arduino.h>
 #include "config/Config.h"
+#include "system/TimeService.h"
+
+#define IRRIGATION_HISTORY_SIZE 32
+
+enum IrrigationMode {
+  MODE_BANG_BANG = 0,   // Run until MOISTURE_STOP (original behaviour)
+  MODE_PULSE_SOAK = 1   // Calibrated pulses separated by soak intervals
+};
+
+enum IrrigationPhase {
+  PHASE_IDLE,
+  PHASE_PULSE,
+  PHASE_SOAK
+};
+
+// Public entry points, as reported to a PumpTracer
+enum PumpCall {
+  PUMP_CALL_AUTO,         // autoIrrigate(soil)
+  PUMP_CALL_SAFETY,       // checkSafety()
+  PUMP_CALL_START,
+  PUMP_CALL_START_FOR,    // startFor(seconds)
+  PUMP_CALL_STOP,
+  PUMP_CALL_DRY_COUNT     // setConsecutiveDryCount(count)
+};
+
+// Sees every input the controller gets from outside and every relay edge it
+// makes: TraceRecorder on the device, the replay tool on the host
+class PumpTracer {
+public:
+  virtual ~PumpTracer() {}
+  virtual void onCall(uint8_t call, int32_t arg) = 0;   // Before the call runs
+  virtual void onEdge(bool on) = 0;
+  virtual void onReturn() = 0;                          // After it
+};
+
+// Everything autoIrrigate() decides on, in fixed-width fields so the device
+// and a 64-bit host agree on the layout. Times are millis() values.
+struct PumpSnapshot {
+  uint32_t startTime;
+  uint32_t runLimit;
+  uint32_t totalWateringTime;
+  uint32_t lastHistory;
+  uint32_t phaseStart;
+  uint32_t pulseDuration;
+  uint32_t soakDuration;
+  uint32_t soakPeakTime;
+  uint32_t overshootStart;
+  uint32_t currentHour;
+  uint32_t historyTime[IRRIGATION_HISTORY_SIZE];
+  int32_t wateringCount;
+  int32_t consecutiveDryCount;
+  int32_t pulseMoisture;
+  int32_t soakPeak;
+  int32_t pulsesInCycle;
+  int32_t overshootPeak;
+  int32_t lastOvershoot;
+  float dryingRate;
+  float pulseGain;
+  float infiltrationLag;
+  float avgOvershoot;
+  int16_t historyMoisture[IRRIGATION_HISTORY_SIZE];
+  uint16_t onSecondsByHour[24];
+  uint16_t cyclesByHour[24];
+  uint8_t isActive;
+  uint8_t historyHead;
+  uint8_t historyCount;
+  uint8_t phase;
+  uint8_t trackingOvershoot;
+  uint8_t reserved[3];
+};
+static_assert(sizeof(PumpSnapshot) == 380, "PumpSnapshot is part of the trace format");
 
 class PumpController {
 private:
@@ -10,28 +81,120 @@ private:
   bool activeLow;
   bool isActive;
   unsigned long startTime;
+  unsigned long runLimit;     // ms for a timed run, 0 = MAX_PUMP_TIME
   unsigned long totalWateringTime;
-  int wateringCount;
+  int wateringCount;          // Irrigation cycles: a pulse-and-soak cycle counts once
   int consecutiveDryCount;
 
+  // Moisture history (one point every IRRIGATION_HISTORY_INTERVAL while idle)
+  struct HistoryPoint {
+    uint32_t time;      // seconds since boot (monotonic, no 49-day wrap)
+    int16_t moisture;
+  } history[IRRIGATION_HISTORY_SIZE];
+  uint8_t historyHead;
+  uint8_t historyCount;
+  unsigned long lastHistory;
+
+  // Pulse-and-soak state
+  IrrigationPhase phase;
+  unsigned long phaseStart;
+  unsigned long pulseDuration;    // ms
+  unsigned long soakDuration;     // ms
+  int pulseMoisture;              // Moisture when the current pulse started
+  int soakPeak;
+  unsigned long soakPeakTime;
+  int pulsesInCycle;
+
+  // Learned plant/soil response
+  float dryingRate;     // %/h, positive when drying
+  float pulseGain;      // % moisture per pump-second
+  float infiltrationLag; // s from pulse end to peak response
+
+  // Overshoot tracking after every stop
+  bool trackingOvershoot;
+  unsigned long overshootStart;
+  int overshootPeak;
+  int lastOvershoot;
+  float avgOvershoot;     // -1 until the first completed cycle
+
+  // Rolling 24 h metrics (hourly buckets)
+  uint16_t onSecondsByHour[24];
+  uint16_t cyclesByHour[24];
+  uint32_t currentHour;
+
+  // micros() of the last start()/stop() call and relay edge, for command latency
+  uint32_t lastCallUs;
+  uint32_t lastEdgeUs;
+  bool lastCallSwitched;
+
+  // UTC of the last relay edges
+  TimeStamp lastStarted;
+  TimeStamp lastStopped;
+
+  PumpTracer *tracer;
+  uint8_t callDepth;      // Public calls in progress; only the outermost one is traced
+
+  // Scope of one public call
+  struct Call {
+    PumpController &controller;
+    Call(PumpController &c, uint8_t call, int32_t arg);
+    ~Call();
+  };
+
+  void recordSample(int soilMoisture);
+  void rollHour();
+  void updateDryingRate();
+  void trackOvershoot(int soilMoisture);
+  void finishOvershoot();
+  void bangBangStep(int soilMoisture);
+  void pulseSoakStep(int soilMoisture);
+  void beginPulse(int soilMoisture);
+  void learnFromSoak();
+
 public:
   PumpController(uint8_t pin, bool activeLow);
-  
+
   void begin();
   void start();
+  void startFor(unsigned long seconds);
   void stop();
   void checkSafety();
   void autoIrrigate(int soilMoisture);
-  
+
   // Getters
   bool isPumpActive() const { return isActive; }
   unsigned long getPumpRunTime() const { return isActive ? (millis() - startTime) : 0; }
   unsigned long getTotalWateringTime() const { return totalWateringTime; }
   int getWateringCount() const { return wateringCount; }
   int getConsecutiveDryCount() const { return consecutiveDryCount; }
-  
+
+  // Irrigation metrics
+  IrrigationMode getMode() const { return (IrrigationMode)IRRIGATION_MODE; }
+  IrrigationPhase getPhase() const { return phase; }
+  bool isSettling() const { return phase != PHASE_IDLE || trackingOvershoot; }  // Soil still responding
+  uint32_t getOnTimeLast24h() const;
+  uint32_t getRelayCyclesLast24h() const;
+  int getLastOvershoot() const { return lastOvershoot; }
+  float getAvgOvershoot() const { return avgOvershoot; }
+  float getDryingRate() const { return dryingRate; }
+  float getPulseGain() const { return pulseGain; }
+  float getInfiltrationLag() const { return infiltrationLag; }
+
+  // Actuation timing of the last start()/stop()
+  uint32_t getLastCallUs() const { return lastCallUs; }
+  uint32_t getLastEdgeUs() const { return lastEdgeUs; }
+  bool didLastCallSwitch() const { return lastCallSwitched; }
+  const TimeStamp &getLastStarted() const { return lastStarted; }
+  const TimeStamp &getLastStopped() const { return lastStopped; }
+
   // Setters for external control
-  void setConsecutiveDryCount(int count) { consecutiveDryCount = count; }
+  void setConsecutiveDryCount(int count);
+  void restoreCounters(int count, unsigned long totalSeconds, int dryCount);   // PumpStateStore, at boot
+
+  // Record/replay
+  void setTracer(PumpTracer *t) { tracer = t; }
+  void saveState(PumpSnapshot &state) const;
+  void loadState(const PumpSnapshot &state);
 };
 
 #endif // PUMP_CONTROLLER_H
@@ -0,0 +1,314 @@
+#include "RuleEngine.h"
+#include "controllers/PumpController.h"
+#include "network/MQTTManager.h"
+#include "system/TimeService.h"
+#include <ctype.h>
+
+static const char *const actionNames[] = {"alert", "pump_on", "pump_off"};
+
+// Tokens of one rule string: words, numbers and operators, spaces optional
+struct RuleScanner {
+  const char *p;
+
+  void skip() {
+    while (*p == ' ' || *p == '\t') p++;
+  }
+
+  bool keyword(const char *word) {
+    skip();
+    size_t length = strlen(word);
+    if (strncmp(p, word, length) != 0) return false;
+    if (isalnum((unsigned char)p[length]) || p[length] == '_') return false;
+    p += length;
+    return true;
+  }
+
+  bool literal(const char *text) {
+    skip();
+    size_t length = strlen(text);
+    if (strncmp(p, text, length) != 0) return false;
+    p += length;
+    return true;
+  }
+
+  bool word(char *out, size_t size) {
+    skip();
+    if (!isalpha((unsigned char)*p) && *p != '_') return false;
+    size_t length = 0;
+    while (isalnum((unsigned char)*p) || *p == '_') {
+      if (length + 1 < size) out[length++] = *p;
+      p++;
+    }
+    out[length] = '\0';
+    return true;
+  }
+
+  bool number(float &out) {
+    skip();
+    char *end;
+    out = strtof(p, &end);
+    if (end == p) return false;
+    p = end;
+    return true;
+  }
+};
+
+RuleEngine::RuleEngine() : pumpController(nullptr), mqttManager(nullptr) {
+  memset(rules, 0, sizeof(rules));
+  for (uint8_t i = 0; i < STORE_METRIC_COUNT; i++) {
+    values[i] = NAN;
+  }
+}
+
+void RuleEngine::begin() {
+  reload();
+}
+
+void RuleEngine::reload() {
+  uint8_t active = 0;
+  for (uint8_t i = 0; i < RULE_SLOTS; i++) {
+    Rule &rule = rules[i];
+    memset(&rule, 0, sizeof(rule));
+    rule.error = compile(RULES[i], rule);
+    if (!rule.name[0]) snprintf(rule.name, sizeof(rule.name), "rule%u", i);
+    if (rule.error) {
+      rule.length = 0;
+      Serial.printf("⚠️  Rule %s rejected: %s\n", rule.name, rule.error);
+    } else if (rule.length) {
+      active++;
+    }
+  }
+  Serial.printf("✅ Rule engine: %u rule(s) active\n", active);
+}
+
+// Grammar: [name:] cmp {and cmp} {or cmp {and cmp}} [for <s>] [hyst <x>] -> action [arg]
+// where cmp is <metric> (< | <= | > | >=) <number>. "and" binds tighter than "or".
+const char *RuleEngine::compile(const char *source, Rule &rule) {
+  RuleScanner scanner = {source};
+  scanner.skip();
+  if (!*scanner.p) return nullptr;        // Empty slot
+
+  const char *colon = strchr(source, ':');
+  if (colon) {
+    if (!scanner.word(rule.name, sizeof(rule.name))) return "bad name";
+    scanner.p = colon + 1;
+  }
+
+  uint8_t length = 0;
+  bool firstTerm = true;
+  do {
+    bool firstComparison = true;
+    do {
+      char metricName[16];
+      if (!scanner.word(metricName, sizeof(metricName))) return "expected metric";
+      int8_t metric = SampleStore::findMetric(metricName);
+      if (metric < 0) return "unknown metric";
+
+      uint8_t op;
+      if (scanner.literal(">=")) op = RULE_OP_GE;
+      else if (scanner.literal("<=")) op = RULE_OP_LE;
+      else if (scanner.literal(">")) op = RULE_OP_GT;
+      else if (scanner.literal("<")) op = RULE_OP_LT;
+      else return "expected comparison";
+
+      float threshold;
+      if (!scanner.number(threshold)) return "expected number";
+      if (length + (firstComparison ? 1 : 2) > RULE_PROGRAM_MAX) return "too many conditions";
+      rule.program[length++] = {op, (uint8_t)metric, threshold};
+      rule.metrics |= 1 << metric;
+      if (!firstComparison) rule.program[length++] = {RULE_OP_AND, 0, 0};
+      firstComparison = false;
+    } while (scanner.keyword("and"));
+
+    if (!firstTerm) {
+      if (length >= RULE_PROGRAM_MAX) return "too many conditions";
+      rule.program[length++] = {RULE_OP_OR, 0, 0};
+    }
+    firstTerm = false;
+  } while (scanner.keyword("or"));
+
+  while (true) {
+    float value;
+    if (scanner.keyword("for")) {
+      if (!scanner.number(value) || value < 0) return "expected seconds";
+      scanner.keyword("s");
+      rule.debounceMs = (unsigned long)(value * 1000);
+    } else if (scanner.keyword("hyst")) {
+      if (!scanner.number(value) || value < 0) return "expected hysteresis";
+      rule.hysteresis = value;
+    } else {
+      break;
+    }
+  }
+
+  if (!scanner.literal("->")) return "expected ->";
+  char action[12];
+  if (!scanner.word(action, sizeof(action))) return "expected action";
+  if (strcmp(action, "alert") == 0) {
+    rule.action = RULE_ACTION_ALERT;
+  } else if (strcmp(action, "pump_on") == 0) {
+    rule.action = RULE_ACTION_PUMP_ON;
+    float seconds;
+    if (scanner.number(seconds)) {
+      if (seconds <= 0) return "duration must be > 0";
+      rule.actionArg = (uint16_t)min(seconds, 65535.0f);
+    }
+  } else if (strcmp(action, "pump_off") == 0) {
+    rule.action = RULE_ACTION_PUMP_OFF;
+  } else {
+    return "unknown action";
+  }
+
+  scanner.skip();
+  if (*scanner.p) return "unexpected text after action";
+  rule.length = length;
+  return nullptr;
+}
+
+bool RuleEngine::evaluate(const Rule &rule) const {
+  // While active, thresholds shift by the hysteresis so the rule holds until
+  // the value is clearly back; NaN (never sampled) compares false
+  float h = rule.state == RULE_ACTIVE ? rule.hysteresis : 0;
+  uint32_t stack = 0;
+  for (uint8_t i = 0; i < rule.length; i++) {
+    const RuleInstruction &in = rule.program[i];
+    float value = values[in.metric];
+    bool result;
+    switch (in.op) {
+      case RULE_OP_GT: result = value > in.operand - h; break;
+      case RULE_OP_GE: result = value >= in.operand - h; break;
+      case RULE_OP_LT: result = value < in.operand + h; break;
+      case RULE_OP_LE: result = value <= in.operand + h; break;
+      case RULE_OP_AND: {
+        bool b = stack & 1;
+        stack >>= 1;
+        result = b && (stack & 1);
+        stack >>= 1;
+        break;
+      }
+      default: {
+        bool b = stack & 1;
+        stack >>= 1;
+        result = b || (stack & 1);
+        stack >>= 1;
+        break;
+      }
+    }
+    stack = (stack << 1) | result;
+  }
+  return stack & 1;
+}
+
+void RuleEngine::onSample(StoreMetric metric, float value) {
+  if (isnan(value)) return;
+  values[metric] = value;
+
+  unsigned long now = millis();
+  uint16_t bit = 1 << metric;
+  for (uint8_t i = 0; i < RULE_SLOTS; i++) {
+    if (rules[i].metrics & bit) step(i, now);
+  }
+}
+
+void RuleEngine::loop() {
+  unsigned long now = millis();
+  for (uint8_t i = 0; i < RULE_SLOTS; i++) {
+    const Rule &rule = rules[i];
+    if (rule.state == RULE_PENDING && now - rule.pendingSince >= rule.debounceMs) step(i, now);
+  }
+}
+
+void RuleEngine::step(uint8_t index, unsigned long now) {
+  Rule &rule = rules[index];
+  if (!rule.length) return;
+
+  uint32_t start = ESP.getCycleCount();
+  bool match = evaluate(rule);
+  uint32_t cycles = ESP.getCycleCount() - start;
+  rule.evaluations++;
+  rule.totalCycles += cycles;
+  if (cycles > rule.maxCycles) rule.maxCycles = cycles;
+
+  if (rule.state == RULE_ACTIVE) {
+    if (!match) release(index);
+    return;
+  }
+  if (!match) {
+    rule.state = RULE_IDLE;
+    return;
+  }
+  if (rule.state == RULE_IDLE) {
+    rule.state = RULE_PENDING;
+    rule.pendingSince = now;
+  }
+  if (now - rule.pendingSince >= rule.debounceMs) fire(index);
+}
+
+void RuleEngine::fire(uint8_t index) {
+  Rule &rule = rules[index];
+  rule.state = RULE_ACTIVE;
+  rule.triggers++;
+  Serial.printf("🚨 Rule %s fired -> %s\n", rule.name, getActionName(rule.action));
+
+  if (pumpController && rule.action == RULE_ACTION_PUMP_ON) {
+    pumpController->startFor(rule.actionArg ? rule.actionArg : MAX_PUMP_TIME);
+  } else if (pumpController && rule.action == RULE_ACTION_PUMP_OFF) {
+    pumpController->stop();
+  }
+  publish(index, "fired");
+}
+
+void RuleEngine::release(uint8_t index) {
+  Rule &rule = rules[index];
+  rule.state = RULE_IDLE;
+  Serial.printf("✅ Rule %s cleared\n", rule.name);
+  publish(index, "cleared");
+}
+
+void RuleEngine::publish(uint8_t index, const char *state) {
+  if (!mqttManager || !mqttManager->isConnected()) return;
+  const Rule &rule = rules[index];
+
+  JsonDocument doc;
+  TimeStamp now = TimeService::stamp();
+  doc["device"] = mqttManager->getClientId();
+  doc["time"] = now.utcMs;
+  doc["tq"] = TimeService::getQualityName(now.quality);
+  doc["rule"] = rule.name;
+  doc["state"] = state;
+  doc["action"] = getActionName(rule.action);
+  for (uint8_t m = 0; m < STORE_METRIC_COUNT; m++) {
+    if (rule.metrics & (1 << m)) doc["values"][SampleStore::getMetricName(m)] = values[m];
+  }
+  mqttManager->publishAlert(doc);
+}
+
+const char *RuleEngine::getActionName(uint8_t action) {
+  return action <= RULE_ACTION_PUMP_OFF ? actionNames[action] : "";
+}
+
+void RuleEngine::toJson(JsonVariant obj) const {
+  static const char *const stateNames[] = {"idle", "pending", "active"};
+  uint32_t mhz = ESP.getCpuFreqMHz();
+
+  for (uint8_t i = 0; i < RULE_SLOTS; i++) {
+    const Rule &rule = rules[i];
+    if (!rule.length && !rule.error) continue;
+
+    char key[8];
+    snprintf(key, sizeof(key), "rule%u", i);
+    JsonVariant r = obj[key];
+    r["name"] = rule.name;
+    if (rule.error) {
+      r["error"] = rule.error;
+      continue;
+    }
+    r["state"] = stateNames[rule.state];
+    r["action"] = getActionName(rule.action);
+    r["ops"] = rule.length;
+    r["evals"] = rule.evaluations;
+    r["triggers"] = rule.triggers;
+    r["avgNs"] = rule.evaluations ? (uint32_t)(rule.totalCycles * 1000 / mhz / rule.evaluations) : 0;
+    r["maxNs"] = rule.maxCycles * 1000 / mhz;
+  }
+}
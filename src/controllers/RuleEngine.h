@@ -0,0 +1,99 @@
+#ifndef RULE_ENGINE_H
+#define RULE_ENGINE_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "config/Config.h"
+#include "storage/SampleStore.h"
+
+#define RULE_PROGRAM_MAX 8      // Instructions per rule (3 comparisons joined by and/or fit)
+#define RULE_NAME_MAX 12
+
+class PumpController;
+class MQTTManager;
+
+// Stack machine: comparisons push one bit, AND/OR pop two and push one
+enum RuleOp {
+  RULE_OP_GT,
+  RULE_OP_GE,
+  RULE_OP_LT,
+  RULE_OP_LE,
+  RULE_OP_AND,
+  RULE_OP_OR
+};
+
+struct RuleInstruction {
+  uint8_t op;
+  uint8_t metric;         // StoreMetric, comparisons only
+  float operand;          // Threshold
+};
+
+enum RuleAction {
+  RULE_ACTION_ALERT,
+  RULE_ACTION_PUMP_ON,
+  RULE_ACTION_PUMP_OFF
+};
+
+enum RuleState {
+  RULE_IDLE,
+  RULE_PENDING,           // Condition holds, waiting out the debounce
+  RULE_ACTIVE             // Fired; released once the condition clears past the hysteresis
+};
+
+struct Rule {
+  char name[RULE_NAME_MAX];
+  RuleInstruction program[RULE_PROGRAM_MAX];
+  uint8_t length;         // 0 = slot empty or failed to compile
+  uint16_t metrics;       // Bit per StoreMetric read, selects the rules a sample wakes
+  float hysteresis;       // Thresholds move by this much towards "still true" while active
+  unsigned long debounceMs;
+  uint8_t action;
+  uint16_t actionArg;     // pump_on seconds, 0 = MAX_PUMP_TIME
+  const char *error;      // Compile error, nullptr when fine
+
+  uint8_t state;
+  unsigned long pendingSince;
+
+  uint32_t evaluations;
+  uint32_t triggers;
+  uint64_t totalCycles;
+  uint32_t maxCycles;
+};
+
+// Local alerts and actions without the cloud round trip. Each rule comes
+// from one config key (rule0..rule5), e.g.
+//   acid: ph < 5.5 for 60 hyst 0.2 -> alert
+//   dry: soil < 20 and temp > 30 for 10 -> pump_on 30
+// and is compiled to a few instructions. A new sample re-evaluates only the
+// rules that read its metric.
+class RuleEngine {
+private:
+  Rule rules[RULE_SLOTS];
+  float values[STORE_METRIC_COUNT];     // Latest sample per metric, NaN until seen
+  PumpController *pumpController;
+  MQTTManager *mqttManager;
+
+  static const char *compile(const char *source, Rule &rule);
+  bool evaluate(const Rule &rule) const;
+  void step(uint8_t index, unsigned long now);
+  void fire(uint8_t index);
+  void release(uint8_t index);
+  void publish(uint8_t index, const char *state);
+
+public:
+  RuleEngine();
+
+  void begin();
+  void loop();            // Fires rules whose debounce ran out between samples
+  void reload();          // Recompiles RULES after a config change
+
+  void onSample(StoreMetric metric, float value);
+
+  void setPumpController(PumpController *controller) { pumpController = controller; }
+  void setMQTTManager(MQTTManager *manager) { mqttManager = manager; }
+
+  static const char *getActionName(uint8_t action);
+  void toJson(JsonVariant obj) const;
+};
+
+#endif // RULE_ENGINE_H
@@ -1,6 +1,11 @@
 #include "LCDDisplay.h"
 
-LCDDisplay::LCDDisplay() : lcd(nullptr), currentPage(0), lastUpdate(0) {
+LCDDisplay::LCDDisplay()
+  : bus(nullptr), client(-1), address(0), present(false), seenErrors(0),
+    currentPage(0), lastUpdate(0) {
+  memset(frame, ' ', sizeof(frame));
+  memset(shown, ' ', sizeof(shown));
+
   // Initialize display data
   data.soilMoisture = 0;
   data.temperature = 0;
@@ -13,23 +18,104 @@ LCDDisplay::LCDDisplay() : lcd(nullptr), currentPage(0), lastUpdate(0) {
   data.wateringCount = 0;
   data.mqttConnected = false;
   data.isAPMode = false;
+  data.ssid[0] = '\0';
+  data.ipAddress[0] = '\0';
 }
 
 bool LCDDisplay::begin(uint8_t address) {
-  // Cast address to pcf8574Address enum type
-  lcd = new LiquidCrystal_I2C((pcf8574Address)address);
-  lcd->begin(16, 2);
-  lcd->backlight();
-  lcd->clear();
+  if (!bus) return false;
+  if (client < 0) client = bus->addClient("lcd", LCD_PRIORITY);
+  if (client < 0 || !bus->probe(client, address)) return false;
+  this->address = address;
+  
+  // Power-on reset into 4-bit mode (HD44780 datasheet, figure 24), then
+  // 2 lines, display on without cursor, left to right, clear
+  sendNibble(0x03, 5);
+  sendNibble(0x03, 1);
+  sendNibble(0x03, 1);
+  sendNibble(0x02, 1);
+  sendCommand(0x28, 0);
+  sendCommand(0x0C, 0);
+  sendCommand(0x06, 0);
+  sendCommand(0x01, 2);
+  memset(frame, ' ', sizeof(frame));
+  memset(shown, ' ', sizeof(shown));
+  seenErrors = bus->getErrors(client);
+  present = true;
   
   Serial.printf("✅ LCD initialized at address 0x%02X\n", address);
   return true;
 }
 
+// One byte as two nibble strobes; the controller latches on the EN falling edge
+size_t LCDDisplay::encode(uint8_t *out, uint8_t value, uint8_t mode) {
+  uint8_t high = (value & 0xF0) | mode | LCD_BACKLIGHT;
+  uint8_t low = ((value << 4) & 0xF0) | mode | LCD_BACKLIGHT;
+  out[0] = high | LCD_EN;
+  out[1] = high;
+  out[2] = low | LCD_EN;
+  out[3] = low;
+  return 4;
+}
+
+void LCDDisplay::sendNibble(uint8_t nibble, uint8_t delayMs) {
+  uint8_t bits = (nibble << 4) | LCD_BACKLIGHT;
+  uint8_t out[2] = {(uint8_t)(bits | LCD_EN), bits};
+  bus->write(client, address, out, sizeof(out), delayMs);
+}
+
+void LCDDisplay::sendCommand(uint8_t command, uint8_t delayMs) {
+  uint8_t out[4];
+  bus->write(client, address, out, encode(out, command, 0), delayMs);
+}
+
+void LCDDisplay::setLine(uint8_t row, const char *format, ...) {
+  char text[LCD_COLS + 1];
+  va_list args;
+  va_start(args, format);
+  vsnprintf(text, sizeof(text), format, args);
+  va_end(args);
+  
+  size_t length = strlen(text);
+  memcpy(frame[row], text, length);
+  memset(frame[row] + length, ' ', LCD_COLS - length);
+}
+
+void LCDDisplay::flush() {
+  // A failed write left the controller in an unknown state: redraw it all
+  uint32_t errors = bus->getErrors(client);
+  if (errors != seenErrors) {
+    seenErrors = errors;
+    memset(shown, 0, sizeof(shown));
+  }
+  
+  // Per row, rewrite the span from the first to the last changed cell
+  uint8_t out[LCD_ROWS * (LCD_COLS + 1) * 4];
+  size_t length = 0;
+  for (uint8_t row = 0; row < LCD_ROWS; row++) {
+    int first = -1, last = -1;
+    for (int col = 0; col < LCD_COLS; col++) {
+      if (frame[row][col] == shown[row][col]) continue;
+      if (first < 0) first = col;
+      last = col;
+    }
+    if (first < 0) continue;
+    length += encode(out + length, 0x80 | (row * 0x40 + first), 0);   // Set DDRAM address
+    for (int col = first; col <= last; col++) {
+      length += encode(out + length, frame[row][col], LCD_RS);
+    }
+  }
+  
+  // Queue full: shown stays as it was and the next frame carries the change
+  if (length && bus->write(client, address, out, length)) {
+    memcpy(shown, frame, sizeof(shown));
+  }
+}
+
 void LCDDisplay::setData(int soilMoisture, float temperature, float humidity,
                         int airQuality, bool airQualityGood, int tdsValue,
                         bool pumpActive, int pumpRunTime, int wateringCount,
-                        bool mqttConnected, bool isAPMode, String ssid, String ipAddress) {
+                        bool mqttConnected, bool isAPMode, const char *ssid, const char *ipAddress) {
   data.soilMoisture = soilMoisture;
   data.temperature = temperature;
   data.humidity = humidity;
@@ -41,118 +127,80 @@ void LCDDisplay::setData(int soilMoisture, float temperature, float humidity,
   data.wateringCount = wateringCount;
   data.mqttConnected = mqttConnected;
   data.isAPMode = isAPMode;
-  data.ssid = ssid;
-  data.ipAddress = ipAddress;
+  strlcpy(data.ssid, ssid, sizeof(data.ssid));
+  strlcpy(data.ipAddress, ipAddress, sizeof(data.ipAddress));
 }
 
 void LCDDisplay::update() {
-  if (!lcd) return;
+  if (!present) return;
   
   if (millis() - lastUpdate < LCD_UPDATE_INTERVAL) return;
   lastUpdate = millis();
   
-  lcd->clear();
-  
   switch (currentPage) {
     case 0: // Soil moisture & Temperature
-      lcd->setCursor(0, 0);
-      lcd->print("Soil:");
-      lcd->print(data.soilMoisture);
-      lcd->print("%");
-      if (data.soilMoisture <= MOISTURE_THRESHOLD) {
-        lcd->print(" DRY");
-      } else if (data.soilMoisture >= MOISTURE_STOP) {
-        lcd->print(" WET");
-      }
-      
-      lcd->setCursor(0, 1);
-      lcd->print("Temp:");
-      lcd->print(data.temperature, 1);
-      lcd->print((char)223); // degree symbol
-      lcd->print("C");
+      setLine(0, "Soil:%d%%%s", data.soilMoisture,
+              data.soilMoisture <= MOISTURE_THRESHOLD ? " DRY" :
+              data.soilMoisture >= MOISTURE_STOP ? " WET" : "");
+      setLine(1, "Temp:%.1f%cC", data.temperature, (char)223);   // degree symbol
       break;
       
     case 1: // Humidity & Air Quality
-      lcd->setCursor(0, 0);
-      lcd->print("Humidity:");
-      lcd->print(data.humidity, 1);
-      lcd->print("%");
-      
-      lcd->setCursor(0, 1);
-      lcd->print("Air:");
-      lcd->print(data.airQuality);
-      lcd->print("% ");
-      lcd->print(data.airQualityGood ? "OK" : "BAD");
+      setLine(0, "Humidity:%.1f%%", data.humidity);
+      setLine(1, "Air:%d%% %s", data.airQuality, data.airQualityGood ? "OK" : "BAD");
       break;
       
     case 2: // TDS & Pump Status
-      lcd->setCursor(0, 0);
-      lcd->print("TDS:");
-      lcd->print(data.tdsValue);
-      lcd->print(" ppm");
-      
-      lcd->setCursor(0, 1);
-      lcd->print("Pump:");
+      setLine(0, "TDS:%d ppm", data.tdsValue);
       if (data.pumpActive) {
-        lcd->print("ON ");
-        lcd->print(data.pumpRunTime);
-        lcd->print("s");
+        setLine(1, "Pump:ON %ds", data.pumpRunTime);
       } else {
-        lcd->print("OFF");
+        setLine(1, "Pump:OFF");
       }
       break;
       
     case 3: // WiFi & MQTT Status
-      lcd->setCursor(0, 0);
       if (data.isAPMode) {
-        lcd->print("WiFi:AP Mode");
+        setLine(0, "WiFi:AP Mode");
       } else if (WiFi.status() == WL_CONNECTED) {
-        lcd->print("WiFi:OK ");
-        lcd->print(WiFi.RSSI());
-        lcd->print("dB");
+        setLine(0, "WiFi:OK %ddB", (int)WiFi.RSSI());
       } else {
-        lcd->print("WiFi:Disc");
+        setLine(0, "WiFi:Disc");
       }
-      
-      lcd->setCursor(0, 1);
-      lcd->print("MQTT:");
-      lcd->print(data.mqttConnected ? "ON" : "OFF");
-      lcd->print(" #");
-      lcd->print(data.wateringCount);
+      setLine(1, "MQTT:%s #%d", data.mqttConnected ? "ON" : "OFF", data.wateringCount);
       break;
       
     case 4: // SSID & IP Address
-      lcd->setCursor(0, 0);
       if (data.isAPMode) {
-        lcd->print("AP:AgroHygra");
+        setLine(0, "AP:AgroHygra");
       } else if (WiFi.status() == WL_CONNECTED) {
-        String displaySSID = data.ssid;
-        if (displaySSID.length() > 16) {
-          displaySSID = displaySSID.substring(0, 16);
-        }
-        lcd->print(displaySSID);
+        setLine(0, "%s", data.ssid);
       } else {
-        lcd->print("WiFi: No Conn");
+        setLine(0, "WiFi: No Conn");
       }
-      
-      lcd->setCursor(0, 1);
-      lcd->print(data.ipAddress);
+      setLine(1, "%s", data.ipAddress);
       break;
   }
+  flush();
   
   // Cycle through pages
   currentPage = (currentPage + 1) % LCD_PAGES;
 }
 
-void LCDDisplay::showMessage(String line1, String line2) {
-  if (!lcd) return;
-  lcd->clear();
-  lcd->setCursor(0, 0);
-  lcd->print(line1);
-  lcd->setCursor(0, 1);
-  lcd->print(line2);
+unsigned long LCDDisplay::msUntilUpdate() const {
+  unsigned long elapsed = millis() - lastUpdate;
+  return elapsed >= LCD_UPDATE_INTERVAL ? 0 : LCD_UPDATE_INTERVAL - elapsed;
+}
+
+void LCDDisplay::showMessage(const char *line1, const char *line2) {
+  if (!present) return;
+  setLine(0, "%s", line1);
+  setLine(1, "%s", line2);
+  flush();
 }
 
 void LCDDisplay::clear() {
-  if (lcd) lcd->clear();
+  if (!present) return;
+  memset(frame, ' ', sizeof(frame));
+  flush();
 }
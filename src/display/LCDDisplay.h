@@ -2,13 +2,31 @@
 #define LCD_DISPLAY_H
 
 #include <Arduino.h>
-#include <LiquidCrystal_I2C.h>
 #include <WiFi.h>
 #include "config/Config.h"
+#include "system/I2CBus.h"
 
+#define LCD_COLS 16
+#define LCD_ROWS 2
+#define LCD_PRIORITY 1          // Below sensors: a late frame costs nothing
+
+// PCF8574 backpack wiring: P0 RS, P1 RW, P2 EN, P3 backlight, P4-P7 D4-D7
+#define LCD_RS 0x01
+#define LCD_EN 0x04
+#define LCD_BACKLIGHT 0x08
+
+// HD44780 16x2 behind a PCF8574, driven through the I2C bus manager. Pages
+// are rendered into a frame buffer; only the cells that changed since the
+// last frame are sent, as one queued write, so update() never waits on I2C.
 class LCDDisplay {
 private:
-  LiquidCrystal_I2C *lcd;
+  I2CBus *bus;
+  int8_t client;
+  uint8_t address;
+  bool present;
+  char frame[LCD_ROWS][LCD_COLS];     // Page being drawn
+  char shown[LCD_ROWS][LCD_COLS];     // What the controller holds
+  uint32_t seenErrors;                // Bus errors already answered with a full redraw
   int currentPage;
   unsigned long lastUpdate;
   
@@ -25,21 +43,30 @@ private:
     int wateringCount;
     bool mqttConnected;
     bool isAPMode;
-    String ssid;
-    String ipAddress;
+    char ssid[17];          // Truncated to the 16-column display
+    char ipAddress[16];
   } data;
 
+  static size_t encode(uint8_t *out, uint8_t value, uint8_t mode);
+  void sendNibble(uint8_t nibble, uint8_t delayMs);
+  void sendCommand(uint8_t command, uint8_t delayMs);
+  void setLine(uint8_t row, const char *format, ...);
+  void flush();
+
 public:
   LCDDisplay();
   
+  void setBus(I2CBus *i2cBus) { bus = i2cBus; }
+  
   bool begin(uint8_t address = 0x27);
   void update();
+  unsigned long msUntilUpdate() const;
   void setData(int soilMoisture, float temperature, float humidity, 
                int airQuality, bool airQualityGood, int tdsValue,
                bool pumpActive, int pumpRunTime, int wateringCount,
-               bool mqttConnected, bool isAPMode, String ssid, String ipAddress);
+               bool mqttConnected, bool isAPMode, const char *ssid, const char *ipAddress);
   
-  void showMessage(String line1, String line2);
+  void showMessage(const char *line1, const char *line2);
   void clear();
 };
 
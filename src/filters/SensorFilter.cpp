@@ -0,0 +1,74 @@
+#include "SensorFilter.h"
+
+// ========== EMA ==========
+EmaFilter::EmaFilter(uint8_t shift) : shift(shift), state(0), primed(false) {
+}
+
+fixed_t EmaFilter::process(fixed_t x, uint32_t) {
+  if (!primed) {
+    state = x;
+    primed = true;
+  } else {
+    state += (x - state) >> shift;
+  }
+  return state;
+}
+
+// ========== RATE LIMIT ==========
+RateLimitFilter::RateLimitFilter(float maxPerSecond)
+  : maxRate(toFixed(maxPerSecond)), state(0), primed(false) {
+}
+
+fixed_t RateLimitFilter::process(fixed_t x, uint32_t dtMs) {
+  if (!primed) {
+    state = x;
+    primed = true;
+    return state;
+  }
+
+  fixed_t maxStep = (fixed_t)(((int64_t)maxRate * dtMs) / 1000);
+  fixed_t delta = x - state;
+  if (delta > maxStep) delta = maxStep;
+  if (delta < -maxStep) delta = -maxStep;
+  state += delta;
+  return state;
+}
+
+// ========== CHAIN ==========
+FilterChain::FilterChain()
+  : stageCount(0), output(0), primed(false), lastMs(0), invalidCount(0) {
+}
+
+FilterChain &FilterChain::add(FilterStage *stage) {
+  if (stageCount < FILTER_MAX_STAGES) {
+    stages[stageCount++] = stage;
+  }
+  return *this;
+}
+
+float FilterChain::apply(float value, uint32_t nowMs) {
+  if (isnan(value) || isinf(value)) {
+    invalidCount++;
+    return primed ? fromFixed(output) : value;
+  }
+
+  uint32_t dtMs = primed ? nowMs - lastMs : 0;
+  lastMs = nowMs;
+
+  fixed_t x = toFixed(value);
+  for (uint8_t i = 0; i < stageCount; i++) {
+    x = stages[i]->process(x, dtMs);
+  }
+
+  output = x;
+  primed = true;
+  return fromFixed(output);
+}
+
+void FilterChain::reset() {
+  for (uint8_t i = 0; i < stageCount; i++) {
+    stages[i]->reset();
+  }
+  primed = false;
+  invalidCount = 0;
+}
@@ -0,0 +1,182 @@
+#ifndef SENSOR_FILTER_H
+#define SENSOR_FILTER_H
+
+// Allocation-free streaming filters for sensor channels.
+// Values run through the chain as Q16.16 fixed point; this header has no
+// Arduino dependencies so the stages also build on the host.
+
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+typedef int32_t fixed_t;  // Q16.16, range +/-32768 with 1/65536 resolution
+
+#define FIXED_SHIFT 16
+#define FIXED_ONE   ((fixed_t)1 << FIXED_SHIFT)
+#define FILTER_MAX_STAGES 4
+
+inline fixed_t toFixed(float value) { return (fixed_t)lroundf(value * FIXED_ONE); }
+inline float fromFixed(fixed_t value) { return (float)value / FIXED_ONE; }
+inline fixed_t fixedMul(fixed_t a, fixed_t b) { return (fixed_t)(((int64_t)a * b) >> FIXED_SHIFT); }
+inline fixed_t fixedAbs(fixed_t value) { return value < 0 ? -value : value; }
+
+class FilterStage {
+public:
+  virtual ~FilterStage() {}
+  virtual fixed_t process(fixed_t x, uint32_t dtMs) = 0;
+  virtual void reset() = 0;
+};
+
+// ========== SORTED WINDOW ==========
+// Ring buffer plus a sorted copy of the last N samples. Insert/remove locate
+// their slot with a binary search and shift at most N words.
+template <uint8_t N>
+class SortedWindow {
+private:
+  fixed_t ring[N];
+  fixed_t sorted[N];
+  uint8_t head;
+  uint8_t count;
+
+  uint8_t lowerBound(fixed_t value) const {
+    uint8_t lo = 0, hi = count;
+    while (lo < hi) {
+      uint8_t mid = (lo + hi) / 2;
+      if (sorted[mid] < value) lo = mid + 1; else hi = mid;
+    }
+    return lo;
+  }
+
+public:
+  SortedWindow() : head(0), count(0) {}
+
+  void push(fixed_t value) {
+    if (count == N) {
+      // Evict the oldest sample from the sorted copy
+      uint8_t pos = lowerBound(ring[head]);
+      memmove(&sorted[pos], &sorted[pos + 1], (count - pos - 1) * sizeof(fixed_t));
+      count--;
+    }
+    uint8_t pos = lowerBound(value);
+    memmove(&sorted[pos + 1], &sorted[pos], (count - pos) * sizeof(fixed_t));
+    sorted[pos] = value;
+    count++;
+
+    ring[head] = value;
+    head = (head + 1) % N;
+  }
+
+  fixed_t median() const { return sorted[count / 2]; }
+  bool full() const { return count == N; }
+  uint8_t size() const { return count; }
+  void clear() { head = 0; count = 0; }
+};
+
+// ========== ROLLING MEDIAN ==========
+template <uint8_t N>
+class MedianFilter : public FilterStage {
+private:
+  SortedWindow<N> window;
+
+public:
+  fixed_t process(fixed_t x, uint32_t) override {
+    window.push(x);
+    return window.median();
+  }
+  void reset() override { window.clear(); }
+};
+
+// ========== EXPONENTIAL MOVING AVERAGE ==========
+// alpha = 1 / 2^shift, so the update is a subtract, shift and add.
+class EmaFilter : public FilterStage {
+private:
+  uint8_t shift;
+  fixed_t state;
+  bool primed;
+
+public:
+  EmaFilter(uint8_t shift);
+  fixed_t process(fixed_t x, uint32_t dtMs) override;
+  void reset() override { primed = false; }
+};
+
+// ========== HAMPEL OUTLIER REJECTION ==========
+// Samples further than k * 1.4826 * MAD from the window median are replaced
+// by the median. MAD is tracked as an EMA of |x - median| so the stage stays
+// O(log N) instead of sorting deviations every sample.
+template <uint8_t N>
+class HampelFilter : public FilterStage {
+private:
+  SortedWindow<N> window;
+  fixed_t k;         // Threshold in MADs
+  fixed_t madFloor;  // Minimum scale, avoids rejecting every step on flat signals
+  fixed_t mad;
+  uint32_t rejected;
+
+public:
+  HampelFilter(float k, float madFloor)
+    : k(toFixed(k * 1.4826f)), madFloor(toFixed(madFloor)), mad(0), rejected(0) {}
+
+  fixed_t process(fixed_t x, uint32_t) override {
+    window.push(x);
+    if (window.size() < 3) return x;
+
+    fixed_t median = window.median();
+    fixed_t deviation = fixedAbs(x - median);
+    fixed_t scale = mad > madFloor ? mad : madFloor;
+    fixed_t limit = fixedMul(k, scale);
+
+    // Clip the deviation fed into the MAD estimate so outliers don't inflate it
+    fixed_t clipped = deviation > limit ? limit : deviation;
+    mad += (clipped - mad) >> 3;
+
+    if (deviation > limit) {
+      rejected++;
+      return median;
+    }
+    return x;
+  }
+
+  void reset() override { window.clear(); mad = 0; }
+  uint32_t getRejected() const { return rejected; }
+};
+
+// ========== RATE-OF-CHANGE CLAMP ==========
+class RateLimitFilter : public FilterStage {
+private:
+  fixed_t maxRate;   // Units per second
+  fixed_t state;
+  bool primed;
+
+public:
+  RateLimitFilter(float maxPerSecond);
+  fixed_t process(fixed_t x, uint32_t dtMs) override;
+  void reset() override { primed = false; }
+};
+
+// ========== FILTER CHAIN ==========
+// Per-channel pipeline. Stages are owned by the caller (usually statics), the
+// chain only keeps pointers. NaN inputs are rejected and the last output held.
+class FilterChain {
+private:
+  FilterStage *stages[FILTER_MAX_STAGES];
+  uint8_t stageCount;
+  fixed_t output;
+  bool primed;
+  uint32_t lastMs;
+  uint32_t invalidCount;
+
+public:
+  FilterChain();
+
+  FilterChain &add(FilterStage *stage);
+  float apply(float value, uint32_t nowMs);
+  void reset();
+
+  // Getters
+  bool hasValue() const { return primed; }
+  float get() const { return fromFixed(output); }
+  uint32_t getInvalidCount() const { return invalidCount; }
+};
+
+#endif // SENSOR_FILTER_H
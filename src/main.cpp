@@ -2,15 +2,21 @@
 
 // Configuration
 #include "config/Config.h"
+#include "config/ConfigRegistry.h"
 
 // Sensors
 #include "sensors/DHTSensor.h"
+#include "filters/SensorFilter.h"
 #include "sensors/NPKSensor.h"
 #include "sensors/MQ135Sensor.h"
 #include "sensors/TDSSensor.h"
+#include "sensors/AdcCalibration.h"
+#include "sensors/SensorHealth.h"
 
 // Controllers
 #include "controllers/PumpController.h"
+#include "controllers/ActuationTracker.h"
+#include "controllers/RuleEngine.h"
 
 // Display
 #include "display/LCDDisplay.h"
@@ -19,32 +25,99 @@
 #include "network/WiFiManager.h"
 #include "network/MQTTManager.h"
 #include "network/WebServer.h"
+#include "network/CommandDispatcher.h"
+
+// System
+#include "system/PowerManager.h"
+#include "system/SamplingPolicy.h"
+#include "system/HeapMonitor.h"
+#include "system/OTAManager.h"
+#include "system/TimeService.h"
+#include "system/StatsAggregator.h"
+#include "system/LatencyHistogram.h"
+#include "system/I2CBus.h"
+
+// Storage
+#include "storage/SampleStore.h"
+#include "storage/PumpStateStore.h"
+#include "storage/TraceRecorder.h"
 
 // ========== GLOBAL OBJECTS ==========
+// Configuration
+ConfigRegistry configRegistry;
+
 // Sensors
+AdcCalibration adcCalibration;
 DHTSensor dhtSensor(DHT_PIN, DHT_TYPE);
 HardwareSerial RS485Serial(2);
 NPKSensor npkSensor(&RS485Serial, RS485_DE_RE);
 MQ135Sensor mq135Sensor(MQ135_AO_PIN, MQ135_DO_PIN);
 TDSSensor tdsSensor(TDS_PIN);
 
+// Sensor health (indexed by SensorId)
+SensorHealth npkHealth("npk");
+SensorHealth dhtHealth("dht");
+SensorHealth mq135Health("mq135");
+SensorHealth tdsHealth("tds");
+SensorHealth *sensorHealth[SENSOR_COUNT] = {&npkHealth, &dhtHealth, &mq135Health, &tdsHealth};
+
+// Sensor filters (stages are static, chains hold pointers)
+HampelFilter<5> tempHampel(3.0f, 0.2f);
+EmaFilter tempEma(2);
+HampelFilter<5> humHampel(3.0f, 0.5f);
+EmaFilter humEma(2);
+HampelFilter<5> soilHampel(3.0f, 1.0f);
+RateLimitFilter soilRate(5.0f);         // %/s, fast enough to track watering
+HampelFilter<5> phHampel(3.0f, 0.1f);
+MedianFilter<5> airMedian;
+EmaFilter airEma(3);
+MedianFilter<5> tdsMedian;
+EmaFilter tdsEma(2);
+
+FilterChain temperatureFilter;
+FilterChain humidityFilter;
+FilterChain soilFilter;
+FilterChain phFilter;
+FilterChain airFilter;
+FilterChain tdsFilter;
+
 // Controllers
 PumpController pumpController(RELAY_PIN, RELAY_ACTIVE_LOW);
+ActuationTracker actuationTracker;
 
 // Display
+I2CBus i2cBus;
 LCDDisplay lcdDisplay;
 
 // Network
 WiFiManager wifiManager;
 MQTTManager mqttManager;
 AgroWebServer webServer(80);
+CommandDispatcher commandDispatcher;
+
+// System
+PowerManager powerManager(POWER_WAKE_PIN);
+SamplingPolicy samplingPolicy;
+HeapMonitor heapMonitor;
+OTAManager otaManager;
+TimeService timeService;
+StatsAggregator statsAggregator;
+RuleEngine ruleEngine;
+LatencyHistogram loopLatency;   // Busy part of each loop pass, for /metrics
+
+// Storage
+SampleStore sampleStore;
+PumpStateStore pumpStateStore;
+TraceRecorder traceRecorder;
 
 // ========== TIMING VARIABLES ==========
-unsigned long lastSensorRead = 0;
-unsigned long lastNPKRead = 0;
+unsigned long lastSensorRead = 0;   // Output refresh (MQTT / web / LCD); reads are scheduled by samplingPolicy
+unsigned long lastHealthPublish = 0;
+uint32_t lastStoreSlot = 0;          // time() / STORE_INTERVAL of the last stored reading
 
 // ========== SENSOR DATA CACHE ==========
 int soilMoisture = 0;
+bool soilFresh = false;     // Irrigation only acts on fresh soil readings
 float temperature = 0;
 float humidity = 0;
 int airQuality = 0;
@@ -53,6 +126,67 @@ bool airQualityGood = true;
 int tdsValue = 0;
 int tdsRaw = 0;
 
+// Milliseconds left until a periodic task is due (0 if overdue)
+unsigned long msUntil(unsigned long last, unsigned long interval) {
+  unsigned long elapsed = millis() - last;
+  return elapsed >= interval ? 0 : interval - elapsed;
+}
+
+// ========== SAMPLING POLICY ==========
+void configureSampling() {
+  unsigned long ambient = SENSOR_READ_INTERVAL * 1000UL;
+  samplingPolicy.configure(SENSOR_NPK, "npk", NPK_READ_INTERVAL, SOIL_SAMPLE_MIN, SOIL_SAMPLE_MAX, 0.5f, true);
+  samplingPolicy.configure(SENSOR_DHT, "dht", ambient, 2000, AMBIENT_SAMPLE_MAX, 0.3f, false);
+  samplingPolicy.configure(SENSOR_MQ135, "mq135", ambient, 2000, AMBIENT_SAMPLE_MAX, 40, false);
+  samplingPolicy.configure(SENSOR_TDS, "tds", ambient, 2000, AMBIENT_SAMPLE_MAX, 20, false);
+}
+
+// Soil moisture drives the stop decision: sample it fast while watering,
+// and keep watching while the water soaks in
+void updateSamplingDemand() {
+  if (pumpController.isPumpActive()) {
+    samplingPolicy.demand(SENSOR_NPK, SOIL_SAMPLE_MIN);
+  } else if (pumpController.isSettling()) {
+    samplingPolicy.demand(SENSOR_NPK, SAMPLING_WATCH_INTERVAL);
+  } else {
+    samplingPolicy.demand(SENSOR_NPK, 0);
+  }
+  
+  for (uint8_t i = 0; i < SENSOR_COUNT; i++) {
+    sensorHealth[i]->setExpectedInterval(samplingPolicy.getInterval((SensorId)i));
+  }
+}
+
+// "sample" command: read every sensor on the next loop pass
+void onSampleRequested() {
+  samplingPolicy.requestSample();
+  lastSensorRead = millis() - SENSOR_READ_INTERVAL * 1000UL;
+}
+
+// New firmware is only confirmed once it is back on the network
+bool firmwareHealthy() {
+  return wifiManager.isConnected() && mqttManager.isConnected();
+}
+
+// ========== CONFIG CHANGE HANDLING ==========
+void onConfigChanged(uint8_t groups) {
+  if (groups & CONFIG_GROUP_TIMING) {
+    configureSampling();
+  }
+  if (groups & CONFIG_GROUP_SENSORS) {
+    mq135Sensor.rebuildPpmTable();
+  }
+  if (groups & CONFIG_GROUP_MQTT) {
+    mqttManager.requestReconfigure();
+  }
+  if (groups & CONFIG_GROUP_IRRIGATION) {
+    traceRecorder.recordConfig();
+  }
+  if (groups & CONFIG_GROUP_RULES) {
+    ruleEngine.reload();
+  }
+}
+
 // ========== STATUS LED CONTROL ==========
 void updateStatusLED() {
   static unsigned long lastBlink = 0;
@@ -78,41 +212,199 @@ void updateStatusLED() {
   }
 }
 
-// ========== READ ALL SENSORS ==========
-void readAllSensors() {
-  // Read DHT sensor
-  dhtSensor.read();
-  temperature = dhtSensor.getTemperature();
-  humidity = dhtSensor.getHumidity();
-  
-  // Read MQ135 air quality sensor
-  mq135Sensor.read();
-  airQuality = mq135Sensor.getQualityPercent();
-  airQualityRaw = mq135Sensor.getRawValue();
-  airQualityGood = mq135Sensor.isGoodQuality();
+// ========== SENSOR HEALTH ==========
+// An analog input stuck at either rail means a floating or shorted sensor
+bool analogRailed(int raw) {
+  return raw <= 0 || raw >= ADC_RAW_MAX;
+}
+
+// ========== READ SENSORS ==========
+// Every good reading feeds the window statistics and the local rules
+void onSample(StoreMetric metric, float value) {
+  traceRecorder.recordSample(metric, value);
+  statsAggregator.add(metric, value);
+  ruleEngine.onSample(metric, value);
+}
+
+// Failed registers go on as NaN, which the stats, rules and history skip
+float npkValue(uint16_t registerAddress, float value) {
+  return npkSensor.isValid(registerAddress) ? value : NAN;
+}
+
+void readNPK() {
+  unsigned long t0 = micros();
+  bool ok;
   
-  // Read TDS sensor
-  tdsSensor.read();
-  tdsValue = tdsSensor.getTDS();
-  tdsRaw = tdsSensor.getRawValue();
+  if (npkHealth.isProbing()) {
+    // While failing, a single-register probe decides whether a full read is worth it
+    ok = npkSensor.probe() && npkSensor.readSensor();
+  } else if (pumpController.isPumpActive()) {
+    // Moisture only: one register instead of seven keeps up with SOIL_SAMPLE_MIN
+    ok = npkSensor.readMoisture();
+  } else {
+    ok = npkSensor.readSensor();
+  }
   
-  // Get soil moisture from NPK sensor
-  if (npkSensor.isAvailable() && npkSensor.getHumidity() >= 0) {
-    soilMoisture = (int)npkSensor.getHumidity();
+  uint32_t cost = micros() - t0;
+  if (ok) {
+    npkHealth.recordSuccess(cost, npkSensor.getHumidity());
   } else {
-    soilMoisture = 0;
+    npkHealth.recordFailure(cost);
   }
+  samplingPolicy.recordSample(SENSOR_NPK, ok ? npkSensor.getHumidity() : NAN, cost, millis());
   
-  // Update consecutive dry counter for pump controller
-  if (soilMoisture <= MOISTURE_THRESHOLD) {
+  // Update consecutive dry counter for pump controller (once per soil sample)
+  if (!ok) return;
+  onSample(STORE_SOIL, npkValue(MOISTURE_REGISTER, npkSensor.getHumidity()));
+  if (!pumpController.isPumpActive()) {
+    onSample(STORE_SOIL_TEMP, npkValue(TEMPERATURE_REGISTER, npkSensor.getTemperature()));
+    onSample(STORE_PH, npkValue(PH_REGISTER, npkSensor.getPH()));
+    onSample(STORE_EC, npkValue(CONDUCTIVITY_REGISTER, npkSensor.getEC()));
+    onSample(STORE_N, npkValue(NITROGEN_REGISTER, npkSensor.getNitrogen()));
+    onSample(STORE_P, npkValue(PHOSPHORUS_REGISTER, npkSensor.getPhosphorus()));
+    onSample(STORE_K, npkValue(POTASSIUM_REGISTER, npkSensor.getPotassium()));
+  }
+  if (npkSensor.getHumidity() >= 0 && npkSensor.getHumidity() <= MOISTURE_THRESHOLD) {
     int count = pumpController.getConsecutiveDryCount() + 1;
     pumpController.setConsecutiveDryCount(count);
   } else {
     pumpController.setConsecutiveDryCount(0);
   }
+}
+
+void publishHealth() {
+  if (!mqttManager.isConnected()) return;
+  
+  JsonDocument doc;
+  doc["device"] = mqttManager.getClientId();
+  doc["time"] = timeService.utcMs();
+  doc["tq"] = TimeService::getQualityName(timeService.getQuality());
+  doc["uptime"] = TimeService::monoMs() / 1000;
+  for (uint8_t i = 0; i < SENSOR_COUNT; i++) {
+    sensorHealth[i]->toJson(doc["health"][sensorHealth[i]->getName()], millis());
+  }
+  heapMonitor.toJson(doc["heap"]);
+  actuationTracker.summaryJson(doc["actuation"]);
+  mqttManager.publishSystemStatus(doc);
+}
+
+void readAmbientSensors(unsigned long now) {
+  unsigned long t0;
+  
+  // DHT: the RMT captures the reply in the background; account for it once decoded
+  dhtSensor.loop();
+  DHTReading reading;
+  uint32_t latency;
+  if (dhtSensor.takeReading(reading, latency)) {
+    bool ok = reading.status == DHT_OK;
+    if (ok) {
+      dhtHealth.recordSuccess(latency, dhtSensor.getTemperature());
+    } else {
+      // Log the pulse train of the first failure in a row for offline decoding
+      if (dhtHealth.getConsecutiveFailures() == 0) {
+        Serial.printf("⚠️  DHT read failed: %s\n", dhtStatusName(reading.status));
+        dhtSensor.dumpTrace(Serial);
+      }
+      dhtHealth.recordFailure(latency);
+    }
+    temperature = dhtSensor.getTemperature();
+    humidity = dhtSensor.getHumidity();
+    if (ok) {
+      onSample(STORE_TEMP, temperature);
+      onSample(STORE_HUM, humidity);
+    }
+    samplingPolicy.recordSample(SENSOR_DHT, ok ? temperature : NAN, latency, millis());
+  } else if (samplingPolicy.isDue(SENSOR_DHT, now)) {
+    dhtSensor.startRead();
+  }
+  
+  // Read MQ135 air quality sensor
+  if (samplingPolicy.isDue(SENSOR_MQ135, now)) {
+    t0 = micros();
+    mq135Sensor.read();
+    uint32_t cost = micros() - t0;
+    airQuality = mq135Sensor.getQualityPercent();
+    airQualityRaw = mq135Sensor.getRawValue();
+    airQualityGood = mq135Sensor.isGoodQuality();
+    bool ok = !analogRailed(airQualityRaw);
+    if (ok) {
+      mq135Health.recordSuccess(cost, airQualityRaw);
+      onSample(STORE_AIR, airQuality);
+    } else {
+      mq135Health.recordFailure(cost);
+    }
+    samplingPolicy.recordSample(SENSOR_MQ135, ok ? airQualityRaw : NAN, cost, millis());
+  }
+  
+  // Read TDS sensor
+  if (samplingPolicy.isDue(SENSOR_TDS, now)) {
+    t0 = micros();
+    tdsSensor.read();
+    uint32_t cost = micros() - t0;
+    tdsValue = tdsSensor.getTDS();
+    tdsRaw = tdsSensor.getRawValue();
+    // 0 is valid (dry probe / pure water), only the top rail is a fault
+    bool ok = tdsRaw < ADC_RAW_MAX;
+    if (ok) {
+      tdsHealth.recordSuccess(cost, tdsRaw);
+      onSample(STORE_TDS, tdsValue);
+    } else {
+      tdsHealth.recordFailure(cost);
+    }
+    samplingPolicy.recordSample(SENSOR_TDS, ok ? tdsRaw : NAN, cost, millis());
+  }
+}
+
+// Soil moisture as seen by irrigation (held values are not trusted once stale)
+void updateSoilMoisture() {
+  soilFresh = npkSensor.isAvailable() && !npkHealth.isStale(millis()) &&
+              npkSensor.getHumidity() >= 0;
+  soilMoisture = soilFresh ? (int)npkSensor.getHumidity() : 0;
+}
+
+// ========== HISTORY ==========
+// Stores one reading per metric on a clock-aligned STORE_INTERVAL grid, so
+// timestamps are regular and compress to ~1 bit each. Stale sensors are skipped,
+// and nothing is stored before the first SNTP sync (no UTC to stamp it with).
+void recordHistory() {
+  if (timeService.getQuality() == TIME_UNSYNCED) return;
+  uint32_t now = timeService.utcMs() / 1000;
+  uint32_t slot = now / STORE_INTERVAL;
+  if (slot == lastStoreSlot) return;
+  lastStoreSlot = slot;
   
-  Serial.printf("📊 Sensors: Soil=%d%% Temp=%.1f°C Hum=%.1f%% Air=%d%% TDS=%dppm\n",
-                soilMoisture, temperature, humidity, airQuality, tdsValue);
+  uint32_t t = slot * STORE_INTERVAL;
+  unsigned long ms = millis();
+  if (soilFresh) {
+    sampleStore.record(STORE_SOIL, t, soilMoisture);
+    // Fields whose register failed are NaN and not stored
+    sampleStore.record(STORE_SOIL_TEMP, t, npkValue(TEMPERATURE_REGISTER, npkSensor.getTemperature()));
+    sampleStore.record(STORE_PH, t, npkValue(PH_REGISTER, npkSensor.getPH()));
+    sampleStore.record(STORE_EC, t, npkValue(CONDUCTIVITY_REGISTER, npkSensor.getEC()));
+    sampleStore.record(STORE_N, t, npkValue(NITROGEN_REGISTER, npkSensor.getNitrogen()));
+    sampleStore.record(STORE_P, t, npkValue(PHOSPHORUS_REGISTER, npkSensor.getPhosphorus()));
+    sampleStore.record(STORE_K, t, npkValue(POTASSIUM_REGISTER, npkSensor.getPotassium()));
+  }
+  if (!dhtHealth.isStale(ms)) {
+    sampleStore.record(STORE_TEMP, t, temperature);
+    sampleStore.record(STORE_HUM, t, humidity);
+  }
+  if (!mq135Health.isStale(ms)) {
+    sampleStore.record(STORE_AIR, t, airQuality);
+  }
+  if (!tdsHealth.isStale(ms)) {
+    sampleStore.record(STORE_TDS, t, tdsValue);
+  }
+}
+
+unsigned long msUntilNextRecord() {
+  if (timeService.getQuality() == TIME_UNSYNCED) return STORE_INTERVAL * 1000UL;
+  return STORE_INTERVAL * 1000UL - (timeService.utcMs() % (STORE_INTERVAL * 1000UL));
+}
+
+void logSensors() {
+  Serial.printf("📊 Sensors: Soil=%d%%%s Temp=%.1f°C Hum=%.1f%% Air=%d%% TDS=%dppm\n",
+                soilMoisture, soilFresh ? "" : " (stale)", temperature, humidity, airQuality, tdsValue);
 }
 
 // ========== PUBLISH MQTT DATA ==========
@@ -120,9 +412,11 @@ void publishSensorData() {
   if (!mqttManager.isConnected()) return;
   
   JsonDocument doc;
-  doc["device"] = MQTT_CLIENT_ID;
-  doc["time"] = millis() / 1000;
+  doc["device"] = mqttManager.getClientId();
+  doc["time"] = timeService.utcMs();
+  doc["tq"] = TimeService::getQualityName(timeService.getQuality());
   doc["soil"] = soilMoisture;
+  doc["soilFresh"] = soilFresh;
   doc["temp"] = temperature;
   doc["hum"] = humidity;
   doc["air"] = airQuality;
@@ -132,9 +426,19 @@ void publishSensorData() {
   doc["pump"] = pumpController.isPumpActive();
   doc["count"] = pumpController.getWateringCount();
   doc["wtime"] = pumpController.getTotalWateringTime();
-  doc["uptime"] = millis() / 1000;
+  doc["uptime"] = TimeService::monoMs() / 1000;
   doc["tdsRaw"] = tdsRaw;
   doc["tds"] = tdsValue;
+  doc["irr"]["mode"] = pumpController.getMode() == MODE_PULSE_SOAK ? "pulse" : "bang";
+  doc["irr"]["on24h"] = pumpController.getOnTimeLast24h();
+  doc["irr"]["cycles24h"] = pumpController.getRelayCyclesLast24h();
+  doc["irr"]["overshoot"] = pumpController.getLastOvershoot();
+  doc["irr"]["dryRate"] = pumpController.getDryingRate();
+  TimeService::stampJson(doc["irr"]["lastOn"], pumpController.getLastStarted());
+  TimeService::stampJson(doc["irr"]["lastOff"], pumpController.getLastStopped());
+  doc["power"]["duty"] = powerManager.getDutyCycle();
+  doc["power"]["wakeLat"] = powerManager.getAvgWakeLatency();
+  samplingPolicy.toJson(doc["sampling"]);
   
   // NPK Sensor data
   if (npkSensor.isAvailable()) {
@@ -144,11 +448,33 @@ void publishSensorData() {
     doc["npk"]["ph"] = npkSensor.getPH();
     doc["npk"]["ec"] = npkSensor.getEC();
     doc["npk"]["soilTemp"] = npkSensor.getTemperature();
+    doc["npk"]["age"] = npkHealth.getAgeSeconds(millis());
   }
   
   mqttManager.publishSensorData(doc);
 }
 
+// One aggregate per metric group for the window that just ended. Without raw
+// samples the snapshot (pump, irrigation, power state) goes out at the same pace.
+void publishStats() {
+  if (mqttManager.isConnected()) {
+    TimeStamp start = statsAggregator.getWindowStart();
+    for (uint8_t group = 0; group < STATS_GROUP_COUNT; group++) {
+      if (!statsAggregator.hasSamples((StatsGroup)group)) continue;
+      JsonDocument doc;
+      doc["device"] = mqttManager.getClientId();
+      doc["time"] = start.utcMs;
+      doc["tq"] = TimeService::getQualityName(start.quality);
+      doc["win"] = statsAggregator.getWindowSeconds();
+      doc["group"] = StatsAggregator::getGroupName((StatsGroup)group);
+      statsAggregator.toJson((StatsGroup)group, doc["m"]);
+      mqttManager.publishStats(doc);
+    }
+    if (!MQTT_RAW_SAMPLES) publishSensorData();
+  }
+  statsAggregator.startWindow();
+}
+
 // ========== SETUP ==========
 void setup() {
   // Initialize Serial
@@ -160,12 +486,35 @@ void setup() {
   Serial.println("   Modular Architecture        ");
   Serial.println("================================");
   
+  // Load runtime configuration before anything reads it
+  configRegistry.begin();
+  configRegistry.setChangeCallback(onConfigChanged);
+  configureSampling();
+  
+  // Check whether this boot is a freshly installed, unconfirmed image
+  otaManager.begin();
+  otaManager.setPumpController(&pumpController);
+  otaManager.setHealthCheck(firmwareHealthy);
+  
   // Initialize status LED
   pinMode(LED_STATUS_PIN, OUTPUT);
   digitalWrite(LED_STATUS_PIN, HIGH);
   
   // Initialize sensors
   Serial.println("\n📡 Initializing sensors...");
+  temperatureFilter.add(&tempHampel).add(&tempEma);
+  humidityFilter.add(&humHampel).add(&humEma);
+  soilFilter.add(&soilHampel).add(&soilRate);
+  phFilter.add(&phHampel);
+  airFilter.add(&airMedian).add(&airEma);
+  tdsFilter.add(&tdsMedian).add(&tdsEma);
+  dhtSensor.setFilters(&temperatureFilter, &humidityFilter);
+  npkSensor.setFilters(&soilFilter, &phFilter);
+  mq135Sensor.setFilter(&airFilter);
+  tdsSensor.setFilter(&tdsFilter);
+  adcCalibration.begin();
+  mq135Sensor.setCalibration(&adcCalibration);
+  tdsSensor.setCalibration(&adcCalibration);
   dhtSensor.begin();
   npkSensor.begin();
   mq135Sensor.begin();
@@ -174,9 +523,16 @@ void setup() {
   // Initialize pump controller
   Serial.println("\n💧 Initializing pump controller...");
   pumpController.begin();
+  pumpStateStore.setPumpController(&pumpController);
+  pumpStateStore.begin();
+  traceRecorder.setPumpController(&pumpController);
+  pumpController.setTracer(&traceRecorder);
+  traceRecorder.begin();
   
-  // Initialize LCD
+  // Initialize LCD (through the I2C bus task)
   Serial.println("\n📺 Initializing LCD display...");
+  i2cBus.begin();
+  lcdDisplay.setBus(&i2cBus);
   if (lcdDisplay.begin(0x27)) {
     lcdDisplay.showMessage("AgroHygra v2.0", "Starting...");
   } else {
@@ -198,46 +554,96 @@ void setup() {
     wifiManager.startAPMode();
     lcdDisplay.showMessage("AP Mode", "192.168.4.1");
   } else {
-    lcdDisplay.showMessage("WiFi Connected", WiFi.localIP().toString());
+    lcdDisplay.showMessage("WiFi Connected", wifiManager.getIPAddress());
   }
   
+  // Wall clock for samples, events and history (syncs in the background)
+  timeService.begin();
+  
   delay(2000);
   
   // Initialize MQTT
   Serial.println("\n📨 Initializing MQTT...");
   mqttManager.begin();
-  mqttManager.setPumpController(&pumpController);
+  commandDispatcher.setPumpController(&pumpController);
+  commandDispatcher.setConfigRegistry(&configRegistry);
+  commandDispatcher.setOTAManager(&otaManager);
+  commandDispatcher.setActuationTracker(&actuationTracker);
+  commandDispatcher.setSampleCallback(onSampleRequested);
+  mqttManager.setCommandDispatcher(&commandDispatcher);
+  mqttManager.setConfigRegistry(&configRegistry);
   
   // Initialize Web Server
   Serial.println("\n🌐 Initializing web server...");
   webServer.begin();
   webServer.setWiFiManager(&wifiManager);
   webServer.setPumpController(&pumpController);
+  webServer.setConfigRegistry(&configRegistry);
   webServer.setSensors(&npkSensor, &mq135Sensor, &tdsSensor, &dhtSensor);
+  webServer.setSensorHealth(sensorHealth, SENSOR_COUNT);
+  webServer.setSamplingPolicy(&samplingPolicy);
+  webServer.setHeapMonitor(&heapMonitor);
+  webServer.setOTAManager(&otaManager);
+  webServer.setSampleStore(&sampleStore);
+  webServer.setActuationTracker(&actuationTracker);
+  webServer.setDeviceId(mqttManager.getClientId());
+  webServer.setTimeService(&timeService);
+  webServer.setRuleEngine(&ruleEngine);
+  webServer.setPumpStateStore(&pumpStateStore);
+  webServer.setTraceRecorder(&traceRecorder);
+  webServer.setI2CBus(&i2cBus);
+  webServer.setMQTTManager(&mqttManager);
+  webServer.setLoopLatency(&loopLatency);
+  
+  // Initialize power management (after WiFi so modem sleep applies to STA)
+  Serial.println("\n🔋 Initializing power manager...");
+  powerManager.begin();
+  
+  // On-device history (raw flash partition)
+  Serial.println("\n📦 Initializing sample store...");
+  sampleStore.begin();
+  
+  // Per-window aggregates (after the clock, so windows align once it syncs)
+  statsAggregator.begin();
+  
+  // Local rules act on samples without the cloud round trip
+  ruleEngine.setPumpController(&pumpController);
+  ruleEngine.setMQTTManager(&mqttManager);
+  ruleEngine.begin();
+  
+  // Heap baseline once everything long-lived is allocated
+  heapMonitor.begin();
   
   Serial.println("\n================================");
   Serial.println("✅ System initialized!");
   Serial.println("================================");
-  Serial.printf("Web Interface: http://%s\n", 
-                wifiManager.isAPMode() ? "192.168.4.1" : WiFi.localIP().toString().c_str());
+  Serial.printf("Web Interface: http://%s\n", wifiManager.getIPAddress());
   Serial.println("================================\n");
 }
 
 // ========== MAIN LOOP ==========
 void loop() {
-  // Read NPK sensor every second
-  if (millis() - lastNPKRead >= NPK_READ_INTERVAL) {
-    lastNPKRead = millis();
-    npkSensor.readSensor();
+  uint32_t loopStart = micros();
+  unsigned long now = millis();
+  updateSamplingDemand();
+  
+  // Read soil (NPK) at its adaptive rate (a failing probe backs off exponentially)
+  if (samplingPolicy.isDue(SENSOR_NPK, now) && npkHealth.shouldAttempt(now)) {
+    powerManager.markSample();
+    readNPK();
   }
   
-  // Read all other sensors every 2 seconds
+  // Read ambient sensors that are due
+  readAmbientSensors(now);
+  updateSoilMoisture();
+  
+  // Refresh outputs every SENSOR_READ_INTERVAL from the cached values
   if (millis() - lastSensorRead >= (SENSOR_READ_INTERVAL * 1000UL)) {
     lastSensorRead = millis();
-    readAllSensors();
+    logSensors();
     
-    // Publish sensor data via MQTT
-    publishSensorData();
+    // Raw snapshots only for debugging; aggregates go out per window
+    if (MQTT_RAW_SAMPLES) publishSensorData();
     
     // Update web server with latest data
     webServer.updateSensorData(soilMoisture, temperature, humidity, 
@@ -253,22 +659,69 @@ void loop() {
                       mqttManager.isConnected(),
                       wifiManager.isAPMode(),
                       wifiManager.getSSID(),
-                      wifiManager.isAPMode() ? "192.168.4.1" : WiFi.localIP().toString());
+                      wifiManager.getIPAddress());
   }
   
+  // Close the statistics window
+  if (statsAggregator.isDue()) publishStats();
+  
+  // Fire rules whose debounce ran out since their last sample
+  ruleEngine.loop();
+  
+  // Store history at STORE_INTERVAL, flush aged blocks to flash
+  recordHistory();
+  sampleStore.loop();
+  pumpStateStore.loop();
+  traceRecorder.loop();
+  
   // Update LCD (handles its own timing)
   lcdDisplay.update();
   
-  // Auto irrigation logic
-  pumpController.autoIrrigate(soilMoisture);
+  // Auto irrigation logic (never on stale soil data; safety limits always apply)
+  if (soilFresh) {
+    pumpController.autoIrrigate(soilMoisture);
+  } else {
+    pumpController.checkSafety();
+  }
+  
+  // Publish sensor health
+  if (millis() - lastHealthPublish >= HEALTH_PUBLISH_INTERVAL) {
+    lastHealthPublish = millis();
+    publishHealth();
+  }
   
   // Handle network tasks
+  timeService.loop();
   mqttManager.loop();
   webServer.loop();
   
   // Update status LED
   updateStatusLED();
   
-  // Small delay to prevent watchdog timeout
-  delay(10);
+  // Persist pending config changes (coalesced)
+  configRegistry.loop();
+  
+  // Track heap / fragmentation
+  heapMonitor.loop();
+  
+  // Firmware download, post-update health check, pending reboot
+  otaManager.loop();
+  
+  loopLatency.record(micros() - loopStart);
+  
+  // Sleep until the next scheduled task (falls back to a short delay)
+  now = millis();
+  unsigned long nextDeadline = max(samplingPolicy.msUntilDue(SENSOR_NPK, now),
+                                   npkHealth.msUntilAttempt(now));
+  nextDeadline = min(nextDeadline, samplingPolicy.msUntilDue(SENSOR_DHT, now));
+  nextDeadline = min(nextDeadline, samplingPolicy.msUntilDue(SENSOR_MQ135, now));
+  nextDeadline = min(nextDeadline, samplingPolicy.msUntilDue(SENSOR_TDS, now));
+  nextDeadline = min(nextDeadline, msUntil(lastSensorRead, SENSOR_READ_INTERVAL * 1000UL));
+  nextDeadline = min(nextDeadline, msUntil(lastHealthPublish, HEALTH_PUBLISH_INTERVAL));
+  nextDeadline = min(nextDeadline, lcdDisplay.msUntilUpdate());
+  nextDeadline = min(nextDeadline, msUntilNextRecord());
+  nextDeadline = min(nextDeadline, statsAggregator.msUntilDue());
+  powerManager.idle(nextDeadline, pumpController.isPumpActive() || wifiManager.isAPMode() ||
+                                  otaManager.isBusy() || otaManager.isHealthPending() ||
+                                  dhtSensor.isBusy() || i2cBus.isBusy());
 }
@@ -0,0 +1,393 @@
+#include "CommandDispatcher.h"
+#include "network/MQTTManager.h"
+#include "controllers/PumpController.h"
+#include "config/ConfigRegistry.h"
+#include "system/OTAManager.h"
+#include <errno.h>
+
+// ========== COMMAND TABLE ==========
+const CommandDispatcher::Command CommandDispatcher::commands[] = {
+  {"pump_on",    &CommandDispatcher::handlePumpOn,    true},
+  {"pump_off",   &CommandDispatcher::handlePumpOff,   true},
+  {"config_set", &CommandDispatcher::handleConfigSet, false},
+  {"sample",     &CommandDispatcher::handleSample,    false},
+  {"reboot",     &CommandDispatcher::handleReboot,    false},
+  {"ota",        &CommandDispatcher::handleOTA,       false},
+};
+
+static const char *statusName(CommandStatus status) {
+  switch (status) {
+    case CMD_OK: return "ok";
+    case CMD_ERROR: return "error";
+    case CMD_BAD_REQUEST: return "bad_request";
+    default: return "unknown_command";
+  }
+}
+
+// ========== IN-PLACE JSON SCANNING ==========
+
+bool Slice::equals(const char *text) const {
+  return strlen(text) == length && memcmp(data, text, length) == 0;
+}
+
+bool Slice::copyTo(char *buffer, size_t size) const {
+  if (length >= size) return false;
+  memcpy(buffer, data, length);
+  buffer[length] = '\0';
+  return true;
+}
+
+static const char *skipWhitespace(const char *p, const char *end) {
+  while (p < end && (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n')) p++;
+  return p;
+}
+
+// p points at the opening quote; returns the position after the closing quote
+static const char *skipString(const char *p, const char *end) {
+  for (p++; p < end; p++) {
+    if (*p == '\\') {
+      p++;
+    } else if (*p == '"') {
+      return p + 1;
+    }
+  }
+  return nullptr;
+}
+
+// Skips any JSON value (nested objects/arrays included), nullptr if malformed
+static const char *skipValue(const char *p, const char *end) {
+  if (p >= end) return nullptr;
+  if (*p == '"') return skipString(p, end);
+
+  if (*p == '{' || *p == '[') {
+    int depth = 0;
+    while (p < end) {
+      if (*p == '"') {
+        p = skipString(p, end);
+        if (!p) return nullptr;
+        continue;
+      }
+      if (*p == '{' || *p == '[') depth++;
+      if (*p == '}' || *p == ']') {
+        if (--depth == 0) return p + 1;
+      }
+      p++;
+    }
+    return nullptr;
+  }
+
+  // Number, true, false, null
+  const char *start = p;
+  while (p < end && *p != ',' && *p != '}' && *p != ']' &&
+         *p != ' ' && *p != '\t' && *p != '\r' && *p != '\n') {
+    p++;
+  }
+  return p > start ? p : nullptr;
+}
+
+bool CommandRequest::field(const char *key, Slice &value, bool *isString) const {
+  const char *end = payload + length;
+  const char *p = skipWhitespace(payload, end);
+  if (p >= end || *p != '{') return false;
+  p++;
+
+  size_t keyLength = strlen(key);
+  while (true) {
+    p = skipWhitespace(p, end);
+    if (p >= end || *p != '"') return false;
+
+    const char *keyStart = p + 1;
+    p = skipString(p, end);
+    if (!p) return false;
+    size_t foundLength = p - 1 - keyStart;
+
+    p = skipWhitespace(p, end);
+    if (p >= end || *p != ':') return false;
+    p = skipWhitespace(p + 1, end);
+
+    const char *valueStart = p;
+    p = skipValue(p, end);
+    if (!p) return false;
+
+    if (foundLength == keyLength && memcmp(keyStart, key, keyLength) == 0) {
+      bool quoted = *valueStart == '"';
+      value.data = quoted ? valueStart + 1 : valueStart;
+      value.length = quoted ? (p - valueStart - 2) : (p - valueStart);
+      if (isString) *isString = quoted;
+      return true;
+    }
+
+    p = skipWhitespace(p, end);
+    if (p >= end || *p != ',') return false;
+    p++;
+  }
+}
+
+// Integers only: strings, fractions and overflow are refused and leave value as it was
+bool CommandRequest::getLong(const char *key, long &value) const {
+  Slice slice;
+  bool quoted;
+  char number[16];
+  if (!field(key, slice, &quoted) || quoted || !slice.copyTo(number, sizeof(number))) return false;
+
+  char *parsed;
+  errno = 0;
+  long result = strtol(number, &parsed, 10);
+  if (parsed == number || *parsed != '\0' || errno == ERANGE) return false;
+  value = result;
+  return true;
+}
+
+bool CommandRequest::getInt64(const char *key, int64_t &value) const {
+  // Millisecond timestamps do not fit a 32-bit long
+  Slice slice;
+  bool quoted;
+  char number[24];
+  if (!field(key, slice, &quoted) || quoted || !slice.copyTo(number, sizeof(number))) return false;
+
+  char *parsed;
+  errno = 0;
+  long long result = strtoll(number, &parsed, 10);
+  if (parsed == number || *parsed != '\0' || errno == ERANGE) return false;
+  value = result;
+  return true;
+}
+
+bool CommandRequest::getString(const char *key, char *buffer, size_t size) const {
+  // Numbers and booleans are returned as their literal text (config values);
+  // escaped strings are not unescaped, so they are refused
+  Slice slice;
+  if (!field(key, slice) || memchr(slice.data, '\\', slice.length)) return false;
+  return slice.copyTo(buffer, size);
+}
+
+// ========== DISPATCH ==========
+
+CommandDispatcher::CommandDispatcher()
+  : queueHead(0), queueCount(0), dropped(0), legacySequence(0),
+    pumpController(nullptr), configRegistry(nullptr), otaManager(nullptr),
+    actuationTracker(nullptr), sampleCallback(nullptr), rebootAt(0) {
+}
+
+CommandDispatcher::Response *CommandDispatcher::enqueue() {
+  if (queueCount >= COMMAND_QUEUE_SIZE) {
+    dropped++;
+    Serial.println("⚠️  Command response queue full, dropping response");
+    return nullptr;
+  }
+  Response *response = &queue[(queueHead + queueCount) % COMMAND_QUEUE_SIZE];
+  queueCount++;
+  memset(response, 0, sizeof(Response));
+  return response;
+}
+
+void CommandDispatcher::dispatchJson(const char *payload, size_t length) {
+  // Stamped before anything else: the receive time of the command
+  ActuationTrace trace;
+  CommandRequest request(payload, length);
+  if (actuationTracker) {
+    int64_t sentMs = 0;
+    request.getInt64("ts", sentMs);
+    actuationTracker->begin(trace, sentMs);
+  }
+  unsigned long t0 = micros();
+
+  Response *response = enqueue();
+  if (!response) return;
+
+  // The id is echoed verbatim, so it must not need escaping
+  Slice id;
+  bool quoted = false;
+  if (request.field("id", id, &quoted) &&
+      (!quoted || !memchr(id.data, '\\', id.length)) && !memchr(id.data, '"', id.length)) {
+    id.copyTo(response->id, sizeof(response->id));
+  }
+
+  Slice name;
+  if (!request.field("cmd", name)) {
+    response->command = "";
+    response->status = CMD_BAD_REQUEST;
+    strlcpy(response->detail, "missing cmd", sizeof(response->detail));
+  } else {
+    response->command = "";
+    response->status = CMD_UNKNOWN;
+    for (size_t i = 0; i < sizeof(commands) / sizeof(commands[0]); i++) {
+      if (!name.equals(commands[i].name)) continue;
+      response->command = commands[i].name;
+
+      bool timed = commands[i].actuates && actuationTracker && pumpController;
+      if (timed && actuationTracker->isExpired(trace)) {
+        // Switching a relay on a command this old would surprise whoever sent it
+        response->status = CMD_ERROR;
+        snprintf(response->detail, sizeof(response->detail), "expired after %ld ms",
+                 (long)(trace.transitUs / 1000));
+        break;
+      }
+
+      response->status = (this->*commands[i].handler)(request, response->detail, sizeof(response->detail));
+      if (timed && response->status == CMD_OK) {
+        actuationTracker->complete(trace, *pumpController);
+        response->trace = trace;
+        response->traced = true;
+      }
+      break;
+    }
+  }
+
+  response->handleUs = micros() - t0;
+  Serial.printf("📨 Command %s (id %s): %s\n", response->command,
+                response->id[0] ? response->id : "-", statusName(response->status));
+}
+
+void CommandDispatcher::dispatchLegacy(const char *payload, size_t length) {
+  if (!pumpController) return;
+
+  // Plain-text ON/OFF on the original pump topic
+  Slice message = {payload, length};
+  bool on = message.equals("ON") || message.equals("on") || message.equals("1") || message.equals("true");
+  bool off = message.equals("OFF") || message.equals("off") || message.equals("0") || message.equals("false");
+  if (!on && !off) return;
+
+  // Plain text carries no id or timestamp: number them, time from receipt
+  ActuationTrace trace;
+  if (actuationTracker) actuationTracker->begin(trace, 0);
+
+  if (on) {
+    pumpController->start();
+  } else {
+    pumpController->stop();
+  }
+
+  Response *response = enqueue();
+  if (!response) return;
+  response->legacy = true;
+  response->command = on ? "pump_on" : "pump_off";
+  snprintf(response->id, sizeof(response->id), "legacy-%lu", (unsigned long)++legacySequence);
+  if (actuationTracker) {
+    actuationTracker->complete(trace, *pumpController);
+    response->trace = trace;
+    response->traced = true;
+  }
+  strlcpy(response->detail, on ? "Pump started via MQTT" : "Pump stopped via MQTT", sizeof(response->detail));
+}
+
+void CommandDispatcher::loop(MQTTManager &mqtt) {
+  if (queueCount > 0 && mqtt.isConnected()) {
+    Response &response = queue[queueHead];
+
+    if (response.legacy) {
+      mqtt.publishPumpStatus(pumpController && pumpController->isPumpActive());
+      mqtt.publishLog(response.detail);
+    }
+
+    // Legacy commands get a JSON ack too, when their latency was measured
+    if (!response.legacy || response.traced) {
+      char payload[320];
+      size_t length = snprintf(payload, sizeof(payload),
+                               "{\"id\":\"%s\",\"cmd\":\"%s\",\"status\":\"%s\",\"detail\":\"%s\",\"us\":%u",
+                               response.id, response.command, statusName(response.status),
+                               response.detail, response.handleUs);
+      if (response.traced && length < sizeof(payload)) {
+        length += ActuationTracker::formatAck(payload + length, sizeof(payload) - length, response.trace);
+      }
+      if (length + 1 < sizeof(payload)) {
+        payload[length++] = '}';
+        mqtt.publishRaw(mqtt.getTopic(MQTT_TOPIC_COMMAND_RESPONSE), payload, length);
+        if (response.traced) actuationTracker->acknowledged(response.trace);
+      }
+
+      // Pump commands also refresh the retained-style status topic
+      if (!response.legacy && response.status == CMD_OK && strncmp(response.command, "pump_", 5) == 0) {
+        mqtt.publishPumpStatus(pumpController && pumpController->isPumpActive());
+      }
+    }
+
+    queueHead = (queueHead + 1) % COMMAND_QUEUE_SIZE;
+    queueCount--;
+  }
+
+  // Reboot only once its acknowledgement has gone out (or the broker is gone)
+  if (rebootAt && (long)(millis() - rebootAt) >= 0 && (queueCount == 0 || !mqtt.isConnected())) {
+    Serial.println("🔄 Rebooting on command");
+    mqtt.disconnect();
+    delay(100);
+    ESP.restart();
+  }
+}
+
+// ========== HANDLERS ==========
+
+CommandStatus CommandDispatcher::handlePumpOn(const CommandRequest &request, char *detail, size_t detailSize) {
+  if (!pumpController) return CMD_ERROR;
+
+  // Absent means MAX_PUMP_TIME; present, it must be a positive integer
+  long duration = MAX_PUMP_TIME;
+  Slice field;
+  if (request.field("duration", field) && (!request.getLong("duration", duration) || duration <= 0)) {
+    strlcpy(detail, "duration must be a positive integer", detailSize);
+    return CMD_BAD_REQUEST;
+  }
+
+  duration = min(duration, (long)MAX_PUMP_TIME);
+  pumpController->startFor(duration);
+  snprintf(detail, detailSize, "running for %lds", duration);
+  return CMD_OK;
+}
+
+CommandStatus CommandDispatcher::handlePumpOff(const CommandRequest &request, char *detail, size_t detailSize) {
+  if (!pumpController) return CMD_ERROR;
+
+  pumpController->stop();
+  strlcpy(detail, "stopped", detailSize);
+  return CMD_OK;
+}
+
+CommandStatus CommandDispatcher::handleConfigSet(const CommandRequest &request, char *detail, size_t detailSize) {
+  if (!configRegistry) return CMD_ERROR;
+
+  char key[32];
+  char value[CONFIG_STRING_MAX];
+  if (!request.getString("key", key, sizeof(key)) || !request.getString("value", value, sizeof(value))) {
+    strlcpy(detail, "key and value required", detailSize);
+    return CMD_BAD_REQUEST;
+  }
+
+  if (!configRegistry->set(key, value)) {
+    snprintf(detail, detailSize, "%s rejected", key);
+    return CMD_ERROR;
+  }
+  snprintf(detail, detailSize, "%s updated", key);
+  return CMD_OK;
+}
+
+CommandStatus CommandDispatcher::handleSample(const CommandRequest &request, char *detail, size_t detailSize) {
+  if (!sampleCallback) return CMD_ERROR;
+
+  sampleCallback();
+  strlcpy(detail, "sampling all sensors", detailSize);
+  return CMD_OK;
+}
+
+CommandStatus CommandDispatcher::handleReboot(const CommandRequest &request, char *detail, size_t detailSize) {
+  rebootAt = millis() + COMMAND_REBOOT_DELAY;
+  snprintf(detail, detailSize, "rebooting in %lums", COMMAND_REBOOT_DELAY);
+  return CMD_OK;
+}
+
+CommandStatus CommandDispatcher::handleOTA(const CommandRequest &request, char *detail, size_t detailSize) {
+  if (!otaManager) return CMD_ERROR;
+
+  char url[OTA_URL_MAX];
+  char sha256[65];
+  if (!request.getString("url", url, sizeof(url)) || !request.getString("sha256", sha256, sizeof(sha256))) {
+    strlcpy(detail, "url and sha256 required", detailSize);
+    return CMD_BAD_REQUEST;
+  }
+
+  if (!otaManager->startPull(url, sha256)) {
+    strlcpy(detail, otaManager->getLastError(), detailSize);
+    return CMD_ERROR;
+  }
+  strlcpy(detail, "download queued", detailSize);
+  return CMD_OK;
+}
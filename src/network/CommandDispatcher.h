@@ -0,0 +1,114 @@
+#ifndef COMMAND_DISPATCHER_H
+#define COMMAND_DISPATCHER_H
+
+#include <Arduino.h>
+#include "config/Config.h"
+#include "controllers/ActuationTracker.h"
+
+#define COMMAND_QUEUE_SIZE 8
+#define COMMAND_ID_MAX 24
+#define COMMAND_DETAIL_MAX 48
+
+// Forward declarations
+class PumpController;
+class ConfigRegistry;
+class MQTTManager;
+class OTAManager;
+
+enum CommandStatus {
+  CMD_OK,
+  CMD_ERROR,          // Valid request that could not be carried out
+  CMD_BAD_REQUEST,    // Missing or malformed fields
+  CMD_UNKNOWN         // No such command
+};
+
+// View into the payload buffer (not NUL-terminated)
+struct Slice {
+  const char *data;
+  size_t length;
+
+  bool equals(const char *text) const;
+  bool copyTo(char *buffer, size_t size) const;
+};
+
+// Flat JSON object read in place: {"cmd":"pump_on","id":"42","duration":30}
+// Values are located on demand, nothing is copied or allocated.
+class CommandRequest {
+private:
+  const char *payload;
+  size_t length;
+
+public:
+  CommandRequest(const char *payload, size_t length) : payload(payload), length(length) {}
+
+  bool field(const char *key, Slice &value, bool *isString = nullptr) const;
+  bool getLong(const char *key, long &value) const;
+  bool getInt64(const char *key, int64_t &value) const;
+  bool getString(const char *key, char *buffer, size_t size) const;
+};
+
+class CommandDispatcher {
+private:
+  typedef CommandStatus (CommandDispatcher::*Handler)(const CommandRequest &request,
+                                                      char *detail, size_t detailSize);
+  struct Command {
+    const char *name;
+    Handler handler;
+    bool actuates;        // Drives the relay: timed, acknowledged with latencies
+  };
+  static const Command commands[];
+
+  // Responses are queued here and published from loop(), never from the callback
+  struct Response {
+    char id[COMMAND_ID_MAX];
+    const char *command;
+    CommandStatus status;
+    char detail[COMMAND_DETAIL_MAX];
+    uint32_t handleUs;
+    bool legacy;          // Plain-text pump command: answer with pump status + log
+    bool traced;          // trace holds actuation timing for the ack
+    ActuationTrace trace;
+  } queue[COMMAND_QUEUE_SIZE];
+  uint8_t queueHead;
+  uint8_t queueCount;
+  uint32_t dropped;
+  uint32_t legacySequence;
+
+  PumpController *pumpController;
+  ConfigRegistry *configRegistry;
+  OTAManager *otaManager;
+  ActuationTracker *actuationTracker;
+  void (*sampleCallback)();
+  unsigned long rebootAt;
+
+  Response *enqueue();
+
+  // Command handlers
+  CommandStatus handlePumpOn(const CommandRequest &request, char *detail, size_t detailSize);
+  CommandStatus handlePumpOff(const CommandRequest &request, char *detail, size_t detailSize);
+  CommandStatus handleConfigSet(const CommandRequest &request, char *detail, size_t detailSize);
+  CommandStatus handleSample(const CommandRequest &request, char *detail, size_t detailSize);
+  CommandStatus handleReboot(const CommandRequest &request, char *detail, size_t detailSize);
+  CommandStatus handleOTA(const CommandRequest &request, char *detail, size_t detailSize);
+
+public:
+  CommandDispatcher();
+
+  void setPumpController(PumpController *controller) { pumpController = controller; }
+  void setConfigRegistry(ConfigRegistry *registry) { configRegistry = registry; }
+  void setOTAManager(OTAManager *manager) { otaManager = manager; }
+  void setActuationTracker(ActuationTracker *tracker) { actuationTracker = tracker; }
+  void setSampleCallback(void (*callback)()) { sampleCallback = callback; }
+
+  // Called from the MQTT callback with PubSubClient's own buffer
+  void dispatchJson(const char *payload, size_t length);       // Command topic
+  void dispatchLegacy(const char *payload, size_t length);     // Pump ON/OFF topic
+
+  // Publishes one queued response per call and performs a pending reboot
+  void loop(MQTTManager &mqtt);
+
+  uint8_t getPendingResponses() const { return queueCount; }
+  uint32_t getDroppedResponses() const { return dropped; }
+};
+
+#endif // COMMAND_DISPATCHER_H
@@ -1,24 +1,80 @@
 #include "MQTTManager.h"
-#include "controllers/PumpController.h"
+#include "network/CommandDispatcher.h"
+#include "config/ConfigRegistry.h"
 
 // Static member initialization
 MQTTManager *MQTTManager::instance = nullptr;
 
 MQTTManager::MQTTManager() 
   : wifiClient(new WiFiClient()), mqttClient(*wifiClient), 
-    lastReconnect(0), lastPublish(0), pumpController(nullptr) {
+    lastReconnect(0), lastPublish(0), configRegistry(nullptr),
+    commandDispatcher(nullptr), reconfigurePending(false),
+    connectCount(0), connectFailures(0) {
   instance = this;
+  deviceId[0] = '\0';
+  clientId[0] = '\0';
+  topicPrefix[0] = '\0';
+  memset(topics, 0, sizeof(topics));
 }
 
 void MQTTManager::begin() {
-  mqttClient.setBufferSize(512);
+  resolveIdentity();
+  mqttClient.setBufferSize(MQTT_BUFFER_SIZE);
   mqttClient.setServer(MQTT_HOST, MQTT_PORT);
   mqttClient.setCallback(staticCallback);
-  Serial.printf("🔧 MQTT configured for %s:%d (buffer size: 512)\n", MQTT_HOST, MQTT_PORT);
+  Serial.printf("🔧 MQTT configured for %s:%d (buffer size: %d)\n", MQTT_HOST, MQTT_PORT, MQTT_BUFFER_SIZE);
+  Serial.printf("🔧 MQTT client %s, topics under %s/\n", clientId, topicPrefix);
 }
 
-void MQTTManager::setPumpController(PumpController *controller) {
-  pumpController = controller;
+void MQTTManager::resolveIdentity() {
+  // Station MAC: unique per chip and printed on the router's client list
+  uint8_t mac[6];
+  WiFi.macAddress(mac);
+  snprintf(deviceId, sizeof(deviceId), "%02x%02x%02x%02x%02x%02x",
+           mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+
+  if (MQTT_CLIENT_ID[0]) {
+    strlcpy(clientId, MQTT_CLIENT_ID, sizeof(clientId));
+  } else {
+    snprintf(clientId, sizeof(clientId), "agrohygra-%s", deviceId);
+  }
+  if (MQTT_TOPIC_PREFIX[0]) {
+    strlcpy(topicPrefix, MQTT_TOPIC_PREFIX, sizeof(topicPrefix));
+  } else {
+    snprintf(topicPrefix, sizeof(topicPrefix), "agrohygra/%s", deviceId);
+  }
+
+  // "~/sensors" -> "agrohygra/a4cf12ab34cd/sensors"; anything else is used as is
+  const char *settings[MQTT_TOPIC_COUNT] = {
+    TOPIC_SENSORS, TOPIC_PUMP_COMMAND, TOPIC_PUMP_STATUS, TOPIC_SYSTEM_STATUS, TOPIC_LOGS,
+    TOPIC_CONFIG_SET, TOPIC_COMMAND, TOPIC_COMMAND_RESPONSE, TOPIC_PRESENCE, TOPIC_STATS,
+    TOPIC_ALERTS
+  };
+  for (uint8_t i = 0; i < MQTT_TOPIC_COUNT; i++) {
+    if (settings[i][0] == MQTT_PREFIX_TOKEN) {
+      snprintf(topics[i], MQTT_TOPIC_MAX, "%s%s", topicPrefix, settings[i] + 1);
+    } else {
+      strlcpy(topics[i], settings[i], MQTT_TOPIC_MAX);
+    }
+  }
+}
+
+void MQTTManager::setCommandDispatcher(CommandDispatcher *dispatcher) {
+  commandDispatcher = dispatcher;
+}
+
+void MQTTManager::setConfigRegistry(ConfigRegistry *registry) {
+  configRegistry = registry;
+}
+
+void MQTTManager::applyReconfigure() {
+  // Broker, credentials or topics changed: drop the session and reconnect now
+  reconfigurePending = false;
+  disconnect();
+  resolveIdentity();
+  mqttClient.setServer(MQTT_HOST, MQTT_PORT);
+  lastReconnect = millis() - MQTT_RECONNECT_INTERVAL;
+  Serial.printf("🔧 MQTT reconfigured for %s:%d\n", MQTT_HOST, MQTT_PORT);
 }
 
 void MQTTManager::staticCallback(char *topic, byte *payload, unsigned int length) {
@@ -28,25 +84,48 @@ void MQTTManager::staticCallback(char *topic, byte *payload, unsigned int length
 }
 
 void MQTTManager::callback(char *topic, byte *payload, unsigned int length) {
-  String message;
-  for (unsigned int i = 0; i < length; i++) {
-    message += (char)payload[i];
+  // Payload is not NUL-terminated; print and compare it in place
+  Serial.printf("📨 MQTT message received on %s: %.*s\n", topic, (int)length, (const char *)payload);
+
+  // Commands (JSON and legacy pump ON/OFF) are parsed in place; replies go out from loop()
+  if (commandDispatcher && strcmp(topic, topics[MQTT_TOPIC_COMMAND]) == 0) {
+    commandDispatcher->dispatchJson((const char *)payload, length);
+  } else if (commandDispatcher && strcmp(topic, topics[MQTT_TOPIC_PUMP_COMMAND]) == 0) {
+    commandDispatcher->dispatchLegacy((const char *)payload, length);
+  } else if (configRegistry && strcmp(topic, topics[MQTT_TOPIC_CONFIG_SET]) == 0) {
+    handleConfigMessage(payload, length);
   }
+}
+
+void MQTTManager::handleConfigMessage(byte *payload, unsigned int length) {
+  int applied = 0;
+
+  if (length > 0 && payload[0] == '{') {
+    // JSON object: {"moisture_thr": 35, "mqtt_host": "..."}
+    JsonDocument doc;
+    if (deserializeJson(doc, payload, length)) {
+      publishLog("Config update rejected: invalid JSON");
+      return;
+    }
+    applied = configRegistry->applyJson(doc.as<JsonVariant>());
+  } else {
+    // Plain text: key=value
+    char buffer[CONFIG_STRING_MAX + 16];
+    if (length >= sizeof(buffer)) {
+      publishLog("Config update rejected: payload too long");
+      return;
+    }
+    memcpy(buffer, payload, length);
+    buffer[length] = '\0';
 
-  Serial.printf("📨 MQTT message received on %s: %s\n", topic, message.c_str());
-
-  // Handle pump commands
-  if (strcmp(topic, TOPIC_PUMP_COMMAND) == 0 && pumpController) {
-    if (message == "ON" || message == "on" || message == "1" || message == "true") {
-      pumpController->start();
-      publishPumpStatus(true);
-      publishLog("Pump started via MQTT");
-    } else if (message == "OFF" || message == "off" || message == "0" || message == "false") {
-      pumpController->stop();
-      publishPumpStatus(false);
-      publishLog("Pump stopped via MQTT");
+    char *separator = strchr(buffer, '=');
+    if (separator) {
+      *separator = '\0';
+      applied = configRegistry->set(buffer, separator + 1) ? 1 : 0;
     }
   }
+
+  publishLog(applied > 0 ? "Config updated via MQTT" : "Config update rejected");
 }
 
 bool MQTTManager::connect() {
@@ -60,29 +139,57 @@ bool MQTTManager::connect() {
   lastReconnect = millis();
 
   Serial.println("🔗 Connecting to MQTT broker...");
-  Serial.printf("🔧 Broker: %s:%d\n", MQTT_HOST, MQTT_PORT);
+  Serial.printf("🔧 Broker: %s:%d as %s\n", MQTT_HOST, MQTT_PORT, clientId);
 
-  if (mqttClient.connect(MQTT_CLIENT_ID)) {
+  // The broker publishes the retained "offline" will if the session dies uncleanly
+  bool hasUser = strlen(MQTT_USERNAME) > 0;
+  bool connected = mqttClient.connect(clientId, hasUser ? MQTT_USERNAME : nullptr,
+                                      hasUser ? MQTT_PASSWORD : nullptr,
+                                      topics[MQTT_TOPIC_PRESENCE], 1, true, "offline");
+
+  if (connected) {
+    connectCount++;
     Serial.println("✅ MQTT connected!");
+    mqttClient.publish(topics[MQTT_TOPIC_PRESENCE], "online", true);
     
-    // Subscribe to topics
-    mqttClient.subscribe(TOPIC_PUMP_COMMAND);
-    Serial.printf("📥 Subscribed to: %s\n", TOPIC_PUMP_COMMAND);
+    // Device-scoped subscriptions: the broker routes each command to one node
+    const MqttTopic subscriptions[] = {MQTT_TOPIC_PUMP_COMMAND, MQTT_TOPIC_CONFIG_SET, MQTT_TOPIC_COMMAND};
+    for (MqttTopic topic : subscriptions) {
+      mqttClient.subscribe(topics[topic]);
+      Serial.printf("📥 Subscribed to: %s\n", topics[topic]);
+    }
     
     publishLog("AgroHygra system connected");
     return true;
   } else {
+    connectFailures++;
     Serial.printf("❌ MQTT connection failed (state: %d)\n", mqttClient.state());
     return false;
   }
 }
 
+void MQTTManager::disconnect() {
+  if (!mqttClient.connected()) return;
+  mqttClient.publish(topics[MQTT_TOPIC_PRESENCE], "offline", true);
+  mqttClient.disconnect();
+}
+
 void MQTTManager::loop() {
+  // Deferred so a config message never tears down the session mid-callback
+  if (reconfigurePending) {
+    applyReconfigure();
+  }
+
   if (mqttClient.connected()) {
     mqttClient.loop();
   } else {
     connect();
   }
+
+  // Command responses are published here, outside the receive callback
+  if (commandDispatcher) {
+    commandDispatcher->loop(*this);
+  }
 }
 
 void MQTTManager::publishSensorData(JsonDocument &doc) {
@@ -91,20 +198,53 @@ void MQTTManager::publishSensorData(JsonDocument &doc) {
   if (millis() - lastPublish < MQTT_SENSOR_INTERVAL) return;
   lastPublish = millis();
 
-  String payload;
-  serializeJson(doc, payload);
-
-  bool success = mqttClient.publish(TOPIC_SENSORS, payload.c_str());
+  bool success = publishJson(topics[MQTT_TOPIC_SENSORS], doc);
   Serial.printf("📤 Published sensor data: %s (success: %s)\n", 
-                payload.c_str(), success ? "YES" : "NO");
+                payloadBuffer, success ? "YES" : "NO");
+}
+
+bool MQTTManager::publishRaw(const char *topic, const char *payload, size_t length) {
+  if (!mqttClient.connected()) return false;
+  return mqttClient.publish(topic, (const uint8_t *)payload, length);
+}
+
+bool MQTTManager::publishJson(const char *topic, JsonDocument &doc) {
+  size_t length = measureJson(doc);
+  if (length >= sizeof(payloadBuffer)) {
+    Serial.printf("❌ MQTT payload for %s too large (%u bytes)\n", topic, (unsigned)length);
+    payloadBuffer[0] = '\0';
+    return false;
+  }
+  serializeJson(doc, payloadBuffer, sizeof(payloadBuffer));
+  return mqttClient.publish(topic, (const uint8_t *)payloadBuffer, length);
 }
 
 void MQTTManager::publishPumpStatus(bool active) {
   if (!mqttClient.connected()) return;
-  mqttClient.publish(TOPIC_PUMP_STATUS, active ? "ON" : "OFF");
+  mqttClient.publish(topics[MQTT_TOPIC_PUMP_STATUS], active ? "ON" : "OFF");
+}
+
+void MQTTManager::publishSystemStatus(JsonDocument &doc) {
+  if (!mqttClient.connected()) return;
+
+  publishJson(topics[MQTT_TOPIC_SYSTEM_STATUS], doc);
+}
+
+void MQTTManager::publishStats(JsonDocument &doc) {
+  if (!mqttClient.connected()) return;
+
+  bool success = publishJson(topics[MQTT_TOPIC_STATS], doc);
+  Serial.printf("📤 Published stats: %s (success: %s)\n", payloadBuffer, success ? "YES" : "NO");
+}
+
+void MQTTManager::publishAlert(JsonDocument &doc) {
+  if (!mqttClient.connected()) return;
+
+  bool success = publishJson(topics[MQTT_TOPIC_ALERTS], doc);
+  Serial.printf("📤 Published alert: %s (success: %s)\n", payloadBuffer, success ? "YES" : "NO");
 }
 
-void MQTTManager::publishLog(String message) {
+void MQTTManager::publishLog(const char *message) {
   if (!mqttClient.connected()) return;
-  mqttClient.publish(TOPIC_LOGS, message.c_str());
+  mqttClient.publish(topics[MQTT_TOPIC_LOGS], message);
 }
@@ -7,8 +7,30 @@
 #include <ArduinoJson.h>
 #include "config/Config.h"
 
+#define MQTT_BUFFER_SIZE 1024     // PubSubClient packet buffer and JSON payload buffer
+#define MQTT_ID_MAX 64
+#define MQTT_TOPIC_MAX 96         // Prefix + topic suffix
+#define MQTT_PREFIX_TOKEN '~'     // Topic settings starting with ~ are relative to the device prefix
+
+// Resolved topics, in the order of the TOPIC_* settings
+enum MqttTopic {
+  MQTT_TOPIC_SENSORS,
+  MQTT_TOPIC_PUMP_COMMAND,
+  MQTT_TOPIC_PUMP_STATUS,
+  MQTT_TOPIC_SYSTEM_STATUS,
+  MQTT_TOPIC_LOGS,
+  MQTT_TOPIC_CONFIG_SET,
+  MQTT_TOPIC_COMMAND,
+  MQTT_TOPIC_COMMAND_RESPONSE,
+  MQTT_TOPIC_PRESENCE,
+  MQTT_TOPIC_STATS,
+  MQTT_TOPIC_ALERTS,
+  MQTT_TOPIC_COUNT
+};
+
 // Forward declarations
-class PumpController;
+class ConfigRegistry;
+class CommandDispatcher;
 
 class MQTTManager {
 private:
@@ -16,8 +38,25 @@ private:
   PubSubClient mqttClient;
   unsigned long lastReconnect;
   unsigned long lastPublish;
-  PumpController *pumpController;
+  ConfigRegistry *configRegistry;
+  CommandDispatcher *commandDispatcher;
+  bool reconfigurePending;
+  uint32_t connectCount;        // Sessions established since boot
+  uint32_t connectFailures;
+  
+  // Identity: MAC-derived unless mqtt_client / mqtt_prefix override it
+  char deviceId[13];
+  char clientId[MQTT_ID_MAX];
+  char topicPrefix[MQTT_ID_MAX];
+  char topics[MQTT_TOPIC_COUNT][MQTT_TOPIC_MAX];
+  
+  // Preallocated so publishing never touches the heap
+  char payloadBuffer[MQTT_BUFFER_SIZE];
   
+  bool publishJson(const char *topic, JsonDocument &doc);
+  void resolveIdentity();
+  void applyReconfigure();
+  void handleConfigMessage(byte *payload, unsigned int length);
   void callback(char *topic, byte *payload, unsigned int length);
   static MQTTManager *instance; // For static callback
   
@@ -25,15 +64,27 @@ public:
   MQTTManager();
   
   void begin();
-  void setPumpController(PumpController *controller);
+  void setCommandDispatcher(CommandDispatcher *dispatcher);
+  void setConfigRegistry(ConfigRegistry *registry);
+  void requestReconfigure() { reconfigurePending = true; }
   bool connect();
+  void disconnect();    // Graceful: retained "offline" presence first
   void loop();
   
+  bool publishRaw(const char *topic, const char *payload, size_t length);
   void publishSensorData(JsonDocument &doc);
   void publishPumpStatus(bool active);
-  void publishLog(String message);
+  void publishSystemStatus(JsonDocument &doc);
+  void publishStats(JsonDocument &doc);
+  void publishAlert(JsonDocument &doc);
+  void publishLog(const char *message);
   
   bool isConnected() { return mqttClient.connected(); }
+  const char *getClientId() const { return clientId; }
+  const char *getDeviceId() const { return deviceId; }
+  const char *getTopic(MqttTopic topic) const { return topics[topic]; }
+  uint32_t getConnectCount() const { return connectCount; }
+  uint32_t getConnectFailures() const { return connectFailures; }
   
   // Static callback wrapper
   static void staticCallback(char *topic, byte *payload, unsigned int length);
@@ -0,0 +1,45 @@
+#include "MetricsWriter.h"
+
+void MetricsWriter::family(const char *name, const char *type, const char *help) {
+  out.printf("# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+}
+
+void MetricsWriter::labels(const char *label, const char *labelValue) {
+  // Label values here are fixed identifiers, nothing needs escaping
+  if (label) out.printf("{%s=\"%s\"}", label, labelValue);
+}
+
+void MetricsWriter::sample(const char *name, double value, const char *label, const char *labelValue) {
+  out.print(name);
+  labels(label, labelValue);
+  if (isnan(value)) {
+    out.print(" NaN\n");
+  } else {
+    // 10 significant digits keep uint32 counters exact
+    out.printf(" %.10g\n", value);
+  }
+}
+
+void MetricsWriter::histogram(const char *name, const LatencyHistogram &histogram,
+                              const char *label, const char *labelValue) {
+  uint32_t cumulative = 0;
+  for (uint8_t i = 0; i < LATENCY_BUCKETS - 1; i++) {
+    cumulative += histogram.getBucket(i);
+    if (i % 2) continue;      // Even indices end on a power of two
+
+    out.printf("%s_bucket{", name);
+    if (label) out.printf("%s=\"%s\",", label, labelValue);
+    out.printf("le=\"%.9g\"} %lu\n", LatencyHistogram::getUpperBound(i) / 1e6, (unsigned long)cumulative);
+  }
+
+  out.printf("%s_bucket{", name);
+  if (label) out.printf("%s=\"%s\",", label, labelValue);
+  out.printf("le=\"+Inf\"} %lu\n", (unsigned long)histogram.getCount());
+
+  out.printf("%s_sum", name);
+  labels(label, labelValue);
+  out.printf(" %.6f\n", histogram.getSum() / 1e6);
+  out.printf("%s_count", name);
+  labels(label, labelValue);
+  out.printf(" %lu\n", (unsigned long)histogram.getCount());
+}
@@ -0,0 +1,31 @@
+#ifndef METRICS_WRITER_H
+#define METRICS_WRITER_H
+
+#include <Arduino.h>
+#include "system/LatencyHistogram.h"
+
+#define METRICS_CONTENT_TYPE "text/plain; version=0.0.4; charset=utf-8"
+
+// Prometheus text exposition written straight to a Print (the chunked HTTP
+// response), line by line, so a scrape needs no buffer for the whole page.
+// Emit family() once, then every sample of that family.
+class MetricsWriter {
+private:
+  Print &out;
+
+  void labels(const char *label, const char *labelValue);
+
+public:
+  MetricsWriter(Print &out) : out(out) {}
+
+  void family(const char *name, const char *type, const char *help);
+
+  void sample(const char *name, double value, const char *label = nullptr, const char *labelValue = nullptr);
+
+  // LatencyHistogram (us) as a seconds histogram. Only the octave bounds are
+  // emitted: cumulative counts stay exact, at half the series per histogram.
+  void histogram(const char *name, const LatencyHistogram &histogram,
+                 const char *label = nullptr, const char *labelValue = nullptr);
+};
+
+#endif // METRICS_WRITER_H
@@ -1,16 +1,40 @@
 #include "WebServer.h"
+#include <new>
 #include "network/WiFiManager.h"
 #include "controllers/PumpController.h"
+#include "controllers/ActuationTracker.h"
+#include "controllers/RuleEngine.h"
+#include "network/CommandDispatcher.h"
+#include "network/MQTTManager.h"
+#include "network/MetricsWriter.h"
 #include "sensors/NPKSensor.h"
+#include "sensors/SensorHealth.h"
+#include "system/SamplingPolicy.h"
+#include "system/HeapMonitor.h"
+#include "system/OTAManager.h"
+#include "system/TimeService.h"
+#include "system/I2CBus.h"
+#include "storage/SampleStore.h"
+#include "storage/PumpStateStore.h"
+#include "storage/TraceRecorder.h"
 #include "sensors/MQ135Sensor.h"
 #include "sensors/TDSSensor.h"
 #include "sensors/DHTSensor.h"
+#include "config/ConfigRegistry.h"
 
 AgroWebServer::AgroWebServer(int port) 
-  : server(port), wifiManager(nullptr), pumpController(nullptr),
+  : server(port), pollServer(LONG_POLL_PORT), wifiManager(nullptr), pumpController(nullptr), configRegistry(nullptr),
     npkSensor(nullptr), mq135Sensor(nullptr), tdsSensor(nullptr), dhtSensor(nullptr),
+    sensorHealth(nullptr), sensorHealthCount(0), samplingPolicy(nullptr),
+    heapMonitor(nullptr), otaManager(nullptr), sampleStore(nullptr), actuationTracker(nullptr),
+    deviceId("AgroHygra-ESP32"), timeService(nullptr), ruleEngine(nullptr), pumpStateStore(nullptr),
+    mqttManager(nullptr), loopLatency(nullptr), i2cBus(nullptr), traceRecorder(nullptr),
     soilMoisture(0), temperature(0), humidity(0), airQuality(0), 
-    airQualityRaw(0), airQualityGood(true), tdsValue(0), tdsRaw(0) {
+    airQualityRaw(0), airQualityGood(true), tdsValue(0), tdsRaw(0),
+    sequence(0), stateTag(0), bootTag(0), notModifiedCount(0), longPollCount(0) {
+  for (uint8_t i = 0; i < LONG_POLL_SLOTS; i++) {
+    longPolls[i].state = POLL_FREE;
+  }
 }
 
 void AgroWebServer::begin() {
@@ -23,8 +47,25 @@ void AgroWebServer::begin() {
   server.on("/pump/on", [this]() { this->handlePumpOn(); });
   server.on("/pump/off", [this]() { this->handlePumpOff(); });
   server.on("/api", [this]() { this->handleAPI(); });
+  server.on("/config", HTTP_GET, [this]() { this->handleConfigGet(); });
+  server.on("/config", HTTP_POST, [this]() { this->handleConfigSet(); });
+  server.on("/config/reset", HTTP_POST, [this]() { this->handleConfigReset(); });
+  server.on("/ota", HTTP_GET, [this]() { this->handleOTAStatus(); });
+  server.on("/ota", HTTP_POST, [this]() { this->handleOTAUploadDone(); },
+            [this]() { this->handleOTAUpload(); });
+  server.on("/ota/pull", HTTP_POST, [this]() { this->handleOTAPull(); });
+  server.on("/api/export", HTTP_GET, [this]() { this->handleExport(); });
+  server.on("/metrics", HTTP_GET, [this]() { this->handleMetrics(); });
+  server.on("/trace", HTTP_GET, [this]() { this->handleTrace(); });
+  
+  // Only collected headers are kept by WebServer
+  static const char *headers[] = {"If-None-Match", "Content-Type"};
+  server.collectHeaders(headers, sizeof(headers) / sizeof(headers[0]));
+  bootTag = esp_random();
   
   server.begin();
+  pollServer.begin();
+  pollServer.setNoDelay(true);
   
   // Start mDNS
   if (MDNS.begin("agrohygra")) {
@@ -43,6 +84,10 @@ void AgroWebServer::setPumpController(PumpController *controller) {
   pumpController = controller;
 }
 
+void AgroWebServer::setConfigRegistry(ConfigRegistry *registry) {
+  configRegistry = registry;
+}
+
 void AgroWebServer::setSensors(NPKSensor *npk, MQ135Sensor *mq135, TDSSensor *tds, DHTSensor *dht) {
   npkSensor = npk;
   mq135Sensor = mq135;
@@ -50,6 +95,55 @@ void AgroWebServer::setSensors(NPKSensor *npk, MQ135Sensor *mq135, TDSSensor *td
   dhtSensor = dht;
 }
 
+void AgroWebServer::setSensorHealth(SensorHealth **health, uint8_t count) {
+  sensorHealth = health;
+  sensorHealthCount = count;
+}
+
+void AgroWebServer::setSamplingPolicy(SamplingPolicy *policy) {
+  samplingPolicy = policy;
+}
+
+void AgroWebServer::setHeapMonitor(HeapMonitor *monitor) {
+  heapMonitor = monitor;
+}
+
+void AgroWebServer::setOTAManager(OTAManager *manager) {
+  otaManager = manager;
+}
+
+void AgroWebServer::setSampleStore(SampleStore *store) {
+  sampleStore = store;
+}
+
+void AgroWebServer::setActuationTracker(ActuationTracker *tracker) {
+  actuationTracker = tracker;
+}
+
+void AgroWebServer::setTimeService(TimeService *service) {
+  timeService = service;
+}
+
+void AgroWebServer::setRuleEngine(RuleEngine *engine) {
+  ruleEngine = engine;
+}
+
+void AgroWebServer::setPumpStateStore(PumpStateStore *store) {
+  pumpStateStore = store;
+}
+
+void AgroWebServer::setI2CBus(I2CBus *bus) {
+  i2cBus = bus;
+}
+
+void AgroWebServer::setTraceRecorder(TraceRecorder *recorder) {
+  traceRecorder = recorder;
+}
+
+void AgroWebServer::setMQTTManager(MQTTManager *manager) {
+  mqttManager = manager;
+}
+
 void AgroWebServer::updateSensorData(int soil, float temp, float hum, int air, 
                                     int airRaw, bool airGood, int tds, int tdsRaw) {
   soilMoisture = soil;
@@ -60,160 +154,308 @@ void AgroWebServer::updateSensorData(int soil, float temp, float hum, int air,
   airQualityGood = airGood;
   tdsValue = tds;
   this->tdsRaw = tdsRaw;
+  sequence++;
 }
 
 void AgroWebServer::loop() {
+  trackStateChanges();
   server.handleClient();
+  serviceLongPolls();
 }
 
+// ========== RESPONSE HELPERS ==========
+// Pages and JSON are streamed in chunks from fixed buffers instead of being
+// concatenated into heap Strings (fragmentation is what reboots long-running nodes)
+
+// Print adapter that batches small writes into chunked-transfer pieces
+template <size_t N = 256>
+class ChunkedPrint : public Print {
+private:
+  WebServer &server;
+  char buffer[N];
+  size_t used;
+  size_t sent;
+
+public:
+  ChunkedPrint(WebServer &server) : server(server), used(0), sent(0) {}
+  ~ChunkedPrint() { flush(); }
+
+  size_t write(uint8_t c) override {
+    buffer[used++] = c;
+    if (used == sizeof(buffer)) flush();
+    return 1;
+  }
+
+  size_t write(const uint8_t *data, size_t length) override {
+    size_t left = length;
+    while (left > 0) {
+      size_t n = min(left, sizeof(buffer) - used);
+      memcpy(buffer + used, data, n);
+      used += n;
+      data += n;
+      left -= n;
+      if (used == sizeof(buffer)) flush();
+    }
+    return length;
+  }
+
+  void flush() override {
+    if (used > 0) server.sendContent(buffer, used);
+    sent += used;
+    used = 0;
+  }
+
+  size_t getBytesWritten() const { return sent + used; }
+};
+
+// Same batching for a raw client (responses written outside a handler)
+template <size_t N = 256>
+class BufferedPrint : public Print {
+private:
+  Print &target;
+  char buffer[N];
+  size_t used;
+
+public:
+  BufferedPrint(Print &target) : target(target), used(0) {}
+  ~BufferedPrint() { flush(); }
+
+  size_t write(uint8_t c) override {
+    buffer[used++] = c;
+    if (used == sizeof(buffer)) flush();
+    return 1;
+  }
+
+  size_t write(const uint8_t *data, size_t length) override {
+    size_t left = length;
+    while (left > 0) {
+      size_t n = min(left, sizeof(buffer) - used);
+      memcpy(buffer + used, data, n);
+      used += n;
+      data += n;
+      left -= n;
+      if (used == sizeof(buffer)) flush();
+    }
+    return length;
+  }
+
+  void flush() override {
+    if (used > 0) target.write((const uint8_t *)buffer, used);
+    used = 0;
+  }
+};
+
+void AgroWebServer::beginChunked(int code, const char *contentType) {
+  server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+  server.send(code, contentType, "");
+}
+
+void AgroWebServer::sendChunk(const char *text) {
+  server.sendContent(text, strlen(text));
+}
+
+void AgroWebServer::sendChunkf(const char *format, ...) {
+  char buffer[192];
+  va_list args;
+  va_start(args, format);
+  int length = vsnprintf(buffer, sizeof(buffer), format, args);
+  va_end(args);
+  if (length > 0) {
+    server.sendContent(buffer, min((size_t)length, sizeof(buffer) - 1));
+  }
+}
+
+void AgroWebServer::endChunked() {
+  server.sendContent("", 0);
+}
+
+void AgroWebServer::sendJson(JsonDocument &doc, int code) {
+  beginChunked(code, "application/json");
+  {
+    ChunkedPrint<> out(server);
+    serializeJson(doc, out);
+  }
+  endChunked();
+}
+
+// ========== PAGES ==========
+static const char ROOT_HEAD[] =
+  "<!DOCTYPE html><html><head>"
+  "<meta charset='UTF-8'><meta name='viewport' content='width=device-width,initial-scale=1'>"
+  "<title>AgroHygra Dashboard</title>"
+  "<style>body{font-family:Arial,sans-serif;margin:0;padding:20px;background:#f0f0f0}"
+  ".container{max-width:800px;margin:0 auto;background:#fff;padding:20px;border-radius:10px;box-shadow:0 2px 5px rgba(0,0,0,0.1)}"
+  "h1{color:#4caf50;text-align:center}h2{color:#333;border-bottom:2px solid #4caf50;padding-bottom:5px}"
+  ".sensor-grid{display:grid;grid-template-columns:repeat(auto-fit,minmax(200px,1fr));gap:15px;margin:20px 0}"
+  ".sensor-card{background:#f9f9f9;padding:15px;border-radius:8px;border-left:4px solid #4caf50}"
+  ".sensor-value{font-size:24px;font-weight:bold;color:#333;margin:5px 0}"
+  ".sensor-label{font-size:14px;color:#666}"
+  ".button{display:inline-block;padding:10px 20px;margin:5px;background:#4caf50;color:#fff;text-decoration:none;"
+  "border:none;border-radius:5px;cursor:pointer;font-size:16px}"
+  ".button:hover{background:#45a049}.button.off{background:#f44336}.button.off:hover{background:#da190b}"
+  ".status{padding:10px;border-radius:5px;margin:10px 0;text-align:center;font-weight:bold}"
+  "</style>"
+  "<script>let seq=-1;function poll(){fetch('//'+location.hostname+':81/api?after='+seq).then(r=>r.status==200?r.json():null).then(d=>{"
+  "if(!d)return;seq=d.seq;"
+  "document.getElementById('soil').innerText=d.soil+'%';"
+  "document.getElementById('temp').innerText=d.temp+'°C';"
+  "document.getElementById('hum').innerText=d.humidity+'%';"
+  "document.getElementById('air').innerText=d.airQuality+'%';"
+  "document.getElementById('tds').innerText=d.tds+' ppm';"
+  "document.getElementById('pumpStatus').innerText=d.pump?'ON':'OFF';"
+  "document.getElementById('pumpStatus').style.background=d.pump?'#4caf50':'#f44336';"
+  "}).then(()=>setTimeout(poll,100),()=>setTimeout(poll,2000))}poll();</script>"
+  "</head><body><div class='container'>"
+  "<h1>🌱 AgroHygra Dashboard</h1>";
+
+static const char ROOT_AP_BANNER[] =
+  "<div style='background:#ff9800;padding:15px;margin:10px 0;border-radius:5px;'>"
+  "<strong>⚠️ AP MODE ACTIVE</strong><br>"
+  "Connect to: <strong>AgroHygra-Setup</strong> (password: agrohygra123)<br>"
+  "<a href='/wifi' style='color:#fff;text-decoration:underline;'>Configure WiFi</a>"
+  "</div>";
+
+static const char ROOT_PUMP_BUTTONS[] =
+  "<div style='text-align:center'>"
+  "<a href='/pump/on' class='button'>Turn Pump ON</a>"
+  "<a href='/pump/off' class='button off'>Turn Pump OFF</a>"
+  "</div>";
+
+static const char ROOT_FOOTER[] =
+  "<h2>Settings</h2>"
+  "<div style='text-align:center'>"
+  "<a href='/wifi' class='button'>WiFi Settings</a>"
+  "<a href='/api' class='button'>API</a>"
+  "</div>"
+  "</div></body></html>";
+
+static const char CARD_FORMAT[] =
+  "<div class='sensor-card'><div class='sensor-label'>%s</div>"
+  "<div class='sensor-value'%s>%s</div></div>";
+
 void AgroWebServer::handleRoot() {
-  String apBanner = "";
+  char value[24];
+  bool pumpOn = pumpController && pumpController->isPumpActive();
+  
+  beginChunked(200, "text/html");
+  sendChunk(ROOT_HEAD);
   if (wifiManager && wifiManager->isAPMode()) {
-    apBanner = "<div style='background:#ff9800;padding:15px;margin:10px 0;border-radius:5px;'>"
-               "<strong>⚠️ AP MODE ACTIVE</strong><br>"
-               "Connect to: <strong>AgroHygra-Setup</strong> (password: agrohygra123)<br>"
-               "<a href='/wifi' style='color:#fff;text-decoration:underline;'>Configure WiFi</a>"
-               "</div>";
+    sendChunk(ROOT_AP_BANNER);
   }
   
-  String pumpStatus = (pumpController && pumpController->isPumpActive()) ? "ON" : "OFF";
-  String pumpColor = (pumpController && pumpController->isPumpActive()) ? "#4caf50" : "#f44336";
-  
-  String html = "<!DOCTYPE html><html><head>"
-                "<meta charset='UTF-8'><meta name='viewport' content='width=device-width,initial-scale=1'>"
-                "<title>AgroHygra Dashboard</title>"
-                "<style>body{font-family:Arial,sans-serif;margin:0;padding:20px;background:#f0f0f0}"
-                ".container{max-width:800px;margin:0 auto;background:#fff;padding:20px;border-radius:10px;box-shadow:0 2px 5px rgba(0,0,0,0.1)}"
-                "h1{color:#4caf50;text-align:center}h2{color:#333;border-bottom:2px solid #4caf50;padding-bottom:5px}"
-                ".sensor-grid{display:grid;grid-template-columns:repeat(auto-fit,minmax(200px,1fr));gap:15px;margin:20px 0}"
-                ".sensor-card{background:#f9f9f9;padding:15px;border-radius:8px;border-left:4px solid #4caf50}"
-                ".sensor-value{font-size:24px;font-weight:bold;color:#333;margin:5px 0}"
-                ".sensor-label{font-size:14px;color:#666}"
-                ".button{display:inline-block;padding:10px 20px;margin:5px;background:#4caf50;color:#fff;text-decoration:none;"
-                "border:none;border-radius:5px;cursor:pointer;font-size:16px}"
-                ".button:hover{background:#45a049}.button.off{background:#f44336}.button.off:hover{background:#da190b}"
-                ".status{padding:10px;border-radius:5px;margin:10px 0;text-align:center;font-weight:bold}"
-                "</style>"
-                "<script>setInterval(()=>fetch('/api').then(r=>r.json()).then(d=>{"
-                "document.getElementById('soil').innerText=d.soil+'%';"
-                "document.getElementById('temp').innerText=d.temp+'°C';"
-                "document.getElementById('hum').innerText=d.humidity+'%';"
-                "document.getElementById('air').innerText=d.airQuality+'%';"
-                "document.getElementById('tds').innerText=d.tds+' ppm';"
-                "document.getElementById('pumpStatus').innerText=d.pump?'ON':'OFF';"
-                "document.getElementById('pumpStatus').style.background=d.pump?'#4caf50':'#f44336';"
-                "}),2000);</script>"
-                "</head><body><div class='container'>"
-                "<h1>🌱 AgroHygra Dashboard</h1>" +
-                apBanner +
-                "<h2>Sensor Readings</h2>"
-                "<div class='sensor-grid'>"
-                "<div class='sensor-card'><div class='sensor-label'>Soil Moisture</div>"
-                "<div class='sensor-value' id='soil'>" + String(soilMoisture) + "%</div></div>"
-                "<div class='sensor-card'><div class='sensor-label'>Temperature</div>"
-                "<div class='sensor-value' id='temp'>" + String(temperature, 1) + "°C</div></div>"
-                "<div class='sensor-card'><div class='sensor-label'>Humidity</div>"
-                "<div class='sensor-value' id='hum'>" + String(humidity, 1) + "%</div></div>"
-                "<div class='sensor-card'><div class='sensor-label'>Air Quality</div>"
-                "<div class='sensor-value' id='air'>" + String(airQuality) + "%</div></div>"
-                "<div class='sensor-card'><div class='sensor-label'>TDS</div>"
-                "<div class='sensor-value' id='tds'>" + String(tdsValue) + " ppm</div></div>"
-                "</div>";
+  sendChunk("<h2>Sensor Readings</h2><div class='sensor-grid'>");
+  snprintf(value, sizeof(value), "%d%%", soilMoisture);
+  sendChunkf(CARD_FORMAT, "Soil Moisture", " id='soil'", value);
+  snprintf(value, sizeof(value), "%.1f°C", temperature);
+  sendChunkf(CARD_FORMAT, "Temperature", " id='temp'", value);
+  snprintf(value, sizeof(value), "%.1f%%", humidity);
+  sendChunkf(CARD_FORMAT, "Humidity", " id='hum'", value);
+  snprintf(value, sizeof(value), "%d%%", airQuality);
+  sendChunkf(CARD_FORMAT, "Air Quality", " id='air'", value);
+  snprintf(value, sizeof(value), "%d ppm", tdsValue);
+  sendChunkf(CARD_FORMAT, "TDS", " id='tds'", value);
+  sendChunk("</div>");
   
   // NPK Sensor data if available
   if (npkSensor && npkSensor->isAvailable()) {
-    html += "<h2>NPK Sensor (7-in-1)</h2><div class='sensor-grid'>"
-            "<div class='sensor-card'><div class='sensor-label'>Nitrogen (N)</div>"
-            "<div class='sensor-value'>" + String(npkSensor->getNitrogen(), 0) + " mg/kg</div></div>"
-            "<div class='sensor-card'><div class='sensor-label'>Phosphorus (P)</div>"
-            "<div class='sensor-value'>" + String(npkSensor->getPhosphorus(), 0) + " mg/kg</div></div>"
-            "<div class='sensor-card'><div class='sensor-label'>Potassium (K)</div>"
-            "<div class='sensor-value'>" + String(npkSensor->getPotassium(), 0) + " mg/kg</div></div>"
-            "<div class='sensor-card'><div class='sensor-label'>pH</div>"
-            "<div class='sensor-value'>" + String(npkSensor->getPH(), 1) + "</div></div>"
-            "<div class='sensor-card'><div class='sensor-label'>EC</div>"
-            "<div class='sensor-value'>" + String(npkSensor->getEC(), 2) + " mS/cm</div></div>"
-            "</div>";
+    sendChunk("<h2>NPK Sensor (7-in-1)</h2><div class='sensor-grid'>");
+    snprintf(value, sizeof(value), "%.0f mg/kg", npkSensor->getNitrogen());
+    sendChunkf(CARD_FORMAT, "Nitrogen (N)", "", value);
+    snprintf(value, sizeof(value), "%.0f mg/kg", npkSensor->getPhosphorus());
+    sendChunkf(CARD_FORMAT, "Phosphorus (P)", "", value);
+    snprintf(value, sizeof(value), "%.0f mg/kg", npkSensor->getPotassium());
+    sendChunkf(CARD_FORMAT, "Potassium (K)", "", value);
+    snprintf(value, sizeof(value), "%.1f", npkSensor->getPH());
+    sendChunkf(CARD_FORMAT, "pH", "", value);
+    snprintf(value, sizeof(value), "%.2f mS/cm", npkSensor->getEC());
+    sendChunkf(CARD_FORMAT, "EC", "", value);
+    sendChunk("</div>");
   }
   
-  html += "<h2>Pump Control</h2>"
-          "<div class='status' id='pumpStatus' style='background:" + pumpColor + ";color:#fff'>" + pumpStatus + "</div>"
-          "<div style='text-align:center'>"
-          "<a href='/pump/on' class='button'>Turn Pump ON</a>"
-          "<a href='/pump/off' class='button off'>Turn Pump OFF</a>"
-          "</div>";
+  sendChunkf("<h2>Pump Control</h2>"
+             "<div class='status' id='pumpStatus' style='background:%s;color:#fff'>%s</div>",
+             pumpOn ? "#4caf50" : "#f44336", pumpOn ? "ON" : "OFF");
+  sendChunk(ROOT_PUMP_BUTTONS);
   
   if (pumpController) {
-    html += "<p style='text-align:center;color:#666'>"
-            "Watering Count: " + String(pumpController->getWateringCount()) + " | "
-            "Total Time: " + String(pumpController->getTotalWateringTime()) + "s"
-            "</p>";
+    sendChunkf("<p style='text-align:center;color:#666'>Watering Count: %d | Total Time: %lus</p>",
+               pumpController->getWateringCount(), pumpController->getTotalWateringTime());
   }
   
-  html += "<h2>Settings</h2>"
-          "<div style='text-align:center'>"
-          "<a href='/wifi' class='button'>WiFi Settings</a>"
-          "<a href='/api' class='button'>API</a>"
-          "</div>"
-          "</div></body></html>";
-  
-  server.send(200, "text/html", html);
+  sendChunk(ROOT_FOOTER);
+  endChunked();
 }
 
+static const char WIFI_SETUP_HEAD[] =
+  "<!DOCTYPE html><html><head>"
+  "<meta charset='UTF-8'><meta name='viewport' content='width=device-width,initial-scale=1'>"
+  "<title>WiFi Setup - AgroHygra</title>"
+  "<style>body{font-family:Arial,sans-serif;margin:0;padding:20px;background:#f0f0f0}"
+  ".container{max-width:600px;margin:0 auto;background:#fff;padding:20px;border-radius:10px}"
+  "h1{color:#4caf50;text-align:center}label{display:block;margin:10px 0 5px;font-weight:bold}"
+  "input,select{width:100%;padding:10px;margin-bottom:15px;border:1px solid #ddd;border-radius:5px;box-sizing:border-box}"
+  ".button{width:100%;padding:12px;background:#4caf50;color:#fff;border:none;border-radius:5px;"
+  "cursor:pointer;font-size:16px;margin-top:10px}.button:hover{background:#45a049}"
+  ".button.danger{background:#f44336}.button.danger:hover{background:#da190b}"
+  "</style></head><body><div class='container'>"
+  "<h1>🌐 WiFi Configuration</h1>"
+  "<form method='POST' action='/wifi/save'>"
+  "<label>Select Network:</label>"
+  "<select name='ssid' id='ssid'>";
+
+static const char WIFI_SETUP_TAIL[] =
+  "</select>"
+  "<label>Password:</label>"
+  "<input type='password' name='password' placeholder='WiFi password'>"
+  "<button type='submit' class='button'>Save & Connect</button>"
+  "</form>"
+  "<form method='POST' action='/wifi/clear'>"
+  "<button type='submit' class='button danger'>Clear Credentials</button>"
+  "</form>"
+  "<p style='text-align:center'><a href='/'>Back to Dashboard</a></p>"
+  "</div></body></html>";
+
+// Scan results for /wifi and /wifi/scan (static: too large for the loop task stack)
+static char scanBuffer[WEB_SCAN_BUFFER_SIZE];
+
 void AgroWebServer::handleWiFiSetup() {
-  String networks = wifiManager ? wifiManager->scanNetworks() : "";
-  
-  String html = "<!DOCTYPE html><html><head>"
-                "<meta charset='UTF-8'><meta name='viewport' content='width=device-width,initial-scale=1'>"
-                "<title>WiFi Setup - AgroHygra</title>"
-                "<style>body{font-family:Arial,sans-serif;margin:0;padding:20px;background:#f0f0f0}"
-                ".container{max-width:600px;margin:0 auto;background:#fff;padding:20px;border-radius:10px}"
-                "h1{color:#4caf50;text-align:center}label{display:block;margin:10px 0 5px;font-weight:bold}"
-                "input,select{width:100%;padding:10px;margin-bottom:15px;border:1px solid #ddd;border-radius:5px;box-sizing:border-box}"
-                ".button{width:100%;padding:12px;background:#4caf50;color:#fff;border:none;border-radius:5px;"
-                "cursor:pointer;font-size:16px;margin-top:10px}.button:hover{background:#45a049}"
-                ".button.danger{background:#f44336}.button.danger:hover{background:#da190b}"
-                "</style></head><body><div class='container'>"
-                "<h1>🌐 WiFi Configuration</h1>"
-                "<form method='POST' action='/wifi/save'>"
-                "<label>Select Network:</label>"
-                "<select name='ssid' id='ssid'>" + networks + "</select>"
-                "<label>Password:</label>"
-                "<input type='password' name='password' placeholder='WiFi password'>"
-                "<button type='submit' class='button'>Save & Connect</button>"
-                "</form>"
-                "<form method='POST' action='/wifi/clear'>"
-                "<button type='submit' class='button danger'>Clear Credentials</button>"
-                "</form>"
-                "<p style='text-align:center'><a href='/'>Back to Dashboard</a></p>"
-                "</div></body></html>";
+  scanBuffer[0] = '\0';
+  if (wifiManager) {
+    wifiManager->scanNetworks(scanBuffer, sizeof(scanBuffer));
+  }
   
-  server.send(200, "text/html", html);
+  beginChunked(200, "text/html");
+  sendChunk(WIFI_SETUP_HEAD);
+  sendChunk(scanBuffer);
+  sendChunk(WIFI_SETUP_TAIL);
+  endChunked();
 }
 
 void AgroWebServer::handleWiFiScan() {
-  String networks = wifiManager ? wifiManager->scanNetworks() : "Error";
-  server.send(200, "text/plain", networks);
+  if (!wifiManager) {
+    server.send(200, "text/plain", "Error");
+    return;
+  }
+  size_t length = wifiManager->scanNetworks(scanBuffer, sizeof(scanBuffer));
+  server.send_P(200, "text/plain", scanBuffer, length);
 }
 
+static const char WIFI_SAVED_PAGE[] =
+  "<!DOCTYPE html><html><head><meta charset='UTF-8'>"
+  "<meta http-equiv='refresh' content='10;url=/'>"
+  "<style>body{font-family:Arial;text-align:center;padding:50px;background:#f0f0f0}"
+  ".message{background:#fff;padding:30px;border-radius:10px;display:inline-block}</style>"
+  "</head><body><div class='message'>"
+  "<h1 style='color:#4caf50'>✅ WiFi Saved!</h1>"
+  "<p>Credentials saved. Device will restart...</p>"
+  "<p>Redirecting in 10 seconds...</p>"
+  "</div></body></html>";
+
 void AgroWebServer::handleWiFiSave() {
   if (server.hasArg("ssid") && server.hasArg("password") && wifiManager) {
-    String ssid = server.arg("ssid");
-    String password = server.arg("password");
+    wifiManager->saveCredentials(server.arg("ssid").c_str(), server.arg("password").c_str());
     
-    wifiManager->saveCredentials(ssid, password);
-    
-    String html = "<!DOCTYPE html><html><head><meta charset='UTF-8'>"
-                  "<meta http-equiv='refresh' content='10;url=/'>"
-                  "<style>body{font-family:Arial;text-align:center;padding:50px;background:#f0f0f0}"
-                  ".message{background:#fff;padding:30px;border-radius:10px;display:inline-block}</style>"
-                  "</head><body><div class='message'>"
-                  "<h1 style='color:#4caf50'>✅ WiFi Saved!</h1>"
-                  "<p>Credentials saved. Device will restart...</p>"
-                  "<p>Redirecting in 10 seconds...</p>"
-                  "</div></body></html>";
-    
-    server.send(200, "text/html", html);
+    server.send_P(200, "text/html", WIFI_SAVED_PAGE, sizeof(WIFI_SAVED_PAGE) - 1);
     delay(2000);
     ESP.restart();
   } else {
@@ -221,44 +463,284 @@ void AgroWebServer::handleWiFiSave() {
   }
 }
 
+static const char WIFI_CLEARED_PAGE[] =
+  "<!DOCTYPE html><html><head><meta charset='UTF-8'>"
+  "<meta http-equiv='refresh' content='5;url=/wifi'>"
+  "<style>body{font-family:Arial;text-align:center;padding:50px;background:#f0f0f0}"
+  ".message{background:#fff;padding:30px;border-radius:10px;display:inline-block}</style>"
+  "</head><body><div class='message'>"
+  "<h1 style='color:#f44336'>🗑️ Credentials Cleared</h1>"
+  "<p>WiFi credentials have been deleted.</p>"
+  "<p>Redirecting to WiFi setup...</p>"
+  "</div></body></html>";
+
 void AgroWebServer::handleWiFiClear() {
   if (wifiManager) {
     wifiManager->clearCredentials();
   }
   
-  String html = "<!DOCTYPE html><html><head><meta charset='UTF-8'>"
-                "<meta http-equiv='refresh' content='5;url=/wifi'>"
-                "<style>body{font-family:Arial;text-align:center;padding:50px;background:#f0f0f0}"
-                ".message{background:#fff;padding:30px;border-radius:10px;display:inline-block}</style>"
-                "</head><body><div class='message'>"
-                "<h1 style='color:#f44336'>🗑️ Credentials Cleared</h1>"
-                "<p>WiFi credentials have been deleted.</p>"
-                "<p>Redirecting to WiFi setup...</p>"
-                "</div></body></html>";
-  
-  server.send(200, "text/html", html);
+  server.send_P(200, "text/html", WIFI_CLEARED_PAGE, sizeof(WIFI_CLEARED_PAGE) - 1);
 }
 
 void AgroWebServer::handlePumpOn() {
+  handlePumpCommand(true);
+}
+
+void AgroWebServer::handlePumpOff() {
+  handlePumpCommand(false);
+}
+
+void AgroWebServer::handlePumpCommand(bool on) {
+  // Stamped first: the receive time of the request
+  ActuationTrace trace;
+  bool timed = actuationTracker && pumpController;
+  if (timed) {
+    int64_t sentMs = server.hasArg("ts") ? strtoll(server.arg("ts").c_str(), nullptr, 10) : 0;
+    actuationTracker->begin(trace, sentMs);
+  }
+
+  // Scripts pass id and/or ts and get a JSON ack; browsers get redirected home
+  bool wantsAck = server.hasArg("id") || server.hasArg("ts");
+  char id[COMMAND_ID_MAX] = "";
+  if (server.hasArg("id")) {
+    const String &arg = server.arg("id");
+    if (arg.indexOf('"') < 0 && arg.indexOf('\\') < 0) strlcpy(id, arg.c_str(), sizeof(id));
+  }
+  const char *command = on ? "pump_on" : "pump_off";
+  char payload[320];
+
+  if (timed && actuationTracker->isExpired(trace)) {
+    snprintf(payload, sizeof(payload),
+             "{\"id\":\"%s\",\"cmd\":\"%s\",\"status\":\"error\",\"detail\":\"expired after %ld ms\"}",
+             id, command, (long)(trace.transitUs / 1000));
+    server.send(409, "application/json", payload);
+    return;
+  }
+
   if (pumpController) {
-    pumpController->start();
+    if (on) {
+      pumpController->start();
+    } else {
+      pumpController->stop();
+    }
   }
-  server.sendHeader("Location", "/");
-  server.send(303);
+  if (timed) actuationTracker->complete(trace, *pumpController);
+
+  if (!wantsAck) {
+    server.sendHeader("Location", "/");
+    server.send(303);
+  } else {
+    size_t length = snprintf(payload, sizeof(payload), "{\"id\":\"%s\",\"cmd\":\"%s\",\"status\":\"%s\"",
+                             id, command, pumpController ? "ok" : "error");
+    if (timed) length += ActuationTracker::formatAck(payload + length, sizeof(payload) - length, trace);
+    if (length + 1 < sizeof(payload)) {
+      payload[length++] = '}';
+      payload[length] = '\0';
+    }
+    server.send(pumpController ? 200 : 503, "application/json", payload);
+  }
+  if (timed) actuationTracker->acknowledged(trace);
 }
 
-void AgroWebServer::handlePumpOff() {
+// ========== /api ==========
+// The sequence moves with every sensor update and every pump, health or
+// actuation change, so unchanged polls are answered from the sequence number
+// alone, without building the document. Clock and heap fields drift between
+// bumps, hence a weak ETag.
+void AgroWebServer::formatETag(char *buffer, size_t size) const {
+  snprintf(buffer, size, "W/\"%08lx-%lu\"", (unsigned long)bootTag, (unsigned long)sequence);
+}
+
+// Weak comparison: the quoted part matches with or without the W/ prefix
+bool AgroWebServer::etagMatches(const char *header) const {
+  char etag[ETAG_MAX];
+  formatETag(etag, sizeof(etag));
+  return strstr(header, etag + 2) != nullptr || strchr(header, '*') != nullptr;
+}
+
+bool AgroWebServer::clientHasSnapshot() {
+  if (!server.hasHeader("If-None-Match")) return false;
+  return etagMatches(server.header("If-None-Match").c_str());
+}
+
+// Pump edges and health changes between sensor updates would otherwise be
+// answered with 304 and the old body until the next SENSOR_READ_INTERVAL
+void AgroWebServer::trackStateChanges() {
+  uint32_t tag = 0;
   if (pumpController) {
-    pumpController->stop();
+    tag = pumpController->getWateringCount() * 2 + pumpController->isPumpActive();
+  }
+  for (uint8_t i = 0; i < sensorHealthCount; i++) {
+    tag = tag * 31 + sensorHealth[i]->getState();
+  }
+  if (actuationTracker) {
+    tag = tag * 31 + actuationTracker->getCommands();
+  }
+  if (tag != stateTag) {
+    stateTag = tag;
+    sequence++;
   }
-  server.sendHeader("Location", "/");
-  server.send(303);
 }
 
 void AgroWebServer::handleAPI() {
+  char etag[ETAG_MAX];
+  formatETag(etag, sizeof(etag));
+  
+  server.sendHeader("ETag", etag);
+  server.sendHeader("Cache-Control", "no-cache");
+  if (clientHasSnapshot()) {
+    notModifiedCount++;
+    server.send(304);
+    return;
+  }
+  
+  JsonDocument doc;
+  buildSnapshot(doc);
+  sendJson(doc);
+}
+
+// ========== LONG POLL (port 81) ==========
+// WebServer serves one client at a time and waits on a connection that is
+// still open after its handler returns, so a request parked there would
+// stall every other route. Long polls get their own listener instead:
+// /api?after=<seq> on LONG_POLL_PORT is read without blocking, parked
+// while <seq> is current, and answered when the next snapshot exists.
+
+void AgroWebServer::serviceLongPolls() {
+  WiFiClient incoming = pollServer.available();
+  if (incoming) {
+    LongPoll *slot = nullptr;
+    for (uint8_t i = 0; i < LONG_POLL_SLOTS && !slot; i++) {
+      if (longPolls[i].state == POLL_FREE) slot = &longPolls[i];
+    }
+    if (slot) {
+      slot->client = incoming;
+      slot->state = POLL_READING;
+      slot->lineLength = 0;
+      slot->gotRequestLine = false;
+      slot->isApi = false;
+      slot->hasAfter = false;
+      slot->matched = false;
+      slot->since = millis();
+    } else {
+      incoming.print("HTTP/1.1 503 Service Unavailable\r\nRetry-After: 1\r\n"
+                     "Access-Control-Allow-Origin: *\r\nContent-Length: 0\r\nConnection: close\r\n\r\n");
+      incoming.stop();
+    }
+  }
+  
+  unsigned long now = millis();
+  // Built at most once per pass, however many clients are answered
   JsonDocument doc;
-  doc["device"] = "AgroHygra-ESP32";
-  doc["timestamp"] = millis() / 1000;
+  size_t length = 0;
+  for (uint8_t i = 0; i < LONG_POLL_SLOTS; i++) {
+    LongPoll &poll = longPolls[i];
+    if (poll.state == POLL_FREE) continue;
+    
+    if (!poll.client.connected()) {
+      poll.client.stop();
+      poll.state = POLL_FREE;
+      continue;
+    }
+    
+    if (poll.state == POLL_READING) {
+      if (!readLongPoll(poll)) {
+        if (now - poll.since >= LONG_POLL_READ_TIMEOUT) {
+          poll.client.stop();
+          poll.state = POLL_FREE;
+        }
+        continue;
+      }
+      if (!poll.isApi) {
+        poll.client.print("HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\nConnection: close\r\n\r\n");
+        poll.client.stop();
+        poll.state = POLL_FREE;
+        continue;
+      }
+      // Only an exact match waits; an older or unknown seq (e.g. from before
+      // a reboot) gets the current snapshot right away
+      if (poll.hasAfter && poll.after == sequence) {
+        poll.state = POLL_WAITING;
+        poll.since = now;
+        longPollCount++;
+        continue;
+      }
+      answerLongPoll(poll, doc, length);
+      continue;
+    }
+    
+    if (sequence != poll.after || now - poll.since >= LONG_POLL_TIMEOUT) {
+      answerLongPoll(poll, doc, length);
+    }
+  }
+}
+
+// Consumes what has arrived; true once the request head is complete
+bool AgroWebServer::readLongPoll(LongPoll &poll) {
+  while (poll.client.available()) {
+    char c = poll.client.read();
+    if (c == '\r') continue;
+    if (c != '\n') {
+      if (poll.lineLength < LONG_POLL_LINE_MAX - 1) poll.line[poll.lineLength++] = c;
+      continue;
+    }
+    if (poll.lineLength == 0) return poll.gotRequestLine;
+    poll.line[poll.lineLength] = '\0';
+    parseLongPollLine(poll);
+    poll.lineLength = 0;
+  }
+  return false;
+}
+
+void AgroWebServer::parseLongPollLine(LongPoll &poll) {
+  if (!poll.gotRequestLine) {
+    poll.gotRequestLine = true;
+    poll.isApi = strncmp(poll.line, "GET /api ", 9) == 0 || strncmp(poll.line, "GET /api?", 9) == 0;
+    const char *after = strstr(poll.line, "after=");
+    if (poll.isApi && after) {
+      poll.hasAfter = true;
+      poll.after = strtoul(after + 6, nullptr, 10);
+    }
+    return;
+  }
+  if (strncasecmp(poll.line, "If-None-Match:", 14) == 0) {
+    poll.matched = etagMatches(poll.line + 14);
+    poll.matchedSeq = sequence;
+  }
+}
+
+// 304 only to a conditional request whose ETag is still current; anything
+// else (including a timed-out poll without If-None-Match) gets the body
+void AgroWebServer::answerLongPoll(LongPoll &poll, JsonDocument &doc, size_t &length) {
+  char etag[ETAG_MAX];
+  formatETag(etag, sizeof(etag));
+  
+  if (poll.matched && poll.matchedSeq == sequence) {
+    poll.client.printf("HTTP/1.1 304 Not Modified\r\nETag: %s\r\nCache-Control: no-cache\r\n"
+                       "Access-Control-Allow-Origin: *\r\nConnection: close\r\n\r\n", etag);
+    notModifiedCount++;
+  } else {
+    if (length == 0) {
+      buildSnapshot(doc);
+      length = measureJson(doc);
+    }
+    poll.client.printf("HTTP/1.1 200 OK\r\nContent-Type: application/json\r\nContent-Length: %u\r\n"
+                       "ETag: %s\r\nCache-Control: no-cache\r\nAccess-Control-Allow-Origin: *\r\n"
+                       "Connection: close\r\n\r\n", (unsigned)length, etag);
+    BufferedPrint<> out(poll.client);
+    serializeJson(doc, out);
+  }
+  poll.client.stop();
+  poll.state = POLL_FREE;
+}
+
+void AgroWebServer::buildSnapshot(JsonDocument &doc) {
+  doc["device"] = deviceId;
+  doc["seq"] = sequence;
+  TimeStamp now = timeService ? timeService->now() : TimeService::stamp();
+  doc["timestamp"] = now.utcMs;
+  doc["tq"] = TimeService::getQualityName(now.quality);
+  doc["uptime"] = TimeService::monoMs() / 1000;
   doc["soil"] = soilMoisture;
   doc["temp"] = temperature;
   doc["humidity"] = humidity;
@@ -271,6 +753,20 @@ void AgroWebServer::handleAPI() {
   doc["wateringCount"] = pumpController ? pumpController->getWateringCount() : 0;
   doc["totalWateringTime"] = pumpController ? pumpController->getTotalWateringTime() : 0;
   
+  if (pumpController) {
+    doc["irrigation"]["mode"] = pumpController->getMode() == MODE_PULSE_SOAK ? "pulse" : "bang";
+    doc["irrigation"]["onTime24h"] = pumpController->getOnTimeLast24h();
+    doc["irrigation"]["relayCycles24h"] = pumpController->getRelayCyclesLast24h();
+    doc["irrigation"]["lastOvershoot"] = pumpController->getLastOvershoot();
+    doc["irrigation"]["avgOvershoot"] = pumpController->getAvgOvershoot();
+    doc["irrigation"]["dryingRate"] = pumpController->getDryingRate();
+    doc["irrigation"]["pulseGain"] = pumpController->getPulseGain();
+    doc["irrigation"]["infiltrationLag"] = pumpController->getInfiltrationLag();
+  }
+  if (pumpStateStore) {
+    pumpStateStore->toJson(doc["irrigation"]["persist"]);
+  }
+  
   // NPK data if available
   if (npkSensor && npkSensor->isAvailable()) {
     doc["npk"]["n"] = npkSensor->getNitrogen();
@@ -280,9 +776,397 @@ void AgroWebServer::handleAPI() {
     doc["npk"]["ec"] = npkSensor->getEC();
     doc["npk"]["temp"] = npkSensor->getTemperature();
     doc["npk"]["moisture"] = npkSensor->getHumidity();
+    doc["npk"]["busUs"] = npkSensor->getAvgTransactionUs();
+    doc["npk"]["crcErrors"] = npkSensor->getCrcErrors();
+    doc["npk"]["timeouts"] = npkSensor->getTimeouts();
+  }
+  
+  // Per-sensor health (state, success rate, latency, staleness)
+  for (uint8_t i = 0; i < sensorHealthCount; i++) {
+    sensorHealth[i]->toJson(doc["health"][sensorHealth[i]->getName()], millis());
+  }
+  
+  // Current per-sensor sampling intervals (ms) and budget use
+  if (samplingPolicy) {
+    samplingPolicy->toJson(doc["sampling"]);
+  }
+  if (heapMonitor) {
+    heapMonitor->toJson(doc["heap"]);
+  }
+  if (sampleStore) {
+    sampleStore->toJson(doc["store"]);
+  }
+  if (actuationTracker) {
+    actuationTracker->toJson(doc["actuation"]);
+  }
+  if (timeService) {
+    timeService->toJson(doc["clock"]);
+  }
+  if (ruleEngine) {
+    ruleEngine->toJson(doc["rules"]);
+  }
+  if (i2cBus) {
+    i2cBus->toJson(doc["i2c"]);
+  }
+  if (traceRecorder) {
+    traceRecorder->toJson(doc["trace"]);
+  }
+  
+  uint8_t parked = 0;
+  for (uint8_t i = 0; i < LONG_POLL_SLOTS; i++) {
+    if (longPolls[i].state == POLL_WAITING) parked++;
+  }
+  doc["http"]["notModified"] = notModifiedCount;
+  doc["http"]["longPolls"] = longPollCount;
+  doc["http"]["parked"] = parked;
+}
+
+void AgroWebServer::handleConfigGet() {
+  if (!configRegistry) {
+    server.send(503, "text/plain", "Config registry unavailable");
+    return;
+  }
+
+  JsonDocument doc;
+  configRegistry->toJson(doc);
+
+  sendJson(doc);
+}
+
+void AgroWebServer::handleConfigSet() {
+  if (!configRegistry) {
+    server.send(503, "text/plain", "Config registry unavailable");
+    return;
+  }
+
+  // JSON object body, or every form argument as key=value. Either way the
+  // keys go in as one update so related keys are checked together.
+  JsonDocument updates;
+  String contentType = server.header("Content-Type");
+  if (contentType.startsWith("application/json")) {
+    if (deserializeJson(updates, server.arg("plain")) || !updates.is<JsonObject>()) {
+      server.send(400, "text/plain", "Invalid JSON");
+      return;
+    }
+  } else {
+    for (int i = 0; i < server.args(); i++) {
+      updates[server.argName(i)] = server.arg(i);
+    }
+  }
+
+  int total = updates.as<JsonObject>().size();
+  int applied = configRegistry->applyJson(updates.as<JsonVariant>());
+  int rejected = total - applied;
+
+  JsonDocument doc;
+  doc["applied"] = applied;
+  doc["rejected"] = rejected;
+
+  sendJson(doc, rejected > 0 ? 400 : 200);
+}
+
+void AgroWebServer::handleConfigReset() {
+  if (!configRegistry || !server.hasArg("key")) {
+    server.send(400, "text/plain", "Missing parameters");
+    return;
+  }
+
+  String key = server.arg("key");
+  if (!configRegistry->hasKey(key.c_str())) {
+    server.send(404, "text/plain", "Unknown key");
+  } else if (configRegistry->reset(key.c_str())) {
+    server.send(200, "text/plain", "OK");
+  } else {
+    server.send(409, "text/plain", "Default conflicts with a related key");
+  }
+}
+
+// ========== EXPORT ==========
+
+// Streams stored history as CSV or NDJSON. Memory use is one decoded block
+// per metric plus the output buffer, whatever the range. Records come in
+// time order across metrics, so an interrupted download resumes with
+// from = the last time received (after dropping the records at that time).
+//   /api/export?format=csv|ndjson&metric=temp&from=<s>&to=<s>&limit=<n>
+void AgroWebServer::handleExport() {
+  if (!sampleStore) {
+    server.send(503, "text/plain", "Sample store unavailable");
+    return;
+  }
+
+  bool ndjson = server.arg("format") == "ndjson";
+  int8_t metric = -1;
+  if (server.hasArg("metric")) {
+    metric = SampleStore::findMetric(server.arg("metric").c_str());
+    if (metric < 0) {
+      server.send(400, "text/plain", "Unknown metric");
+      return;
+    }
+  }
+  uint32_t from = server.hasArg("from") ? strtoul(server.arg("from").c_str(), nullptr, 10) : 0;
+  uint32_t to = server.hasArg("to") ? strtoul(server.arg("to").c_str(), nullptr, 10) : UINT32_MAX;
+  uint32_t limit = server.hasArg("limit") ? strtoul(server.arg("limit").c_str(), nullptr, 10) : UINT32_MAX;
+
+  // One cursor per metric is too much for the loop task's stack
+  StoreReader *reader = new (std::nothrow) StoreReader(*sampleStore, from, to, metric);
+  if (!reader) {
+    server.send(503, "text/plain", "Out of memory");
+    return;
   }
+
+  unsigned long start = millis();
+  uint32_t records = 0;
+  size_t bytes;
+
+  beginChunked(200, ndjson ? "application/x-ndjson" : "text/csv");
+  {
+    ChunkedPrint<EXPORT_BUFFER_SIZE> out(server);
+    if (!ndjson) out.print("time,metric,value\n");
+
+    StoreRecord record;
+    char line[80];
+    while (records < limit && reader->next(record)) {
+      const char *name = SampleStore::getMetricName(record.metric);
+      int decimals = SampleStore::getDecimals(record.metric);
+      int length = ndjson
+        ? snprintf(line, sizeof(line), "{\"t\":%lu,\"m\":\"%s\",\"v\":%.*f}\n",
+                   (unsigned long)record.time, name, decimals, record.value)
+        : snprintf(line, sizeof(line), "%lu,%s,%.*f\n",
+                   (unsigned long)record.time, name, decimals, record.value);
+      out.write((const uint8_t *)line, min((size_t)length, sizeof(line) - 1));
+      records++;
+
+      // Long exports run inside the request; keep the pump limit enforced
+      // and stop early if the client went away
+      if ((records & 0xFF) == 0) {
+        if (pumpController) pumpController->checkSafety();
+        if (!server.client().connected()) break;
+      }
+    }
+    out.flush();
+    bytes = out.getBytesWritten();
+  }
+  endChunked();
+  delete reader;
+
+  unsigned long elapsed = millis() - start;
+  sampleStore->noteExport(records, bytes, elapsed);
+  Serial.printf("📦 Export: %lu records, %u bytes in %lums (%.1f KB/s)\n",
+                (unsigned long)records, (unsigned)bytes, elapsed,
+                elapsed ? bytes / (float)elapsed : 0.0f);
+}
+
+// ========== OTA ==========
+
+// ========== /metrics ==========
+// Tasks whose stack headroom is reported. Missing ones are skipped.
+static const char *const METRIC_TASKS[] = {"loopTask", "arduino_events", "tiT", "wifi", "esp_timer", "Tmr Svc", I2C_TASK_NAME};
+
+void AgroWebServer::handleMetrics() {
+  beginChunked(200, METRICS_CONTENT_TYPE);
+  {
+    ChunkedPrint<EXPORT_BUFFER_SIZE> out(server);
+    writeMetrics(out);
+  }
+  endChunked();
+}
+
+void AgroWebServer::writeMetrics(Print &out) {
+  MetricsWriter metrics(out);
+  
+  metrics.family("agrohygra_info", "gauge", "Device identity");
+  metrics.sample("agrohygra_info", 1, "device", deviceId);
+  metrics.family("agrohygra_uptime_seconds", "gauge", "Time since boot");
+  metrics.sample("agrohygra_uptime_seconds", TimeService::monoMs() / 1000);
+  
+  // Latest readings (same snapshot as /api)
+  metrics.family("agrohygra_soil_moisture_percent", "gauge", "Soil moisture");
+  metrics.sample("agrohygra_soil_moisture_percent", soilMoisture);
+  metrics.family("agrohygra_temperature_celsius", "gauge", "Air temperature");
+  metrics.sample("agrohygra_temperature_celsius", temperature);
+  metrics.family("agrohygra_humidity_percent", "gauge", "Relative air humidity");
+  metrics.sample("agrohygra_humidity_percent", humidity);
+  metrics.family("agrohygra_air_quality_percent", "gauge", "MQ-135 air quality, 0 = clean");
+  metrics.sample("agrohygra_air_quality_percent", airQuality);
+  metrics.family("agrohygra_tds_ppm", "gauge", "Total dissolved solids");
+  metrics.sample("agrohygra_tds_ppm", tdsValue);
+  if (npkSensor && npkSensor->isAvailable()) {
+    metrics.family("agrohygra_soil_temperature_celsius", "gauge", "Soil temperature");
+    metrics.sample("agrohygra_soil_temperature_celsius", npkSensor->getTemperature());
+    metrics.family("agrohygra_soil_ph", "gauge", "Soil pH");
+    metrics.sample("agrohygra_soil_ph", npkSensor->getPH());
+    metrics.family("agrohygra_soil_ec", "gauge", "Soil electrical conductivity");
+    metrics.sample("agrohygra_soil_ec", npkSensor->getEC());
+    metrics.family("agrohygra_soil_nutrient_mg_per_kg", "gauge", "Soil nitrogen, phosphorus and potassium");
+    metrics.sample("agrohygra_soil_nutrient_mg_per_kg", npkSensor->getNitrogen(), "nutrient", "n");
+    metrics.sample("agrohygra_soil_nutrient_mg_per_kg", npkSensor->getPhosphorus(), "nutrient", "p");
+    metrics.sample("agrohygra_soil_nutrient_mg_per_kg", npkSensor->getPotassium(), "nutrient", "k");
+  }
+  
+  if (pumpController) {
+    metrics.family("agrohygra_pump_active", "gauge", "1 while the pump runs");
+    metrics.sample("agrohygra_pump_active", pumpController->isPumpActive());
+    metrics.family("agrohygra_watering_count_total", "counter", "Watering cycles, kept across reboots");
+    metrics.sample("agrohygra_watering_count_total", pumpController->getWateringCount());
+    metrics.family("agrohygra_watering_seconds_total", "counter", "Pump run time, kept across reboots");
+    metrics.sample("agrohygra_watering_seconds_total", pumpController->getTotalWateringTime());
+  }
+  
+  // Connectivity
+  metrics.family("agrohygra_wifi_connected", "gauge", "1 while associated to the access point");
+  metrics.sample("agrohygra_wifi_connected", WiFi.status() == WL_CONNECTED);
+  if (WiFi.status() == WL_CONNECTED) {
+    metrics.family("agrohygra_wifi_rssi_dbm", "gauge", "Signal strength of the access point");
+    metrics.sample("agrohygra_wifi_rssi_dbm", WiFi.RSSI());
+  }
+  if (mqttManager) {
+    metrics.family("agrohygra_mqtt_connected", "gauge", "1 while the broker session is up");
+    metrics.sample("agrohygra_mqtt_connected", mqttManager->isConnected());
+    metrics.family("agrohygra_mqtt_connects_total", "counter", "Broker sessions established since boot");
+    metrics.sample("agrohygra_mqtt_connects_total", mqttManager->getConnectCount());
+    metrics.family("agrohygra_mqtt_connect_failures_total", "counter", "Failed broker connection attempts");
+    metrics.sample("agrohygra_mqtt_connect_failures_total", mqttManager->getConnectFailures());
+  }
+  metrics.family("agrohygra_http_not_modified_total", "counter", "/api polls answered with 304");
+  metrics.sample("agrohygra_http_not_modified_total", notModifiedCount);
   
-  String json;
-  serializeJson(doc, json);
-  server.send(200, "application/json", json);
+  // Memory
+  if (heapMonitor) {
+    metrics.family("agrohygra_heap_free_bytes", "gauge", "Free heap at the last sample");
+    metrics.sample("agrohygra_heap_free_bytes", heapMonitor->getFreeHeap());
+    metrics.family("agrohygra_heap_largest_block_bytes", "gauge", "Largest allocatable block at the last sample");
+    metrics.sample("agrohygra_heap_largest_block_bytes", heapMonitor->getLargestBlock());
+    metrics.family("agrohygra_heap_min_free_bytes", "gauge", "Lowest free heap since boot");
+    metrics.sample("agrohygra_heap_min_free_bytes", heapMonitor->getMinFreeHeap());
+  }
+  metrics.family("agrohygra_task_stack_free_bytes", "gauge", "Stack high-water mark: least free stack since the task started");
+  for (const char *task : METRIC_TASKS) {
+    TaskHandle_t handle = xTaskGetHandle(task);
+    if (handle) metrics.sample("agrohygra_task_stack_free_bytes", uxTaskGetStackHighWaterMark(handle), "task", task);
+  }
+  
+  // Latency
+  if (loopLatency) {
+    metrics.family("agrohygra_loop_duration_seconds", "histogram", "Busy time of one main loop pass, sleep excluded");
+    metrics.histogram("agrohygra_loop_duration_seconds", *loopLatency);
+  }
+  metrics.family("agrohygra_sensor_read_duration_seconds", "histogram", "Time spent per sensor read attempt");
+  for (uint8_t i = 0; i < sensorHealthCount; i++) {
+    metrics.histogram("agrohygra_sensor_read_duration_seconds", sensorHealth[i]->getLatencyHistogram(),
+                      "sensor", sensorHealth[i]->getName());
+  }
+  metrics.family("agrohygra_sensor_reads_total", "counter", "Good sensor reads");
+  for (uint8_t i = 0; i < sensorHealthCount; i++) {
+    metrics.sample("agrohygra_sensor_reads_total", sensorHealth[i]->getSuccesses(), "sensor", sensorHealth[i]->getName());
+  }
+  metrics.family("agrohygra_sensor_failures_total", "counter", "Failed sensor reads, NaNs included");
+  for (uint8_t i = 0; i < sensorHealthCount; i++) {
+    metrics.sample("agrohygra_sensor_failures_total", sensorHealth[i]->getFailures(), "sensor", sensorHealth[i]->getName());
+  }
+  if (actuationTracker) {
+    metrics.family("agrohygra_actuation_duration_seconds", "histogram", "Pump command latency by stage");
+    for (uint8_t stage = 0; stage < STAGE_COUNT; stage++) {
+      metrics.histogram("agrohygra_actuation_duration_seconds", actuationTracker->getStage((ActuationStage)stage),
+                        "stage", ActuationTracker::getStageName(stage));
+    }
+  }
+  
+  // I2C bus, per client
+  if (i2cBus) {
+    metrics.family("agrohygra_i2c_busy_seconds_total", "counter", "Time on the I2C wire");
+    for (uint8_t i = 0; i < i2cBus->getClientCount(); i++) {
+      I2CClient c = i2cBus->getClient(i);
+      metrics.sample("agrohygra_i2c_busy_seconds_total", c.busUs / 1e6, "client", c.name);
+    }
+    metrics.family("agrohygra_i2c_transactions_total", "counter", "I2C transactions run");
+    for (uint8_t i = 0; i < i2cBus->getClientCount(); i++) {
+      I2CClient c = i2cBus->getClient(i);
+      metrics.sample("agrohygra_i2c_transactions_total", c.transactions, "client", c.name);
+    }
+    metrics.family("agrohygra_i2c_errors_total", "counter", "I2C transactions that failed (NACK, timeout, short read)");
+    for (uint8_t i = 0; i < i2cBus->getClientCount(); i++) {
+      I2CClient c = i2cBus->getClient(i);
+      metrics.sample("agrohygra_i2c_errors_total", c.errors, "client", c.name);
+    }
+    metrics.family("agrohygra_i2c_dropped_total", "counter", "I2C submits refused because the queue was full");
+    for (uint8_t i = 0; i < i2cBus->getClientCount(); i++) {
+      I2CClient c = i2cBus->getClient(i);
+      metrics.sample("agrohygra_i2c_dropped_total", c.dropped, "client", c.name);
+    }
+  }
+}
+
+// Controller trace for tools/replay (set config key "trace" to record)
+void AgroWebServer::handleTrace() {
+  if (!traceRecorder || !traceRecorder->hasData()) {
+    server.send(404, "text/plain", "No trace recorded");
+    return;
+  }
+
+  server.sendHeader("Content-Disposition", "attachment; filename=\"agrohygra.trace\"");
+  beginChunked(200, "application/octet-stream");
+  {
+    ChunkedPrint<EXPORT_BUFFER_SIZE> out(server);
+    traceRecorder->writeTo(out);
+  }
+  endChunked();
+}
+
+void AgroWebServer::handleOTAStatus() {
+  if (!otaManager) {
+    server.send(503, "text/plain", "OTA unavailable");
+    return;
+  }
+
+  JsonDocument doc;
+  otaManager->toJson(doc.to<JsonObject>());
+  sendJson(doc);
+}
+
+// Called by WebServer for every received block of the multipart body;
+// each block goes straight to flash, the image is never buffered. If
+// beginUpdate() was refused (e.g. a URL pull is running), the rest of this
+// upload is ignored by OTAManager instead of landing in the other image.
+void AgroWebServer::handleOTAUpload() {
+  if (!otaManager) return;
+
+  HTTPUpload &upload = server.upload();
+  switch (upload.status) {
+    case UPLOAD_FILE_START:
+      otaManager->beginUpdate(OTA_SOURCE_UPLOAD, 0, server.arg("sha256").c_str());
+      break;
+    case UPLOAD_FILE_WRITE:
+      otaManager->write(OTA_SOURCE_UPLOAD, upload.buf, upload.currentSize);
+      break;
+    case UPLOAD_FILE_END:
+      otaManager->finishUpdate(OTA_SOURCE_UPLOAD);
+      break;
+    case UPLOAD_FILE_ABORTED:
+      otaManager->abortUpdate(OTA_SOURCE_UPLOAD, "upload aborted");
+      break;
+  }
+}
+
+void AgroWebServer::handleOTAUploadDone() {
+  if (!otaManager) {
+    server.send(503, "text/plain", "OTA unavailable");
+    return;
+  }
+
+  JsonDocument doc;
+  otaManager->toJson(doc.to<JsonObject>());
+  sendJson(doc, otaManager->getState() == OTA_REBOOT_PENDING ? 200 : 400);
+}
+
+void AgroWebServer::handleOTAPull() {
+  if (!otaManager || !server.hasArg("url") || !server.hasArg("sha256")) {
+    server.send(400, "text/plain", "Missing parameters");
+    return;
+  }
+
+  bool started = otaManager->startPull(server.arg("url").c_str(), server.arg("sha256").c_str());
+
+  JsonDocument doc;
+  otaManager->toJson(doc.to<JsonObject>());
+  sendJson(doc, started ? 202 : 400);
 }
@@ -3,9 +3,19 @@
 
 #include <Arduino.h>
 #include <WebServer.h>
+#include <WiFi.h>
 #include <ESPmDNS.h>
 #include <ArduinoJson.h>
 
+#define WEB_SCAN_BUFFER_SIZE 2048   // <option> list from a WiFi scan
+#define EXPORT_BUFFER_SIZE 1024     // Chunk size of /api/export
+#define LONG_POLL_PORT 81           // Long polls get their own listener (see serviceLongPolls)
+#define LONG_POLL_SLOTS 4           // Connections on LONG_POLL_PORT at once
+#define LONG_POLL_TIMEOUT 25000     // ms a parked request waits before it is answered anyway
+#define LONG_POLL_READ_TIMEOUT 2000 // ms to receive the request head
+#define LONG_POLL_LINE_MAX 96       // Longer header lines are cut (only two are read)
+#define ETAG_MAX 24
+
 // Forward declarations
 class WiFiManager;
 class PumpController;
@@ -13,18 +23,70 @@ class NPKSensor;
 class MQ135Sensor;
 class TDSSensor;
 class DHTSensor;
+class ConfigRegistry;
+class SensorHealth;
+class SamplingPolicy;
+class HeapMonitor;
+class OTAManager;
+class SampleStore;
+class ActuationTracker;
+class TimeService;
+class RuleEngine;
+class PumpStateStore;
+class MQTTManager;
+class LatencyHistogram;
+class I2CBus;
+class TraceRecorder;
+
+enum LongPollState {
+  POLL_FREE,
+  POLL_READING,           // Receiving the request head
+  POLL_WAITING            // Parked until the snapshot after <after> exists
+};
+
+// Connection on LONG_POLL_PORT, from accept to answer
+struct LongPoll {
+  WiFiClient client;
+  uint8_t state;
+  char line[LONG_POLL_LINE_MAX];    // Header line being received
+  uint8_t lineLength;
+  bool gotRequestLine;
+  bool isApi;             // GET /api
+  bool hasAfter;
+  uint32_t after;         // Snapshot the client already has
+  bool matched;           // If-None-Match held the ETag of snapshot matchedSeq
+  uint32_t matchedSeq;
+  unsigned long since;    // Accepted, then parked
+};
 
 class AgroWebServer {
 private:
   WebServer server;
+  WiFiServer pollServer;
   WiFiManager *wifiManager;
   PumpController *pumpController;
+  ConfigRegistry *configRegistry;
   
   // Sensor pointers
   NPKSensor *npkSensor;
   MQ135Sensor *mq135Sensor;
   TDSSensor *tdsSensor;
   DHTSensor *dhtSensor;
+  SensorHealth **sensorHealth;
+  uint8_t sensorHealthCount;
+  SamplingPolicy *samplingPolicy;
+  HeapMonitor *heapMonitor;
+  OTAManager *otaManager;
+  SampleStore *sampleStore;
+  ActuationTracker *actuationTracker;
+  const char *deviceId;
+  TimeService *timeService;
+  RuleEngine *ruleEngine;
+  PumpStateStore *pumpStateStore;
+  MQTTManager *mqttManager;
+  const LatencyHistogram *loopLatency;
+  I2CBus *i2cBus;
+  TraceRecorder *traceRecorder;
   
   // Current sensor values (updated externally)
   int soilMoisture;
@@ -36,6 +98,32 @@ private:
   int tdsValue;
   int tdsRaw;
   
+  // Snapshot versioning for conditional and long-poll GETs
+  uint32_t sequence;      // Bumped by updateSensorData() and by trackStateChanges()
+  uint32_t stateTag;      // Pump, health and actuation state at the last bump
+  uint32_t bootTag;       // Random per boot, so ETags from before a reboot never match
+  LongPoll longPolls[LONG_POLL_SLOTS];
+  uint32_t notModifiedCount;
+  uint32_t longPollCount;
+  
+  // Chunked response helpers (no String concatenation)
+  void beginChunked(int code, const char *contentType);
+  void sendChunk(const char *text);
+  void sendChunkf(const char *format, ...);
+  void endChunked();
+  void sendJson(JsonDocument &doc, int code = 200);
+  
+  // /api snapshot
+  void formatETag(char *buffer, size_t size) const;
+  bool etagMatches(const char *header) const;
+  bool clientHasSnapshot();
+  void trackStateChanges();
+  void buildSnapshot(JsonDocument &doc);
+  void serviceLongPolls();
+  bool readLongPoll(LongPoll &poll);
+  void parseLongPollLine(LongPoll &poll);
+  void answerLongPoll(LongPoll &poll, JsonDocument &doc, size_t &length);
+  
   // Route handlers
   void handleRoot();
   void handleWiFiSetup();
@@ -44,7 +132,19 @@ private:
   void handleWiFiClear();
   void handlePumpOn();
   void handlePumpOff();
+  void handlePumpCommand(bool on);
   void handleAPI();
+  void handleConfigGet();
+  void handleConfigSet();
+  void handleConfigReset();
+  void handleExport();
+  void handleMetrics();
+  void handleTrace();
+  void writeMetrics(Print &out);
+  void handleOTAStatus();
+  void handleOTAUpload();
+  void handleOTAUploadDone();
+  void handleOTAPull();
   
 public:
   AgroWebServer(int port = 80);
@@ -52,7 +152,22 @@ public:
   void begin();
   void setWiFiManager(WiFiManager *manager);
   void setPumpController(PumpController *controller);
+  void setConfigRegistry(ConfigRegistry *registry);
   void setSensors(NPKSensor *npk, MQ135Sensor *mq135, TDSSensor *tds, DHTSensor *dht);
+  void setSensorHealth(SensorHealth **health, uint8_t count);
+  void setSamplingPolicy(SamplingPolicy *policy);
+  void setHeapMonitor(HeapMonitor *monitor);
+  void setOTAManager(OTAManager *manager);
+  void setSampleStore(SampleStore *store);
+  void setActuationTracker(ActuationTracker *tracker);
+  void setDeviceId(const char *id) { deviceId = id; }
+  void setTimeService(TimeService *service);
+  void setRuleEngine(RuleEngine *engine);
+  void setPumpStateStore(PumpStateStore *store);
+  void setI2CBus(I2CBus *bus);
+  void setTraceRecorder(TraceRecorder *recorder);
+  void setMQTTManager(MQTTManager *manager);
+  void setLoopLatency(const LatencyHistogram *histogram) { loopLatency = histogram; }
   void updateSensorData(int soil, float temp, float hum, int air, int airRaw, 
                        bool airGood, int tds, int tdsRaw);
   void loop();
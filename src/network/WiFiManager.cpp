@@ -1,6 +1,9 @@
 #include "WiFiManager.h"
 
-WiFiManager::WiFiManager() : savedSSID(""), savedPassword(""), apMode(false) {
+WiFiManager::WiFiManager() : apMode(false), cachedIP(0) {
+  savedSSID[0] = '\0';
+  savedPassword[0] = '\0';
+  strcpy(ipAddress, "0.0.0.0");
 }
 
 void WiFiManager::begin() {
@@ -11,25 +14,25 @@ void WiFiManager::begin() {
 
 void WiFiManager::loadCredentials() {
   preferences.begin("wifi", true);
-  savedSSID = preferences.getString("ssid", "");
-  savedPassword = preferences.getString("password", "");
+  if (preferences.getString("ssid", savedSSID, sizeof(savedSSID)) == 0) savedSSID[0] = '\0';
+  if (preferences.getString("password", savedPassword, sizeof(savedPassword)) == 0) savedPassword[0] = '\0';
   preferences.end();
 
-  if (savedSSID.length() > 0) {
+  if (savedSSID[0] != '\0') {
     Serial.println("📡 Loaded WiFi credentials from flash:");
-    Serial.println("   SSID: " + savedSSID);
+    Serial.printf("   SSID: %s\n", savedSSID);
   } else {
     Serial.println("⚠️  No saved WiFi credentials found");
   }
 }
 
-void WiFiManager::saveCredentials(String ssid, String password) {
+void WiFiManager::saveCredentials(const char *ssid, const char *password) {
+  strlcpy(savedSSID, ssid, sizeof(savedSSID));
+  strlcpy(savedPassword, password, sizeof(savedPassword));
   preferences.begin("wifi", false);
-  preferences.putString("ssid", ssid);
-  preferences.putString("password", password);
+  preferences.putString("ssid", savedSSID);
+  preferences.putString("password", savedPassword);
   preferences.end();
-  savedSSID = ssid;
-  savedPassword = password;
   Serial.println("✅ WiFi credentials saved to flash");
 }
 
@@ -37,19 +40,19 @@ void WiFiManager::clearCredentials() {
   preferences.begin("wifi", false);
   preferences.clear();
   preferences.end();
-  savedSSID = "";
-  savedPassword = "";
+  savedSSID[0] = '\0';
+  savedPassword[0] = '\0';
   Serial.println("🗑️  WiFi credentials cleared");
 }
 
 bool WiFiManager::connect() {
-  if (savedSSID.length() == 0) {
+  if (savedSSID[0] == '\0') {
     Serial.println("❌ No WiFi credentials configured");
     return false;
   }
 
-  Serial.println("📡 Connecting to WiFi: " + savedSSID);
-  WiFi.begin(savedSSID.c_str(), savedPassword.c_str());
+  Serial.printf("📡 Connecting to WiFi: %s\n", savedSSID);
+  WiFi.begin(savedSSID, savedPassword);
 
   int attempts = 0;
   while (WiFi.status() != WL_CONNECTED && attempts < 20) {
@@ -89,22 +92,49 @@ void WiFiManager::startAPMode() {
   Serial.println("   Connect to this AP and visit http://192.168.4.1");
 }
 
-String WiFiManager::scanNetworks() {
+const char *WiFiManager::getIPAddress() {
+  if (apMode) return "192.168.4.1";
+
+  uint32_t ip = WiFi.localIP();
+  if (ip != cachedIP) {
+    cachedIP = ip;
+    snprintf(ipAddress, sizeof(ipAddress), "%u.%u.%u.%u",
+             (unsigned)(ip & 0xFF), (unsigned)((ip >> 8) & 0xFF),
+             (unsigned)((ip >> 16) & 0xFF), (unsigned)(ip >> 24));
+  }
+  return ipAddress;
+}
+
+// Writes <option> elements into buffer (truncated at a whole entry),
+// returns the number of bytes written
+size_t WiFiManager::scanNetworks(char *buffer, size_t size) {
   Serial.println("🔍 Scanning WiFi networks...");
   int n = WiFi.scanNetworks();
-  String networks = "";
+  size_t used = 0;
+  buffer[0] = '\0';
 
-  if (n == 0) {
-    networks = "No networks found";
-  } else {
-    Serial.printf("Found %d networks\n", n);
-    for (int i = 0; i < n; ++i) {
-      networks += "<option value=\"" + WiFi.SSID(i) + "\">";
-      networks += WiFi.SSID(i);
-      networks += " (" + String(WiFi.RSSI(i)) + " dBm)";
-      networks += (WiFi.encryptionType(i) == WIFI_AUTH_OPEN) ? " [Open]" : " [Secured]";
-      networks += "</option>";
+  if (n <= 0) {
+    used = strlcpy(buffer, "No networks found", size);
+    return min(used, size - 1);
+  }
+
+  Serial.printf("Found %d networks\n", n);
+  for (int i = 0; i < n; ++i) {
+    // Read the scan record directly instead of the String-returning SSID(i)
+    wifi_ap_record_t *ap = (wifi_ap_record_t *)WiFi.getScanInfoByIndex(i);
+    if (!ap) continue;
+
+    const char *ssid = (const char *)ap->ssid;
+    int written = snprintf(buffer + used, size - used,
+                           "<option value=\"%s\">%s (%d dBm)%s</option>",
+                           ssid, ssid, ap->rssi,
+                           ap->authmode == WIFI_AUTH_OPEN ? " [Open]" : " [Secured]");
+    if (written < 0 || (size_t)written >= size - used) {
+      buffer[used] = '\0';
+      break;
     }
+    used += written;
   }
-  return networks;
+  WiFi.scanDelete();
+  return used;
 }
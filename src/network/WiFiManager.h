@@ -5,29 +5,37 @@
 #include <WiFi.h>
 #include <Preferences.h>
 
+#define WIFI_SSID_MAX 33        // 32 chars + terminator (802.11 limit)
+#define WIFI_PASSWORD_MAX 65    // 64 chars + terminator (WPA2 limit)
+
 class WiFiManager {
 private:
   Preferences preferences;
-  String savedSSID;
-  String savedPassword;
+  char savedSSID[WIFI_SSID_MAX];
+  char savedPassword[WIFI_PASSWORD_MAX];
   bool apMode;
   
+  // Dotted IP text, re-formatted only when the address changes
+  uint32_t cachedIP;
+  char ipAddress[16];
+  
 public:
   WiFiManager();
   
   void begin();
   bool connect();
   void startAPMode();
-  String scanNetworks();
+  size_t scanNetworks(char *buffer, size_t size);
   
   // Credentials management
-  void saveCredentials(String ssid, String password);
+  void saveCredentials(const char *ssid, const char *password);
   void loadCredentials();
   void clearCredentials();
   
   // Getters
-  String getSSID() const { return savedSSID; }
-  String getPassword() const { return savedPassword; }
+  const char *getSSID() const { return savedSSID; }
+  const char *getPassword() const { return savedPassword; }
+  const char *getIPAddress();
   bool isAPMode() const { return apMode; }
   bool isConnected() const { return WiFi.status() == WL_CONNECTED; }
 };
@@ -0,0 +1,28 @@
+#include "AdcCalibration.h"
+#include "esp_adc_cal.h"
+
+AdcCalibration::AdcCalibration() : source("none") {
+  // Until begin() runs, behave like the old linear 0-3.3 V conversion
+  for (int i = 0; i <= ADC_LUT_SEGMENTS; i++) {
+    voltageLut[i] = (uint32_t)(i << ADC_LUT_SHIFT) * 3300 / 4095;
+  }
+}
+
+void AdcCalibration::begin() {
+  esp_adc_cal_characteristics_t chars;
+  esp_adc_cal_value_t type = esp_adc_cal_characterize(ADC_UNIT_1, ADC_ATTEN_DB_11,
+                                                      ADC_WIDTH_BIT_12, ADC_DEFAULT_VREF, &chars);
+  switch (type) {
+    case ESP_ADC_CAL_VAL_EFUSE_TP:   source = "eFuse two-point"; break;
+    case ESP_ADC_CAL_VAL_EFUSE_VREF: source = "eFuse Vref"; break;
+    default:                         source = "default Vref"; break;
+  }
+
+  // The last knot sits one segment past 4095 so interpolation never reads past the table
+  for (int i = 0; i <= ADC_LUT_SEGMENTS; i++) {
+    voltageLut[i] = esp_adc_cal_raw_to_voltage(i << ADC_LUT_SHIFT, &chars);
+  }
+
+  Serial.printf("✅ ADC calibration: %s (0 -> %u mV, 4095 -> %u mV)\n",
+                source, toMilliVolts(0), toMilliVolts(4095));
+}
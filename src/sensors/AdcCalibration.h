@@ -0,0 +1,37 @@
+#ifndef ADC_CALIBRATION_H
+#define ADC_CALIBRATION_H
+
+#include <Arduino.h>
+#include "config/Config.h"
+
+// Piecewise-linear table over the 12-bit code range: one knot every
+// 4096 / ADC_LUT_SEGMENTS codes, interpolated with a shift and a multiply.
+#define ADC_LUT_SEGMENTS 64
+#define ADC_LUT_SHIFT    6     // log2(4096 / ADC_LUT_SEGMENTS)
+
+class AdcCalibration {
+private:
+  uint16_t voltageLut[ADC_LUT_SEGMENTS + 1];   // mV at each knot
+  const char *source;
+
+public:
+  AdcCalibration();
+
+  // Characterises ADC1 at 11 dB from eFuse data and builds the table
+  void begin();
+
+  // Defined up to the last knot (code 4096), so tables built on top of this
+  // one can keep uniform knots over the whole range
+  uint16_t toMilliVolts(int raw) const {
+    if (raw <= 0) return voltageLut[0];
+    if (raw >= (ADC_LUT_SEGMENTS << ADC_LUT_SHIFT)) return voltageLut[ADC_LUT_SEGMENTS];
+    uint16_t index = raw >> ADC_LUT_SHIFT;
+    uint16_t frac = raw & ((1 << ADC_LUT_SHIFT) - 1);
+    int32_t span = (int32_t)voltageLut[index + 1] - voltageLut[index];
+    return voltageLut[index] + ((span * frac) >> ADC_LUT_SHIFT);
+  }
+
+  const char *getSource() const { return source; }
+};
+
+#endif // ADC_CALIBRATION_H
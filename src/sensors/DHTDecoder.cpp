@@ -0,0 +1,111 @@
+#include "DHTDecoder.h"
+
+// Datasheet timings with margin for clones, RMT filtering and pull-up rise time
+#define DHT_ACK_MIN 40          // us, acknowledge low / high (nominal 80)
+#define DHT_ACK_MAX 120
+#define DHT_BIT_LOW_MIN 30      // us, low before every bit (nominal 50)
+#define DHT_BIT_LOW_MAX 90
+#define DHT_BIT_HIGH_MIN 10     // us, 26-28 for a 0, 70 for a 1
+#define DHT_BIT_HIGH_MAX 100
+#define DHT_BIT_ONE_THRESHOLD 48
+
+// Walks the captured levels, merging repeats of the same level
+class LevelCursor {
+private:
+  const DHTLevel *levels;
+  size_t count;
+
+public:
+  size_t position;
+
+  LevelCursor(const DHTLevel *levels, size_t count) : levels(levels), count(count), position(0) {}
+
+  bool next(DHTLevel &out) {
+    if (position >= count) return false;
+    out = levels[position++];
+    while (position < count && levels[position].level == out.level) {
+      uint32_t sum = (uint32_t)out.us + levels[position++].us;
+      out.us = sum > 0xFFFF ? 0xFFFF : sum;
+    }
+    return true;
+  }
+};
+
+static inline bool within(uint16_t value, uint16_t low, uint16_t high) {
+  return value >= low && value <= high;
+}
+
+DHTStatus decodeDHTLevels(const DHTLevel *levels, size_t count, DHTModel model, DHTReading &reading) {
+  LevelCursor cursor(levels, count);
+  DHTLevel level;
+
+  // Acknowledge: ~80 us low followed by ~80 us high
+  bool acknowledged = false;
+  while (!acknowledged && cursor.next(level)) {
+    if (level.level != 0 || !within(level.us, DHT_ACK_MIN, DHT_ACK_MAX)) continue;
+
+    size_t resume = cursor.position;
+    DHTLevel high;
+    if (cursor.next(high) && high.level == 1 && within(high.us, DHT_ACK_MIN, DHT_ACK_MAX)) {
+      acknowledged = true;
+    } else {
+      cursor.position = resume;
+    }
+  }
+  if (!acknowledged) return reading.status = DHT_NO_RESPONSE;
+
+  // 40 bits, MSB first: ~50 us low, then the high time carries the bit
+  uint8_t data[5] = {0, 0, 0, 0, 0};
+  for (uint8_t bit = 0; bit < DHT_FRAME_BITS; bit++) {
+    DHTLevel low, high;
+    if (!cursor.next(low) || !cursor.next(high)) return reading.status = DHT_TRUNCATED;
+    if (low.level != 0 || !within(low.us, DHT_BIT_LOW_MIN, DHT_BIT_LOW_MAX)) {
+      return reading.status = DHT_BAD_TIMING;
+    }
+    if (high.level != 1 || !within(high.us, DHT_BIT_HIGH_MIN, DHT_BIT_HIGH_MAX)) {
+      return reading.status = DHT_BAD_TIMING;
+    }
+    data[bit / 8] = (data[bit / 8] << 1) | (high.us > DHT_BIT_ONE_THRESHOLD ? 1 : 0);
+  }
+
+  return decodeDHTFrame(data, model, reading);
+}
+
+DHTStatus decodeDHTFrame(const uint8_t data[5], DHTModel model, DHTReading &reading) {
+  if ((uint8_t)(data[0] + data[1] + data[2] + data[3]) != data[4]) {
+    return reading.status = DHT_CHECKSUM;
+  }
+
+  float humidity, temperature;
+  if (model == DHT_MODEL_22) {
+    // 16-bit values in 0.1 units, sign-magnitude temperature
+    humidity = ((data[0] << 8) | data[1]) * 0.1f;
+    temperature = (((data[2] & 0x7F) << 8) | data[3]) * 0.1f;
+  } else {
+    // Integer and decimal bytes; newer DHT11s flag negatives in bit 7
+    humidity = data[0] + data[1] * 0.1f;
+    temperature = data[2] + (data[3] & 0x7F) * 0.1f;
+  }
+  if ((model == DHT_MODEL_22 ? data[2] : data[3]) & 0x80) {
+    temperature = -temperature;
+  }
+
+  if (humidity > 100.0f || temperature < -40.0f || temperature > 80.0f) {
+    return reading.status = DHT_OUT_OF_RANGE;
+  }
+
+  reading.humidity = humidity;
+  reading.temperature = temperature;
+  return reading.status = DHT_OK;
+}
+
+const char *dhtStatusName(DHTStatus status) {
+  switch (status) {
+    case DHT_OK: return "ok";
+    case DHT_NO_RESPONSE: return "no_response";
+    case DHT_TRUNCATED: return "truncated";
+    case DHT_BAD_TIMING: return "bad_timing";
+    case DHT_CHECKSUM: return "checksum";
+    default: return "out_of_range";
+  }
+}
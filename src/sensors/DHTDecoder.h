@@ -0,0 +1,47 @@
+#ifndef DHT_DECODER_H
+#define DHT_DECODER_H
+
+// Pure decoding of a captured DHT11/DHT22 pulse train. No Arduino or
+// driver dependencies, so recorded timing traces can be decoded on the host.
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define DHT_FRAME_BITS 40
+
+enum DHTModel {
+  DHT_MODEL_11 = 11,
+  DHT_MODEL_22 = 22
+};
+
+enum DHTStatus {
+  DHT_OK,
+  DHT_NO_RESPONSE,    // No 80 us low / 80 us high acknowledge
+  DHT_TRUNCATED,      // Fewer than 40 bits captured
+  DHT_BAD_TIMING,     // A bit pulse outside the datasheet window
+  DHT_CHECKSUM,
+  DHT_OUT_OF_RANGE    // Checksum fine but the values are not physical
+};
+
+// One level of the line and how long it lasted, in capture order
+struct DHTLevel {
+  uint8_t level;
+  uint16_t us;
+};
+
+struct DHTReading {
+  DHTStatus status;
+  float temperature;  // °C
+  float humidity;     // %RH
+};
+
+// Decodes a captured level sequence. Anything before the sensor's
+// acknowledge (the tail of the host start pulse) is skipped.
+DHTStatus decodeDHTLevels(const DHTLevel *levels, size_t count, DHTModel model, DHTReading &reading);
+
+// Converts the 5 raw bytes (checksum included) to engineering units
+DHTStatus decodeDHTFrame(const uint8_t data[5], DHTModel model, DHTReading &reading);
+
+const char *dhtStatusName(DHTStatus status);
+
+#endif // DHT_DECODER_H
@@ -1,19 +1,149 @@
 #include "DHTSensor.h"
 
-DHTSensor::DHTSensor(uint8_t pin, uint8_t type) 
-  : dht(pin, type), temperature(0), humidity(0) {
+DHTSensor::DHTSensor(uint8_t pin, DHTModel model)
+  : pin(pin), model(model), ringbuf(nullptr), driverReady(false),
+    phase(DHT_PHASE_IDLE), phaseStart(0), requestedAt(0),
+    levelCount(0), lastLatency(0), fresh(false), okCount(0), errorCount(0),
+    temperature(0), humidity(0),
+    temperatureFilter(nullptr), humidityFilter(nullptr), readingCallback(nullptr) {
+  lastReading.status = DHT_NO_RESPONSE;
+  lastReading.temperature = NAN;
+  lastReading.humidity = NAN;
 }
 
 void DHTSensor::begin() {
-  dht.begin();
-  Serial.println("✅ DHT Sensor initialized");
+  rmt_config_t config = {};
+  config.rmt_mode = RMT_MODE_RX;
+  config.channel = DHT_RMT_CHANNEL;
+  config.gpio_num = (gpio_num_t)pin;
+  config.clk_div = 80;                            // 1 us per tick
+  config.mem_block_num = 1;
+  config.rx_config.filter_en = true;
+  config.rx_config.filter_ticks_thresh = 100;     // APB cycles, drops glitches < ~1 us
+  config.rx_config.idle_threshold = DHT_IDLE_THRESHOLD;
+
+  driverReady = rmt_config(&config) == ESP_OK &&
+                rmt_driver_install(DHT_RMT_CHANNEL, 1024, 0) == ESP_OK &&
+                rmt_get_ringbuf_handle(DHT_RMT_CHANNEL, &ringbuf) == ESP_OK;
+
+  // Open drain: the host pulls low to start, the pull-up releases the line.
+  // The RMT input keeps listening through the GPIO matrix.
+  gpio_set_direction((gpio_num_t)pin, GPIO_MODE_INPUT_OUTPUT_OD);
+  gpio_set_pull_mode((gpio_num_t)pin, GPIO_PULLUP_ONLY);
+  gpio_set_level((gpio_num_t)pin, 1);
+
+  if (driverReady) {
+    Serial.printf("✅ DHT%d sensor initialized (RMT capture)\n", model);
+  } else {
+    Serial.println("❌ DHT RMT receiver setup failed");
+  }
+}
+
+void DHTSensor::setFilters(FilterChain *temperature, FilterChain *humidity) {
+  temperatureFilter = temperature;
+  humidityFilter = humidity;
+}
+
+bool DHTSensor::startRead() {
+  if (phase != DHT_PHASE_IDLE) return false;
+
+  requestedAt = micros();
+  if (!driverReady) {
+    lastReading.status = DHT_NO_RESPONSE;
+    levelCount = 0;
+    finish();
+    return true;
+  }
+
+  // Drop anything captured after the previous frame
+  size_t size;
+  void *stale;
+  while ((stale = xRingbufferReceive(ringbuf, &size, 0)) != nullptr) {
+    vRingbufferReturnItem(ringbuf, stale);
+  }
+
+  gpio_set_level((gpio_num_t)pin, 0);
+  phase = DHT_PHASE_START;
+  phaseStart = micros();
+  return true;
+}
+
+void DHTSensor::loop() {
+  if (phase == DHT_PHASE_START) {
+    if (micros() - phaseStart < startLowUs()) return;
+
+    // Receiver first, then release: the reply starts 20-40 us later
+    rmt_rx_start(DHT_RMT_CHANNEL, true);
+    gpio_set_level((gpio_num_t)pin, 1);
+    phase = DHT_PHASE_CAPTURE;
+    phaseStart = micros();
+    return;
+  }
+
+  if (phase != DHT_PHASE_CAPTURE) return;
+
+  size_t size = 0;
+  rmt_item32_t *items = (rmt_item32_t *)xRingbufferReceive(ringbuf, &size, 0);
+  if (!items) {
+    if (micros() - phaseStart >= DHT_CAPTURE_TIMEOUT * 1000UL) {
+      rmt_rx_stop(DHT_RMT_CHANNEL);
+      levelCount = 0;
+      lastReading.status = DHT_NO_RESPONSE;
+      finish();
+    }
+    return;
+  }
+
+  // Each item holds two levels; a zero duration marks the end of the frame
+  levelCount = 0;
+  size_t itemCount = size / sizeof(rmt_item32_t);
+  for (size_t i = 0; i < itemCount && levelCount + 2 <= DHT_MAX_LEVELS; i++) {
+    if (items[i].duration0 == 0) break;
+    levels[levelCount++] = {(uint8_t)items[i].level0, (uint16_t)items[i].duration0};
+    if (items[i].duration1 == 0) break;
+    levels[levelCount++] = {(uint8_t)items[i].level1, (uint16_t)items[i].duration1};
+  }
+  vRingbufferReturnItem(ringbuf, items);
+  rmt_rx_stop(DHT_RMT_CHANNEL);
+
+  decodeDHTLevels(levels, levelCount, model, lastReading);
+  finish();
+}
+
+void DHTSensor::finish() {
+  phase = DHT_PHASE_IDLE;
+  lastLatency = micros() - requestedAt;
+  fresh = true;
+
+  bool valid = lastReading.status == DHT_OK;
+  if (valid) {
+    okCount++;
+  } else {
+    errorCount++;
+  }
+
+  // Filters hold the last good value when a capture fails
+  float t = valid ? lastReading.temperature : NAN;
+  float h = valid ? lastReading.humidity : NAN;
+  if (temperatureFilter) t = temperatureFilter->apply(t, millis());
+  if (humidityFilter) h = humidityFilter->apply(h, millis());
+  temperature = isnan(t) ? 0 : t;
+  humidity = isnan(h) ? 0 : h;
+
+  if (readingCallback) readingCallback(lastReading);
+}
+
+bool DHTSensor::takeReading(DHTReading &reading, uint32_t &latencyUs) {
+  if (!fresh) return false;
+  fresh = false;
+  reading = lastReading;
+  latencyUs = lastLatency;
+  return true;
 }
 
-void DHTSensor::read() {
-  temperature = dht.readTemperature();
-  humidity = dht.readHumidity();
-  
-  // Check if readings are valid
-  if (isnan(temperature)) temperature = 0;
-  if (isnan(humidity)) humidity = 0;
+void DHTSensor::dumpTrace(Print &out) const {
+  out.printf("# DHT%d %s, %u levels\n", model, dhtStatusName(lastReading.status), levelCount);
+  for (uint8_t i = 0; i < levelCount; i++) {
+    out.printf("%u,%u\n", levels[i].level, levels[i].us);
+  }
 }
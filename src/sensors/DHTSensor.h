@@ -2,24 +2,80 @@
 #define DHT_SENSOR_H
 
 #include <Arduino.h>
-#include "DHT.h"
+#include <driver/rmt.h>
 #include "config/Config.h"
+#include "filters/SensorFilter.h"
+#include "sensors/DHTDecoder.h"
 
+#define DHT_RMT_CHANNEL RMT_CHANNEL_4
+#define DHT_MAX_LEVELS 128          // One RMT memory block (64 items)
+#define DHT_CAPTURE_TIMEOUT 50      // ms from releasing the line to a complete frame
+#define DHT_IDLE_THRESHOLD 1000     // us without an edge ends the frame
+
+enum DHTPhase {
+  DHT_PHASE_IDLE,
+  DHT_PHASE_START,      // Host is holding the line low
+  DHT_PHASE_CAPTURE     // RMT is recording the sensor's reply
+};
+
+// DHT11/DHT22 driver that never disables interrupts: the reply is captured
+// by the RMT receiver and decoded from loop(). Results are delivered as a
+// snapshot (takeReading) and, optionally, through a callback.
 class DHTSensor {
 private:
-  DHT dht;
+  uint8_t pin;
+  DHTModel model;
+  RingbufHandle_t ringbuf;
+  bool driverReady;
+
+  DHTPhase phase;
+  unsigned long phaseStart;     // micros()
+  unsigned long requestedAt;    // micros() of startRead()
+
+  // Last capture, kept for dumpTrace()
+  DHTLevel levels[DHT_MAX_LEVELS];
+  uint8_t levelCount;
+
+  DHTReading lastReading;
+  uint32_t lastLatency;         // us from startRead() to the decoded result
+  bool fresh;
+  uint32_t okCount;
+  uint32_t errorCount;
+
   float temperature;
   float humidity;
+  FilterChain *temperatureFilter;
+  FilterChain *humidityFilter;
+  void (*readingCallback)(const DHTReading &reading);
+
+  unsigned long startLowUs() const { return model == DHT_MODEL_22 ? 1100 : 20000; }
+  void finish();
 
 public:
-  DHTSensor(uint8_t pin, uint8_t type);
+  DHTSensor(uint8_t pin, DHTModel model);
   
   void begin();
-  void read();
+  void loop();
+
+  // Starts a capture; false while one is already in progress
+  bool startRead();
+
+  // True once per completed capture (successful or not)
+  bool takeReading(DHTReading &reading, uint32_t &latencyUs);
+
+  void setFilters(FilterChain *temperature, FilterChain *humidity);
+  void setCallback(void (*callback)(const DHTReading &reading)) { readingCallback = callback; }
+
+  // Prints the last capture as "level,us" lines (input for decodeDHTLevels on the host)
+  void dumpTrace(Print &out) const;
   
   // Getters
+  bool isBusy() const { return phase != DHT_PHASE_IDLE; }
   float getTemperature() const { return temperature; }
   float getHumidity() const { return humidity; }
+  DHTStatus getLastStatus() const { return lastReading.status; }
+  uint32_t getOkCount() const { return okCount; }
+  uint32_t getErrorCount() const { return errorCount; }
 };
 
 #endif // DHT_SENSOR_H
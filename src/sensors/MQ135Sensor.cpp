@@ -1,7 +1,38 @@
 #include "MQ135Sensor.h"
+#include "AdcCalibration.h"
 
 MQ135Sensor::MQ135Sensor(uint8_t aoPin, uint8_t doPin) 
-  : aoPin(aoPin), doPin(doPin), rawValue(0), qualityPercent(0), digitalStatus(true) {
+  : aoPin(aoPin), doPin(doPin), rawValue(0), filter(nullptr),
+    qualityPercent(0), digitalStatus(true), calibration(nullptr) {
+  rebuildPpmTable();
+}
+
+void MQ135Sensor::setCalibration(const AdcCalibration *cal) {
+  calibration = cal;
+  rebuildPpmTable();
+}
+
+// Unclamped, capped at what a knot can hold
+float MQ135Sensor::ppmFromVoltage(float voltage) {
+  if (voltage <= 0) return 0;
+
+  float rs = ((MQ135_VOLTAGE_REF * MQ135_RL_VALUE) / voltage) - MQ135_RL_VALUE;
+  if (rs <= 0) return UINT16_MAX;
+  float ratio = rs / MQ135_RO_CLEAN_AIR;
+
+  // Simplified conversion to CO2 equivalent ppm
+  float ppm = 116.6020682 * pow(ratio, -2.769034857);
+  return min(ppm, (float)UINT16_MAX);
+}
+
+void MQ135Sensor::rebuildPpmTable() {
+  // pow() runs here only: at boot and whenever the MQ-135 constants change
+  for (int i = 0; i <= MQ135_PPM_SEGMENTS; i++) {
+    int code = i << MQ135_PPM_SHIFT;
+    float voltage = calibration ? calibration->toMilliVolts(code) / 1000.0f
+                                : (code / MQ135_ADC_MAX) * MQ135_VOLTAGE_REF;
+    ppmLut[i] = (uint16_t)lroundf(ppmFromVoltage(voltage));
+  }
 }
 
 void MQ135Sensor::begin() {
@@ -23,6 +54,9 @@ int MQ135Sensor::readRaw() {
 
 void MQ135Sensor::read() {
   rawValue = readRaw();
+  if (filter) {
+    rawValue = (int)lroundf(filter->apply(rawValue, millis()));
+  }
   
   // Convert to quality percentage (0-100, lower is better)
   qualityPercent = map(rawValue, MQ135_CLEAN_AIR_VALUE, MQ135_POLLUTED_THRESHOLD, 0, 100);
@@ -32,14 +66,13 @@ void MQ135Sensor::read() {
   digitalStatus = (digitalRead(doPin) == LOW);
 }
 
-float MQ135Sensor::getPPM() const {
-  if (rawValue <= 0) return 0;
+float MQ135Sensor::ppmForRaw(int raw) const {
+  if (raw <= 0) return 0;
 
-  float voltage = (rawValue / MQ135_ADC_MAX) * MQ135_VOLTAGE_REF;
-  float rs = ((MQ135_VOLTAGE_REF * MQ135_RL_VALUE) / voltage) - MQ135_RL_VALUE;
-  float ratio = rs / MQ135_RO_CLEAN_AIR;
-
-  // Simplified conversion to CO2 equivalent ppm
-  float ppm = 116.6020682 * pow(ratio, -2.769034857);
-  return constrain(ppm, 10, 2000);
+  raw = min(raw, 4095);
+  int index = raw >> MQ135_PPM_SHIFT;
+  int frac = raw & ((1 << MQ135_PPM_SHIFT) - 1);
+  int span = (int)ppmLut[index + 1] - ppmLut[index];
+  int ppm = ppmLut[index] + ((span * frac) >> MQ135_PPM_SHIFT);
+  return constrain(ppm, MQ135_PPM_MIN, MQ135_PPM_MAX);
 }
@@ -3,6 +3,17 @@
 
 #include <Arduino.h>
 #include "config/Config.h"
+#include "filters/SensorFilter.h"
+
+class AdcCalibration;
+
+// Raw code -> ppm table, one knot every 16 codes from 0 to 4096. Knots hold
+// the unclamped curve and the result is clamped after interpolating, so the
+// segment holding the 2000 ppm knee stays accurate (tools/mq135_lut).
+#define MQ135_PPM_SEGMENTS 256
+#define MQ135_PPM_SHIFT    4
+#define MQ135_PPM_MIN      10
+#define MQ135_PPM_MAX      2000
 
 class MQ135Sensor {
 private:
@@ -10,22 +21,31 @@ private:
   uint8_t doPin;
   
   int rawValue;
+  FilterChain *filter;
   int qualityPercent;
   bool digitalStatus;
   
+  const AdcCalibration *calibration;
+  uint16_t ppmLut[MQ135_PPM_SEGMENTS + 1];
+  
   int readRaw();
+  static float ppmFromVoltage(float voltage);
 
 public:
   MQ135Sensor(uint8_t aoPin, uint8_t doPin);
   
   void begin();
   void read();
+  void setFilter(FilterChain *chain) { filter = chain; }
+  void setCalibration(const AdcCalibration *cal);
+  void rebuildPpmTable();
   
   // Getters
   int getRawValue() const { return rawValue; }
   int getQualityPercent() const { return qualityPercent; }
   bool isGoodQuality() const { return digitalStatus; }
-  float getPPM() const;
+  float getPPM() const { return ppmForRaw(rawValue); }
+  float ppmForRaw(int raw) const;
 };
 
 #endif // MQ135_SENSOR_H
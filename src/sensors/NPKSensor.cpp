@@ -1,18 +1,33 @@
 #include "NPKSensor.h"
 
 NPKSensor::NPKSensor(HardwareSerial *serialPort, uint8_t deRePin) 
-  : serial(serialPort), deRePin(deRePin), 
+  : serial(serialPort), deRePin(deRePin), frameReady(nullptr),
+    lastTransaction(0), avgTransaction(0), crcErrors(0), timeouts(0), exceptions(0),
     nitrogen(0), phosphorus(0), potassium(0), 
     ph(0), ec(0), temperature(0), humidity(0), 
-    available(false) {
+    available(false), validMask(0), moistureFilter(nullptr), phFilter(nullptr) {
 }
 
 void NPKSensor::begin() {
-  pinMode(deRePin, OUTPUT);
-  digitalWrite(deRePin, LOW); // Start in receive mode
+  frameReady = xSemaphoreCreateBinary();
   serial->begin(NPK_BAUD_RATE, SERIAL_8N1, RS485_RX, RS485_TX);
-  delay(100);
-  Serial.println("✅ NPK Sensor initialized");
+  
+  // The UART drives DE/RE through RTS: asserted exactly while the request is
+  // on the wire, no GPIO toggling or guard delays
+  serial->setPins(RS485_RX, RS485_TX, -1, deRePin);
+  serial->setMode(UART_MODE_RS485_HALF_DUPLEX);
+  
+  // A Modbus RTU frame ends after 3.5 silent character times; the UART RX
+  // timeout detects that and the event task wakes the reader
+  serial->setRxTimeout(NPK_FRAME_GAP_SYMBOLS);
+  serial->onReceive([this]() { xSemaphoreGive(frameReady); }, true);
+  
+  Serial.println("✅ NPK Sensor initialized (RS485 half-duplex)");
+}
+
+void NPKSensor::setFilters(FilterChain *moisture, FilterChain *ph) {
+  moistureFilter = moisture;
+  phFilter = ph;
 }
 
 uint16_t NPKSensor::calculateCRC16(uint8_t *data, uint8_t length) {
@@ -46,92 +61,144 @@ void NPKSensor::createRequestFrame(uint8_t *frame, uint8_t deviceAddress,
   frame[7] = (crc >> 8) & 0xFF;
 }
 
-uint16_t NPKSensor::readRegister(uint16_t registerAddress) {
+bool NPKSensor::readRegisters(uint16_t registerAddress, uint8_t count, uint16_t *values,
+                              unsigned long timeoutMs) {
   uint8_t requestFrame[8];
-  uint8_t responseFrame[9];
-  uint16_t value = 0;
+  uint8_t responseFrame[5 + 2 * NPK_REGISTER_COUNT];
+  size_t expected = 5 + 2 * count;
+  if (count == 0 || expected > sizeof(responseFrame)) return false;
 
-  // Clear serial buffer
+  createRequestFrame(requestFrame, NPK_SENSOR_ADDRESS, MODBUS_READ_HOLDING_REGISTERS,
+                     registerAddress, count);
+
+  // Drop late bytes and the frame signal of an earlier transaction
   while (serial->available()) {
     serial->read();
   }
+  xSemaphoreTake(frameReady, 0);
 
-  // Create request frame
-  createRequestFrame(requestFrame, NPK_SENSOR_ADDRESS, MODBUS_READ_HOLDING_REGISTERS,
-                    registerAddress, 1);
-
-  // Set to transmit mode
-  digitalWrite(deRePin, HIGH);
-  delay(10);
-
-  // Send request
+  unsigned long start = micros();
   serial->write(requestFrame, sizeof(requestFrame));
-  serial->flush();
 
-  // Set to receive mode
-  digitalWrite(deRePin, LOW);
-  delay(10);
+  // Block on the frame signal instead of polling; a frame split by noise
+  // arrives as several signals, so collect until the expected length
+  size_t received = 0;
+  while (received < expected) {
+    unsigned long elapsed = (micros() - start) / 1000;
+    if (elapsed >= timeoutMs) break;
+    if (xSemaphoreTake(frameReady, pdMS_TO_TICKS(timeoutMs - elapsed)) != pdTRUE) break;
+    received += serial->read(responseFrame + received, sizeof(responseFrame) - received);
+
+    // Exception responses are short: address, function | 0x80, code, CRC
+    if (received >= 5 && (responseFrame[1] & MODBUS_EXCEPTION)) break;
+  }
 
-  // Wait for response (timeout 1000ms)
-  unsigned long startTime = millis();
-  uint8_t index = 0;
+  if (received < 5) {
+    timeouts++;
+    Serial.printf("❌ NPK Reg 0x%04X: Timeout (%u bytes)\n", registerAddress, (unsigned)received);
+    return false;
+  }
 
-  while (millis() - startTime < 1000 && index < sizeof(responseFrame)) {
-    if (serial->available()) {
-      responseFrame[index++] = serial->read();
-    }
+  size_t length = (responseFrame[1] & MODBUS_EXCEPTION) ? 5 : min(received, expected);
+  uint16_t receivedCRC = (responseFrame[length - 1] << 8) | responseFrame[length - 2];
+  if (receivedCRC != calculateCRC16(responseFrame, length - 2)) {
+    crcErrors++;
+    Serial.printf("❌ NPK Reg 0x%04X: CRC error\n", registerAddress);
+    return false;
+  }
+  if (responseFrame[1] & MODBUS_EXCEPTION) {
+    exceptions++;
+    Serial.printf("❌ NPK Reg 0x%04X: Modbus exception %u\n", registerAddress, responseFrame[2]);
+    return false;
+  }
+  if (responseFrame[0] != NPK_SENSOR_ADDRESS || responseFrame[1] != MODBUS_READ_HOLDING_REGISTERS ||
+      responseFrame[2] != 2 * count || length < expected) {
+    crcErrors++;
+    Serial.printf("❌ NPK Reg 0x%04X: Malformed response\n", registerAddress);
+    return false;
   }
 
-  // Check response
-  if (index >= 7) {
-    uint16_t receivedCRC = (responseFrame[index - 1] << 8) | responseFrame[index - 2];
-    uint16_t calculatedCRC = calculateCRC16(responseFrame, index - 2);
-
-    if (receivedCRC == calculatedCRC && responseFrame[1] == MODBUS_READ_HOLDING_REGISTERS) {
-      value = (responseFrame[3] << 8) | responseFrame[4];
-      return value;
-    } else {
-      Serial.printf("❌ NPK Reg 0x%04X: CRC error\n", registerAddress);
-      return 0xFFFF;
-    }
-  } else {
-    Serial.printf("❌ NPK Reg 0x%04X: Timeout (%d bytes)\n", registerAddress, index);
-    return 0xFFFF;
+  for (uint8_t i = 0; i < count; i++) {
+    values[i] = (responseFrame[3 + 2 * i] << 8) | responseFrame[4 + 2 * i];
   }
-}
 
-bool NPKSensor::readSensor() {
-  // Read all 7 registers one by one
-  uint16_t moisture_raw = readRegister(MOISTURE_REGISTER);
-  delay(50);
+  lastTransaction = micros() - start;
+  avgTransaction = (avgTransaction == 0) ? lastTransaction : avgTransaction * 0.9f + lastTransaction * 0.1f;
+  return true;
+}
 
-  uint16_t temperature_raw = readRegister(TEMPERATURE_REGISTER);
-  delay(50);
+uint16_t NPKSensor::readRegister(uint16_t registerAddress, unsigned long timeoutMs) {
+  uint16_t value;
+  return readRegisters(registerAddress, 1, &value, timeoutMs) ? value : 0xFFFF;
+}
 
-  uint16_t conductivity_raw = readRegister(CONDUCTIVITY_REGISTER);
-  delay(50);
+bool NPKSensor::probe() {
+  // Cheap liveness check used while the sensor is backing off
+  return readRegister(MOISTURE_REGISTER, NPK_PROBE_TIMEOUT) != 0xFFFF;
+}
 
-  uint16_t ph_raw = readRegister(PH_REGISTER);
-  delay(50);
+bool NPKSensor::readMoisture() {
+  // Single-register read for fast sampling while the pump runs
+  uint16_t moisture_raw = readRegister(MOISTURE_REGISTER, NPK_RESPONSE_TIMEOUT);
+  if (moisture_raw == 0xFFFF) return false;
 
-  uint16_t nitrogen_raw = readRegister(NITROGEN_REGISTER);
-  delay(50);
+  humidity = moisture_raw / 10.0;
+  if (moistureFilter) {
+    float filtered = moistureFilter->apply(humidity, millis());
+    humidity = isnan(filtered) ? -1.0 : filtered;
+  }
+  if (humidity >= 0) {
+    validMask |= 1;
+  } else {
+    validMask &= ~1;
+  }
+  available = true;
+  return true;
+}
 
-  uint16_t phosphorus_raw = readRegister(PHOSPHORUS_REGISTER);
-  delay(50);
+bool NPKSensor::readSensor() {
+  uint16_t raw[NPK_REGISTER_COUNT];
+  
+  // Optional: the seven registers are contiguous, one request instead of seven
+  if (NPK_BLOCK_READ) {
+    uint32_t exceptionsBefore = exceptions;
+    if (readRegisters(MOISTURE_REGISTER, NPK_REGISTER_COUNT, raw, NPK_RESPONSE_TIMEOUT)) {
+      return applyReadings(raw);
+    }
+    if (exceptions == exceptionsBefore) {
+      Serial.println("❌ NPK sensor not responding");
+      return false;
+    }
+    // Sensor refuses multi-register reads: fall back to one at a time
+  }
+  
+  // Read all 7 registers one by one (most reliable across 7-in-1 clones)
+  for (uint8_t i = 0; i < NPK_REGISTER_COUNT; i++) {
+    raw[i] = readRegister(MOISTURE_REGISTER + i, NPK_RESPONSE_TIMEOUT);
+    if (i == 0 && raw[0] == 0xFFFF) {
+      // No answer on the first register: don't wait out six more timeouts
+      Serial.println("❌ NPK sensor not responding");
+      return false;
+    }
+  }
+  return applyReadings(raw);
+}
 
-  uint16_t potassium_raw = readRegister(POTASSIUM_REGISTER);
-  delay(50);
+bool NPKSensor::applyReadings(const uint16_t *raw) {
+  uint16_t moisture_raw = raw[MOISTURE_REGISTER - MOISTURE_REGISTER];
+  uint16_t temperature_raw = raw[TEMPERATURE_REGISTER - MOISTURE_REGISTER];
+  uint16_t conductivity_raw = raw[CONDUCTIVITY_REGISTER - MOISTURE_REGISTER];
+  uint16_t ph_raw = raw[PH_REGISTER - MOISTURE_REGISTER];
+  uint16_t nitrogen_raw = raw[NITROGEN_REGISTER - MOISTURE_REGISTER];
+  uint16_t phosphorus_raw = raw[PHOSPHORUS_REGISTER - MOISTURE_REGISTER];
+  uint16_t potassium_raw = raw[POTASSIUM_REGISTER - MOISTURE_REGISTER];
 
   // Count valid readings
-  int validReadings = 0;
-  if (moisture_raw != 0xFFFF) validReadings++;
-  if (temperature_raw != 0xFFFF) validReadings++;
-  if (conductivity_raw != 0xFFFF) validReadings++;
-  if (ph_raw != 0xFFFF) validReadings++;
-  if (nitrogen_raw != 0xFFFF) validReadings++;
-  if (phosphorus_raw != 0xFFFF) validReadings++;
-  if (potassium_raw != 0xFFFF) validReadings++;
+  uint8_t mask = 0;
+  for (uint8_t i = 0; i < NPK_REGISTER_COUNT; i++) {
+    if (raw[i] != 0xFFFF) mask |= 1 << i;
+  }
+  int validReadings = __builtin_popcount(mask);
 
   if (validReadings >= 4) {
     // Convert raw values to actual measurements
@@ -139,10 +206,24 @@ bool NPKSensor::readSensor() {
     temperature = (temperature_raw != 0xFFFF) ? temperature_raw / 10.0 : -100.0;
     ec = (conductivity_raw != 0xFFFF) ? conductivity_raw / 1000.0 : -1.0;
     ph = (ph_raw != 0xFFFF) ? ph_raw / 10.0 : -1.0;
+
+    // Failed registers go in as NaN so the filters hold the last good value
+    if (moistureFilter) {
+      float filtered = moistureFilter->apply(moisture_raw != 0xFFFF ? humidity : NAN, millis());
+      humidity = isnan(filtered) ? -1.0 : filtered;
+    }
+    if (phFilter) {
+      float filtered = phFilter->apply(ph_raw != 0xFFFF ? ph : NAN, millis());
+      ph = isnan(filtered) ? -1.0 : filtered;
+    }
     nitrogen = (nitrogen_raw != 0xFFFF) ? nitrogen_raw : 0;
     phosphorus = (phosphorus_raw != 0xFFFF) ? phosphorus_raw : 0;
     potassium = (potassium_raw != 0xFFFF) ? potassium_raw : 0;
 
+    // A filter that has no value yet leaves its channel at the sentinel
+    if (humidity < 0) mask &= ~(1 << (MOISTURE_REGISTER - MOISTURE_REGISTER));
+    if (ph < 0) mask &= ~(1 << (PH_REGISTER - MOISTURE_REGISTER));
+    validMask = mask;
     available = true;
 
     Serial.println("=== 7-in-1 NPK Sensor Readings ===");
@@ -158,7 +239,7 @@ bool NPKSensor::readSensor() {
 
     return true;
   } else {
-    available = false;
+    // Keep the last good values; SensorHealth tracks how stale they are
     Serial.printf("❌ NPK sensor failed (only %d/7 valid readings)\n", validReadings);
     return false;
   }
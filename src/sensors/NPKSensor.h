@@ -3,11 +3,24 @@
 
 #include <Arduino.h>
 #include "config/Config.h"
+#include "filters/SensorFilter.h"
+
+#define NPK_REGISTER_COUNT 7        // Moisture .. potassium, contiguous from MOISTURE_REGISTER
+#define NPK_FRAME_GAP_SYMBOLS 4     // UART RX timeout closing a frame (Modbus 3.5 characters)
+#define MODBUS_EXCEPTION 0x80
 
 class NPKSensor {
 private:
   HardwareSerial *serial;
-  uint8_t deRePin;
+  uint8_t deRePin;                  // Driven by the UART as RTS in RS485 half-duplex mode
+  SemaphoreHandle_t frameReady;     // Given from the UART event task at the end of a frame
+  
+  // Bus statistics
+  uint32_t lastTransaction;         // us, request written to response decoded
+  float avgTransaction;
+  uint32_t crcErrors;
+  uint32_t timeouts;
+  uint32_t exceptions;
   
   // Sensor data
   float nitrogen;
@@ -18,18 +31,28 @@ private:
   float temperature;
   float humidity;
   bool available;
+  uint8_t validMask;                // Bit per register from MOISTURE_REGISTER: last read of it succeeded
+  
+  // Optional filters (moisture feeds the irrigation controller)
+  FilterChain *moistureFilter;
+  FilterChain *phFilter;
   
   // Helper functions
   uint16_t calculateCRC16(uint8_t *data, uint8_t length);
   void createRequestFrame(uint8_t *frame, uint8_t deviceAddress, uint8_t functionCode,
                          uint16_t registerAddress, uint16_t registerCount);
-  uint16_t readRegister(uint16_t registerAddress);
+  bool readRegisters(uint16_t registerAddress, uint8_t count, uint16_t *values, unsigned long timeoutMs);
+  uint16_t readRegister(uint16_t registerAddress, unsigned long timeoutMs);
+  bool applyReadings(const uint16_t *raw);
 
 public:
   NPKSensor(HardwareSerial *serialPort, uint8_t deRePin);
   
   void begin();
   bool readSensor();
+  bool readMoisture();
+  bool probe();
+  void setFilters(FilterChain *moisture, FilterChain *ph);
   
   // Getters
   float getNitrogen() const { return nitrogen; }
@@ -39,7 +62,15 @@ public:
   float getEC() const { return ec; }
   float getTemperature() const { return temperature; }
   float getHumidity() const { return humidity; }
-  bool isAvailable() const { return available; }
+  bool isAvailable() const { return available; }   // Holds values (check health for staleness)
+  // A failed register leaves its sentinel (-1, -100 °C, 0 mg/kg) in the getter
+  bool isValid(uint16_t registerAddress) const {
+    return validMask & (1 << (registerAddress - MOISTURE_REGISTER));
+  }
+  uint32_t getLastTransactionUs() const { return lastTransaction; }
+  uint32_t getAvgTransactionUs() const { return (uint32_t)avgTransaction; }
+  uint32_t getCrcErrors() const { return crcErrors; }
+  uint32_t getTimeouts() const { return timeouts; }
 };
 
 #endif // NPK_SENSOR_H
@@ -0,0 +1,99 @@
+#include "SensorHealth.h"
+
+SensorHealth::SensorHealth(const char *name)
+  : name(name), successes(0), failures(0), nanCount(0), successRate(1.0f),
+    lastLatency(0), maxLatency(0), avgLatency(0),
+    lastValue(NAN), repeatCount(0), sameSince(0),
+    lastGood(0), everGood(false), consecutiveFailures(0),
+    nextAttempt(0), backoff(0), expectedInterval(0) {
+}
+
+bool SensorHealth::shouldAttempt(unsigned long now) const {
+  return msUntilAttempt(now) == 0;
+}
+
+unsigned long SensorHealth::msUntilAttempt(unsigned long now) const {
+  if (!isProbing() || (long)(now - nextAttempt) >= 0) return 0;
+  return nextAttempt - now;
+}
+
+void SensorHealth::recordLatency(uint32_t latencyUs) {
+  lastLatency = latencyUs;
+  if (latencyUs > maxLatency) maxLatency = latencyUs;
+  avgLatency = (avgLatency == 0) ? latencyUs : avgLatency * 0.9f + latencyUs * 0.1f;
+  latency.record(latencyUs);
+}
+
+void SensorHealth::recordSuccess(uint32_t latencyUs, float value) {
+  // A NaN from a driver that reported success is still a failed read
+  if (isnan(value)) {
+    nanCount++;
+    recordFailure(latencyUs);
+    return;
+  }
+
+  recordLatency(latencyUs);
+  successes++;
+  successRate = successRate * 0.9f + 0.1f;
+
+  unsigned long now = millis();
+  if (value == lastValue) {
+    if (repeatCount < 0xFFFF) repeatCount++;
+  } else {
+    repeatCount = 0;
+    lastValue = value;
+    sameSince = now;
+  }
+
+  if (isProbing()) {
+    Serial.printf("✅ %s sensor recovered after %u failures\n", name, consecutiveFailures);
+  }
+  consecutiveFailures = 0;
+  backoff = 0;
+  lastGood = now;
+  everGood = true;
+}
+
+void SensorHealth::recordFailure(uint32_t latencyUs) {
+  recordLatency(latencyUs);
+  failures++;
+  successRate = successRate * 0.9f;
+  if (consecutiveFailures < 0xFFFF) consecutiveFailures++;
+
+  if (isProbing()) {
+    // Exponential backoff: base, 2x base, 4x base ... capped
+    uint16_t exponent = min(consecutiveFailures - HEALTH_FAIL_THRESHOLD, 16);
+    backoff = min(HEALTH_BACKOFF_BASE << exponent, HEALTH_BACKOFF_MAX);
+    nextAttempt = millis() + backoff;
+    if (consecutiveFailures == HEALTH_FAIL_THRESHOLD) {
+      Serial.printf("⚠️  %s sensor failing, backing off\n", name);
+    }
+  }
+}
+
+HealthState SensorHealth::getState() const {
+  if (isProbing()) return HEALTH_FAILED;
+  if (consecutiveFailures > 0 || isStuck() || successRate < 0.8f) return HEALTH_DEGRADED;
+  return HEALTH_OK;
+}
+
+const char *SensorHealth::getStateName() const {
+  switch (getState()) {
+    case HEALTH_OK: return "ok";
+    case HEALTH_DEGRADED: return "degraded";
+    default: return "failed";
+  }
+}
+
+void SensorHealth::toJson(JsonVariant obj, unsigned long now) const {
+  obj["state"] = getStateName();
+  obj["rate"] = successRate;
+  obj["lat"] = getAvgLatency();
+  obj["latMax"] = maxLatency;
+  obj["fails"] = consecutiveFailures;
+  obj["nan"] = nanCount;
+  obj["stuck"] = isStuck();
+  obj["stale"] = isStale(now);
+  obj["age"] = getAgeSeconds(now);
+  obj["retryIn"] = msUntilAttempt(now);
+}
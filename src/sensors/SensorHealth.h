@@ -0,0 +1,88 @@
+#ifndef SENSOR_HEALTH_H
+#define SENSOR_HEALTH_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "config/Config.h"
+#include "system/LatencyHistogram.h"
+
+enum SensorId {
+  SENSOR_NPK,
+  SENSOR_DHT,
+  SENSOR_MQ135,
+  SENSOR_TDS,
+  SENSOR_COUNT
+};
+
+enum HealthState {
+  HEALTH_OK,
+  HEALTH_DEGRADED,   // Recent failures, NaNs or a stuck value
+  HEALTH_FAILED      // Backing off, only cheap probes are attempted
+};
+
+class SensorHealth {
+private:
+  const char *name;
+
+  uint32_t successes;
+  uint32_t failures;
+  uint32_t nanCount;
+  float successRate;        // EMA over recent attempts (0-1)
+
+  uint32_t lastLatency;     // us
+  uint32_t maxLatency;
+  float avgLatency;
+  LatencyHistogram latency; // Every attempt, for /metrics
+
+  // Stuck-value detection: how long and how often the same value came back
+  float lastValue;
+  uint16_t repeatCount;
+  unsigned long sameSince;  // millis() of the first reading with lastValue
+
+  unsigned long lastGood;   // millis() of last good reading
+  bool everGood;
+  uint16_t consecutiveFailures;
+  unsigned long nextAttempt;
+  unsigned long backoff;
+  unsigned long expectedInterval;   // Current sampling interval (ms)
+
+  void recordLatency(uint32_t latencyUs);
+
+public:
+  SensorHealth(const char *name);
+
+  // Whether a read (or probe) is due, honouring the failure backoff
+  bool shouldAttempt(unsigned long now) const;
+  unsigned long msUntilAttempt(unsigned long now) const;
+  bool isProbing() const { return consecutiveFailures >= HEALTH_FAIL_THRESHOLD; }
+
+  void recordSuccess(uint32_t latencyUs, float value);
+  void recordFailure(uint32_t latencyUs);
+
+  HealthState getState() const;
+  const char *getStateName() const;
+  void setExpectedInterval(unsigned long intervalMs) { expectedInterval = intervalMs; }
+  bool isStale(unsigned long now) const {
+    return !everGood || now - lastGood >= expectedInterval + HEALTH_STALE_AFTER;
+  }
+  // Time-based, so a channel read once a minute is judged like one read every 2 s
+  bool isStuck() const {
+    return repeatCount >= HEALTH_STUCK_MIN_COUNT && lastGood - sameSince >= HEALTH_STUCK_TIME;
+  }
+
+  // Getters
+  const char *getName() const { return name; }
+  float getSuccessRate() const { return successRate; }
+  uint32_t getAvgLatency() const { return (uint32_t)avgLatency; }
+  uint32_t getMaxLatency() const { return maxLatency; }
+  uint32_t getNaNCount() const { return nanCount; }
+  uint32_t getSuccesses() const { return successes; }
+  uint32_t getFailures() const { return failures; }
+  const LatencyHistogram &getLatencyHistogram() const { return latency; }
+  uint16_t getConsecutiveFailures() const { return consecutiveFailures; }
+  long getAgeSeconds(unsigned long now) const { return everGood ? (long)((now - lastGood) / 1000) : -1; }
+
+  void toJson(JsonVariant obj, unsigned long now) const;
+};
+
+#endif // SENSOR_HEALTH_H
@@ -1,6 +1,8 @@
 #include "TDSSensor.h"
+#include "AdcCalibration.h"
 
-TDSSensor::TDSSensor(uint8_t pin) : pin(pin), rawValue(0), tdsValue(0) {
+TDSSensor::TDSSensor(uint8_t pin) : pin(pin), rawValue(0), filter(nullptr), tdsValue(0),
+    calibration(nullptr) {
 }
 
 void TDSSensor::begin() {
@@ -17,11 +19,15 @@ void TDSSensor::read() {
     delay(10);
   }
   rawValue = sum / samples;
+  if (filter) {
+    rawValue = (int)lroundf(filter->apply(rawValue, millis()));
+  }
   
-  // Convert raw ADC to voltage (12-bit ADC, 3.3V reference)
-  float voltage = (rawValue / 4095.0) * 3.3;
+  // Convert raw ADC to voltage (calibrated table, or 12-bit/3.3V linear fallback)
+  float voltage = calibration ? calibration->toMilliVolts(rawValue) / 1000.0f
+                              : (rawValue / 4095.0) * 3.3;
   
-  // Convert to TDS (ppm) - requires calibration
+  // Convert to TDS (ppm) - linear in voltage, requires calibration
   tdsValue = (int)(voltage * TDS_K);
   
   Serial.printf("📡 TDS: %d ppm (raw: %d)\n", tdsValue, rawValue);
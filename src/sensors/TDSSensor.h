@@ -3,18 +3,25 @@
 
 #include <Arduino.h>
 #include "config/Config.h"
+#include "filters/SensorFilter.h"
+
+class AdcCalibration;
 
 class TDSSensor {
 private:
   uint8_t pin;
   int rawValue;
+  FilterChain *filter;
   int tdsValue;
+  const AdcCalibration *calibration;
 
 public:
   TDSSensor(uint8_t pin);
   
   void begin();
   void read();
+  void setFilter(FilterChain *chain) { filter = chain; }
+  void setCalibration(const AdcCalibration *cal) { calibration = cal; }
   
   // Getters
   int getRawValue() const { return rawValue; }
@@ -0,0 +1,188 @@
+#include "PumpStateStore.h"
+#include "controllers/PumpController.h"
+#include "system/TimeService.h"
+
+// Not zeroed by the startup code, so it still holds the last state after a
+// reset. Garbage after a power cycle fails the checksum.
+RTC_NOINIT_ATTR static PumpState rtcState;
+
+static const char *const slotKeys[] = {"s0", "s1"};
+
+PumpStateStore::PumpStateStore()
+  : pumpController(nullptr), nextSlot(0), tokens(PUMP_STATE_WRITE_BURST), lastRefill(0),
+    dirty(false), urgent(false), dirtySince(0),
+    source(PUMP_STATE_NONE), restoreUs(0), interruptedSeconds(0), interrupted(false),
+    nvsWrites(0) {
+  memset(&current, 0, sizeof(current));
+  memset(&committed, 0, sizeof(committed));
+}
+
+uint32_t PumpStateStore::checksum(const PumpState &state) {
+  const uint8_t *bytes = (const uint8_t *)&state;
+  uint32_t hash = 2166136261UL;
+  for (size_t i = 0; i < offsetof(PumpState, checksum); i++) {
+    hash = (hash ^ bytes[i]) * 16777619UL;
+  }
+  return hash;
+}
+
+bool PumpStateStore::isValid(const PumpState &state) {
+  return state.magic == PUMP_STATE_MAGIC && state.version == PUMP_STATE_VERSION &&
+         state.checksum == checksum(state);
+}
+
+// The fields worth a flash write; runSeconds only ticks while running
+bool PumpStateStore::samePersistent(const PumpState &a, const PumpState &b) {
+  return a.wateringCount == b.wateringCount && a.totalWateringTime == b.totalWateringTime &&
+         a.consecutiveDryCount == b.consecutiveDryCount && a.running == b.running &&
+         a.runStartUtcMs == b.runStartUtcMs;
+}
+
+void PumpStateStore::seal(PumpState &state) {
+  state.magic = PUMP_STATE_MAGIC;
+  state.version = PUMP_STATE_VERSION;
+  state.checksum = checksum(state);
+}
+
+void PumpStateStore::capture(PumpState &state) const {
+  state.wateringCount = pumpController->getWateringCount();
+  state.totalWateringTime = pumpController->getTotalWateringTime();
+  state.consecutiveDryCount = (uint16_t)min(pumpController->getConsecutiveDryCount(), 0xFFFF);
+  state.running = pumpController->isPumpActive();
+  state.runSeconds = pumpController->getPumpRunTime() / 1000;
+  state.runStartUtcMs = state.running ? pumpController->getLastStarted().utcMs : 0;
+}
+
+void PumpStateStore::begin() {
+  uint32_t t0 = micros();
+
+  // Newest valid NVS slot
+  PumpState slots[2];
+  preferences.begin(PUMP_STATE_NAMESPACE, false);
+  int8_t newest = -1;
+  for (uint8_t i = 0; i < 2; i++) {
+    if (preferences.getBytes(slotKeys[i], &slots[i], sizeof(PumpState)) != sizeof(PumpState) ||
+        !isValid(slots[i])) continue;
+    if (newest < 0 || slots[i].sequence > slots[newest].sequence) newest = i;
+  }
+  if (newest >= 0) {
+    committed = slots[newest];
+    nextSlot = newest ^ 1;
+  }
+
+  // RTC wins unless flash holds something newer (e.g. after a power cycle)
+  PumpState restored;
+  if (isValid(rtcState) && (newest < 0 || rtcState.sequence >= committed.sequence)) {
+    restored = rtcState;
+    source = PUMP_STATE_RTC;
+  } else if (newest >= 0) {
+    restored = committed;
+    source = PUMP_STATE_NVS;
+  } else {
+    memset(&restored, 0, sizeof(restored));
+    source = PUMP_STATE_NONE;
+  }
+
+  // The relay came up off: close the interrupted run instead of resuming it.
+  // Auto-irrigation restarts it after BOOT_SAFE_DELAY if the soil is still dry.
+  if (restored.running) {
+    interrupted = true;
+    if (source == PUMP_STATE_RTC) {
+      interruptedSeconds = restored.runSeconds;
+      restored.totalWateringTime += restored.runSeconds;
+    } else {
+      interruptedSeconds = -1;
+    }
+    restored.running = 0;
+    restored.runSeconds = 0;
+    restored.runStartUtcMs = 0;
+    restored.sequence++;
+  }
+
+  if (pumpController) {
+    pumpController->restoreCounters(restored.wateringCount, restored.totalWateringTime,
+                                    restored.consecutiveDryCount);
+  }
+  current = restored;
+  seal(current);
+  rtcState = current;
+  dirty = !samePersistent(current, committed);
+  urgent = dirty;
+  dirtySince = millis();
+  lastRefill = millis();
+  restoreUs = micros() - t0;
+
+  Serial.printf("✅ Pump state restored from %s in %lu us: %lu runs, %lu s watered\n",
+                getSourceName(source), (unsigned long)restoreUs,
+                (unsigned long)restored.wateringCount, (unsigned long)restored.totalWateringTime);
+  if (interrupted && interruptedSeconds >= 0) {
+    Serial.printf("⚠️  Reset during watering after %ld s; pump left off\n", (long)interruptedSeconds);
+  } else if (interrupted) {
+    Serial.println("⚠️  Power lost during watering (run length unknown); pump left off");
+  }
+}
+
+void PumpStateStore::loop() {
+  if (!pumpController) return;
+  unsigned long now = millis();
+
+  // One token every 24 h / PUMP_STATE_WRITES_PER_DAY, up to the burst size
+  float period = 86400000.0f / PUMP_STATE_WRITES_PER_DAY;
+  unsigned long elapsed = now - lastRefill;
+  if (elapsed >= period) {
+    unsigned long whole = elapsed / (unsigned long)period;
+    tokens = min(tokens + whole, (float)PUMP_STATE_WRITE_BURST);
+    lastRefill += whole * (unsigned long)period;
+  }
+
+  PumpState next = current;
+  capture(next);
+  if (!samePersistent(next, current) || next.runSeconds != current.runSeconds) {
+    bool edge = next.running != current.running || next.wateringCount != current.wateringCount;
+    next.sequence = current.sequence + 1;
+    seal(next);
+    current = next;
+    rtcState = current;       // Plain RAM store
+
+    if (!samePersistent(current, committed)) {
+      if (!dirty) dirtySince = now;
+      dirty = true;
+      urgent = urgent || edge;
+    } else {
+      dirty = false;
+      urgent = false;
+    }
+  }
+
+  if (!dirty) return;
+  if (!urgent && now - dirtySince < PUMP_STATE_COMMIT_DELAY * 1000UL) return;
+  if (tokens >= 1) commit();
+}
+
+void PumpStateStore::commit() {
+  preferences.putBytes(slotKeys[nextSlot], &current, sizeof(PumpState));
+  committed = current;
+  nextSlot ^= 1;
+  tokens -= 1;
+  nvsWrites++;
+  dirty = false;
+  urgent = false;
+}
+
+const char *PumpStateStore::getSourceName(PumpStateSource source) {
+  switch (source) {
+    case PUMP_STATE_RTC: return "rtc";
+    case PUMP_STATE_NVS: return "nvs";
+    default: return "none";
+  }
+}
+
+void PumpStateStore::toJson(JsonVariant obj) const {
+  obj["source"] = getSourceName(source);
+  obj["restoreUs"] = restoreUs;
+  if (interrupted) obj["interruptedRun"] = interruptedSeconds;
+  obj["seq"] = current.sequence;
+  obj["nvsWrites"] = nvsWrites;
+  obj["tokens"] = tokens;
+  obj["pending"] = dirty;
+}
@@ -0,0 +1,85 @@
+#ifndef PUMP_STATE_STORE_H
+#define PUMP_STATE_STORE_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <Preferences.h>
+#include "config/Config.h"
+
+#define PUMP_STATE_MAGIC 0x504D5053     // "SPMP"
+#define PUMP_STATE_VERSION 1
+#define PUMP_STATE_NAMESPACE "pump"
+
+class PumpController;
+
+// Everything PumpController needs to carry across a reboot. The same record
+// is kept in RTC memory (every change) and in NVS (coalesced).
+struct PumpState {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t consecutiveDryCount;
+  uint32_t sequence;            // Bumped on every change, the newest valid copy wins
+  uint32_t wateringCount;
+  uint32_t totalWateringTime;   // s, finished runs
+  uint32_t runSeconds;          // Of the run in progress; only the RTC copy keeps it current
+  int64_t runStartUtcMs;        // 0 when the start was not clock-synced
+  uint8_t running;
+  uint8_t reserved[3];
+  uint32_t checksum;            // FNV-1a of everything above
+};
+
+enum PumpStateSource {
+  PUMP_STATE_NONE,      // First boot, counters start at zero
+  PUMP_STATE_RTC,       // Warm reset: exact to the last loop pass
+  PUMP_STATE_NVS        // Power loss: as of the last flash commit
+};
+
+// Persists pump counters and the "running since" state. RTC memory survives
+// resets, watchdogs and usually brownouts, and costs nothing to update. NVS
+// survives power loss; its writes are rationed by a token bucket
+// (PUMP_STATE_WRITES_PER_DAY) and alternate between two keys, so an
+// interrupted write never takes the previous record with it.
+class PumpStateStore {
+private:
+  Preferences preferences;
+  PumpController *pumpController;
+
+  PumpState current;            // Mirrors the controller
+  PumpState committed;          // Last record written to NVS
+  uint8_t nextSlot;
+
+  float tokens;                 // NVS writes available now
+  unsigned long lastRefill;
+  bool dirty;                   // current differs from committed
+  bool urgent;                  // ... by a start or stop, which is committed first
+  unsigned long dirtySince;     // millis() of the oldest uncommitted change
+
+  PumpStateSource source;
+  uint32_t restoreUs;
+  int32_t interruptedSeconds;   // Run cut short by the reset, -1 if its length is unknown
+  bool interrupted;
+  uint32_t nvsWrites;
+
+  static uint32_t checksum(const PumpState &state);
+  static bool isValid(const PumpState &state);
+  static bool samePersistent(const PumpState &a, const PumpState &b);
+  void capture(PumpState &state) const;
+  void seal(PumpState &state);
+  void commit();
+
+public:
+  PumpStateStore();
+
+  void setPumpController(PumpController *controller) { pumpController = controller; }
+
+  void begin();     // Restores the controller; call right after PumpController::begin()
+  void loop();
+
+  PumpStateSource getSource() const { return source; }
+  static const char *getSourceName(PumpStateSource source);
+  uint32_t getNvsWrites() const { return nvsWrites; }
+
+  void toJson(JsonVariant obj) const;
+};
+
+#endif // PUMP_STATE_STORE_H
@@ -0,0 +1,274 @@
+#include "SampleStore.h"
+
+const SampleStore::Metric SampleStore::metrics[STORE_METRIC_COUNT] = {
+  {"soil",     0},
+  {"temp",     1},
+  {"hum",      1},
+  {"air",      0},
+  {"tds",      0},
+  {"ph",       1},
+  {"ec",       3},
+  {"soilTemp", 1},
+  {"n",        0},
+  {"p",        0},
+  {"k",        0},
+};
+
+SampleStore::SampleStore()
+  : partition(nullptr), mounted(false), capacity(0), slotCount(0), nextSlot(0), nextSequence(0),
+    recorded(0), sealFailures(0),
+    exportRecords(0), exportBytes(0), exportMs(0) {
+  memset(firstTime, 0, sizeof(firstTime));
+  memset(openedAt, 0, sizeof(openedAt));
+}
+
+void SampleStore::begin() {
+  for (uint8_t i = 0; i < STORE_METRIC_COUNT; i++) {
+    openBlock(i);
+  }
+
+  partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, STORE_PARTITION);
+  if (!partition) {
+    Serial.println("❌ No '" STORE_PARTITION "' partition, history kept in RAM only");
+    return;
+  }
+  capacity = partition->size / STORE_SECTOR_SIZE * STORE_SLOTS_PER_SECTOR;
+  mounted = true;
+
+  // Find the newest slot; the ring continues right after it
+  uint32_t newest = 0;
+  bool any = false;
+  for (uint16_t i = 0; i < capacity; i++) {
+    StoreSlotHeader header;
+    if (!readHeader(i, header)) continue;
+
+    slotCount++;
+    if (!any || header.sequence > newest) {
+      newest = header.sequence;
+      nextSlot = (i + 1) % capacity;
+      any = true;
+    }
+  }
+  nextSequence = any ? newest + 1 : 0;
+
+  // A write cut short by a reset leaves the rest of its sector unusable
+  if (nextSlot % STORE_SLOTS_PER_SECTOR != 0) {
+    for (uint16_t i = nextSlot; i % STORE_SLOTS_PER_SECTOR != 0; i++) {
+      if (!isErased(i)) {
+        nextSlot = (i / STORE_SLOTS_PER_SECTOR + 1) * STORE_SLOTS_PER_SECTOR % capacity;
+        break;
+      }
+    }
+  }
+
+  Serial.printf("✅ Sample store: %u/%u blocks in flash\n", slotCount, capacity);
+}
+
+void SampleStore::loop() {
+  // Bounds what a power cut can lose; full blocks are sealed by record()
+  unsigned long now = millis();
+  for (uint8_t i = 0; i < STORE_METRIC_COUNT; i++) {
+    if (!encoders[i].isEmpty() && now - openedAt[i] >= STORE_FLUSH_INTERVAL * 1000UL) {
+      seal(i);
+    }
+  }
+}
+
+void SampleStore::openBlock(uint8_t metric) {
+  encoders[metric].begin(blocks[metric], SERIES_BLOCK_SIZE, SERIES_FIXED, metrics[metric].decimals);
+}
+
+bool SampleStore::seal(uint8_t metric) {
+  if (encoders[metric].isEmpty()) return true;
+
+  bool ok = false;
+  if (mounted && (nextSlot % STORE_SLOTS_PER_SECTOR != 0 || eraseSector(nextSlot))) {
+    StoreSlotHeader header;
+    header.magic = STORE_SLOT_MAGIC;
+    header.metric = metric;
+    header.reserved = 0;
+    header.sequence = nextSequence;
+    header.firstTime = firstTime[metric];
+    header.lastTime = encoders[metric].getLastTime();
+
+    // Header last: a slot only becomes valid once its block is complete
+    size_t offset = (size_t)(nextSlot / STORE_SLOTS_PER_SECTOR) * STORE_SECTOR_SIZE +
+                    (nextSlot % STORE_SLOTS_PER_SECTOR) * STORE_SLOT_SIZE;
+    ok = esp_partition_write(partition, offset + sizeof(header), blocks[metric], SERIES_BLOCK_SIZE) == ESP_OK &&
+         esp_partition_write(partition, offset, &header, sizeof(header)) == ESP_OK;
+  }
+
+  if (ok) {
+    nextSequence++;
+    nextSlot = (nextSlot + 1) % capacity;
+    slotCount++;
+  } else {
+    // Keep recording; the block's samples are lost
+    sealFailures++;
+  }
+
+  openBlock(metric);
+  return ok;
+}
+
+bool SampleStore::readHeader(uint16_t slot, StoreSlotHeader &header) const {
+  size_t offset = (size_t)(slot / STORE_SLOTS_PER_SECTOR) * STORE_SECTOR_SIZE +
+                  (slot % STORE_SLOTS_PER_SECTOR) * STORE_SLOT_SIZE;
+  if (esp_partition_read(partition, offset, &header, sizeof(header)) != ESP_OK) return false;
+  return header.magic == STORE_SLOT_MAGIC && header.metric < STORE_METRIC_COUNT &&
+         header.firstTime <= header.lastTime;
+}
+
+bool SampleStore::isErased(uint16_t slot) const {
+  size_t offset = (size_t)(slot / STORE_SLOTS_PER_SECTOR) * STORE_SECTOR_SIZE +
+                  (slot % STORE_SLOTS_PER_SECTOR) * STORE_SLOT_SIZE;
+  uint32_t words[STORE_SLOT_SIZE / 4];
+  if (esp_partition_read(partition, offset, words, sizeof(words)) != ESP_OK) return false;
+  for (uint16_t i = 0; i < STORE_SLOT_SIZE / 4; i++) {
+    if (words[i] != 0xFFFFFFFF) return false;
+  }
+  return true;
+}
+
+// Called when the ring enters a sector: its old blocks go (~45 ms)
+bool SampleStore::eraseSector(uint16_t slot) {
+  uint16_t first = slot / STORE_SLOTS_PER_SECTOR * STORE_SLOTS_PER_SECTOR;
+  for (uint16_t i = first; i < first + STORE_SLOTS_PER_SECTOR; i++) {
+    StoreSlotHeader header;
+    if (readHeader(i, header) && slotCount > 0) slotCount--;
+  }
+  return esp_partition_erase_range(partition, (size_t)(first / STORE_SLOTS_PER_SECTOR) * STORE_SECTOR_SIZE,
+                                   STORE_SECTOR_SIZE) == ESP_OK;
+}
+
+void SampleStore::record(StoreMetric metric, uint32_t time, float value) {
+  if (metric >= STORE_METRIC_COUNT || isnan(value)) return;
+
+  SeriesEncoder &encoder = encoders[metric];
+  if (!encoder.append(time, value)) {
+    seal(metric);
+    if (!encoder.append(time, value)) return;
+  }
+
+  if (encoder.getCount() == 1) {
+    firstTime[metric] = time;
+    openedAt[metric] = millis();
+  }
+  recorded++;
+}
+
+void SampleStore::flush() {
+  for (uint8_t i = 0; i < STORE_METRIC_COUNT; i++) {
+    seal(i);
+  }
+}
+
+int8_t SampleStore::findMetric(const char *name) {
+  for (uint8_t i = 0; i < STORE_METRIC_COUNT; i++) {
+    if (strcmp(metrics[i].name, name) == 0) return i;
+  }
+  return -1;
+}
+
+void SampleStore::noteExport(uint32_t records, uint32_t bytes, uint32_t ms) {
+  exportRecords = records;
+  exportBytes = bytes;
+  exportMs = ms;
+}
+
+void SampleStore::toJson(JsonVariant obj) const {
+  obj["flash"] = mounted;
+  obj["blocks"] = slotCount;
+  obj["capacity"] = capacity;
+  obj["recorded"] = recorded;
+  obj["sealFailures"] = sealFailures;
+  obj["export"]["records"] = exportRecords;
+  obj["export"]["bytes"] = exportBytes;
+  obj["export"]["ms"] = exportMs;
+  obj["export"]["kbps"] = exportMs ? exportBytes / (float)exportMs : 0;
+}
+
+// ========== READER ==========
+
+StoreCursor::StoreCursor()
+  : store(nullptr), from(0), to(0), metric(0), slotsLeft(0), slot(0), openDone(true), active(false) {}
+
+void StoreCursor::begin(SampleStore &s, uint32_t f, uint32_t t, uint8_t m) {
+  store = &s;
+  from = f;
+  to = t;
+  metric = m;
+  // Oldest first: the ring resumes at nextSlot, empty and erased slots are skipped
+  slotsLeft = s.mounted ? s.capacity : 0;
+  slot = s.nextSlot;
+  openDone = false;
+  active = false;
+}
+
+bool StoreCursor::loadNext() {
+  // Sealed blocks, skipped by their header when outside the filter
+  while (slotsLeft > 0) {
+    uint16_t current = slot;
+    slot = (slot + 1) % store->capacity;
+    slotsLeft--;
+
+    StoreSlotHeader header;
+    if (!store->readHeader(current, header)) continue;
+    if (header.metric != metric) continue;
+    if (header.lastTime < from || header.firstTime > to) continue;
+
+    size_t offset = (size_t)(current / STORE_SLOTS_PER_SECTOR) * STORE_SECTOR_SIZE +
+                    (current % STORE_SLOTS_PER_SECTOR) * STORE_SLOT_SIZE + sizeof(header);
+    if (esp_partition_read(store->partition, offset, block, SERIES_BLOCK_SIZE) != ESP_OK) continue;
+    if (!decoder.begin(block, SERIES_BLOCK_SIZE)) continue;
+    return true;
+  }
+
+  // Then the block still being filled, decoded in place
+  if (!openDone) {
+    openDone = true;
+    const SeriesEncoder &encoder = store->encoders[metric];
+    if (encoder.isEmpty()) return false;
+    if (encoder.getLastTime() < from || store->firstTime[metric] > to) return false;
+    return decoder.begin(store->blocks[metric], encoder.getSize());
+  }
+  return false;
+}
+
+bool StoreCursor::next(StoreRecord &record) {
+  if (!store) return false;
+  while (true) {
+    if (!active) {
+      if (!loadNext()) return false;
+      active = true;
+    }
+
+    while (decoder.next(record.time, record.value)) {
+      if (record.time < from) continue;
+      if (record.time > to) break;
+      record.metric = metric;
+      return true;
+    }
+    active = false;
+  }
+}
+
+StoreReader::StoreReader(SampleStore &store, uint32_t from, uint32_t to, int8_t metric) {
+  for (uint8_t i = 0; i < STORE_METRIC_COUNT; i++) {
+    if (metric < 0 || metric == i) cursors[i].begin(store, from, to, i);
+    hasPending[i] = cursors[i].next(pending[i]);
+  }
+}
+
+// Merges the per-metric streams, each already in time order
+bool StoreReader::next(StoreRecord &record) {
+  int8_t earliest = -1;
+  for (uint8_t i = 0; i < STORE_METRIC_COUNT; i++) {
+    if (hasPending[i] && (earliest < 0 || pending[i].time < pending[earliest].time)) earliest = i;
+  }
+  if (earliest < 0) return false;
+
+  record = pending[earliest];
+  hasPending[earliest] = cursors[earliest].next(pending[earliest]);
+  return true;
+}
@@ -0,0 +1,155 @@
+#ifndef SAMPLE_STORE_H
+#define SAMPLE_STORE_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <esp_partition.h>
+#include "config/Config.h"
+#include "storage/SeriesCodec.h"
+
+#define STORE_PARTITION "samples"   // Raw data partition (partitions.csv), no file system
+#define STORE_SECTOR_SIZE 4096      // Flash erase unit
+#define STORE_SLOT_MAGIC 0xA65E
+
+enum StoreMetric {
+  STORE_SOIL,
+  STORE_TEMP,
+  STORE_HUM,
+  STORE_AIR,
+  STORE_TDS,
+  STORE_PH,
+  STORE_EC,
+  STORE_SOIL_TEMP,
+  STORE_N,
+  STORE_P,
+  STORE_K,
+  STORE_METRIC_COUNT
+};
+
+// Flash slot: fixed header followed by one SeriesCodec block
+struct StoreSlotHeader {
+  uint16_t magic;
+  uint8_t metric;
+  uint8_t reserved;
+  uint32_t sequence;      // Monotonic, the highest one is the newest slot
+  uint32_t firstTime;     // s, lets readers skip blocks outside a time range
+  uint32_t lastTime;
+};
+
+#define STORE_SLOT_SIZE (sizeof(StoreSlotHeader) + SERIES_BLOCK_SIZE)
+#define STORE_SLOTS_PER_SECTOR (STORE_SECTOR_SIZE / STORE_SLOT_SIZE)   // 15
+
+struct StoreRecord {
+  uint8_t metric;
+  uint32_t time;          // s
+  float value;
+};
+
+class SampleStore;
+
+// Walks one metric's records oldest block first: sealed flash slots, then
+// the block still open in RAM. Holds a single block, whatever the range.
+class StoreCursor {
+private:
+  SampleStore *store;
+  uint32_t from;
+  uint32_t to;
+  uint8_t metric;
+
+  uint16_t slotsLeft;
+  uint16_t slot;
+  bool openDone;          // The RAM block was visited
+  uint8_t block[SERIES_BLOCK_SIZE];
+  SeriesDecoder decoder;
+  bool active;            // decoder holds a block
+
+  bool loadNext();
+
+public:
+  StoreCursor();
+
+  void begin(SampleStore &store, uint32_t from, uint32_t to, uint8_t metric);
+  bool next(StoreRecord &record);
+};
+
+// Records of one or all metrics in time order (ties in metric order), so a
+// download can be resumed from the last time received. One cursor per
+// metric (~3.5 KB for all), allocate it on the heap.
+class StoreReader {
+private:
+  StoreCursor cursors[STORE_METRIC_COUNT];
+  StoreRecord pending[STORE_METRIC_COUNT];
+  bool hasPending[STORE_METRIC_COUNT];
+
+public:
+  StoreReader(SampleStore &store, uint32_t from, uint32_t to, int8_t metric);
+
+  bool next(StoreRecord &record);
+};
+
+// On-device history at STORE_INTERVAL resolution. Each metric fills a
+// compressed block in RAM; full blocks (or ones older than
+// STORE_FLUSH_INTERVAL) are sealed into a ring of slots in a raw flash
+// partition. Slots are appended, never rewritten: the sector ahead is erased
+// when the ring enters it, which drops its 15 oldest blocks.
+class SampleStore {
+private:
+  struct Metric {
+    const char *name;
+    uint8_t decimals;     // Resolution kept by SERIES_FIXED
+  };
+  static const Metric metrics[STORE_METRIC_COUNT];
+
+  uint8_t blocks[STORE_METRIC_COUNT][SERIES_BLOCK_SIZE];
+  SeriesEncoder encoders[STORE_METRIC_COUNT];
+  uint32_t firstTime[STORE_METRIC_COUNT];
+  unsigned long openedAt[STORE_METRIC_COUNT];   // millis()
+
+  const esp_partition_t *partition;
+  bool mounted;
+  uint16_t capacity;      // Slots in the partition
+  uint16_t slotCount;     // Valid slots
+  uint16_t nextSlot;
+  uint32_t nextSequence;
+  uint32_t recorded;
+  uint32_t sealFailures;
+
+  // Last export, for throughput reporting
+  uint32_t exportRecords;
+  uint32_t exportBytes;
+  uint32_t exportMs;
+
+  void openBlock(uint8_t metric);
+  bool seal(uint8_t metric);
+  bool readHeader(uint16_t slot, StoreSlotHeader &header) const;
+  bool isErased(uint16_t slot) const;
+  bool eraseSector(uint16_t slot);
+
+  friend class StoreCursor;
+
+public:
+  SampleStore();
+
+  void begin();
+  void loop();
+
+  // Appends one reading at time (s); NaN readings are skipped
+  void record(StoreMetric metric, uint32_t time, float value);
+  void flush();     // Seal every open block (before a planned reboot)
+
+  // Export helpers
+  static int8_t findMetric(const char *name);
+  static const char *getMetricName(uint8_t metric) { return metrics[metric].name; }
+  static uint8_t getDecimals(uint8_t metric) { return metrics[metric].decimals; }
+  void noteExport(uint32_t records, uint32_t bytes, uint32_t ms);
+
+  // Getters
+  bool isMounted() const { return mounted; }
+  uint16_t getSlotCount() const { return slotCount; }
+  uint16_t getCapacity() const { return capacity; }
+  uint32_t getRecorded() const { return recorded; }
+
+  void toJson(JsonVariant obj) const;
+};
+
+#endif // SAMPLE_STORE_H
@@ -0,0 +1,329 @@
+#include "SeriesCodec.h"
+
+#define WINDOW_NONE 0xFF      // No previous XOR window yet
+
+static inline uint64_t zigzag(int64_t value) {
+  return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+}
+
+static inline int64_t unzigzag(uint64_t value) {
+  return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+}
+
+static inline uint32_t floatBits(float value) {
+  uint32_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  return bits;
+}
+
+static inline float bitsFloat(uint32_t bits) {
+  float value;
+  memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+static float decimalScale(uint8_t decimals) {
+  float scale = 1.0f;
+  for (uint8_t i = 0; i < decimals; i++) scale *= 10.0f;
+  return scale;
+}
+
+static int32_t quantize(float value, float scale) {
+  if (isnan(value)) return SERIES_FIXED_NAN;
+  double scaled = round((double)value * scale);
+  if (scaled >= INT32_MAX) return INT32_MAX;
+  if (scaled <= (double)SERIES_FIXED_NAN + 1) return SERIES_FIXED_NAN + 1;
+  return (int32_t)scaled;
+}
+
+// ========== ENCODER ==========
+
+SeriesEncoder::SeriesEncoder()
+  : buffer(nullptr), capacity(0), bitPos(0), count(0),
+    format(SERIES_FLOAT), scale(1.0f),
+    prevTime(0), prevDelta(0), prevBits(0),
+    prevLeading(WINDOW_NONE), prevTrailing(0) {
+}
+
+bool SeriesEncoder::begin(uint8_t *storage, size_t size, SeriesFormat fmt, uint8_t decimals) {
+  if (!storage || size < SERIES_HEADER_SIZE + 8) return false;
+  if (fmt != SERIES_FLOAT && fmt != SERIES_FIXED) return false;
+  if (decimals > SERIES_MAX_DECIMALS) return false;
+
+  buffer = storage;
+  capacity = size;
+  format = fmt;
+  scale = decimalScale(decimals);
+  count = 0;
+  prevTime = 0;
+  prevDelta = 0;
+  prevBits = 0;
+  prevLeading = WINDOW_NONE;
+  prevTrailing = 0;
+
+  buffer[0] = (uint8_t)fmt;
+  buffer[1] = fmt == SERIES_FIXED ? decimals : 0;
+  buffer[2] = 0;
+  buffer[3] = 0;
+  bitPos = SERIES_HEADER_SIZE * 8;
+  return true;
+}
+
+bool SeriesEncoder::writeBits(uint64_t value, uint8_t bits) {
+  if (bitPos + bits > capacity * 8) return false;
+
+  // Up to one byte per step; bits are overwritten, not OR-ed, so a
+  // rolled-back append leaves no stale state behind
+  while (bits > 0) {
+    uint8_t offset = bitPos & 7;
+    uint8_t room = 8 - offset;
+    uint8_t n = bits < room ? bits : room;
+    uint8_t mask = (uint8_t)(((1u << n) - 1) << (room - n));
+    uint8_t chunk = (uint8_t)((value >> (bits - n)) << (room - n));
+
+    uint8_t &target = buffer[bitPos >> 3];
+    target = (target & ~mask) | (chunk & mask);
+    bitPos += n;
+    bits -= n;
+  }
+  return true;
+}
+
+bool SeriesEncoder::writeVarint(uint64_t value) {
+  do {
+    uint8_t group = value & 0x7F;
+    value >>= 7;
+    if (value) group |= 0x80;
+    if (!writeBits(group, 8)) return false;
+  } while (value);
+  return true;
+}
+
+bool SeriesEncoder::writeTime(uint32_t time) {
+  int64_t delta = (int64_t)time - prevTime;
+  int64_t dod = delta - prevDelta;
+  prevDelta = delta;
+  prevTime = time;
+
+  // Regular sampling makes almost every delta-of-delta 0 or a few ms of jitter
+  if (dod == 0) return writeBits(0, 1);
+
+  uint64_t z = zigzag(dod);
+  if (z < (1u << 7)) return writeBits(0x2, 2) && writeBits(z, 7);
+  if (z < (1u << 9)) return writeBits(0x6, 3) && writeBits(z, 9);
+  if (z < (1u << 12)) return writeBits(0xE, 4) && writeBits(z, 12);
+  return writeBits(0xF, 4) && writeBits(z, 36);
+}
+
+bool SeriesEncoder::writeFloat(uint32_t bits) {
+  uint32_t x = bits ^ prevBits;
+  prevBits = bits;
+  if (x == 0) return writeBits(0, 1);
+
+  uint8_t leading = __builtin_clz(x);
+  uint8_t trailing = __builtin_ctz(x);
+  if (leading > 31) leading = 31;
+
+  // Reuse the previous window when the changed bits fit inside it
+  if (prevLeading != WINDOW_NONE && leading >= prevLeading && trailing >= prevTrailing) {
+    uint8_t length = 32 - prevLeading - prevTrailing;
+    return writeBits(0x2, 2) && writeBits(x >> prevTrailing, length);
+  }
+
+  uint8_t length = 32 - leading - trailing;
+  prevLeading = leading;
+  prevTrailing = trailing;
+  return writeBits(0x3, 2) && writeBits(leading, 5) && writeBits(length - 1, 5) &&
+         writeBits(x >> trailing, length);
+}
+
+bool SeriesEncoder::writeFixed(int32_t quantized) {
+  int64_t delta = (int64_t)quantized - (int32_t)prevBits;
+  prevBits = (uint32_t)quantized;
+  if (delta == 0) return writeBits(0, 1);
+  return writeBits(1, 1) && writeVarint(zigzag(delta));
+}
+
+bool SeriesEncoder::append(uint32_t time, float value) {
+  if (!buffer || count == UINT16_MAX) return false;
+
+  // Snapshot so a sample that does not fit can be undone
+  size_t savedPos = bitPos;
+  uint32_t savedTime = prevTime;
+  int64_t savedDelta = prevDelta;
+  uint32_t savedBits = prevBits;
+  uint8_t savedLeading = prevLeading;
+  uint8_t savedTrailing = prevTrailing;
+
+  uint32_t bits = format == SERIES_FIXED ? (uint32_t)quantize(value, scale) : floatBits(value);
+  bool ok;
+  if (count == 0) {
+    ok = writeBits(time, 32) && writeBits(bits, 32);
+    prevTime = time;
+    prevBits = bits;
+  } else {
+    ok = writeTime(time) &&
+         (format == SERIES_FIXED ? writeFixed((int32_t)bits) : writeFloat(bits));
+  }
+
+  if (!ok) {
+    bitPos = savedPos;
+    prevTime = savedTime;
+    prevDelta = savedDelta;
+    prevBits = savedBits;
+    prevLeading = savedLeading;
+    prevTrailing = savedTrailing;
+    return false;
+  }
+
+  count++;
+  buffer[2] = count & 0xFF;
+  buffer[3] = count >> 8;
+  return true;
+}
+
+// ========== DECODER ==========
+
+SeriesDecoder::SeriesDecoder()
+  : buffer(nullptr), size(0), bitPos(0), count(0), index(0),
+    format(SERIES_FLOAT), scale(1.0f),
+    prevTime(0), prevDelta(0), prevBits(0),
+    prevLeading(WINDOW_NONE), prevTrailing(0) {
+}
+
+bool SeriesDecoder::begin(const uint8_t *data, size_t length) {
+  if (!data || length < SERIES_HEADER_SIZE) return false;
+  if (data[0] != SERIES_FLOAT && data[0] != SERIES_FIXED) return false;
+  if (data[1] > SERIES_MAX_DECIMALS) return false;
+
+  buffer = data;
+  size = length;
+  format = (SeriesFormat)data[0];
+  scale = decimalScale(data[1]);
+  count = data[2] | (data[3] << 8);
+  index = 0;
+  bitPos = SERIES_HEADER_SIZE * 8;
+  prevTime = 0;
+  prevDelta = 0;
+  prevBits = 0;
+  prevLeading = WINDOW_NONE;
+  prevTrailing = 0;
+  return true;
+}
+
+bool SeriesDecoder::readBits(uint8_t bits, uint64_t &value) {
+  if (bitPos + bits > size * 8) return false;
+
+  value = 0;
+  while (bits > 0) {
+    uint8_t offset = bitPos & 7;
+    uint8_t room = 8 - offset;
+    uint8_t n = bits < room ? bits : room;
+    uint8_t chunk = (buffer[bitPos >> 3] >> (room - n)) & ((1u << n) - 1);
+
+    value = (value << n) | chunk;
+    bitPos += n;
+    bits -= n;
+  }
+  return true;
+}
+
+bool SeriesDecoder::readVarint(uint64_t &value) {
+  value = 0;
+  for (uint8_t shift = 0; shift < 64; shift += 7) {
+    uint64_t group;
+    if (!readBits(8, group)) return false;
+    value |= (group & 0x7F) << shift;
+    if (!(group & 0x80)) return true;
+  }
+  return false;
+}
+
+bool SeriesDecoder::readTime(uint32_t &time) {
+  // Prefix of up to four 1-bits selects the payload width
+  static const uint8_t widths[] = {7, 9, 12, 36};
+  uint64_t bit;
+  uint8_t ones = 0;
+  while (ones < 4) {
+    if (!readBits(1, bit)) return false;
+    if (!bit) break;
+    ones++;
+  }
+
+  int64_t dod = 0;
+  if (ones > 0) {
+    uint64_t z;
+    if (!readBits(widths[ones - 1], z)) return false;
+    dod = unzigzag(z);
+  }
+
+  prevDelta += dod;
+  prevTime = (uint32_t)(prevTime + prevDelta);
+  time = prevTime;
+  return true;
+}
+
+bool SeriesDecoder::readFloat(float &value) {
+  uint64_t control;
+  if (!readBits(1, control)) return false;
+
+  if (control) {
+    if (!readBits(1, control)) return false;
+    if (control) {
+      uint64_t leading, length;
+      if (!readBits(5, leading) || !readBits(5, length)) return false;
+      length++;
+      if (leading + length > 32) return false;
+      prevLeading = leading;
+      prevTrailing = 32 - leading - length;
+    } else if (prevLeading == WINDOW_NONE) {
+      return false;
+    }
+
+    uint64_t meaningful;
+    if (!readBits(32 - prevLeading - prevTrailing, meaningful)) return false;
+    prevBits ^= (uint32_t)(meaningful << prevTrailing);
+  }
+
+  value = bitsFloat(prevBits);
+  return true;
+}
+
+bool SeriesDecoder::readFixed(float &value) {
+  uint64_t changed;
+  if (!readBits(1, changed)) return false;
+
+  if (changed) {
+    uint64_t z;
+    if (!readVarint(z)) return false;
+    prevBits += (uint32_t)unzigzag(z);    // Modular, matches the encoder's int64 delta
+  }
+
+  int32_t quantized = (int32_t)prevBits;
+  value = quantized == SERIES_FIXED_NAN ? NAN : quantized / scale;
+  return true;
+}
+
+bool SeriesDecoder::next(uint32_t &time, float &value) {
+  if (!buffer || index >= count) return false;
+
+  if (index == 0) {
+    uint64_t t, bits;
+    if (!readBits(32, t) || !readBits(32, bits)) return false;
+    prevTime = (uint32_t)t;
+    prevBits = (uint32_t)bits;
+    time = prevTime;
+    if (format == SERIES_FIXED) {
+      int32_t quantized = (int32_t)prevBits;
+      value = quantized == SERIES_FIXED_NAN ? NAN : quantized / scale;
+    } else {
+      value = bitsFloat(prevBits);
+    }
+  } else {
+    if (!readTime(time)) return false;
+    if (!(format == SERIES_FIXED ? readFixed(value) : readFloat(value))) return false;
+  }
+
+  index++;
+  return true;
+}
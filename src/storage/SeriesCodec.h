@@ -0,0 +1,107 @@
+#ifndef SERIES_CODEC_H
+#define SERIES_CODEC_H
+
+// Compressed blocks for one metric's (timestamp, value) series.
+// Timestamps are delta-of-delta coded; values are either XOR-compressed
+// float32 (Gorilla) or quantized to fixed point and delta/zigzag/varint
+// coded. No Arduino dependencies, so the codec also builds on the host.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <math.h>
+
+#define SERIES_BLOCK_SIZE 256
+#define SERIES_HEADER_SIZE 4
+#define SERIES_MAX_DECIMALS 6
+#define SERIES_FIXED_NAN INT32_MIN     // Quantized value reserved for NaN
+
+enum SeriesFormat {
+  SERIES_FLOAT = 1,     // XOR of successive float32 bit patterns, lossless
+  SERIES_FIXED = 2      // value * 10^decimals rounded, exact for quantized readings
+};
+
+// Block layout:
+//   [0]    format
+//   [1]    decimals (SERIES_FIXED only)
+//   [2..3] sample count, little endian, updated on every append
+//   [4..]  MSB-first bit stream: first timestamp (32) and value (32) raw,
+//          then per sample a timestamp delta-of-delta and a value code.
+
+class SeriesEncoder {
+private:
+  uint8_t *buffer;
+  size_t capacity;      // bytes
+  size_t bitPos;        // Next bit to write, from the start of the buffer
+  uint16_t count;
+
+  SeriesFormat format;
+  float scale;
+
+  uint32_t prevTime;
+  int64_t prevDelta;
+  uint32_t prevBits;    // Float bit pattern or quantized value
+  uint8_t prevLeading;  // XOR window of the previous value
+  uint8_t prevTrailing;
+
+  bool writeBits(uint64_t value, uint8_t bits);
+  bool writeVarint(uint64_t value);
+  bool writeTime(uint32_t time);
+  bool writeFloat(uint32_t bits);
+  bool writeFixed(int32_t quantized);
+
+public:
+  SeriesEncoder();
+
+  // Starts a block in caller-owned storage (usually SERIES_BLOCK_SIZE bytes)
+  bool begin(uint8_t *storage, size_t size, SeriesFormat fmt, uint8_t decimals = 0);
+
+  // Appends one sample; false when it does not fit (the block is unchanged)
+  bool append(uint32_t time, float value);
+
+  // Getters
+  uint16_t getCount() const { return count; }
+  size_t getSize() const { return (bitPos + 7) / 8; }     // Bytes used, header included
+  uint32_t getLastTime() const { return prevTime; }
+  bool isEmpty() const { return count == 0; }
+};
+
+class SeriesDecoder {
+private:
+  const uint8_t *buffer;
+  size_t size;
+  size_t bitPos;
+  uint16_t count;
+  uint16_t index;
+
+  SeriesFormat format;
+  float scale;
+
+  uint32_t prevTime;
+  int64_t prevDelta;
+  uint32_t prevBits;
+  uint8_t prevLeading;
+  uint8_t prevTrailing;
+
+  bool readBits(uint8_t bits, uint64_t &value);
+  bool readVarint(uint64_t &value);
+  bool readTime(uint32_t &time);
+  bool readFloat(float &value);
+  bool readFixed(float &value);
+
+public:
+  SeriesDecoder();
+
+  // False if the header is not a valid block
+  bool begin(const uint8_t *data, size_t length);
+
+  // Next sample in time order; false at the end of the block or on corrupt data
+  bool next(uint32_t &time, float &value);
+
+  // Getters
+  uint16_t getCount() const { return count; }
+  uint16_t getIndex() const { return index; }
+  SeriesFormat getFormat() const { return format; }
+};
+
+#endif // SERIES_CODEC_H
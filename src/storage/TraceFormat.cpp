@@ -0,0 +1,31 @@
+#include "TraceFormat.h"
+
+// Order is part of the format; append only
+const TraceConfigField TRACE_CONFIG_FIELDS[] = {
+  {"moisture_thr",  &MOISTURE_THRESHOLD,       nullptr},
+  {"moisture_stop", &MOISTURE_STOP,            nullptr},
+  {"max_pump_time", &MAX_PUMP_TIME,            nullptr},
+  {"dry_count",     &REQUIRED_CONSECUTIVE_DRY, nullptr},
+  {"boot_delay",    nullptr,                   &BOOT_SAFE_DELAY},
+  {"irr_mode",      &IRRIGATION_MODE,          nullptr},
+  {"pulse_min",     &PULSE_MIN_TIME,           nullptr},
+  {"pulse_max",     &PULSE_MAX_TIME,           nullptr},
+  {"soak_min",      &SOAK_MIN_TIME,            nullptr},
+  {"soak_max",      &SOAK_MAX_TIME,            nullptr},
+};
+
+const uint8_t TRACE_CONFIG_COUNT = sizeof(TRACE_CONFIG_FIELDS) / sizeof(TRACE_CONFIG_FIELDS[0]);
+
+int32_t traceConfigGet(uint8_t field) {
+  const TraceConfigField &f = TRACE_CONFIG_FIELDS[field];
+  return f.intValue ? *f.intValue : (int32_t)*f.ulongValue;
+}
+
+void traceConfigSet(uint8_t field, int32_t value) {
+  const TraceConfigField &f = TRACE_CONFIG_FIELDS[field];
+  if (f.intValue) {
+    *f.intValue = value;
+  } else {
+    *f.ulongValue = (unsigned long)value;
+  }
+}
@@ -0,0 +1,73 @@
+#ifndef TRACE_FORMAT_H
+#define TRACE_FORMAT_H
+
+#include <Arduino.h>
+#include "config/Config.h"
+
+// Pump controller trace, shared by TraceRecorder (device) and tools/replay.
+//
+// Download: "AGTR", version, block count, snapshot size (u16), metric names
+// (u8 length + comma list), then per block, oldest first: u16 length + bytes.
+//
+// A block starts with a keyframe, so it replays on its own. autoIrrigate()
+// calls with an unchanged soil value and checkSafety() calls that left the
+// controller untouched are not recorded (see TraceRecorder). Each record is
+// one header byte, type in the high nibble and the ms since the previous
+// record in the low one (15 = a varint with the full delta follows).
+#define TRACE_MAGIC "AGTR"
+#define TRACE_VERSION 1
+#define TRACE_SMALL_DELTA 15
+
+enum TraceRecordType {
+  TRACE_KEYFRAME,     // varint uptime ms, zigzag soil, config, PumpSnapshot
+  TRACE_CONFIG,       // Controller settings changed: zigzag varint per TRACE_CONFIG_FIELDS
+  TRACE_AUTO,         // autoIrrigate(): zigzag soil change
+  TRACE_AUTO_SAME,    // autoIrrigate() with the previous soil value
+  TRACE_SAFETY,       // checkSafety()
+  TRACE_START,        // start()
+  TRACE_START_FOR,    // startFor(): varint seconds
+  TRACE_STOP,         // stop()
+  TRACE_DRY_COUNT,    // setConsecutiveDryCount(): zigzag count
+  TRACE_EDGE_ON,      // Relay switched on by the call before it
+  TRACE_EDGE_OFF,
+  TRACE_SAMPLE,       // Sensor reading: metric byte, float
+  TRACE_REPEAT        // The previous payload-less record again, same spacing: varint times
+};
+
+// Settings the controller reads that can change at runtime (registry keys)
+struct TraceConfigField {
+  const char *name;
+  int *intValue;
+  unsigned long *ulongValue;
+};
+
+extern const TraceConfigField TRACE_CONFIG_FIELDS[];
+extern const uint8_t TRACE_CONFIG_COUNT;
+
+int32_t traceConfigGet(uint8_t field);
+void traceConfigSet(uint8_t field, int32_t value);
+
+inline uint32_t traceZigzag(int32_t v) { return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31); }
+inline int32_t traceUnzigzag(uint32_t v) { return (int32_t)(v >> 1) ^ -(int32_t)(v & 1); }
+
+inline size_t traceVarint(uint8_t *out, uint64_t v) {
+  size_t n = 0;
+  while (v >= 0x80) {
+    out[n++] = (uint8_t)v | 0x80;
+    v >>= 7;
+  }
+  out[n++] = (uint8_t)v;
+  return n;
+}
+
+inline bool traceReadVarint(const uint8_t *&p, const uint8_t *end, uint64_t &v) {
+  v = 0;
+  for (uint8_t shift = 0; p < end && shift < 64; shift += 7) {
+    uint8_t b = *p++;
+    v |= (uint64_t)(b & 0x7F) << shift;
+    if (!(b & 0x80)) return true;
+  }
+  return false;
+}
+
+#endif // TRACE_FORMAT_H
@@ -0,0 +1,268 @@
+#include "TraceRecorder.h"
+#include "system/TimeService.h"
+
+TraceRecorder::TraceRecorder()
+  : pumpController(nullptr), buffer(nullptr), head(0), filled(0), active(false),
+    lastMs(0), lastSoil(0), lastBare(-1), lastBareDelta(0), repeatCount(0),
+    pendingCall(-1), pendingArg(0),
+    records(0), overwritten(0), dropped(0) {
+  memset(used, 0, sizeof(used));
+  memset(blockStart, 0, sizeof(blockStart));
+}
+
+void TraceRecorder::begin() {
+  if (TRACE_ENABLED) start();
+}
+
+void TraceRecorder::loop() {
+  if (TRACE_ENABLED && !active) {
+    start();
+  } else if (!TRACE_ENABLED && active) {
+    stop();
+  }
+}
+
+void TraceRecorder::start() {
+  if (!pumpController) return;
+  if (!buffer) {
+    buffer = (uint8_t *)malloc(TRACE_BLOCKS * TRACE_BLOCK_SIZE);
+    if (!buffer) {
+      Serial.println("❌ Trace buffer allocation failed, tracing off");
+      TRACE_ENABLED = false;
+      return;
+    }
+  }
+  head = 0;
+  filled = 0;
+  lastSoil = 0;
+  repeatCount = 0;
+  pendingCall = -1;
+  for (uint8_t i = 0; i < STORE_METRIC_COUNT; i++) {
+    lastValue[i] = NAN;
+  }
+  records = overwritten = dropped = 0;
+  active = true;
+  startBlock(TimeService::monoMs());
+  Serial.printf("🎞️  Trace recording started (%u x %u bytes)\n", TRACE_BLOCKS, TRACE_BLOCK_SIZE);
+}
+
+// The buffer stays for download until tracing is switched on again
+void TraceRecorder::stop() {
+  flushRepeat();
+  active = false;
+  Serial.printf("🎞️  Trace recording stopped after %lu records\n", (unsigned long)records);
+}
+
+// Only called between controller calls, where a snapshot is consistent
+void TraceRecorder::makeRoom() {
+  if (used[head] + TRACE_RECORD_MAX + TRACE_CALL_RESERVE <= TRACE_BLOCK_SIZE) return;
+  flushRepeat();
+  startBlock(TimeService::monoMs());
+}
+
+void TraceRecorder::startBlock(uint64_t now) {
+  if (filled) head = (head + 1) % TRACE_BLOCKS;
+  if (filled < TRACE_BLOCKS) {
+    filled++;
+  } else {
+    overwritten++;
+  }
+
+  uint8_t *p = block(head);
+  size_t n = 0;
+  p[n++] = TRACE_KEYFRAME << 4;
+  n += traceVarint(p + n, now);
+  n += traceVarint(p + n, traceZigzag(lastSoil));
+  for (uint8_t i = 0; i < TRACE_CONFIG_COUNT; i++) {
+    n += traceVarint(p + n, traceZigzag(traceConfigGet(i)));
+  }
+  PumpSnapshot state;
+  pumpController->saveState(state);
+  memcpy(p + n, &state, sizeof(state));
+  n += sizeof(state);
+
+  used[head] = n;
+  blockStart[head] = now;
+  lastMs = now;
+  lastBare = -1;
+}
+
+void TraceRecorder::write(uint8_t type, const uint8_t *payload, size_t length) {
+  uint64_t now = TimeService::monoMs();
+  uint64_t delta = now - lastMs;
+  lastMs = now;
+  records++;
+
+  // Same call, same spacing as the last one: count it
+  if (!length && type == lastBare && delta == lastBareDelta) {
+    repeatCount++;
+    return;
+  }
+  flushRepeat();
+
+  uint8_t record[TRACE_RECORD_MAX];
+  size_t n = 1;
+  if (delta < TRACE_SMALL_DELTA) {
+    record[0] = (type << 4) | (uint8_t)delta;
+  } else {
+    record[0] = (type << 4) | TRACE_SMALL_DELTA;
+    n += traceVarint(record + 1, delta);
+  }
+  memcpy(record + n, payload, length);
+  n += length;
+
+  if (used[head] + n > TRACE_BLOCK_SIZE) {
+    dropped++;
+    lastBare = -1;
+    return;
+  }
+  memcpy(block(head) + used[head], record, n);
+  used[head] += n;
+  lastBare = length ? -1 : type;
+  lastBareDelta = delta;
+}
+
+void TraceRecorder::flushRepeat() {
+  if (!repeatCount) return;
+  uint8_t record[1 + 5];
+  record[0] = TRACE_REPEAT << 4;
+  size_t n = 1 + traceVarint(record + 1, repeatCount);
+  repeatCount = 0;
+  if (used[head] + n > TRACE_BLOCK_SIZE) {
+    dropped++;
+    return;
+  }
+  memcpy(block(head) + used[head], record, n);
+  used[head] += n;
+}
+
+void TraceRecorder::onCall(uint8_t call, int32_t arg) {
+  if (!active) return;
+  makeRoom();
+
+  // Most loop calls change nothing; hold them until the call returns
+  if (call == PUMP_CALL_AUTO || call == PUMP_CALL_SAFETY) {
+    pumpController->saveState(before);
+    pendingCall = call;
+    pendingArg = arg;
+    return;
+  }
+  writeCall(call, arg);
+}
+
+void TraceRecorder::onEdge(bool on) {
+  if (!active) return;
+  writePending();
+  write(on ? TRACE_EDGE_ON : TRACE_EDGE_OFF, nullptr, 0);
+}
+
+void TraceRecorder::onReturn() {
+  if (pendingCall < 0) return;
+  PumpSnapshot after;
+  pumpController->saveState(after);
+  // A new soil value is kept even when it changed nothing here: a replay
+  // with other settings may act on it
+  if (memcmp(&before, &after, sizeof(after)) != 0 ||
+      (pendingCall == PUMP_CALL_AUTO && pendingArg != lastSoil)) {
+    writePending();
+  }
+  pendingCall = -1;
+}
+
+void TraceRecorder::writePending() {
+  if (pendingCall < 0) return;
+  writeCall(pendingCall, pendingArg);
+  pendingCall = -1;
+}
+
+void TraceRecorder::writeCall(uint8_t call, int32_t arg) {
+  uint8_t payload[5];
+  size_t length = 0;
+  uint8_t type;
+  switch (call) {
+    case PUMP_CALL_AUTO:
+      if (arg == lastSoil) {
+        type = TRACE_AUTO_SAME;
+      } else {
+        type = TRACE_AUTO;
+        length = traceVarint(payload, traceZigzag(arg - lastSoil));
+        lastSoil = arg;
+      }
+      break;
+    case PUMP_CALL_SAFETY: type = TRACE_SAFETY; break;
+    case PUMP_CALL_START: type = TRACE_START; break;
+    case PUMP_CALL_START_FOR:
+      type = TRACE_START_FOR;
+      length = traceVarint(payload, (uint32_t)arg);
+      break;
+    case PUMP_CALL_STOP: type = TRACE_STOP; break;
+    case PUMP_CALL_DRY_COUNT:
+      type = TRACE_DRY_COUNT;
+      length = traceVarint(payload, traceZigzag(arg));
+      break;
+    default: return;
+  }
+  write(type, payload, length);
+}
+
+void TraceRecorder::recordSample(uint8_t metric, float value) {
+  if (!active || metric >= STORE_METRIC_COUNT) return;
+  if (memcmp(&value, &lastValue[metric], sizeof(float)) == 0) return;
+  lastValue[metric] = value;
+  makeRoom();
+  uint8_t payload[1 + sizeof(float)];
+  payload[0] = metric;
+  memcpy(payload + 1, &value, sizeof(float));
+  write(TRACE_SAMPLE, payload, sizeof(payload));
+}
+
+void TraceRecorder::recordConfig() {
+  if (!active) return;
+  makeRoom();
+  uint8_t payload[TRACE_RECORD_MAX - 11];     // After a header with a 10-byte delta
+  size_t length = 0;
+  for (uint8_t i = 0; i < TRACE_CONFIG_COUNT; i++) {
+    length += traceVarint(payload + length, traceZigzag(traceConfigGet(i)));
+  }
+  write(TRACE_CONFIG, payload, length);
+}
+
+void TraceRecorder::writeTo(Print &out) {
+  if (active) flushRepeat();
+  lastBare = -1;
+
+  out.write((const uint8_t *)TRACE_MAGIC, 4);
+  out.write((uint8_t)TRACE_VERSION);
+  out.write(filled);
+  uint16_t snapshotSize = sizeof(PumpSnapshot);
+  out.write((const uint8_t *)&snapshotSize, 2);
+
+  char names[128];
+  size_t length = 0;
+  for (uint8_t i = 0; i < STORE_METRIC_COUNT; i++) {
+    length += snprintf(names + length, sizeof(names) - length, "%s%s",
+                       i ? "," : "", SampleStore::getMetricName(i));
+  }
+  out.write((uint8_t)length);
+  out.write((const uint8_t *)names, length);
+
+  for (uint8_t i = 0; i < filled; i++) {
+    uint8_t index = (oldest() + i) % TRACE_BLOCKS;
+    out.write((const uint8_t *)&used[index], 2);
+    out.write(block(index), used[index]);
+  }
+}
+
+void TraceRecorder::toJson(JsonVariant obj) const {
+  obj["active"] = active;
+  size_t bytes = 0;
+  for (uint8_t i = 0; i < filled; i++) {
+    bytes += used[i];
+  }
+  obj["bytes"] = bytes;
+  obj["blocks"] = filled;
+  obj["records"] = records;
+  obj["overwritten"] = overwritten;
+  obj["dropped"] = dropped;
+  if (filled) obj["spanS"] = (uint32_t)((TimeService::monoMs() - blockStart[oldest()]) / 1000);
+}
@@ -0,0 +1,81 @@
+#ifndef TRACE_RECORDER_H
+#define TRACE_RECORDER_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "config/Config.h"
+#include "controllers/PumpController.h"
+#include "storage/SampleStore.h"
+#include "storage/TraceFormat.h"
+
+#define TRACE_BLOCK_SIZE 4096
+#define TRACE_BLOCKS 4              // 16 KB, allocated while tracing is on
+#define TRACE_RECORD_MAX 64         // Largest record after the keyframe (config)
+#define TRACE_CALL_RESERVE 32       // Kept free for the edges a call makes
+
+// Records every input PumpController gets (soil readings, safety ticks,
+// commands from MQTT, web and rules), its relay edges and the sensor samples
+// in a RAM ring of self-contained blocks, for tools/replay. A soil reading is
+// kept when its value differs from the last one kept or when it changed the
+// controller's state, a safety tick only in the latter case, so an idle loop
+// costs nothing; replaying without the rest ends in the same state.
+// Samples are kept when their value changed. When the ring is full the oldest
+// block goes. Switched by TRACE_ENABLED.
+class TraceRecorder : public PumpTracer {
+private:
+  PumpController *pumpController;
+  uint8_t *buffer;
+  uint16_t used[TRACE_BLOCKS];
+  uint64_t blockStart[TRACE_BLOCKS];  // Uptime ms of each keyframe
+  uint8_t head;                       // Block being written
+  uint8_t filled;                     // Blocks holding data
+  bool active;
+
+  uint64_t lastMs;
+  int32_t lastSoil;                   // Base of the next TRACE_AUTO delta
+  int16_t lastBare;                   // Type of the last record if it had no payload, else -1
+  uint64_t lastBareDelta;             // ... its spacing
+  uint32_t repeatCount;               // ... and how often it came again since
+
+  int8_t pendingCall;                 // Loop call in progress, written if it changes something
+  int32_t pendingArg;
+  PumpSnapshot before;                // Controller state when it began
+  float lastValue[STORE_METRIC_COUNT];
+
+  uint32_t records;
+  uint32_t overwritten;
+  uint32_t dropped;
+
+  uint8_t *block(uint8_t index) const { return buffer + index * TRACE_BLOCK_SIZE; }
+  uint8_t oldest() const { return filled < TRACE_BLOCKS ? 0 : (head + 1) % TRACE_BLOCKS; }
+  void start();
+  void stop();
+  void makeRoom();
+  void startBlock(uint64_t now);
+  void write(uint8_t type, const uint8_t *payload, size_t length);
+  void writeCall(uint8_t call, int32_t arg);
+  void writePending();
+  void flushRepeat();
+
+public:
+  TraceRecorder();
+
+  void setPumpController(PumpController *controller) { pumpController = controller; }
+
+  void begin();       // After PumpStateStore::begin(), so the first keyframe has the restored counters
+  void loop();        // Follows TRACE_ENABLED
+
+  // PumpTracer
+  void onCall(uint8_t call, int32_t arg) override;
+  void onEdge(bool on) override;
+  void onReturn() override;
+
+  void recordSample(uint8_t metric, float value);
+  void recordConfig();
+
+  bool hasData() const { return filled > 0; }
+  void writeTo(Print &out);     // The download format described in TraceFormat.h
+  void toJson(JsonVariant obj) const;
+};
+
+#endif // TRACE_RECORDER_H
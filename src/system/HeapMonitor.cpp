@@ -0,0 +1,43 @@
+#include "HeapMonitor.h"
+
+HeapMonitor::HeapMonitor()
+  : freeHeap(0), largestBlock(0), minFreeHeap(0), minLargestBlock(UINT32_MAX),
+    baselineLargest(0), lastSample(0), lowWarned(false) {
+}
+
+void HeapMonitor::begin() {
+  sample();
+  baselineLargest = largestBlock;
+  Serial.printf("✅ Heap monitor: %u bytes free, largest block %u\n", freeHeap, largestBlock);
+}
+
+void HeapMonitor::loop() {
+  if (millis() - lastSample < HEAP_SAMPLE_INTERVAL) return;
+  sample();
+}
+
+void HeapMonitor::sample() {
+  lastSample = millis();
+  freeHeap = ESP.getFreeHeap();
+  largestBlock = ESP.getMaxAllocHeap();
+  minFreeHeap = ESP.getMinFreeHeap();
+  if (largestBlock < minLargestBlock) minLargestBlock = largestBlock;
+
+  if (largestBlock < HEAP_LOW_BLOCK) {
+    if (!lowWarned) {
+      Serial.printf("⚠️  Heap fragmented: largest block %u of %u free\n", largestBlock, freeHeap);
+      lowWarned = true;
+    }
+  } else {
+    lowWarned = false;
+  }
+}
+
+void HeapMonitor::toJson(JsonVariant obj) const {
+  obj["free"] = freeHeap;
+  obj["largest"] = largestBlock;
+  obj["minFree"] = minFreeHeap;
+  obj["minLargest"] = minLargestBlock;
+  obj["baseline"] = baselineLargest;
+  obj["frag"] = getFragmentation();
+}
@@ -0,0 +1,39 @@
+#ifndef HEAP_MONITOR_H
+#define HEAP_MONITOR_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "config/Config.h"
+
+// Tracks free heap, the largest allocatable block and their lows.
+// A shrinking largest block with steady free heap is fragmentation.
+class HeapMonitor {
+private:
+  uint32_t freeHeap;
+  uint32_t largestBlock;
+  uint32_t minFreeHeap;         // Lowest free heap since boot (from the allocator)
+  uint32_t minLargestBlock;     // Lowest largest block seen by sample()
+  uint32_t baselineLargest;     // Largest block right after setup()
+  unsigned long lastSample;
+  bool lowWarned;
+
+  void sample();
+
+public:
+  HeapMonitor();
+
+  void begin();
+  void loop();
+
+  // Getters
+  uint32_t getFreeHeap() const { return freeHeap; }
+  uint32_t getLargestBlock() const { return largestBlock; }
+  uint32_t getMinFreeHeap() const { return minFreeHeap; }
+  uint32_t getMinLargestBlock() const { return minLargestBlock; }
+  uint32_t getBaselineLargest() const { return baselineLargest; }
+  float getFragmentation() const { return freeHeap ? 1.0f - (float)largestBlock / freeHeap : 0; }
+
+  void toJson(JsonVariant obj) const;
+};
+
+#endif // HEAP_MONITOR_H
@@ -0,0 +1,241 @@
+#include "I2CBus.h"
+
+I2CBus::I2CBus()
+  : mux(portMUX_INITIALIZER_UNLOCKED), task(nullptr), clientCount(0), sequence(0),
+    queuePeak(0), probeResult(-1) {
+  memset(slots, 0, sizeof(slots));
+  memset(clients, 0, sizeof(clients));
+}
+
+bool I2CBus::begin() {
+  if (task) return true;
+  if (xTaskCreatePinnedToCore(taskEntry, I2C_TASK_NAME, I2C_TASK_STACK, this,
+                              I2C_TASK_PRIORITY, &task, I2C_TASK_CORE) != pdPASS) {
+    task = nullptr;
+    Serial.println("❌ I2C bus task could not be started");
+    return false;
+  }
+  Serial.printf("✅ I2C bus manager on SDA %d / SCL %d at %lu kHz\n",
+                I2C_SDA, I2C_SCL, (unsigned long)(I2C_FREQUENCY / 1000));
+  return true;
+}
+
+int8_t I2CBus::addClient(const char *name, uint8_t priority) {
+  if (clientCount >= I2C_CLIENTS_MAX) return -1;
+  portENTER_CRITICAL(&mux);
+  I2CClient &c = clients[clientCount];
+  c.name = name;
+  c.priority = priority;
+  int8_t id = clientCount++;
+  portEXIT_CRITICAL(&mux);
+  return id;
+}
+
+bool I2CBus::write(uint8_t client, uint8_t address, const uint8_t *data, uint16_t length,
+                   uint8_t delayMs) {
+  return submit(client, address, data, length, 0, delayMs, true, nullptr, nullptr);
+}
+
+bool I2CBus::read(uint8_t client, uint8_t address, const uint8_t *tx, uint16_t txLength,
+                  uint8_t rxLength, I2CCallback callback, void *context) {
+  return submit(client, address, tx, txLength, rxLength, 0, false, callback, context);
+}
+
+bool I2CBus::submit(uint8_t client, uint8_t address, const uint8_t *tx, uint16_t txLength,
+                    uint8_t rxLength, uint8_t delayMs, bool merge, I2CCallback callback,
+                    void *context) {
+  if (!task || client >= clientCount || txLength + rxLength > I2C_PAYLOAD_MAX) return false;
+  bool accepted = false;
+  bool merged = false;
+
+  portENTER_CRITICAL(&mux);
+  // Only the client's newest queued transaction can take more bytes;
+  // appending to an older one would reorder its writes
+  I2CTransaction *last = nullptr;
+  uint8_t queued = 0;
+  for (I2CTransaction &t : slots) {
+    if (t.state == I2C_SLOT_FREE) continue;
+    queued++;
+    if (t.state == I2C_SLOT_QUEUED && t.client == client &&
+        (!last || (int32_t)(t.sequence - last->sequence) > 0)) last = &t;
+  }
+  if (merge && last && last->mergeable && last->address == address && last->delayMs == 0 &&
+      last->txLength + txLength <= I2C_PAYLOAD_MAX) {
+    memcpy(last->data + last->txLength, tx, txLength);
+    last->txLength += txLength;
+    last->delayMs = delayMs;
+    clients[client].merged++;
+    accepted = merged = true;
+  } else {
+    for (I2CTransaction &t : slots) {
+      if (t.state != I2C_SLOT_FREE) continue;
+      t.client = client;
+      t.address = address;
+      t.rxLength = rxLength;
+      t.delayMs = delayMs;
+      t.mergeable = merge;
+      t.txLength = txLength;
+      t.sequence = sequence++;
+      t.queuedUs = micros();
+      t.callback = callback;
+      t.context = context;
+      if (txLength) memcpy(t.data, tx, txLength);
+      t.state = I2C_SLOT_QUEUED;
+      if (++queued > queuePeak) queuePeak = queued;
+      accepted = true;
+      break;
+    }
+    if (!accepted) clients[client].dropped++;
+  }
+  portEXIT_CRITICAL(&mux);
+
+  if (accepted && !merged) xTaskNotifyGive(task);
+  return accepted;
+}
+
+void I2CBus::onProbe(void *context, bool ok, const uint8_t *rx, uint8_t length) {
+  *(volatile int8_t *)context = ok ? 1 : 0;
+}
+
+bool I2CBus::probe(uint8_t client, uint8_t address) {
+  // Address-only write: the device ACKs or it is not there. The result lands
+  // in a member, so a late callback after the timeout stays harmless.
+  probeResult = -1;
+  if (!submit(client, address, nullptr, 0, 0, 0, false, onProbe, (void *)&probeResult)) return false;
+  unsigned long start = millis();
+  while (probeResult < 0 && millis() - start < I2C_PROBE_TIMEOUT) {
+    vTaskDelay(1);
+  }
+  return probeResult == 1;
+}
+
+void I2CBus::taskEntry(void *arg) {
+  ((I2CBus *)arg)->run();
+}
+
+void I2CBus::run() {
+  Wire.begin(I2C_SDA, I2C_SCL, I2C_FREQUENCY);
+  Wire.setTimeOut(20);
+  while (true) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    I2CTransaction *t;
+    while ((t = next()) != nullptr) {
+      execute(*t);
+    }
+  }
+}
+
+I2CTransaction *I2CBus::next() {
+  I2CTransaction *best = nullptr;
+  portENTER_CRITICAL(&mux);
+  for (I2CTransaction &t : slots) {
+    if (t.state != I2C_SLOT_QUEUED) continue;
+    if (!best) {
+      best = &t;
+      continue;
+    }
+    uint8_t p = clients[t.client].priority;
+    uint8_t bp = clients[best->client].priority;
+    if (p > bp || (p == bp && (int32_t)(t.sequence - best->sequence) < 0)) best = &t;
+  }
+  if (best) best->state = I2C_SLOT_BUSY;
+  portEXIT_CRITICAL(&mux);
+  return best;
+}
+
+void I2CBus::execute(I2CTransaction &t) {
+  uint32_t start = micros();
+  uint32_t waited = start - t.queuedUs;
+  uint8_t error = 0;
+  uint8_t received = 0;
+
+  // Long writes go out in several transactions; fine for the PCF8574 and
+  // other byte-stream devices, sensors never get near I2C_CHUNK
+  if (t.txLength || !t.rxLength) {
+    uint16_t sent = 0;
+    do {
+      uint16_t n = min((uint16_t)(t.txLength - sent), (uint16_t)I2C_CHUNK);
+      Wire.beginTransmission(t.address);
+      if (n) Wire.write(t.data + sent, n);
+      sent += n;
+      // Keep the bus for the read: repeated START instead of STOP
+      error = Wire.endTransmission(t.rxLength == 0 || sent < t.txLength);
+    } while (!error && sent < t.txLength);
+  }
+  if (!error && t.rxLength) {
+    received = Wire.requestFrom(t.address, (size_t)t.rxLength);
+    for (uint8_t i = 0; i < received; i++) {
+      t.data[t.txLength + i] = Wire.read();
+    }
+    if (received != t.rxLength) error = 4;    // Same code Wire uses for "other error"
+  }
+  uint32_t busy = micros() - start;
+
+  portENTER_CRITICAL(&mux);
+  I2CClient &c = clients[t.client];
+  c.transactions++;
+  c.bytes += t.txLength + received;
+  c.busUs += busy;
+  if (waited > c.maxWaitUs) c.maxWaitUs = waited;
+  if (error) {
+    c.errors++;
+    c.lastError = error;
+  }
+  portEXIT_CRITICAL(&mux);
+
+  if (t.callback) t.callback(t.context, !error, t.data + t.txLength, received);
+  if (t.delayMs) vTaskDelay(pdMS_TO_TICKS(t.delayMs));
+
+  portENTER_CRITICAL(&mux);
+  t.state = I2C_SLOT_FREE;
+  portEXIT_CRITICAL(&mux);
+}
+
+bool I2CBus::isBusy() const {
+  bool busy = false;
+  portENTER_CRITICAL(&mux);
+  for (const I2CTransaction &t : slots) {
+    if (t.state != I2C_SLOT_FREE) busy = true;
+  }
+  portEXIT_CRITICAL(&mux);
+  return busy;
+}
+
+uint32_t I2CBus::getErrors(uint8_t client) const {
+  return client < clientCount ? clients[client].errors : 0;
+}
+
+I2CClient I2CBus::getClient(uint8_t client) const {
+  I2CClient copy;
+  memset(&copy, 0, sizeof(copy));
+  if (client >= clientCount) return copy;
+  portENTER_CRITICAL(&mux);
+  copy = clients[client];
+  portEXIT_CRITICAL(&mux);
+  return copy;
+}
+
+void I2CBus::toJson(JsonVariant obj) const {
+  uint8_t queued = 0;
+  portENTER_CRITICAL(&mux);
+  for (const I2CTransaction &t : slots) {
+    if (t.state != I2C_SLOT_FREE) queued++;
+  }
+  portEXIT_CRITICAL(&mux);
+  obj["queued"] = queued;
+  obj["queuePeak"] = queuePeak;
+
+  for (uint8_t i = 0; i < clientCount; i++) {
+    I2CClient c = getClient(i);
+    JsonVariant client = obj["clients"][c.name];
+    client["prio"] = c.priority;
+    client["tx"] = c.transactions;
+    client["bytes"] = c.bytes;
+    client["busUs"] = c.busUs;
+    client["maxWaitUs"] = c.maxWaitUs;
+    client["merged"] = c.merged;
+    client["dropped"] = c.dropped;
+    client["errors"] = c.errors;
+    if (c.errors) client["lastError"] = c.lastError;
+  }
+}
@@ -0,0 +1,103 @@
+#ifndef I2C_BUS_H
+#define I2C_BUS_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <Wire.h>
+#include "config/Config.h"
+
+#define I2C_CLIENTS_MAX 4
+#define I2C_SLOTS 8               // Queued transactions, all clients together
+#define I2C_PAYLOAD_MAX 160       // Bytes per transaction, merged writes and read data included
+#define I2C_CHUNK 96              // Write bytes per START; Wire buffers 128
+#define I2C_FREQUENCY 100000
+#define I2C_PROBE_TIMEOUT 50      // ms, probe() is for setup only
+#define I2C_TASK_NAME "i2c"
+#define I2C_TASK_STACK 3072
+#define I2C_TASK_PRIORITY 2
+#define I2C_TASK_CORE 0           // Beside the WiFi stack; loopTask keeps core 1
+
+// Called from the bus task once a transaction finished; rx holds the bytes read.
+// Keep it short and do not submit from it.
+typedef void (*I2CCallback)(void *context, bool ok, const uint8_t *rx, uint8_t length);
+
+enum I2CSlotState {
+  I2C_SLOT_FREE,
+  I2C_SLOT_QUEUED,
+  I2C_SLOT_BUSY
+};
+
+struct I2CTransaction {
+  uint8_t state;
+  uint8_t client;
+  uint8_t address;
+  uint8_t rxLength;           // Read after the write (repeated START), 0 = write only
+  uint8_t delayMs;            // Bus held idle afterwards, for device settle times
+  bool mergeable;             // Later writes to the same device may be appended
+  uint16_t txLength;
+  uint32_t sequence;          // FIFO order within a priority
+  uint32_t queuedUs;
+  I2CCallback callback;
+  void *context;
+  uint8_t data[I2C_PAYLOAD_MAX];  // Write bytes, then the read bytes
+};
+
+struct I2CClient {
+  const char *name;
+  uint8_t priority;           // Higher goes first
+  uint8_t lastError;          // Wire endTransmission() code, 0 = none yet
+  uint32_t transactions;
+  uint32_t bytes;
+  uint32_t errors;
+  uint32_t merged;            // Writes appended to one already queued
+  uint32_t dropped;           // Submits refused, queue full
+  uint32_t maxWaitUs;         // Longest time queued before the bus picked it up
+  uint64_t busUs;             // Time on the wire, settle delays excluded
+};
+
+// Owns Wire. Clients (LCD, I2C sensors) register once and submit transactions
+// that a dedicated task runs by priority, FIFO within a priority. Submitting
+// never blocks: it copies the bytes into a free slot or fails at once. A write
+// to the same device as the client's last queued one is appended to it, so a
+// burst of small writes goes out as one transaction.
+class I2CBus {
+private:
+  mutable portMUX_TYPE mux;
+  TaskHandle_t task;
+  I2CTransaction slots[I2C_SLOTS];
+  I2CClient clients[I2C_CLIENTS_MAX];
+  uint8_t clientCount;
+  uint32_t sequence;
+  uint8_t queuePeak;
+  volatile int8_t probeResult;
+
+  static void taskEntry(void *arg);
+  static void onProbe(void *context, bool ok, const uint8_t *rx, uint8_t length);
+  void run();
+  I2CTransaction *next();
+  void execute(I2CTransaction &t);
+  bool submit(uint8_t client, uint8_t address, const uint8_t *tx, uint16_t txLength,
+              uint8_t rxLength, uint8_t delayMs, bool merge, I2CCallback callback, void *context);
+
+public:
+  I2CBus();
+
+  bool begin();       // Starts Wire on I2C_SDA/I2C_SCL and the bus task
+
+  int8_t addClient(const char *name, uint8_t priority);   // -1 when all slots are taken
+
+  bool write(uint8_t client, uint8_t address, const uint8_t *data, uint16_t length,
+             uint8_t delayMs = 0);
+  bool read(uint8_t client, uint8_t address, const uint8_t *tx, uint16_t txLength,
+            uint8_t rxLength, I2CCallback callback, void *context);
+  bool probe(uint8_t client, uint8_t address);    // Blocks up to I2C_PROBE_TIMEOUT
+
+  bool isBusy() const;                            // Anything queued or on the wire
+  uint32_t getErrors(uint8_t client) const;
+  uint8_t getClientCount() const { return clientCount; }
+  I2CClient getClient(uint8_t client) const;      // Consistent copy
+
+  void toJson(JsonVariant obj) const;
+};
+
+#endif // I2C_BUS_H
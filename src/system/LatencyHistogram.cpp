@@ -0,0 +1,73 @@
+#include "LatencyHistogram.h"
+
+LatencyHistogram::LatencyHistogram() {
+  reset();
+}
+
+void LatencyHistogram::reset() {
+  memset(buckets, 0, sizeof(buckets));
+  count = 0;
+  sum = 0;
+  maxValue = 0;
+}
+
+uint8_t LatencyHistogram::bucketFor(uint32_t us) {
+  if (us < LATENCY_MIN_US) return 0;
+
+  // Octave from the top bit, half-octave from the bit below it
+  uint8_t msb = 31 - __builtin_clz(us);
+  uint8_t upperHalf = (us >> (msb - 1)) & 1;
+  uint16_t index = 1 + (msb - 3) * 2 + upperHalf;
+  return index < LATENCY_BUCKETS ? index : LATENCY_BUCKETS - 1;
+}
+
+uint32_t LatencyHistogram::getUpperBound(uint8_t index) {
+  if (index == 0) return LATENCY_MIN_US;
+  if (index >= LATENCY_BUCKETS - 1) return UINT32_MAX;
+
+  uint8_t msb = 3 + (index - 1) / 2;
+  uint32_t base = 1UL << msb;
+  return (index - 1) % 2 ? base * 2 : base + base / 2;
+}
+
+void LatencyHistogram::record(uint32_t us) {
+  buckets[bucketFor(us)]++;
+  count++;
+  sum += us;
+  if (us > maxValue) maxValue = us;
+}
+
+uint32_t LatencyHistogram::percentile(float fraction) const {
+  if (count == 0) return 0;
+
+  uint32_t rank = (uint32_t)(fraction * count);
+  if (rank >= count) rank = count - 1;
+  uint32_t seen = 0;
+  for (uint8_t i = 0; i < LATENCY_BUCKETS; i++) {
+    seen += buckets[i];
+    if (seen > rank) return min(getUpperBound(i), maxValue);
+  }
+  return maxValue;
+}
+
+void LatencyHistogram::toJson(JsonVariant obj) const {
+  obj["n"] = count;
+  obj["mean"] = getMean();
+  obj["p50"] = percentile(0.50f);
+  obj["p90"] = percentile(0.90f);
+  obj["p99"] = percentile(0.99f);
+  obj["max"] = maxValue;
+
+  // Non-empty buckets only, keyed by upper bound in us ("inf" for the last)
+  JsonVariant counts = obj["buckets"];
+  char key[12];
+  for (uint8_t i = 0; i < LATENCY_BUCKETS; i++) {
+    if (!buckets[i]) continue;
+    if (i == LATENCY_BUCKETS - 1) {
+      strcpy(key, "inf");
+    } else {
+      snprintf(key, sizeof(key), "%lu", (unsigned long)getUpperBound(i));
+    }
+    counts[key] = buckets[i];
+  }
+}
@@ -0,0 +1,41 @@
+#ifndef LATENCY_HISTOGRAM_H
+#define LATENCY_HISTOGRAM_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+// Two buckets per power of two from 8 us up to ~134 s. Percentiles are
+// bucket upper bounds (at most half an octave high) for 200 bytes of counts.
+#define LATENCY_BUCKETS 50
+#define LATENCY_MIN_US 8
+
+class LatencyHistogram {
+private:
+  uint32_t buckets[LATENCY_BUCKETS];
+  uint32_t count;
+  uint64_t sum;
+  uint32_t maxValue;
+
+  static uint8_t bucketFor(uint32_t us);
+
+public:
+  LatencyHistogram();
+
+  void record(uint32_t us);
+  void reset();
+
+  // Upper bound of the bucket holding the given fraction of samples
+  uint32_t percentile(float fraction) const;
+
+  // Getters
+  uint32_t getCount() const { return count; }
+  uint32_t getMax() const { return maxValue; }
+  uint32_t getMean() const { return count ? (uint32_t)(sum / count) : 0; }
+  uint64_t getSum() const { return sum; }
+  uint32_t getBucket(uint8_t index) const { return buckets[index]; }
+  static uint32_t getUpperBound(uint8_t index);
+
+  void toJson(JsonVariant obj) const;
+};
+
+#endif // LATENCY_HISTOGRAM_H
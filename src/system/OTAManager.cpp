@@ -0,0 +1,412 @@
+#include "OTAManager.h"
+#include "controllers/PumpController.h"
+
+// The Arduino core marks a pending image valid during startup unless told to
+// wait; we confirm it ourselves once the health check passes
+extern "C" bool verifyRollbackLater() {
+  return true;
+}
+
+static const char *stateName(OTAState state) {
+  switch (state) {
+    case OTA_IDLE: return "idle";
+    case OTA_CONNECTING: return "connecting";
+    case OTA_RECEIVING: return "receiving";
+    case OTA_REBOOT_PENDING: return "rebooting";
+    default: return "failed";
+  }
+}
+
+OTAManager::OTAManager()
+  : state(OTA_IDLE), source(OTA_SOURCE_NONE), target(nullptr), handle(0),
+    expectedSize(0), received(0), lastLoggedPercent(0),
+    startTime(0), lastProgress(0), rebootAt(0),
+    stream(nullptr), healthPending(false), healthCheck(nullptr),
+    lastSize(0), lastDuration(0), lastThroughput(0), timeToHealthy(0),
+    pumpController(nullptr) {
+  lastError[0] = '\0';
+  pullUrl[0] = '\0';
+  pullHash[0] = '\0';
+  strcpy(lastResult, "none");
+}
+
+void OTAManager::begin() {
+  const esp_partition_t *running = esp_ota_get_running_partition();
+  esp_ota_img_states_t imageState;
+  bool bootloaderPending = esp_ota_get_state_partition(running, &imageState) == ESP_OK &&
+                           imageState == ESP_OTA_IMG_PENDING_VERIFY;
+
+  preferences.begin("ota", false);
+  bool pending = preferences.getBool("pending", false);
+  lastSize = preferences.getUInt("size", 0);
+  lastDuration = preferences.getUInt("ms", 0);
+  lastThroughput = preferences.getFloat("kbps", 0);
+  timeToHealthy = preferences.getUInt("tth", 0);
+  preferences.getString("result", lastResult, sizeof(lastResult));
+
+  uint8_t attempts = 0;
+  if (pending || bootloaderPending) {
+    attempts = preferences.getUChar("attempts", 0) + 1;
+    preferences.putUChar("attempts", attempts);
+  }
+  preferences.end();
+
+  if (pending || bootloaderPending) {
+    // A crash before the health check reboots into here again; stop after a few tries
+    if (attempts > OTA_MAX_BOOT_ATTEMPTS) {
+      rollback("boot loop");
+      return;
+    }
+    healthPending = true;
+    Serial.printf("🩺 New firmware on %s pending verification (boot %u/%d)\n",
+                  running->label, attempts, OTA_MAX_BOOT_ATTEMPTS);
+  }
+
+  const esp_partition_t *next = esp_ota_get_next_update_partition(nullptr);
+  Serial.printf("✅ OTA ready: running %s, updates go to %s\n",
+                running->label, next ? next->label : "(none)");
+}
+
+void OTAManager::loop() {
+  // Probation of a new image: confirm it or fall back to the previous slot
+  if (healthPending) {
+    if (healthCheck && healthCheck()) {
+      markHealthy();
+    } else if (millis() >= OTA_HEALTH_TIMEOUT) {
+      rollback("health check timeout");
+    }
+  }
+
+  if (state == OTA_CONNECTING) {
+    connectPull();
+  }
+
+  if (state == OTA_RECEIVING) {
+    if (source == OTA_SOURCE_URL) {
+      pullStep();
+    }
+    if (state == OTA_RECEIVING && millis() - lastProgress >= OTA_STALL_TIMEOUT) {
+      abortUpdate(source, "transfer stalled");
+    }
+  }
+
+  if (state == OTA_REBOOT_PENDING && (long)(millis() - rebootAt) >= 0) {
+    Serial.println("🔄 Restarting into new firmware");
+    delay(100);
+    ESP.restart();
+  }
+}
+
+// ========== STREAMING ==========
+
+bool OTAManager::beginUpdate(OTASource from, size_t size, const char *sha256Hex) {
+  if (isBusy()) {
+    strlcpy(lastError, "update already in progress", sizeof(lastError));
+    return false;
+  }
+  if (!parseHash(sha256Hex, expectedHash)) {
+    return fail("sha256 must be 64 hex characters");
+  }
+
+  target = esp_ota_get_next_update_partition(nullptr);
+  if (!target) {
+    return fail("no OTA partition");
+  }
+  if (size > target->size) {
+    return fail("image larger than partition");
+  }
+
+  // Nothing should water unattended while flash writes hold up the loop
+  if (pumpController && pumpController->isPumpActive()) {
+    pumpController->stop();
+  }
+
+  // Sequential writes erase sector by sector instead of the whole slot up front
+  esp_err_t err = esp_ota_begin(target, OTA_WITH_SEQUENTIAL_WRITES, &handle);
+  if (err != ESP_OK) {
+    return fail(esp_err_to_name(err));
+  }
+
+  mbedtls_sha256_init(&sha);
+  mbedtls_sha256_starts(&sha, 0);
+
+  state = OTA_RECEIVING;
+  source = from;
+  expectedSize = size;
+  received = 0;
+  lastLoggedPercent = 0;
+  startTime = millis();
+  lastProgress = startTime;
+  lastError[0] = '\0';
+
+  Serial.printf("📦 OTA started into %s (%u bytes expected)\n", target->label, (unsigned)size);
+  return true;
+}
+
+bool OTAManager::write(OTASource from, const uint8_t *data, size_t length) {
+  if (state != OTA_RECEIVING || from != source) return false;
+
+  if (expectedSize && received + length > expectedSize) {
+    abortUpdate(from, "more data than announced");
+    return false;
+  }
+
+  esp_err_t err = esp_ota_write(handle, data, length);
+  if (err != ESP_OK) {
+    abortUpdate(from, esp_err_to_name(err));
+    return false;
+  }
+  mbedtls_sha256_update(&sha, data, length);
+
+  received += length;
+  lastProgress = millis();
+
+  if (expectedSize) {
+    size_t percent = received * 100 / expectedSize;
+    if (percent >= lastLoggedPercent + 10) {
+      lastLoggedPercent = percent - percent % 10;
+      Serial.printf("📦 OTA %u%% (%u bytes)\n", (unsigned)lastLoggedPercent, (unsigned)received);
+    }
+  }
+  return true;
+}
+
+bool OTAManager::finishUpdate(OTASource from) {
+  if (state != OTA_RECEIVING || from != source) return false;
+
+  uint8_t digest[32];
+  mbedtls_sha256_finish(&sha, digest);
+  mbedtls_sha256_free(&sha);
+
+  if (source == OTA_SOURCE_URL) {
+    http.end();
+    stream = nullptr;
+  }
+
+  if (expectedSize && received != expectedSize) {
+    esp_ota_abort(handle);
+    return fail("size mismatch");
+  }
+  if (memcmp(digest, expectedHash, sizeof(digest)) != 0) {
+    esp_ota_abort(handle);
+    return fail("sha256 mismatch");
+  }
+
+  // esp_ota_end also checks the image header and its embedded checksum
+  esp_err_t err = esp_ota_end(handle);
+  if (err == ESP_OK) {
+    err = esp_ota_set_boot_partition(target);
+  }
+  if (err != ESP_OK) {
+    return fail(esp_err_to_name(err));
+  }
+
+  lastSize = received;
+  lastDuration = millis() - startTime;
+  lastThroughput = lastDuration ? received / 1.024f / lastDuration : 0;
+  timeToHealthy = 0;
+  strcpy(lastResult, "pending");
+
+  preferences.begin("ota", false);
+  preferences.putBool("pending", true);
+  preferences.putUChar("attempts", 0);
+  preferences.putString("prev", esp_ota_get_running_partition()->label);
+  preferences.putUInt("size", lastSize);
+  preferences.putUInt("ms", lastDuration);
+  preferences.putFloat("kbps", lastThroughput);
+  preferences.putUInt("tth", 0);
+  preferences.putString("result", lastResult);
+  preferences.end();
+
+  Serial.printf("✅ OTA image verified: %u bytes in %.1f s (%.1f KB/s), booting %s next\n",
+                (unsigned)lastSize, lastDuration / 1000.0f, lastThroughput, target->label);
+
+  state = OTA_REBOOT_PENDING;
+  rebootAt = millis() + OTA_REBOOT_DELAY;
+  return true;
+}
+
+void OTAManager::abortUpdate(OTASource from, const char *reason) {
+  if (state != OTA_RECEIVING || from != source) return;
+
+  esp_ota_abort(handle);
+  mbedtls_sha256_free(&sha);
+  if (source == OTA_SOURCE_URL) {
+    http.end();
+    stream = nullptr;
+  }
+  fail(reason);
+}
+
+bool OTAManager::fail(const char *reason) {
+  strlcpy(lastError, reason, sizeof(lastError));
+  state = OTA_FAILED;
+  Serial.printf("❌ OTA failed: %s\n", reason);
+  return false;
+}
+
+// ========== URL PULL ==========
+
+// Runs inside the MQTT callback and HTTP handlers, so only the arguments are
+// checked here; connectPull() opens the connection on the next loop pass
+bool OTAManager::startPull(const char *url, const char *sha256Hex) {
+  if (isBusy()) {
+    strlcpy(lastError, "update already in progress", sizeof(lastError));
+    return false;
+  }
+  if (WiFi.status() != WL_CONNECTED) {
+    return fail("WiFi not connected");
+  }
+  if (strlen(url) >= sizeof(pullUrl)) {
+    return fail("URL too long");
+  }
+  if (!parseHash(sha256Hex, expectedHash)) {
+    return fail("sha256 must be 64 hex characters");
+  }
+
+  strcpy(pullUrl, url);
+  strcpy(pullHash, sha256Hex);
+  state = OTA_CONNECTING;
+  source = OTA_SOURCE_URL;
+  expectedSize = 0;
+  received = 0;
+  lastError[0] = '\0';
+  Serial.printf("📦 OTA pull queued: %s\n", url);
+  return true;
+}
+
+// Blocks for up to OTA_HTTP_TIMEOUT (plus DNS and connect), so the pump is
+// stopped first rather than left running unchecked
+void OTAManager::connectPull() {
+  state = OTA_IDLE;     // Served now; beginUpdate() or fail() sets the next state
+  if (pumpController && pumpController->isPumpActive()) {
+    pumpController->stop();
+  }
+
+  Serial.printf("📦 OTA fetching %s\n", pullUrl);
+  http.setTimeout(OTA_HTTP_TIMEOUT);
+  if (!http.begin(pullUrl)) {
+    fail("invalid URL");
+    return;
+  }
+
+  int code = http.GET();
+  if (code != HTTP_CODE_OK) {
+    http.end();
+    char reason[OTA_ERROR_MAX];
+    snprintf(reason, sizeof(reason), "HTTP %d", code);
+    fail(reason);
+    return;
+  }
+
+  int size = http.getSize();
+  if (size <= 0) {
+    http.end();
+    fail("server sent no Content-Length");
+    return;
+  }
+
+  if (!beginUpdate(OTA_SOURCE_URL, size, pullHash)) {
+    http.end();
+    return;
+  }
+  stream = http.getStreamPtr();
+}
+
+void OTAManager::pullStep() {
+  // Bounded slice per loop pass so sensors, pump safety and MQTT keep running
+  unsigned long sliceStart = millis();
+  while (millis() - sliceStart < OTA_PULL_SLICE_MS) {
+    int available = stream->available();
+    if (available <= 0) break;
+
+    int n = stream->read(chunk, min((size_t)available, sizeof(chunk)));
+    if (n <= 0) break;
+    if (!write(OTA_SOURCE_URL, chunk, n)) return;
+
+    if (received >= expectedSize) {
+      finishUpdate(OTA_SOURCE_URL);
+      return;
+    }
+  }
+
+  if (!stream->connected() && stream->available() <= 0 && received < expectedSize) {
+    abortUpdate(OTA_SOURCE_URL, "connection closed early");
+  }
+}
+
+// ========== POST-BOOT VERIFICATION ==========
+
+void OTAManager::markHealthy() {
+  healthPending = false;
+  esp_ota_mark_app_valid_cancel_rollback();
+  timeToHealthy = millis();
+  strcpy(lastResult, "ok");
+
+  preferences.begin("ota", false);
+  preferences.putBool("pending", false);
+  preferences.putUChar("attempts", 0);
+  preferences.putUInt("tth", timeToHealthy);
+  preferences.putString("result", lastResult);
+  preferences.end();
+
+  Serial.printf("✅ New firmware healthy %lu ms after boot\n", (unsigned long)timeToHealthy);
+}
+
+void OTAManager::rollback(const char *reason) {
+  healthPending = false;
+  Serial.printf("❌ New firmware failed (%s), rolling back\n", reason);
+
+  char previous[17] = "";
+  preferences.begin("ota", false);
+  preferences.putBool("pending", false);
+  preferences.putUChar("attempts", 0);
+  preferences.putString("result", "rolled back");
+  preferences.getString("prev", previous, sizeof(previous));
+  preferences.end();
+
+  // With bootloader rollback support this does not return
+  esp_ota_mark_app_invalid_rollback_and_reboot();
+
+  // Otherwise select the previous slot explicitly
+  const esp_partition_t *slot = previous[0]
+    ? esp_partition_find_first(ESP_PARTITION_TYPE_APP, ESP_PARTITION_SUBTYPE_ANY, previous)
+    : nullptr;
+  if (slot && esp_ota_set_boot_partition(slot) == ESP_OK) {
+    delay(100);
+    ESP.restart();
+  }
+  Serial.println("⚠️  No previous firmware to roll back to, keeping this one");
+}
+
+bool OTAManager::parseHash(const char *hex, uint8_t *hash) {
+  if (!hex || strlen(hex) != 64) return false;
+  for (int i = 0; i < 32; i++) {
+    uint8_t byte = 0;
+    for (int j = 0; j < 2; j++) {
+      char c = hex[i * 2 + j];
+      uint8_t nibble;
+      if (c >= '0' && c <= '9') nibble = c - '0';
+      else if (c >= 'a' && c <= 'f') nibble = c - 'a' + 10;
+      else if (c >= 'A' && c <= 'F') nibble = c - 'A' + 10;
+      else return false;
+      byte = (byte << 4) | nibble;
+    }
+    hash[i] = byte;
+  }
+  return true;
+}
+
+void OTAManager::toJson(JsonVariant obj) const {
+  obj["state"] = stateName(state);
+  obj["running"] = esp_ota_get_running_partition()->label;
+  obj["received"] = received;
+  obj["expected"] = expectedSize;
+  obj["healthPending"] = healthPending;
+  if (lastError[0]) obj["error"] = lastError;
+  obj["last"]["result"] = lastResult;
+  obj["last"]["size"] = lastSize;
+  obj["last"]["ms"] = lastDuration;
+  obj["last"]["kbps"] = lastThroughput;
+  obj["last"]["timeToHealthy"] = timeToHealthy;
+}
@@ -0,0 +1,112 @@
+#ifndef OTA_MANAGER_H
+#define OTA_MANAGER_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <HTTPClient.h>
+#include <Preferences.h>
+#include <esp_ota_ops.h>
+#include <mbedtls/sha256.h>
+#include "config/Config.h"
+
+#define OTA_CHUNK_SIZE 1024
+#define OTA_ERROR_MAX 48
+#define OTA_URL_MAX 192
+
+// Forward declarations
+class PumpController;
+
+enum OTAState {
+  OTA_IDLE,
+  OTA_CONNECTING,       // URL pull queued; the request is sent from loop()
+  OTA_RECEIVING,        // Writing into the inactive app partition
+  OTA_REBOOT_PENDING,   // Image verified and selected, restarting shortly
+  OTA_FAILED
+};
+
+enum OTASource {
+  OTA_SOURCE_NONE,
+  OTA_SOURCE_UPLOAD,    // HTTP POST /ota (pushed by a client)
+  OTA_SOURCE_URL        // Pulled from a URL (HTTP /ota/pull or MQTT "ota" command)
+};
+
+// Streams firmware images into the inactive OTA slot chunk by chunk,
+// hashing as it goes. After the reboot the new image stays on probation
+// until the health check passes, otherwise the previous slot is restored.
+class OTAManager {
+private:
+  OTAState state;
+  OTASource source;
+  const esp_partition_t *target;
+  esp_ota_handle_t handle;
+  mbedtls_sha256_context sha;
+  uint8_t expectedHash[32];
+  size_t expectedSize;          // 0 = unknown (multipart upload)
+  size_t received;
+  size_t lastLoggedPercent;
+  unsigned long startTime;
+  unsigned long lastProgress;
+  unsigned long rebootAt;
+  char lastError[OTA_ERROR_MAX];
+
+  // URL pulls are opened and then read a slice at a time from loop()
+  char pullUrl[OTA_URL_MAX];
+  char pullHash[65];
+  HTTPClient http;
+  WiFiClient *stream;
+  uint8_t chunk[OTA_CHUNK_SIZE];
+
+  // Post-boot verification of a freshly installed image
+  bool healthPending;
+  bool (*healthCheck)();
+
+  // Metrics of the last update (persisted across the reboot)
+  uint32_t lastSize;
+  uint32_t lastDuration;        // ms
+  float lastThroughput;         // KB/s
+  uint32_t timeToHealthy;       // ms from boot to passing the health check
+  char lastResult[16];
+
+  PumpController *pumpController;
+  Preferences preferences;
+
+  bool fail(const char *reason);
+  void connectPull();
+  void pullStep();
+  void markHealthy();
+  void rollback(const char *reason);
+  static bool parseHash(const char *hex, uint8_t *hash);
+
+public:
+  OTAManager();
+
+  void begin();
+  void loop();
+  void setPumpController(PumpController *controller) { pumpController = controller; }
+  void setHealthCheck(bool (*check)()) { healthCheck = check; }
+
+  // Streaming API (used by the HTTP upload handler and URL pulls). Calls
+  // from a source that does not own the transfer in progress are ignored.
+  bool beginUpdate(OTASource from, size_t size, const char *sha256Hex);
+  bool write(OTASource from, const uint8_t *data, size_t length);
+  bool finishUpdate(OTASource from);
+  void abortUpdate(OTASource from, const char *reason);
+
+  // Checks and queues the pull; it never waits on the network
+  bool startPull(const char *url, const char *sha256Hex);
+
+  // Getters
+  OTAState getState() const { return state; }
+  bool isReceiving() const { return state == OTA_RECEIVING; }
+  bool isBusy() const {
+    return state == OTA_CONNECTING || state == OTA_RECEIVING || state == OTA_REBOOT_PENDING;
+  }
+  bool isHealthPending() const { return healthPending; }
+  const char *getLastError() const { return lastError; }
+  size_t getReceived() const { return received; }
+  size_t getExpectedSize() const { return expectedSize; }
+
+  void toJson(JsonVariant obj) const;
+};
+
+#endif // OTA_MANAGER_H
@@ -0,0 +1,154 @@
+#include "PowerManager.h"
+#include <WiFi.h>
+#include "esp_pm.h"
+#include "esp_sleep.h"
+#include "esp_timer.h"
+#include "driver/gpio.h"
+
+PowerManager::PowerManager(uint8_t wakePin)
+  : wakePin(wakePin), enabled(POWER_SAVE_ENABLED), autoSleep(false), loopTask(nullptr),
+    windowStart(0), idleInWindow(0), dutyCycle(1.0f),
+    sleepCount(0), timerWakeups(0), gpioWakeups(0),
+    lastWake(0), samplePending(false),
+    lastWakeLatency(0), maxWakeLatency(0), avgWakeLatency(0) {
+}
+
+void PowerManager::begin() {
+  // Modem sleep: the radio only wakes for DTIM beacons, association is kept.
+  // Automatic light sleep builds on it and needs tickless idle in the SDK.
+  if (WiFi.getMode() == WIFI_STA) {
+    WiFi.setSleep(WIFI_PS_MIN_MODEM);
+  }
+  if (enabled) {
+    esp_pm_config_esp32_t pm = {};
+    pm.max_freq_mhz = POWER_CPU_MAX_MHZ;
+    pm.min_freq_mhz = POWER_CPU_MIN_MHZ;
+    pm.light_sleep_enable = true;
+    esp_err_t err = esp_pm_configure(&pm);
+    autoSleep = err == ESP_OK;
+    if (!autoSleep) {
+      Serial.printf("⚠️  Automatic light sleep unavailable (%s), modem sleep only while online\n",
+                    esp_err_to_name(err));
+    }
+  }
+
+  // The wake pin ends a wait early in either mode
+  loopTask = xTaskGetCurrentTaskHandle();
+  gpio_install_isr_service(0);      // Already installed if anything used attachInterrupt()
+  gpio_isr_handler_add((gpio_num_t)wakePin, onWakePin, this);
+  gpio_intr_disable((gpio_num_t)wakePin);
+  esp_sleep_enable_gpio_wakeup();
+
+  windowStart = esp_timer_get_time();
+  Serial.printf("✅ Power manager initialized (light sleep: %s, wake pin: %d)\n",
+                !enabled ? "OFF" : autoSleep ? "automatic" : "offline only", wakePin);
+}
+
+void PowerManager::idle(unsigned long nextDeadlineMs, bool busy) {
+  rollWindow(esp_timer_get_time());
+
+  // Not worth sleeping: keep the original loop delay
+  if (!enabled || busy || nextDeadlineMs < POWER_MIN_SLEEP_MS + POWER_WAKE_GUARD_MS) {
+    delay(10);
+    return;
+  }
+
+  // Wake a little early and never sleep past the MQTT/WiFi keep-alive budget
+  unsigned long sleepMs = nextDeadlineMs - POWER_WAKE_GUARD_MS;
+  if (sleepMs > POWER_MAX_SLEEP_MS) {
+    sleepMs = POWER_MAX_SLEEP_MS;
+  }
+
+  // Forcing light sleep would stop the radio between DTIM beacons and drop
+  // the link; while online the power management does it safely
+  if (WiFi.status() == WL_CONNECTED) {
+    waitFor(sleepMs);
+  } else {
+    sleepFor(sleepMs);
+  }
+}
+
+// Level-triggered on the opposite of the current level, so it fires on the
+// next change; disabled here so the level does not retrigger
+void IRAM_ATTR PowerManager::onWakePin(void *arg) {
+  PowerManager *self = (PowerManager *)arg;
+  gpio_intr_disable((gpio_num_t)self->wakePin);
+  BaseType_t woken = pdFALSE;
+  vTaskNotifyGiveFromISR(self->loopTask, &woken);
+  if (woken) portYIELD_FROM_ISR();
+}
+
+void PowerManager::armWakePin() {
+  gpio_num_t pin = (gpio_num_t)wakePin;
+  gpio_wakeup_enable(pin, digitalRead(wakePin) ? GPIO_INTR_LOW_LEVEL : GPIO_INTR_HIGH_LEVEL);
+}
+
+// Online: block the loop task and let tickless idle put the chip to sleep
+void PowerManager::waitFor(unsigned long waitMs) {
+  gpio_num_t pin = (gpio_num_t)wakePin;
+  ulTaskNotifyTake(pdTRUE, 0);      // Drop a wake left over from a sleep by hand
+  armWakePin();
+  gpio_intr_enable(pin);
+
+  int64_t before = esp_timer_get_time();
+  bool byPin = ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(waitMs)) > 0;
+  int64_t after = esp_timer_get_time();
+
+  gpio_intr_disable(pin);
+  gpio_wakeup_disable(pin);
+  noteWake(before, after, byPin);
+}
+
+// Offline: nothing to keep alive, sleep by hand
+void PowerManager::sleepFor(unsigned long sleepMs) {
+  gpio_num_t pin = (gpio_num_t)wakePin;
+  armWakePin();
+  esp_sleep_enable_timer_wakeup((uint64_t)sleepMs * 1000ULL);
+
+  // Drain the UART so log output is not cut off by the clock gating
+  Serial.flush();
+
+  int64_t before = esp_timer_get_time();
+  esp_light_sleep_start();
+  int64_t after = esp_timer_get_time();
+
+  gpio_wakeup_disable(pin);
+  esp_sleep_disable_wakeup_source(ESP_SLEEP_WAKEUP_TIMER);
+  noteWake(before, after, esp_sleep_get_wakeup_cause() == ESP_SLEEP_WAKEUP_GPIO);
+}
+
+void PowerManager::noteWake(int64_t before, int64_t after, bool byPin) {
+  idleInWindow += after - before;
+  sleepCount++;
+  if (byPin) {
+    gpioWakeups++;
+  } else {
+    timerWakeups++;
+  }
+
+  lastWake = after;
+  samplePending = true;
+}
+
+void PowerManager::markSample() {
+  if (!samplePending) return;
+  samplePending = false;
+
+  uint32_t latency = (uint32_t)(esp_timer_get_time() - lastWake);
+  lastWakeLatency = latency;
+  if (latency > maxWakeLatency) maxWakeLatency = latency;
+  avgWakeLatency = (avgWakeLatency == 0) ? latency : avgWakeLatency * 0.9f + latency * 0.1f;
+}
+
+void PowerManager::rollWindow(int64_t now) {
+  int64_t elapsed = now - windowStart;
+  if (elapsed < (int64_t)POWER_REPORT_WINDOW_MS * 1000LL) return;
+
+  dutyCycle = 1.0f - (float)idleInWindow / (float)elapsed;
+  Serial.printf("🔋 Power: busy %.1f%% (sleeps: %lu, timer: %lu, gpio: %lu, wake->sample avg %lu us, max %lu us)\n",
+                dutyCycle * 100.0f, (unsigned long)sleepCount, (unsigned long)timerWakeups,
+                (unsigned long)gpioWakeups, (unsigned long)avgWakeLatency, (unsigned long)maxWakeLatency);
+
+  windowStart = now;
+  idleInWindow = 0;
+}
@@ -0,0 +1,63 @@
+#ifndef POWER_MANAGER_H
+#define POWER_MANAGER_H
+
+#include <Arduino.h>
+#include "config/Config.h"
+
+#define POWER_CPU_MAX_MHZ 240
+#define POWER_CPU_MIN_MHZ 80        // Lowest clock that keeps WiFi running
+
+// Idles the main loop until its next deadline. While the station is
+// connected the chip light-sleeps on its own (tickless idle, esp_pm) and the
+// WiFi driver keeps waking it for DTIM beacons, so the link and MQTT stay
+// up. Only without a network link is light sleep entered by hand.
+class PowerManager {
+private:
+  uint8_t wakePin;
+  bool enabled;
+  bool autoSleep;             // esp_pm light sleep configured
+  TaskHandle_t loopTask;      // Woken by the wake pin interrupt
+
+  // Duty cycle accounting (esp_timer microseconds)
+  int64_t windowStart;
+  int64_t idleInWindow;       // Spent in idle(); asleep for most of it
+  float dutyCycle;            // Fraction of the last window the loop was busy (0-1)
+  uint32_t sleepCount;
+  uint32_t timerWakeups;
+  uint32_t gpioWakeups;
+
+  // Wake-to-sample latency
+  int64_t lastWake;
+  bool samplePending;
+  uint32_t lastWakeLatency;   // us
+  uint32_t maxWakeLatency;    // us
+  float avgWakeLatency;       // us, exponential moving average
+
+  void sleepFor(unsigned long sleepMs);
+  void waitFor(unsigned long waitMs);
+  void armWakePin();
+  void noteWake(int64_t before, int64_t after, bool byPin);
+  void rollWindow(int64_t now);
+  static void IRAM_ATTR onWakePin(void *arg);
+
+public:
+  PowerManager(uint8_t wakePin);
+
+  void begin();
+  void idle(unsigned long nextDeadlineMs, bool busy);
+  void markSample();
+  void setEnabled(bool enable) { enabled = enable; }
+
+  // Getters
+  bool isEnabled() const { return enabled; }
+  bool isAutoSleep() const { return autoSleep; }
+  float getDutyCycle() const { return dutyCycle; }
+  uint32_t getSleepCount() const { return sleepCount; }
+  uint32_t getTimerWakeups() const { return timerWakeups; }
+  uint32_t getGpioWakeups() const { return gpioWakeups; }
+  uint32_t getLastWakeLatency() const { return lastWakeLatency; }
+  uint32_t getMaxWakeLatency() const { return maxWakeLatency; }
+  uint32_t getAvgWakeLatency() const { return (uint32_t)avgWakeLatency; }
+};
+
+#endif // POWER_MANAGER_H
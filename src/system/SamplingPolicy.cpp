@@ -0,0 +1,133 @@
+#include "SamplingPolicy.h"
+
+SamplingPolicy::SamplingPolicy()
+  : windowStart(0), busUsedUs(0), activeUsedUs(0),
+    busUse(0), energyUse(0), deferredCount(0), lastDeferred(0), budgetLogged(false) {
+  memset(channels, 0, sizeof(channels));
+}
+
+void SamplingPolicy::configure(SensorId id, const char *name, unsigned long baseMs,
+                               unsigned long minMs, unsigned long maxMs, float delta, bool onBus) {
+  Channel &c = channels[id];
+  c.name = name;
+  c.baseInterval = baseMs;
+  c.minInterval = min(minMs, baseMs);
+  c.maxInterval = max(maxMs, baseMs);
+  c.delta = delta;
+  c.onBus = onBus;
+  // Re-configuring (e.g. after a config change) restarts from the base rate
+  c.interval = baseMs;
+  c.flatCount = 0;
+}
+
+void SamplingPolicy::requestSample() {
+  for (uint8_t i = 0; i < SENSOR_COUNT; i++) {
+    channels[i].forced = true;
+  }
+}
+
+void SamplingPolicy::demand(SensorId id, unsigned long maxIntervalMs) {
+  channels[id].demand = maxIntervalMs;
+}
+
+unsigned long SamplingPolicy::effectiveInterval(const Channel &c) const {
+  if (!SAMPLING_ADAPTIVE) return c.baseInterval;
+  if (c.demand > 0 && c.demand < c.interval) return max(c.demand, c.minInterval);
+  return c.interval;
+}
+
+bool SamplingPolicy::overBudget() const {
+  return activeUsedUs >= SAMPLING_ENERGY_BUDGET * 1000UL;
+}
+
+bool SamplingPolicy::isDue(SensorId id, unsigned long now) {
+  Channel &c = channels[id];
+  if (c.forced) return true;
+  if (c.samples > 0 && now - c.lastSample < effectiveInterval(c)) return false;
+
+  // Demanded rates (pump running) are never throttled
+  if (!SAMPLING_ADAPTIVE || (c.demand > 0 && c.samples > 0)) return true;
+
+  rollWindow(now);
+  bool busFull = c.onBus && busUsedUs >= SAMPLING_BUS_BUDGET * 1000UL;
+  if (busFull || overBudget()) {
+    if (!budgetLogged) {
+      Serial.printf("⚠️  Sampling budget spent (%s), deferring %s until next window\n",
+                    busFull ? "bus" : "energy", c.name);
+      budgetLogged = true;
+    }
+    if (!c.deferred) {
+      c.deferred = true;
+      deferredCount++;
+    }
+    return false;
+  }
+  return true;
+}
+
+unsigned long SamplingPolicy::msUntilDue(SensorId id, unsigned long now) const {
+  const Channel &c = channels[id];
+  if (c.forced) return 0;
+
+  unsigned long interval = effectiveInterval(c);
+  unsigned long elapsed = now - c.lastSample;
+  unsigned long wait = (c.samples == 0 || elapsed >= interval) ? 0 : interval - elapsed;
+
+  if (SAMPLING_ADAPTIVE && c.demand == 0 &&
+      ((c.onBus && busUsedUs >= SAMPLING_BUS_BUDGET * 1000UL) || overBudget())) {
+    unsigned long windowElapsed = now - windowStart;
+    unsigned long windowLeft = windowElapsed >= SAMPLING_WINDOW ? 0 : SAMPLING_WINDOW - windowElapsed;
+    wait = max(wait, windowLeft);
+  }
+  return wait;
+}
+
+void SamplingPolicy::recordSample(SensorId id, float value, uint32_t costUs, unsigned long now) {
+  Channel &c = channels[id];
+  rollWindow(now);
+  activeUsedUs += costUs;
+  if (c.onBus) busUsedUs += costUs;
+
+  c.lastSample = now;
+  c.samples++;
+  c.forced = false;
+  c.deferred = false;
+  if (isnan(value)) return;   // Failed reads are paced by SensorHealth, not here
+
+  // Fast attack, slow decay: a moving value quarters the interval, every
+  // SAMPLING_FLAT_COUNT flat samples double it. A slow drift therefore
+  // settles at roughly one sample per `delta` of change.
+  if (c.hasValue) {
+    if (fabs(value - c.lastValue) >= c.delta) {
+      c.interval = max(c.interval / 4, c.minInterval);
+      c.flatCount = 0;
+    } else if (++c.flatCount >= SAMPLING_FLAT_COUNT) {
+      c.interval = min(c.interval * 2, c.maxInterval);
+      c.flatCount = 0;
+    }
+  }
+  c.lastValue = value;
+  c.hasValue = true;
+}
+
+void SamplingPolicy::rollWindow(unsigned long now) {
+  if (now - windowStart < SAMPLING_WINDOW) return;
+
+  busUse = busUsedUs / (SAMPLING_BUS_BUDGET * 1000.0f);
+  energyUse = activeUsedUs / (SAMPLING_ENERGY_BUDGET * 1000.0f);
+  lastDeferred = deferredCount;
+  deferredCount = 0;
+  busUsedUs = 0;
+  activeUsedUs = 0;
+  budgetLogged = false;
+  windowStart = now;
+}
+
+void SamplingPolicy::toJson(JsonVariant obj) const {
+  for (uint8_t i = 0; i < SENSOR_COUNT; i++) {
+    if (channels[i].name) obj[channels[i].name] = effectiveInterval(channels[i]);
+  }
+  obj["busUse"] = busUse;
+  obj["energyUse"] = energyUse;
+  obj["deferred"] = lastDeferred;
+}
@@ -0,0 +1,70 @@
+#ifndef SAMPLING_POLICY_H
+#define SAMPLING_POLICY_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "config/Config.h"
+#include "sensors/SensorHealth.h"
+
+// Per-sensor sample scheduling.
+// Each channel starts at its base interval, drops quickly when its value
+// moves, and doubles towards maxInterval while it stays flat. Callers can
+// demand a faster rate (e.g. soil moisture while the pump runs); demanded
+// reads ignore the budget, everything else is deferred once the bus or
+// energy budget for the current window is spent.
+class SamplingPolicy {
+private:
+  struct Channel {
+    const char *name;
+    unsigned long baseInterval;   // ms, used as-is when adaptive sampling is off
+    unsigned long minInterval;
+    unsigned long maxInterval;
+    unsigned long interval;       // current adaptive interval
+    unsigned long demand;         // slowest acceptable interval right now (0 = none)
+    float delta;                  // change between samples that counts as "moving"
+    bool onBus;                   // reads occupy the RS485 bus
+    float lastValue;
+    bool hasValue;
+    uint8_t flatCount;
+    unsigned long lastSample;
+    uint32_t samples;
+    bool forced;                  // One immediate read requested (bypasses interval and budget)
+    bool deferred;                // Due but held back by the budget (counted once until read)
+  } channels[SENSOR_COUNT];
+
+  // Budget accounting (per SAMPLING_WINDOW)
+  unsigned long windowStart;
+  uint32_t busUsedUs;
+  uint32_t activeUsedUs;
+  float busUse;                   // Fraction of the bus budget used in the last window
+  float energyUse;
+  uint32_t deferredCount;         // Reads postponed by the budget in this window
+  uint32_t lastDeferred;          // ... and in the last complete window
+  bool budgetLogged;
+
+  unsigned long effectiveInterval(const Channel &c) const;
+  bool overBudget() const;
+  void rollWindow(unsigned long now);
+
+public:
+  SamplingPolicy();
+
+  void configure(SensorId id, const char *name, unsigned long baseMs, unsigned long minMs,
+                 unsigned long maxMs, float delta, bool onBus);
+  void demand(SensorId id, unsigned long maxIntervalMs);
+  void requestSample();
+
+  bool isDue(SensorId id, unsigned long now);
+  unsigned long msUntilDue(SensorId id, unsigned long now) const;
+  void recordSample(SensorId id, float value, uint32_t costUs, unsigned long now);
+
+  // Getters
+  unsigned long getInterval(SensorId id) const { return effectiveInterval(channels[id]); }
+  float getBusUse() const { return busUse; }
+  float getEnergyUse() const { return energyUse; }
+  uint32_t getDeferred() const { return lastDeferred; }
+
+  void toJson(JsonVariant obj) const;
+};
+
+#endif // SAMPLING_POLICY_H
@@ -0,0 +1,114 @@
+#include "StatsAggregator.h"
+
+static const char *const groupNames[STATS_GROUP_COUNT] = {"soil", "ambient"};
+
+static float roundTo(float value, uint8_t decimals) {
+  float scale = powf(10, decimals);
+  return roundf(value * scale) / scale;
+}
+
+void RunningStats::reset() {
+  count = 0;
+  mean = 0;
+  m2 = 0;
+  min = 0;
+  max = 0;
+}
+
+void RunningStats::add(float value) {
+  count++;
+  float delta = value - mean;
+  mean += delta / count;
+  m2 += delta * (value - mean);
+  if (count == 1 || value < min) min = value;
+  if (count == 1 || value > max) max = value;
+}
+
+StatsAggregator::StatsAggregator()
+  : windowSlot(0), windowUtc(false), windowSeconds(0), windowStart{0, TIME_UNSYNCED} {
+  for (uint8_t i = 0; i < STORE_METRIC_COUNT; i++) {
+    stats[i].reset();
+  }
+}
+
+void StatsAggregator::begin() {
+  startWindow();
+  Serial.printf("✅ Stats aggregation: %lus windows, raw samples %s\n",
+                windowSeconds, MQTT_RAW_SAMPLES ? "on" : "off");
+}
+
+StatsGroup StatsAggregator::getGroup(uint8_t metric) {
+  switch (metric) {
+    case STORE_TEMP:
+    case STORE_HUM:
+    case STORE_AIR:
+    case STORE_TDS:
+      return STATS_AMBIENT;
+    default:
+      return STATS_SOIL;
+  }
+}
+
+const char *StatsAggregator::getGroupName(StatsGroup group) {
+  return group < STATS_GROUP_COUNT ? groupNames[group] : "";
+}
+
+int64_t StatsAggregator::currentSlot(bool &utc) const {
+  TimeStamp now = TimeService::stamp();
+  utc = now.quality != TIME_UNSYNCED;
+  int64_t ms = utc ? now.utcMs : (int64_t)TimeService::monoMs();
+  return ms / ((int64_t)windowSeconds * 1000);
+}
+
+void StatsAggregator::add(StoreMetric metric, float value) {
+  if (isnan(value)) return;
+  stats[metric].add(value);
+}
+
+bool StatsAggregator::isDue() const {
+  // A first sync mid-window switches clocks and closes the window early
+  bool utc;
+  int64_t slot = currentSlot(utc);
+  return utc != windowUtc || slot != windowSlot || windowSeconds != STATS_WINDOW;
+}
+
+unsigned long StatsAggregator::msUntilDue() const {
+  if (isDue()) return 0;
+  TimeStamp now = TimeService::stamp();
+  int64_t ms = windowUtc ? now.utcMs : (int64_t)TimeService::monoMs();
+  int64_t windowMs = (int64_t)windowSeconds * 1000;
+  return (unsigned long)(windowMs - ms % windowMs);
+}
+
+void StatsAggregator::startWindow() {
+  windowSeconds = STATS_WINDOW;
+  windowSlot = currentSlot(windowUtc);
+  windowStart = TimeService::stamp();
+  if (windowUtc) windowStart.utcMs = windowSlot * windowSeconds * 1000;
+  for (uint8_t i = 0; i < STORE_METRIC_COUNT; i++) {
+    stats[i].reset();
+  }
+}
+
+bool StatsAggregator::hasSamples(StatsGroup group) const {
+  for (uint8_t i = 0; i < STORE_METRIC_COUNT; i++) {
+    if (getGroup(i) == group && stats[i].count > 0) return true;
+  }
+  return false;
+}
+
+void StatsAggregator::toJson(StatsGroup group, JsonVariant obj) const {
+  for (uint8_t i = 0; i < STORE_METRIC_COUNT; i++) {
+    const RunningStats &s = stats[i];
+    if (getGroup(i) != group || s.count == 0) continue;
+
+    // One digit beyond what the sensor resolves keeps mean and spread meaningful
+    uint8_t decimals = SampleStore::getDecimals(i);
+    JsonVariant metric = obj[SampleStore::getMetricName(i)];
+    metric["n"] = s.count;
+    metric["mean"] = roundTo(s.mean, decimals + 1);
+    metric["sd"] = roundTo(s.stddev(), decimals + 1);
+    metric["min"] = roundTo(s.min, decimals);
+    metric["max"] = roundTo(s.max, decimals);
+  }
+}
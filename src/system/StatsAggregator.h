@@ -0,0 +1,62 @@
+#ifndef STATS_AGGREGATOR_H
+#define STATS_AGGREGATOR_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "config/Config.h"
+#include "storage/SampleStore.h"
+#include "system/TimeService.h"
+
+enum StatsGroup {
+  STATS_SOIL,       // NPK probe: moisture, soil temperature, pH, EC, N/P/K
+  STATS_AMBIENT,    // DHT, MQ-135, TDS
+  STATS_GROUP_COUNT
+};
+
+// Welford running statistics: O(1) memory, numerically stable variance
+struct RunningStats {
+  uint32_t count;
+  float mean;
+  float m2;         // Sum of squared deviations from the mean
+  float min;
+  float max;
+
+  void reset();
+  void add(float value);
+  float stddev() const { return count > 1 ? sqrtf(m2 / (count - 1)) : 0; }
+};
+
+// Per-window min/max/mean/stddev of every stored metric, updated as samples
+// land. Windows of STATS_WINDOW seconds are aligned to UTC once the clock has
+// synced (to uptime before that), so a fleet's windows line up.
+class StatsAggregator {
+private:
+  RunningStats stats[STORE_METRIC_COUNT];
+  int64_t windowSlot;         // Window number in the clock it was opened on
+  bool windowUtc;
+  unsigned long windowSeconds;
+  TimeStamp windowStart;
+
+  int64_t currentSlot(bool &utc) const;
+
+public:
+  StatsAggregator();
+
+  void begin();
+  void add(StoreMetric metric, float value);    // NaN is ignored
+
+  bool isDue() const;                           // Open window has ended
+  unsigned long msUntilDue() const;
+  void startWindow();                           // Clears all stats
+
+  bool hasSamples(StatsGroup group) const;
+  TimeStamp getWindowStart() const { return windowStart; }
+  unsigned long getWindowSeconds() const { return windowSeconds; }
+  static StatsGroup getGroup(uint8_t metric);
+  static const char *getGroupName(StatsGroup group);
+
+  // {"soil":{"n":30,"mean":45.2,"sd":0.8,"min":44,"max":47},...}
+  void toJson(StatsGroup group, JsonVariant obj) const;
+};
+
+#endif // STATS_AGGREGATOR_H
@@ -0,0 +1,101 @@
+#include "TimeService.h"
+#include <esp_sntp.h>
+#include <sys/time.h>
+
+static const char *const qualityNames[] = {"none", "sync", "hold"};
+
+TimeService *TimeService::instance = nullptr;
+
+TimeService::TimeService()
+  : anchorMonoUs(0), anchorUtcUs(0), driftPpm(0), lastOffsetMs(0), syncCount(0),
+    appliedInterval(0) {
+  instance = this;
+}
+
+void TimeService::begin() {
+  // The interval has to be in place before configTime() starts the client
+  appliedInterval = TIME_SYNC_INTERVAL;
+  sntp_set_sync_interval(appliedInterval * 1000UL);
+  configTime(0, 0, NTP_SERVER);
+  Serial.printf("🕐 SNTP started (%s, every %lus)\n", NTP_SERVER, appliedInterval);
+}
+
+void TimeService::loop() {
+  if (appliedInterval != TIME_SYNC_INTERVAL) {
+    appliedInterval = TIME_SYNC_INTERVAL;
+    sntp_set_sync_interval(appliedInterval * 1000UL);
+    sntp_restart();
+  }
+
+  // Reported once per completed sync; the system clock has just been set
+  if (sntp_get_sync_status() == SNTP_SYNC_STATUS_COMPLETED) {
+    onSync();
+  }
+}
+
+void TimeService::onSync() {
+  struct timeval tv;
+  gettimeofday(&tv, nullptr);
+  if (tv.tv_sec < TIME_VALID_AFTER) return;
+
+  int64_t mono = monoUs();
+  int64_t actual = (int64_t)tv.tv_sec * 1000000LL + tv.tv_usec;
+
+  if (syncCount > 0) {
+    // What is left after the drift correction is the error of the estimate.
+    // Steps far beyond any crystal (server change, manual set) are not learned.
+    int64_t elapsed = mono - anchorMonoUs;
+    int64_t predicted = anchorUtcUs + elapsed + (int64_t)(elapsed * (double)driftPpm * 1e-6);
+    int64_t offset = actual - predicted;
+    lastOffsetMs = (int32_t)(offset / 1000);
+    if (elapsed >= 60000000LL && llabs(offset) < elapsed / 1000) {
+      float measured = driftPpm + (float)((double)offset * 1e6 / elapsed);
+      driftPpm += TIME_DRIFT_SMOOTHING * (measured - driftPpm);
+    }
+    Serial.printf("🕐 Clock synced: offset %+ld ms, drift %.1f ppm\n", (long)lastOffsetMs, driftPpm);
+  } else {
+    Serial.printf("🕐 Clock synced: %ld UTC after %lus\n", (long)tv.tv_sec, (unsigned long)(mono / 1000000));
+  }
+
+  anchorMonoUs = mono;
+  anchorUtcUs = actual;
+  syncCount++;
+}
+
+int64_t TimeService::utcMs() const {
+  if (syncCount == 0) return 0;
+  int64_t elapsed = monoUs() - anchorMonoUs;
+  return (anchorUtcUs + elapsed + (int64_t)(elapsed * (double)driftPpm * 1e-6)) / 1000;
+}
+
+TimeQuality TimeService::getQuality() const {
+  if (syncCount == 0) return TIME_UNSYNCED;
+  int64_t age = monoUs() - anchorMonoUs;
+  return age > (int64_t)appliedInterval * TIME_HOLDOVER_SYNCS * 1000000LL ? TIME_HOLDOVER : TIME_SYNCED;
+}
+
+TimeStamp TimeService::stamp() {
+  if (!instance) return {0, TIME_UNSYNCED};
+  return instance->now();
+}
+
+const char *TimeService::getQualityName(TimeQuality quality) {
+  return quality <= TIME_HOLDOVER ? qualityNames[quality] : "";
+}
+
+void TimeService::stampJson(JsonVariant obj, const TimeStamp &stamp) {
+  obj["t"] = stamp.utcMs;
+  obj["q"] = getQualityName(stamp.quality);
+}
+
+void TimeService::toJson(JsonVariant obj) const {
+  obj["utc"] = utcMs();
+  obj["quality"] = getQualityName(getQuality());
+  obj["mono"] = monoMs() / 1000;
+  obj["syncs"] = syncCount;
+  if (syncCount > 0) {
+    obj["syncAge"] = (monoUs() - anchorMonoUs) / 1000000;
+    obj["offsetMs"] = lastOffsetMs;
+    obj["driftPpm"] = driftPpm;
+  }
+}
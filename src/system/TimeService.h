@@ -0,0 +1,66 @@
+#ifndef TIME_SERVICE_H
+#define TIME_SERVICE_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <esp_timer.h>
+#include "config/Config.h"
+
+#define TIME_VALID_AFTER 1600000000LL   // s; earlier system time means SNTP never set it
+#define TIME_HOLDOVER_SYNCS 3           // Missed sync intervals before quality drops to holdover
+#define TIME_DRIFT_SMOOTHING 0.25f      // Weight of the newest drift estimate
+
+enum TimeQuality {
+  TIME_UNSYNCED = 0,    // No SNTP reply since boot, utcMs is 0
+  TIME_SYNCED = 1,      // Last sync within TIME_HOLDOVER_SYNCS intervals
+  TIME_HOLDOVER = 2     // Free-running on the drift estimate since then
+};
+
+struct TimeStamp {
+  int64_t utcMs;        // Epoch ms, 0 while unsynced
+  TimeQuality quality;
+};
+
+// Wall clock for samples and events. The monotonic clock is the 64-bit
+// esp_timer (µs since boot, never wraps); UTC is extrapolated from the last
+// SNTP sync along it, corrected for the crystal drift measured between syncs.
+class TimeService {
+private:
+  static TimeService *instance;
+
+  int64_t anchorMonoUs;     // Monotonic time of the last sync
+  int64_t anchorUtcUs;      // UTC at that instant
+  float driftPpm;           // Local clock slow (+) or fast (-) against SNTP
+  int32_t lastOffsetMs;     // Correction applied at the last sync
+  uint32_t syncCount;
+  unsigned long appliedInterval;
+
+  void onSync();
+
+public:
+  TimeService();
+
+  void begin();
+  void loop();              // Folds in SNTP results, applies interval changes
+
+  static int64_t monoUs() { return esp_timer_get_time(); }
+  static uint64_t monoMs() { return esp_timer_get_time() / 1000; }
+
+  int64_t utcMs() const;
+  TimeQuality getQuality() const;
+  TimeStamp now() const { return {utcMs(), getQuality()}; }
+
+  // Stamp from the shared instance, for code without one injected
+  static TimeStamp stamp();
+  static const char *getQualityName(TimeQuality quality);
+
+  // Getters
+  uint32_t getSyncCount() const { return syncCount; }
+  float getDriftPpm() const { return driftPpm; }
+  int32_t getLastOffsetMs() const { return lastOffsetMs; }
+
+  static void stampJson(JsonVariant obj, const TimeStamp &stamp);
+  void toJson(JsonVariant obj) const;
+};
+
+#endif // TIME_SERVICE_H
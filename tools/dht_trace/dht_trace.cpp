@@ -0,0 +1,89 @@
+// Decodes recorded DHT pulse trains with the firmware's decoder.
+//
+//   dht_trace [--dht22] trace.txt...
+//
+// A trace is what DHTSensor::dumpTrace() prints on serial after a failed
+// read: "level,us" per line, '#' lines are comments (the header line
+// "# DHT22 ..." also selects the model). A trace may carry the result it
+// must give, "# expect: <status>" or "# expect: ok <°C> <%RH>", as the ones
+// in traces/ do. Exit status is non-zero if any trace fails to decode, or
+// does not decode to what it expects.
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "sensors/DHTDecoder.h"
+
+static bool decodeFile(const char *path, DHTModel model) {
+  FILE *file = fopen(path, "r");
+  if (!file) {
+    perror(path);
+    return false;
+  }
+
+  std::vector<DHTLevel> levels;
+  char line[128];
+  char expected[16] = "";
+  float expectedTemperature = 0, expectedHumidity = 0;
+  while (fgets(line, sizeof(line), file)) {
+    if (strncmp(line, "# expect:", 9) == 0) {
+      sscanf(line + 9, "%15s %f %f", expected, &expectedTemperature, &expectedHumidity);
+      continue;
+    }
+    if (line[0] == '#') {
+      if (strstr(line, "DHT22")) model = DHT_MODEL_22;
+      if (strstr(line, "DHT11")) model = DHT_MODEL_11;
+      continue;
+    }
+    unsigned level, us;
+    if (sscanf(line, "%u,%u", &level, &us) == 2) {
+      levels.push_back({(uint8_t)(level ? 1 : 0), (uint16_t)(us > 0xFFFF ? 0xFFFF : us)});
+    }
+  }
+  fclose(file);
+
+  DHTReading reading;
+  DHTStatus status = decodeDHTLevels(levels.data(), levels.size(), model, reading);
+  if (status == DHT_OK) {
+    printf("%s: DHT%d %zu levels -> %.1f °C, %.1f %%RH\n",
+           path, model, levels.size(), reading.temperature, reading.humidity);
+  } else {
+    printf("%s: DHT%d %zu levels -> %s\n", path, model, levels.size(), dhtStatusName(status));
+  }
+  if (!expected[0]) return status == DHT_OK;
+
+  bool matches = strcmp(expected, dhtStatusName(status)) == 0;
+  if (matches && status == DHT_OK) {
+    matches = fabsf(reading.temperature - expectedTemperature) < 0.05f &&
+              fabsf(reading.humidity - expectedHumidity) < 0.05f;
+  }
+  if (!matches) {
+    printf("%s: MISMATCH, expected %s", path, expected);
+    if (strcmp(expected, "ok") == 0) printf(" %.1f °C, %.1f %%RH", expectedTemperature, expectedHumidity);
+    printf("\n");
+  }
+  return matches;
+}
+
+int main(int argc, char **argv) {
+  DHTModel model = DHT_MODEL_11;
+  int failures = 0;
+  int files = 0;
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--dht22") == 0) {
+      model = DHT_MODEL_22;
+      continue;
+    }
+    files++;
+    if (!decodeFile(argv[i], model)) failures++;
+  }
+
+  if (files == 0) {
+    fprintf(stderr, "usage: %s [--dht22] trace.txt...\n", argv[0]);
+    return 2;
+  }
+  return failures ? 1 : 0;
+}
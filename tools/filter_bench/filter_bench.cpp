@@ -0,0 +1,324 @@
+// Host benchmark for src/filters/SensorFilter: ns per sample of the firmware's
+// Q16.16 filter chains against the same stages computed in float, and how far
+// the two outputs drift apart.
+//
+//   filter_bench [samples]
+//
+// The chains are the ones main.cpp builds. The float reference runs the same
+// algorithms (sorted window, EMA-tracked MAD) with float state. Host timings
+// only rank the two paths; the ESP32's FPU has no divide and no double
+// support, so measure on the board before reading absolute numbers.
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "filters/SensorFilter.h"
+
+struct Input {
+  float value;
+  uint32_t timeMs;
+};
+
+// ========== FLOAT REFERENCE ==========
+
+class FloatStage {
+public:
+  virtual ~FloatStage() {}
+  virtual float process(float x, uint32_t dtMs) = 0;
+};
+
+template <uint8_t N>
+class FloatWindow {
+private:
+  float ring[N];
+  float sorted[N];
+  uint8_t head;
+  uint8_t count;
+
+  uint8_t lowerBound(float value) const {
+    uint8_t lo = 0, hi = count;
+    while (lo < hi) {
+      uint8_t mid = (lo + hi) / 2;
+      if (sorted[mid] < value) lo = mid + 1; else hi = mid;
+    }
+    return lo;
+  }
+
+public:
+  FloatWindow() : head(0), count(0) {}
+
+  void push(float value) {
+    if (count == N) {
+      uint8_t pos = lowerBound(ring[head]);
+      memmove(&sorted[pos], &sorted[pos + 1], (count - pos - 1) * sizeof(float));
+      count--;
+    }
+    uint8_t pos = lowerBound(value);
+    memmove(&sorted[pos + 1], &sorted[pos], (count - pos) * sizeof(float));
+    sorted[pos] = value;
+    count++;
+    ring[head] = value;
+    head = (head + 1) % N;
+  }
+
+  float median() const { return sorted[count / 2]; }
+  uint8_t size() const { return count; }
+};
+
+template <uint8_t N>
+class FloatMedian : public FloatStage {
+private:
+  FloatWindow<N> window;
+
+public:
+  float process(float x, uint32_t) override {
+    window.push(x);
+    return window.median();
+  }
+};
+
+class FloatEma : public FloatStage {
+private:
+  float alpha;
+  float state;
+  bool primed;
+
+public:
+  explicit FloatEma(uint8_t shift) : alpha(1.0f / (1 << shift)), state(0), primed(false) {}
+
+  float process(float x, uint32_t) override {
+    if (!primed) {
+      state = x;
+      primed = true;
+    } else {
+      state += alpha * (x - state);
+    }
+    return state;
+  }
+};
+
+template <uint8_t N>
+class FloatHampel : public FloatStage {
+private:
+  FloatWindow<N> window;
+  float k;
+  float madFloor;
+  float mad;
+
+public:
+  FloatHampel(float k, float madFloor) : k(k * 1.4826f), madFloor(madFloor), mad(0) {}
+
+  float process(float x, uint32_t) override {
+    window.push(x);
+    if (window.size() < 3) return x;
+    float median = window.median();
+    float deviation = fabsf(x - median);
+    float limit = k * (mad > madFloor ? mad : madFloor);
+    mad += ((deviation > limit ? limit : deviation) - mad) * 0.125f;
+    return deviation > limit ? median : x;
+  }
+};
+
+class FloatRateLimit : public FloatStage {
+private:
+  float maxRate;
+  float state;
+  bool primed;
+
+public:
+  explicit FloatRateLimit(float maxPerSecond) : maxRate(maxPerSecond), state(0), primed(false) {}
+
+  float process(float x, uint32_t dtMs) override {
+    if (!primed) {
+      state = x;
+      primed = true;
+      return state;
+    }
+    float maxStep = maxRate * dtMs / 1000.0f;
+    float delta = x - state;
+    if (delta > maxStep) delta = maxStep;
+    if (delta < -maxStep) delta = -maxStep;
+    state += delta;
+    return state;
+  }
+};
+
+class FloatChain {
+private:
+  FloatStage *stages[FILTER_MAX_STAGES];
+  uint8_t stageCount;
+  float output;
+  bool primed;
+  uint32_t lastMs;
+
+public:
+  FloatChain() : stageCount(0), output(0), primed(false), lastMs(0) {}
+
+  FloatChain &add(FloatStage *stage) {
+    if (stageCount < FILTER_MAX_STAGES) stages[stageCount++] = stage;
+    return *this;
+  }
+
+  float apply(float value, uint32_t nowMs) {
+    if (std::isnan(value) || std::isinf(value)) return primed ? output : value;
+    uint32_t dtMs = primed ? nowMs - lastMs : 0;
+    lastMs = nowMs;
+    float x = value;
+    for (uint8_t i = 0; i < stageCount; i++) x = stages[i]->process(x, dtMs);
+    output = x;
+    primed = true;
+    return output;
+  }
+};
+
+// ========== CHANNELS ==========
+
+// Slow drift plus noise, a 1 % rate of spikes and 0.1 % NaN reads, sampled
+// every period ms with scheduling jitter
+static std::vector<Input> generate(size_t count, float base, float swing, float noise, float spike,
+                                   uint32_t periodMs, uint32_t seed) {
+  std::mt19937 rng(seed);
+  std::normal_distribution<float> gauss(0.0f, noise);
+  std::uniform_real_distribution<float> uniform(0.0f, 1.0f);
+  std::uniform_int_distribution<int> jitter(-3, 3);
+  std::vector<Input> inputs(count);
+  for (size_t i = 0; i < count; i++) {
+    float phase = i * 6.283f / 43200.0f;
+    float value = base + swing * sinf(phase) + gauss(rng);
+    float roll = uniform(rng);
+    if (roll < 0.001f) value = NAN;
+    else if (roll < 0.011f) value += uniform(rng) < 0.5f ? -spike : spike;
+    inputs[i] = {value, (uint32_t)(i * periodMs + jitter(rng))};
+  }
+  return inputs;
+}
+
+template <typename F>
+static double bestSeconds(F &&run) {
+  double best = 1e9;
+  for (int i = 0; i < 5; i++) {
+    auto start = std::chrono::steady_clock::now();
+    run();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (seconds < best) best = seconds;
+  }
+  return best;
+}
+
+struct Result {
+  double fixedNs;
+  double floatNs;
+  float maxDiff;
+};
+
+// Stages keep state, so every timed pass builds fresh chains
+template <typename MakeFixed, typename MakeFloat>
+static Result run(const std::vector<Input> &inputs, MakeFixed makeFixed, MakeFloat makeFloat) {
+  std::vector<float> fixedOut(inputs.size()), floatOut(inputs.size());
+  double fixedSeconds = bestSeconds([&] {
+    makeFixed([&](FilterChain &chain) {
+      for (size_t i = 0; i < inputs.size(); i++) fixedOut[i] = chain.apply(inputs[i].value, inputs[i].timeMs);
+    });
+  });
+  double floatSeconds = bestSeconds([&] {
+    makeFloat([&](FloatChain &chain) {
+      for (size_t i = 0; i < inputs.size(); i++) floatOut[i] = chain.apply(inputs[i].value, inputs[i].timeMs);
+    });
+  });
+
+  float maxDiff = 0;
+  for (size_t i = 0; i < inputs.size(); i++) {
+    if (std::isnan(fixedOut[i]) || std::isnan(floatOut[i])) continue;
+    maxDiff = fmaxf(maxDiff, fabsf(fixedOut[i] - floatOut[i]));
+  }
+  return {fixedSeconds * 1e9 / inputs.size(), floatSeconds * 1e9 / inputs.size(), maxDiff};
+}
+
+static void print(const char *name, const char *stages, const Result &result) {
+  printf("%-6s %-22s %9.1f %9.1f %7.2fx %10.5f\n", name, stages, result.fixedNs, result.floatNs,
+         result.floatNs / result.fixedNs, result.maxDiff);
+}
+
+int main(int argc, char **argv) {
+  size_t count = argc > 1 ? (size_t)strtoul(argv[1], nullptr, 10) : 1000000;
+  if (count == 0) {
+    fprintf(stderr, "usage: %s [samples]\n", argv[0]);
+    return 2;
+  }
+
+  printf("%-6s %-22s %9s %9s %8s %10s\n", "chain", "stages", "fixed ns", "float ns", "speedup", "max diff");
+
+  // Same stage parameters as main.cpp
+  std::vector<Input> temp = generate(count, 24.0f, 6.0f, 0.1f, 8.0f, 5000, 1);
+  print("temp", "Hampel(5) > EMA(1/4)", run(temp,
+    [](auto body) {
+      HampelFilter<5> hampel(3.0f, 0.2f);
+      EmaFilter ema(2);
+      FilterChain chain;
+      chain.add(&hampel).add(&ema);
+      body(chain);
+    },
+    [](auto body) {
+      FloatHampel<5> hampel(3.0f, 0.2f);
+      FloatEma ema(2);
+      FloatChain chain;
+      chain.add(&hampel).add(&ema);
+      body(chain);
+    }));
+
+  std::vector<Input> soil = generate(count, 45.0f, 15.0f, 0.4f, 30.0f, 2000, 2);
+  print("soil", "Hampel(5) > rate 5/s", run(soil,
+    [](auto body) {
+      HampelFilter<5> hampel(3.0f, 1.0f);
+      RateLimitFilter rate(5.0f);
+      FilterChain chain;
+      chain.add(&hampel).add(&rate);
+      body(chain);
+    },
+    [](auto body) {
+      FloatHampel<5> hampel(3.0f, 1.0f);
+      FloatRateLimit rate(5.0f);
+      FloatChain chain;
+      chain.add(&hampel).add(&rate);
+      body(chain);
+    }));
+
+  std::vector<Input> ph = generate(count, 6.5f, 0.3f, 0.03f, 2.0f, 2000, 3);
+  print("ph", "Hampel(5)", run(ph,
+    [](auto body) {
+      HampelFilter<5> hampel(3.0f, 0.1f);
+      FilterChain chain;
+      chain.add(&hampel);
+      body(chain);
+    },
+    [](auto body) {
+      FloatHampel<5> hampel(3.0f, 0.1f);
+      FloatChain chain;
+      chain.add(&hampel);
+      body(chain);
+    }));
+
+  std::vector<Input> air = generate(count, 1200.0f, 300.0f, 15.0f, 900.0f, 5000, 4);
+  print("air", "Median(5) > EMA(1/8)", run(air,
+    [](auto body) {
+      MedianFilter<5> median;
+      EmaFilter ema(3);
+      FilterChain chain;
+      chain.add(&median).add(&ema);
+      body(chain);
+    },
+    [](auto body) {
+      FloatMedian<5> median;
+      FloatEma ema(3);
+      FloatChain chain;
+      chain.add(&median).add(&ema);
+      body(chain);
+    }));
+
+  return 0;
+}
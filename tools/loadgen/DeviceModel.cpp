@@ -0,0 +1,293 @@
+#include "DeviceModel.h"
+#include <math.h>
+#include <stdio.h>
+#include <algorithm>
+
+// Firmware defaults (Config.cpp)
+#define MOISTURE_THRESHOLD 30
+#define MOISTURE_STOP 70
+#define MAX_PUMP_TIME 60
+#define DRY_COUNT_REQUIRED 2
+#define SENSOR_READ_INTERVAL 2.0    // s between soil samples
+#define MQ135_CLEAN_AIR_VALUE 500
+#define MQ135_POLLUTED_THRESHOLD 1500
+
+// Sensor periods in soil samples: DHT 10 s, MQ-135/TDS 30 s, NPK 60 s
+#define DHT_EVERY 5
+#define ANALOG_EVERY 15
+#define NPK_EVERY 30
+
+// SampleStore's metrics in order: name, decimals, stats group
+static const struct {
+  const char *name;
+  uint8_t decimals;
+  StatsGroup group;
+} metrics[MODEL_METRIC_COUNT] = {
+  {"soil",     0, STATS_SOIL},
+  {"temp",     1, STATS_AMBIENT},
+  {"hum",      1, STATS_AMBIENT},
+  {"air",      0, STATS_AMBIENT},
+  {"tds",      0, STATS_AMBIENT},
+  {"ph",       1, STATS_SOIL},
+  {"ec",       3, STATS_SOIL},
+  {"soilTemp", 1, STATS_SOIL},
+  {"n",        0, STATS_SOIL},
+  {"p",        0, STATS_SOIL},
+  {"k",        0, STATS_SOIL},
+};
+
+static double clampTo(double value, double low, double high) {
+  return std::max(low, std::min(high, value));
+}
+
+static double roundTo(double value, uint8_t decimals) {
+  double scale = pow(10, decimals);
+  return round(value * scale) / scale;
+}
+
+void WindowStats::reset() {
+  count = 0;
+  mean = 0;
+  m2 = 0;
+  min = 0;
+  max = 0;
+}
+
+void WindowStats::add(double value) {
+  count++;
+  double delta = value - mean;
+  mean += delta / count;
+  m2 += delta * (value - mean);
+  if (count == 1 || value < min) min = value;
+  if (count == 1 || value > max) max = value;
+}
+
+DeviceModel::DeviceModel(uint32_t seed)
+  : rng(seed), tempNoise(0), pump(false), pumpRun(0), pumpLimit(MAX_PUMP_TIME),
+    dryCount(0), count(0), wateringTime(0), onToday(0), cyclesToday(0), dayTime(0),
+    overshoot(0), sinceSample(0), clockMs(0), lastOnMs(0), lastOffMs(0), samples(0) {
+  std::uniform_real_distribution<double> uniform(0, 1);
+  dryRate = 1.0 + 3.0 * uniform(rng);
+  pumpGain = 0.4 + 0.8 * uniform(rng);
+  tempOffset = -3.0 + 6.0 * uniform(rng);
+  phase = -1800 + 3600 * uniform(rng);
+
+  soil = 35 + 40 * uniform(rng);
+  temp = 25 + tempOffset;
+  airRaw = 700 + 500 * uniform(rng);
+  tds = 300 + 600 * uniform(rng);
+  n = 20 + 40 * uniform(rng);
+  p = 10 + 30 * uniform(rng);
+  k = 50 + 100 * uniform(rng);
+  ph = 5.8 + 1.2 * uniform(rng);
+  ec = 0.3 + 0.9 * uniform(rng);
+  soilTemp = temp - 2;
+  startWindow();
+}
+
+double DeviceModel::noise(double sigma) {
+  std::normal_distribution<double> normal(0, sigma);
+  return normal(rng);
+}
+
+void DeviceModel::step(double timeOfDay, double dt, int64_t utcMs) {
+  clockMs = utcMs;
+  if (dt <= 0) return;
+
+  // DHT: diurnal sine peaking mid-afternoon plus AR(1) noise
+  double hours = fmod(timeOfDay + phase, 86400.0) / 3600.0;
+  tempNoise = tempNoise * exp(-dt / 600.0) + noise(0.05 * sqrt(dt));
+  temp = 24 + tempOffset + 6 * sin(2 * M_PI * (hours - 9) / 24) + tempNoise;
+  soilTemp += (temp - 2 - soilTemp) * (1 - exp(-dt / 3600.0));
+
+  // Soil dries faster when hot, rises while watering
+  if (pump) {
+    soil += pumpGain * dt;
+    pumpRun += dt;
+    onToday += dt;
+  } else {
+    double heat = clampTo((temp - 10) / 15, 0.2, 2.0);
+    soil -= dryRate * heat * dt / 3600;
+  }
+  soil = clampTo(soil, 0, 100);
+
+  // Slow mean-reverting drift for the rest
+  double revert = 1 - exp(-dt / 1800.0);
+  airRaw += (950 - airRaw) * revert + noise(6 * sqrt(dt));
+  airRaw = clampTo(airRaw, 200, 4095);
+  tds += (600 - tds) * revert * 0.1 + noise(2 * sqrt(dt));
+  tds = clampTo(tds, 0, 2000);
+  ph = clampTo(ph + noise(0.002 * sqrt(dt)), 4, 9);
+  ec = clampTo(ec + noise(0.002 * sqrt(dt)), 0.05, 3);
+  n = clampTo(n + noise(0.02 * sqrt(dt)) - (pump ? 0.01 * dt : 0), 0, 200);
+  p = clampTo(p + noise(0.01 * sqrt(dt)), 0, 200);
+  k = clampTo(k + noise(0.03 * sqrt(dt)), 0, 400);
+
+  dayTime += dt;
+  if (dayTime >= 86400) {
+    dayTime = 0;
+    onToday = 0;
+    cyclesToday = 0;
+  }
+
+  sinceSample += dt;
+  while (sinceSample >= SENSOR_READ_INTERVAL) {
+    sinceSample -= SENSOR_READ_INTERVAL;
+    sampleSoil();
+    addSamples();
+  }
+}
+
+void DeviceModel::sampleSoil() {
+  // Same decisions as PumpController::update() in bang-bang mode
+  if (pump) {
+    if (soil >= MOISTURE_STOP || pumpRun >= pumpLimit) stopPump();
+    return;
+  }
+
+  dryCount = soil <= MOISTURE_THRESHOLD ? dryCount + 1 : 0;
+  if (dryCount >= DRY_COUNT_REQUIRED) startPump(MAX_PUMP_TIME);
+}
+
+// Feeds the window the readings the firmware would have taken by now
+void DeviceModel::addSamples() {
+  samples++;
+  stats[0].add(round(soil));
+  if (samples % DHT_EVERY == 0) {
+    stats[1].add(roundTo(temp, 1));
+    stats[2].add(humidity());
+  }
+  if (samples % ANALOG_EVERY == 0) {
+    stats[3].add(airQuality());
+    stats[4].add((int)tds);
+  }
+  if (samples % NPK_EVERY == 0) {
+    stats[5].add(roundTo(ph, 1));
+    stats[6].add(roundTo(ec, 3));
+    stats[7].add(roundTo(soilTemp, 1));
+    stats[8].add((int)n);
+    stats[9].add((int)p);
+    stats[10].add((int)k);
+  }
+}
+
+void DeviceModel::startWindow() {
+  for (WindowStats &s : stats) {
+    s.reset();
+  }
+}
+
+int DeviceModel::airQuality() const {
+  return (int)clampTo((airRaw - MQ135_CLEAN_AIR_VALUE) * 100 /
+                      (MQ135_POLLUTED_THRESHOLD - MQ135_CLEAN_AIR_VALUE), 0, 100);
+}
+
+double DeviceModel::humidity() const {
+  return round(clampTo(88 - 1.8 * (temp - 18), 20, 99) * 10) / 10;
+}
+
+void DeviceModel::startPump(int duration) {
+  if (!pump) {
+    count++;
+    cyclesToday++;
+    pumpRun = 0;
+    lastOnMs = clockMs;
+  }
+  pump = true;
+  pumpLimit = std::min(duration, MAX_PUMP_TIME);
+  dryCount = 0;
+}
+
+void DeviceModel::stopPump() {
+  if (!pump) return;
+  pump = false;
+  wateringTime += pumpRun;
+  lastOffMs = clockMs;
+
+  // Water still soaking in after the stop
+  overshoot = (int)std::max(0.0, round(2 + noise(1.5)));
+  soil = clampTo(soil + overshoot * 0.5, 0, 100);
+}
+
+size_t DeviceModel::sensorJson(char *buffer, size_t size, const char *device, int64_t utcMs, uint32_t uptime,
+                               PayloadMode mode) const {
+  int air = airQuality();
+  unsigned long npkInterval = pump ? 500 : (soil < MOISTURE_THRESHOLD + 10 ? 5000 : 60000);
+
+  int length = snprintf(buffer, size,
+    "{\"device\":\"%s\",\"time\":%lld,\"tq\":\"sync\",\"soil\":%d,\"soilFresh\":true,\"temp\":%.2f,\"hum\":%.1f,"
+    "\"air\":%d,\"airRaw\":%d,\"airGood\":%s,\"ppm\":%d,\"pump\":%s,\"count\":%d,\"wtime\":%lu,"
+    "\"uptime\":%u,\"tdsRaw\":%d,\"tds\":%d,"
+    "\"irr\":{\"mode\":\"bang\",\"on24h\":%u,\"cycles24h\":%u,\"overshoot\":%d,\"dryRate\":%.2f,"
+    "\"lastOn\":{\"t\":%lld,\"q\":\"%s\"},\"lastOff\":{\"t\":%lld,\"q\":\"%s\"}},"
+    "\"power\":{\"duty\":%.3f,\"wakeLat\":%u},"
+    "\"sampling\":{\"npk\":%lu,\"dht\":%d,\"mq135\":%d,\"tds\":%d,\"busUse\":%.3f,\"energyUse\":%.3f,\"deferred\":0}",
+    device, (long long)utcMs, (int)round(soil), temp, humidity(),
+    air, (int)airRaw, airRaw < MQ135_POLLUTED_THRESHOLD ? "true" : "false", (int)(10 + airRaw * 0.4),
+    pump ? "true" : "false", count, (unsigned long)wateringTime,
+    uptime, (int)(tds * 2.2), (int)tds,
+    (unsigned)onToday, cyclesToday, overshoot, pump ? 0.0 : dryRate,
+    (long long)lastOnMs, lastOnMs ? "sync" : "none", (long long)lastOffMs, lastOffMs ? "sync" : "none",
+    pump ? 1.0 : 0.35, pump ? 0u : 850u,
+    npkInterval, 10000, 30000, 30000, pump ? 0.42 : 0.08, pump ? 0.9 : 0.2);
+  if (length < 0 || (size_t)length >= size) return 0;
+
+  if (mode == PAYLOAD_FULL) {
+    length += snprintf(buffer + length, size - length,
+      ",\"npk\":{\"n\":%d,\"p\":%d,\"k\":%d,\"ph\":%.1f,\"ec\":%.3f,\"soilTemp\":%.1f,\"age\":%d}",
+      (int)n, (int)p, (int)k, ph, ec, soilTemp, pump ? 0 : 1);
+  }
+  if ((size_t)length + 2 > size) return 0;
+  buffer[length++] = '}';
+  buffer[length] = '\0';
+  return length;
+}
+
+// Same document as the firmware's publishStats() loop:
+// {"device":...,"time":<window start>,"tq":"sync","win":60,"group":"soil","m":{"soil":{"n":30,...}}}
+size_t DeviceModel::statsJson(char *buffer, size_t size, const char *device, int64_t windowStartMs,
+                              uint32_t windowSeconds, StatsGroup group) const {
+  int length = snprintf(buffer, size, "{\"device\":\"%s\",\"time\":%lld,\"tq\":\"sync\",\"win\":%u,"
+                        "\"group\":\"%s\",\"m\":{", device, (long long)windowStartMs, windowSeconds,
+                        group == STATS_SOIL ? "soil" : "ambient");
+  bool any = false;
+  for (int i = 0; i < MODEL_METRIC_COUNT && length > 0 && (size_t)length < size; i++) {
+    const WindowStats &s = stats[i];
+    if (metrics[i].group != group || s.count == 0) continue;
+    uint8_t decimals = metrics[i].decimals;
+    double sd = s.count > 1 ? sqrt(s.m2 / (s.count - 1)) : 0;
+    length += snprintf(buffer + length, size - length,
+      "%s\"%s\":{\"n\":%u,\"mean\":%.*f,\"sd\":%.*f,\"min\":%.*f,\"max\":%.*f}",
+      any ? "," : "", metrics[i].name, s.count, decimals + 1, roundTo(s.mean, decimals + 1),
+      decimals + 1, roundTo(sd, decimals + 1), decimals, s.min, decimals, s.max);
+    any = true;
+  }
+  if (!any || length < 0 || (size_t)length + 3 > size) return 0;
+  buffer[length++] = '}';
+  buffer[length++] = '}';
+  buffer[length] = '\0';
+  return length;
+}
+
+size_t DeviceModel::healthJson(char *buffer, size_t size, const char *device, int64_t utcMs, uint32_t uptime) {
+  static const char *const sensors[] = {"npk", "dht", "mq135", "tds"};
+  static const unsigned latency[] = {48000, 4200, 110, 110};
+
+  int length = snprintf(buffer, size, "{\"device\":\"%s\",\"time\":%lld,\"tq\":\"sync\",\"uptime\":%u,\"health\":{",
+                        device, (long long)utcMs, uptime);
+  for (int i = 0; i < 4 && length > 0 && (size_t)length < size; i++) {
+    unsigned lat = (unsigned)(latency[i] * (1 + std::abs(noise(0.1))));
+    length += snprintf(buffer + length, size - length,
+      "%s\"%s\":{\"state\":\"ok\",\"rate\":1,\"lat\":%u,\"latMax\":%u,\"fails\":0,\"nan\":0,"
+      "\"stuck\":false,\"stale\":false,\"age\":%d,\"retryIn\":0}",
+      i ? "," : "", sensors[i], lat, lat * 2, i == 0 ? 1 : 2);
+  }
+  if (length < 0 || (size_t)length >= size) return 0;
+
+  uint32_t free = 180000 + (uint32_t)std::abs(noise(4000));
+  length += snprintf(buffer + length, size - length,
+    "},\"heap\":{\"free\":%u,\"largest\":%u,\"minFree\":%u,\"minLargest\":%u,\"baseline\":%u,\"frag\":%.3f}}",
+    free, 110592u, 171000u, 106496u, 110592u, 1 - 110592.0 / free);
+  if ((size_t)length >= size) return 0;
+  return length;
+}
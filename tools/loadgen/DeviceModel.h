@@ -0,0 +1,103 @@
+#ifndef DEVICE_MODEL_H
+#define DEVICE_MODEL_H
+
+// Simulated AgroHygra node: soil that dries with temperature and rises
+// while the pump runs, a diurnal DHT curve, drifting MQ-135/TDS/NPK
+// readings, and the firmware's bang-bang irrigation logic on top.
+// Payloads follow publishSensorData() / publishHealth() and the per-window
+// ~/stats aggregates field for field.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <random>
+
+enum PayloadMode {
+  PAYLOAD_FULL,       // NPK sensor present (the usual field install)
+  PAYLOAD_BASIC       // No NPK block, as published while the sensor is unavailable
+};
+
+// StatsAggregator's groups: one ~/stats message each per window
+enum StatsGroup {
+  STATS_SOIL,
+  STATS_AMBIENT,
+  STATS_GROUP_COUNT
+};
+
+#define MODEL_METRIC_COUNT 11     // STORE_METRIC_COUNT
+
+// Welford running statistics, as RunningStats in the firmware
+struct WindowStats {
+  uint32_t count;
+  double mean;
+  double m2;
+  double min;
+  double max;
+
+  void reset();
+  void add(double value);
+};
+
+class DeviceModel {
+private:
+  std::mt19937 rng;
+
+  // Per-device character
+  double dryRate;         // %/h at 25 °C
+  double pumpGain;        // %/s while the pump runs
+  double tempOffset;
+  double phase;           // s added to the shared time of day
+
+  // Physical state
+  double soil;
+  double temp;
+  double tempNoise;
+  double airRaw;
+  double tds;
+  double n, p, k, ph, ec, soilTemp;
+
+  // Firmware state mirrored from PumpController
+  bool pump;
+  double pumpRun;         // s since the pump started
+  double pumpLimit;       // s, MAX_PUMP_TIME or a command's duration
+  int dryCount;
+  int count;
+  double wateringTime;    // s
+  double onToday;         // s, reset every 24 h of simulated time
+  uint32_t cyclesToday;
+  double dayTime;         // s into the current 24 h accounting window
+  int overshoot;
+  double sinceSample;     // s since the last soil sample
+  int64_t clockMs;        // Wall clock at the last step, stamps pump edges
+  int64_t lastOnMs;
+  int64_t lastOffMs;
+
+  // Open stats window
+  WindowStats stats[MODEL_METRIC_COUNT];
+  uint32_t samples;       // Soil samples taken, paces the slower sensors
+
+  double noise(double sigma);
+  void sampleSoil();
+  void addSamples();
+  int airQuality() const;
+  double humidity() const;
+
+public:
+  explicit DeviceModel(uint32_t seed);
+
+  // Advances the simulation by dt seconds; timeOfDay drives the diurnal curves
+  void step(double timeOfDay, double dt, int64_t utcMs);
+
+  void startPump(int duration);
+  void stopPump();
+  bool isPumpActive() const { return pump; }
+
+  size_t sensorJson(char *buffer, size_t size, const char *device, int64_t utcMs, uint32_t uptime,
+                    PayloadMode mode) const;
+  // One group's aggregates for the open window; 0 if it has no samples
+  size_t statsJson(char *buffer, size_t size, const char *device, int64_t windowStartMs,
+                   uint32_t windowSeconds, StatsGroup group) const;
+  void startWindow();
+  size_t healthJson(char *buffer, size_t size, const char *device, int64_t utcMs, uint32_t uptime);
+};
+
+#endif // DEVICE_MODEL_H
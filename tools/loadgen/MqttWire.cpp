@@ -0,0 +1,149 @@
+#include "MqttWire.h"
+#include <string.h>
+
+static void putLength(std::string &out, size_t length) {
+  do {
+    uint8_t digit = length % 128;
+    length /= 128;
+    if (length > 0) digit |= 0x80;
+    out.push_back((char)digit);
+  } while (length > 0);
+}
+
+static void putU16(std::string &out, uint16_t value) {
+  out.push_back((char)(value >> 8));
+  out.push_back((char)(value & 0xFF));
+}
+
+static void putString(std::string &out, const char *text, size_t length) {
+  putU16(out, (uint16_t)length);
+  out.append(text, length);
+}
+
+static void putString(std::string &out, const char *text) {
+  putString(out, text, strlen(text));
+}
+
+void mqttConnect(std::string &out, const char *clientId, const char *user, const char *password,
+                 uint16_t keepAlive, const MqttWill *will) {
+  std::string body;
+  putString(body, "MQTT");
+  body.push_back(4);                            // Protocol level 3.1.1
+
+  uint8_t flags = 0x02;                         // Clean session, like PubSubClient
+  if (will) flags |= 0x04 | ((will->qos & 0x03) << 3) | (will->retain ? 0x20 : 0);
+  if (user && *user) flags |= 0x80;
+  if (user && *user && password && *password) flags |= 0x40;
+  body.push_back((char)flags);
+  putU16(body, keepAlive);
+
+  putString(body, clientId);
+  if (will) {
+    putString(body, will->topic);
+    putString(body, will->message);
+  }
+  if (flags & 0x80) putString(body, user);
+  if (flags & 0x40) putString(body, password);
+
+  out.push_back((char)(MQTT_CONNECT << 4));
+  putLength(out, body.size());
+  out += body;
+}
+
+void mqttSubscribe(std::string &out, uint16_t packetId, const char *topic) {
+  size_t topicLength = strlen(topic);
+  out.push_back((char)((MQTT_SUBSCRIBE << 4) | 0x02));
+  putLength(out, 2 + 2 + topicLength + 1);
+  putU16(out, packetId);
+  putString(out, topic, topicLength);
+  out.push_back(0);                             // QoS 0
+}
+
+void mqttPublish(std::string &out, const char *topic, const char *payload, size_t length, bool retain) {
+  size_t topicLength = strlen(topic);
+  out.push_back((char)((MQTT_PUBLISH << 4) | (retain ? 0x01 : 0)));
+  putLength(out, 2 + topicLength + length);
+  putString(out, topic, topicLength);
+  out.append(payload, length);
+}
+
+void mqttPing(std::string &out) {
+  out.push_back((char)(MQTT_PINGREQ << 4));
+  out.push_back(0);
+}
+
+void mqttDisconnect(std::string &out) {
+  out.push_back((char)(MQTT_DISCONNECT << 4));
+  out.push_back(0);
+}
+
+bool MqttMessage::topicIs(const char *name) const {
+  return strlen(name) == topicLength && memcmp(topic, name, topicLength) == 0;
+}
+
+bool MqttMessage::topicIs(const char *prefix, const char *suffix) const {
+  size_t prefixLength = strlen(prefix);
+  size_t suffixLength = strlen(suffix);
+  return prefixLength + suffixLength == topicLength && memcmp(topic, prefix, prefixLength) == 0 &&
+         memcmp(topic + prefixLength, suffix, suffixLength) == 0;
+}
+
+bool MqttMessage::topicEndsWith(const char *suffix) const {
+  size_t suffixLength = strlen(suffix);
+  return suffixLength <= topicLength && memcmp(topic + topicLength - suffixLength, suffix, suffixLength) == 0;
+}
+
+bool mqttParsePublish(const MqttPacket &packet, MqttMessage &message) {
+  if (packet.type != MQTT_PUBLISH || packet.length < 2) return false;
+
+  size_t topicLength = (packet.body[0] << 8) | packet.body[1];
+  size_t offset = 2 + topicLength;
+  if ((packet.flags & 0x06) != 0) offset += 2;  // Packet id for QoS 1/2
+  if (offset > packet.length) return false;
+
+  message.topic = (const char *)packet.body + 2;
+  message.topicLength = topicLength;
+  message.payload = (const char *)packet.body + offset;
+  message.payloadLength = packet.length - offset;
+  message.retained = (packet.flags & 0x01) != 0;
+  return true;
+}
+
+void MqttReader::feed(const uint8_t *data, size_t length) {
+  // Drop consumed packets before growing the buffer
+  if (position > 0 && position == buffer.size()) {
+    buffer.clear();
+    position = 0;
+  } else if (position > 4096 && position * 2 > buffer.size()) {
+    buffer.erase(0, position);
+    position = 0;
+  }
+  buffer.append((const char *)data, length);
+}
+
+bool MqttReader::next(MqttPacket &packet) {
+  size_t available = buffer.size() - position;
+  if (malformed || available < 2) return false;
+
+  const uint8_t *p = (const uint8_t *)buffer.data() + position;
+  size_t length = 0;
+  size_t header = 1;
+  for (int shift = 0; ; shift += 7) {
+    if (header > 4) {
+      malformed = true;
+      return false;
+    }
+    if (header >= available) return false;
+    uint8_t digit = p[header++];
+    length |= (size_t)(digit & 0x7F) << shift;
+    if (!(digit & 0x80)) break;
+  }
+  if (available < header + length) return false;
+
+  packet.type = p[0] >> 4;
+  packet.flags = p[0] & 0x0F;
+  packet.body = p + header;
+  packet.length = length;
+  position += header + length;
+  return true;
+}
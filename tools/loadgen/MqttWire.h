@@ -0,0 +1,79 @@
+#ifndef MQTT_WIRE_H
+#define MQTT_WIRE_H
+
+// Just enough MQTT 3.1.1 for the load generator: the packets PubSubClient
+// sends (CONNECT, SUBSCRIBE, QoS 0 PUBLISH, PINGREQ, DISCONNECT) and an
+// incremental parser for what a broker sends back.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+
+enum MqttPacketType {
+  MQTT_CONNECT = 1,
+  MQTT_CONNACK = 2,
+  MQTT_PUBLISH = 3,
+  MQTT_SUBSCRIBE = 8,
+  MQTT_SUBACK = 9,
+  MQTT_PINGREQ = 12,
+  MQTT_PINGRESP = 13,
+  MQTT_DISCONNECT = 14
+};
+
+struct MqttWill {
+  const char *topic;
+  const char *message;
+  uint8_t qos;
+  bool retain;
+};
+
+// Encoders append the complete packet to out
+void mqttConnect(std::string &out, const char *clientId, const char *user, const char *password,
+                 uint16_t keepAlive, const MqttWill *will = nullptr);
+void mqttSubscribe(std::string &out, uint16_t packetId, const char *topic);
+void mqttPublish(std::string &out, const char *topic, const char *payload, size_t length,
+                 bool retain = false);
+void mqttPing(std::string &out);
+void mqttDisconnect(std::string &out);
+
+// One received packet; body excludes the fixed header
+struct MqttPacket {
+  uint8_t type;
+  uint8_t flags;
+  const uint8_t *body;
+  size_t length;
+};
+
+// Fields of a QoS 0/1 PUBLISH, pointing into the packet body
+struct MqttMessage {
+  const char *topic;
+  size_t topicLength;
+  const char *payload;
+  size_t payloadLength;
+  bool retained;
+
+  bool topicIs(const char *name) const;
+  bool topicIs(const char *prefix, const char *suffix) const;
+  bool topicEndsWith(const char *suffix) const;
+};
+
+bool mqttParsePublish(const MqttPacket &packet, MqttMessage &message);
+
+// Reassembles packets from a byte stream. A returned packet stays valid
+// until the next call to feed().
+class MqttReader {
+private:
+  std::string buffer;
+  size_t position;
+  bool malformed;
+
+public:
+  MqttReader() : position(0), malformed(false) {}
+
+  void feed(const uint8_t *data, size_t length);
+  bool next(MqttPacket &packet);      // false: need more bytes
+  bool isMalformed() const { return malformed; }
+  void reset() { buffer.clear(); position = 0; malformed = false; }
+};
+
+#endif // MQTT_WIRE_H
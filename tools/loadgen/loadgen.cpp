@@ -0,0 +1,1070 @@
+// Fleet load generator: emulates N AgroHygra nodes against an MQTT broker.
+//
+// Every device speaks the firmware's protocol: same client/subscription
+// sequence under its own agrohygra/<mac> prefix, retained online/offline
+// presence with a Last Will, per-window stats, sensor and health payloads
+// field for field (raw sensor snapshots every interval only with --raw),
+// and replies to <prefix>/command (JSON) and <prefix>/pump/command (ON/OFF).
+// A separate controller connection addresses commands to individual nodes
+// and measures the round trip to every reply, optionally also counting
+// what an ingest subscriber receives.
+//
+//   loadgen --host 127.0.0.1 --devices 2000 --interval 2000 --duration 120
+//
+// Single-threaded, epoll driven; Linux only.
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <deque>
+#include <queue>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "DeviceModel.h"
+#include "MqttWire.h"
+
+// Firmware topics relative to the device prefix (Config.cpp "~/...") and timing
+static const char *TOPIC_SENSORS = "/sensors";
+static const char *TOPIC_STATS = "/stats";
+static const char *TOPIC_PUMP_COMMAND = "/pump/command";
+static const char *TOPIC_PUMP_STATUS = "/pump/status";
+static const char *TOPIC_SYSTEM_STATUS = "/system/status";
+static const char *TOPIC_LOGS = "/logs";
+static const char *TOPIC_CONFIG_SET = "/config/set";
+static const char *TOPIC_COMMAND = "/command";
+static const char *TOPIC_COMMAND_RESPONSE = "/command/response";
+static const char *TOPIC_PRESENCE = "/status";
+static const char *FLEET_ROOT = "agrohygra";
+
+#define KEEPALIVE_S 15
+#define HEALTH_INTERVAL_S 30.0
+#define CONNACK_TIMEOUT_S 10.0
+#define COMMAND_TIMEOUT_S 10.0
+#define MAX_QUEUED_BYTES 65536      // Per connection; beyond it publishes are dropped
+#define PAYLOAD_MAX 1024            // MQTT_BUFFER_SIZE
+#define DEVICE_ID_MAX 32
+#define TOPIC_MAX 96                // MQTT_TOPIC_MAX
+
+// ========== OPTIONS ==========
+
+struct Options {
+  const char *host = "127.0.0.1";
+  int port = 1883;
+  const char *user = "";
+  const char *password = "";
+  int devices = 100;
+  double window = 60;           // s, STATS_WINDOW
+  bool raw = false;             // MQTT_RAW_SAMPLES: also publish every snapshot
+  double interval = 2.0;        // s between raw sensor publishes per device
+  double rate = 0;              // Total raw msg/s, overrides interval
+  double duration = 60;         // s, 0 = until Ctrl-C
+  double ramp = 200;            // New connections per second
+  double churn = 0;             // Fraction of devices dropping per minute
+  bool churnAbort = false;      // Drop without DISCONNECT (power loss)
+  double reconnect = 5.0;       // MQTT_RECONNECT_INTERVAL
+  PayloadMode payload = PAYLOAD_FULL;
+  bool health = true;
+  double speed = 1;             // Simulated seconds per real second
+  double cmdInterval = 1.0;     // s, 0 = no commands
+  int cmdTargets = 1;           // Nodes addressed per command
+  bool cmdLegacy = false;
+  bool ingest = false;
+  double report = 5;
+  uint32_t seed = 1;
+};
+
+static Options options;
+static volatile sig_atomic_t stopRequested = 0;
+
+static int64_t wallClockMs() {
+  timespec ts;
+  clock_gettime(CLOCK_REALTIME, &ts);
+  return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static double nowSeconds() {
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// ========== STATISTICS ==========
+
+struct Counters {
+  uint64_t published = 0;       // Every device publish, replies and logs included
+  uint64_t sensors = 0;         // agrohygra/sensors only
+  uint64_t stats = 0;           // agrohygra/stats only
+  uint64_t bytes = 0;
+  uint64_t dropped = 0;         // Publishes skipped: socket backed up
+  uint64_t connects = 0;
+  uint64_t connectFailures = 0;
+  uint64_t churned = 0;
+  uint64_t lost = 0;            // Closed by the broker or the network
+  uint64_t ingested = 0;
+  uint64_t commands = 0;
+  uint64_t replies = 0;
+  uint64_t expected = 0;        // Replies due: addressed devices when sent
+  uint64_t online = 0;          // Live presence changes seen by the controller
+  uint64_t offline = 0;
+  std::vector<uint32_t> rtt;    // us
+};
+
+static Counters total, window;
+
+static void count(uint64_t Counters::*field, uint64_t amount = 1) {
+  total.*field += amount;
+  window.*field += amount;
+}
+
+static uint32_t percentile(std::vector<uint32_t> &samples, double fraction) {
+  if (samples.empty()) return 0;
+  size_t index = std::min(samples.size() - 1, (size_t)(fraction * samples.size()));
+  std::nth_element(samples.begin(), samples.begin() + index, samples.end());
+  return samples[index];
+}
+
+// ========== CONNECTIONS ==========
+
+enum ConnState {
+  CONN_IDLE,
+  CONN_TCP,           // Non-blocking connect() in progress
+  CONN_CONNACK,       // CONNECT sent
+  CONN_UP
+};
+
+struct Connection {
+  int fd = -1;
+  ConnState state = CONN_IDLE;
+  MqttReader reader;
+  std::string out;
+  size_t outPosition = 0;
+  bool wantWrite = false;
+  double lastTx = 0;
+  double stateSince = 0;
+  uint16_t packetId = 0;
+};
+
+struct Device : Connection {
+  DeviceModel model;
+  char id[DEVICE_ID_MAX];       // Client id, "agrohygra-<mac>"
+  char prefix[DEVICE_ID_MAX];   // Topic prefix, "agrohygra/<mac>"
+  double bootAt;            // Real time the emulated node "powered on"
+  double lastStep;
+  double nextPublish = 0;
+  double nextWindow = 0;
+  int64_t windowStartMs = 0;
+  double nextHealth = 0;
+  double reconnectAt = 0;
+  double churnAt = 0;
+  double wake = -1;         // Time of the pending timer entry
+  bool everConnected = false;
+
+  Device(uint32_t seed) : model(seed) {}
+};
+
+static int epollFd = -1;
+static sockaddr_storage brokerAddress;
+static socklen_t brokerAddressLength = 0;
+static std::vector<Device *> devices;
+static Connection controller;
+static int connectedDevices = 0;
+static std::mt19937 rng;
+static double startTime;
+static double startTimeOfDay;
+
+// Token bucket for connection attempts
+static double rampTokens = 0;
+static double rampUpdated = 0;
+
+// epoll data: device index, or -1 for the controller
+static Connection &connectionFor(int64_t tag) {
+  return tag < 0 ? controller : *devices[tag];
+}
+
+static void updateEvents(Connection &c, int64_t tag) {
+  epoll_event event;
+  memset(&event, 0, sizeof(event));
+  event.events = EPOLLIN | (c.wantWrite || c.state == CONN_TCP ? (uint32_t)EPOLLOUT : 0u);
+  event.data.u64 = (uint64_t)tag;
+  epoll_ctl(epollFd, EPOLL_CTL_MOD, c.fd, &event);
+}
+
+static void closeConnection(Connection &c, int64_t tag) {
+  if (c.fd >= 0) {
+    epoll_ctl(epollFd, EPOLL_CTL_DEL, c.fd, nullptr);
+    close(c.fd);
+  }
+  if (tag >= 0 && c.state == CONN_UP) connectedDevices--;
+  c.fd = -1;
+  c.state = CONN_IDLE;
+  c.out.clear();
+  c.outPosition = 0;
+  c.wantWrite = false;
+  c.reader.reset();
+}
+
+static bool flush(Connection &c, int64_t tag) {
+  while (c.outPosition < c.out.size()) {
+    ssize_t sent = send(c.fd, c.out.data() + c.outPosition, c.out.size() - c.outPosition, MSG_NOSIGNAL);
+    if (sent < 0) {
+      if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+      return false;
+    }
+    c.outPosition += sent;
+  }
+  if (c.outPosition == c.out.size()) {
+    c.out.clear();
+    c.outPosition = 0;
+  }
+
+  bool pending = !c.out.empty();
+  if (pending != c.wantWrite) {
+    c.wantWrite = pending;
+    updateEvents(c, tag);
+  }
+  return true;
+}
+
+static bool startConnect(Connection &c, int64_t tag, double now) {
+  c.fd = socket(brokerAddress.ss_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (c.fd < 0) return false;
+  int one = 1;
+  setsockopt(c.fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+  if (connect(c.fd, (sockaddr *)&brokerAddress, brokerAddressLength) < 0 && errno != EINPROGRESS) {
+    close(c.fd);
+    c.fd = -1;
+    return false;
+  }
+
+  c.state = CONN_TCP;
+  c.stateSince = now;
+  epoll_event event;
+  memset(&event, 0, sizeof(event));
+  event.events = EPOLLIN | EPOLLOUT;
+  event.data.u64 = (uint64_t)tag;
+  epoll_ctl(epollFd, EPOLL_CTL_ADD, c.fd, &event);
+  return true;
+}
+
+static void sendConnect(Connection &c, const char *clientId, const MqttWill *will, double now) {
+  mqttConnect(c.out, clientId, options.user, options.password, KEEPALIVE_S, will);
+  c.state = CONN_CONNACK;
+  c.stateSince = now;
+  c.lastTx = now;
+}
+
+static void subscribe(Connection &c, const char *topic) {
+  mqttSubscribe(c.out, ++c.packetId ? c.packetId : ++c.packetId, topic);
+}
+
+// ========== DEVICES ==========
+
+// Min-heap of (time, device); stale entries are skipped on pop
+typedef std::pair<double, int> TimerEntry;
+static std::priority_queue<TimerEntry, std::vector<TimerEntry>, std::greater<TimerEntry>> timers;
+
+static void wakeAt(int index, double at) {
+  Device &d = *devices[index];
+  if (d.wake >= 0 && d.wake <= at) return;
+  d.wake = at;
+  timers.push(TimerEntry(at, index));
+}
+
+static double exponential(double mean) {
+  std::exponential_distribution<double> distribution(1.0 / mean);
+  return distribution(rng);
+}
+
+static void advanceModel(Device &d, double now) {
+  double dt = (now - d.lastStep) * options.speed;
+  double timeOfDay = startTimeOfDay + (now - startTime) * options.speed;
+  d.model.step(timeOfDay, dt, wallClockMs());
+  d.lastStep = now;
+}
+
+static uint32_t uptime(const Device &d, double now) {
+  return (uint32_t)(now - d.bootAt);
+}
+
+static void deviceTopic(const Device &d, const char *suffix, char *topic) {
+  snprintf(topic, TOPIC_MAX, "%s%s", d.prefix, suffix);
+}
+
+static void publish(Device &d, const char *suffix, const char *payload, size_t length, bool retain = false) {
+  if (d.out.size() - d.outPosition > MAX_QUEUED_BYTES) {
+    count(&Counters::dropped);
+    return;
+  }
+  char topic[TOPIC_MAX];
+  deviceTopic(d, suffix, topic);
+  mqttPublish(d.out, topic, payload, length, retain);
+  count(&Counters::published);
+  count(&Counters::bytes, length);
+}
+
+static void publishText(Device &d, const char *suffix, const char *text, bool retain = false) {
+  publish(d, suffix, text, strlen(text), retain);
+}
+
+// Windows line up with UTC across the fleet, as StatsAggregator's do once
+// the clock has synced; a node publishes within a second of the boundary
+static void scheduleWindow(Device &d, double now) {
+  std::uniform_real_distribution<double> latency(0, 1);
+  int64_t windowMs = (int64_t)(options.window * 1000);
+  int64_t wallMs = wallClockMs();
+  d.windowStartMs = wallMs / windowMs * windowMs;
+  d.nextWindow = now + (d.windowStartMs + windowMs - wallMs) / 1000.0 + latency(rng);
+}
+
+static void subscribeDevice(Device &d, const char *suffix) {
+  char topic[TOPIC_MAX];
+  deviceTopic(d, suffix, topic);
+  subscribe(d, topic);
+}
+
+static void dropDevice(int index, double now, bool retry) {
+  Device &d = *devices[index];
+  closeConnection(d, index);
+  d.reconnectAt = now + (retry ? options.reconnect : 0);
+  wakeAt(index, d.reconnectAt);
+}
+
+static void onDeviceConnected(int index, double now) {
+  Device &d = *devices[index];
+  d.state = CONN_UP;
+  d.stateSince = now;
+  connectedDevices++;
+  count(&Counters::connects);
+
+  // MQTTManager::connect(): retained presence, one SUBSCRIBE per topic, then the hello log
+  publishText(d, TOPIC_PRESENCE, "online", true);
+  subscribeDevice(d, TOPIC_PUMP_COMMAND);
+  subscribeDevice(d, TOPIC_CONFIG_SET);
+  subscribeDevice(d, TOPIC_COMMAND);
+  publishText(d, TOPIC_LOGS, "AgroHygra system connected");
+
+  std::uniform_real_distribution<double> spread(0, 1);
+  double interval = options.interval;
+  if (!d.everConnected) {
+    // Spread first publishes so the fleet doesn't tick in lockstep
+    d.nextPublish = now + interval * spread(rng);
+    d.nextHealth = now + HEALTH_INTERVAL_S * spread(rng);
+    scheduleWindow(d, now);
+    d.everConnected = true;
+  } else {
+    d.nextPublish = std::max(d.nextPublish, now);
+    d.nextHealth = std::max(d.nextHealth, now);
+    if (d.nextWindow < now) scheduleWindow(d, now);   // Windows missed offline are gone
+  }
+  if (options.churn > 0) d.churnAt = now + exponential(60.0 / options.churn);
+}
+
+// Finds "key":"value" or "key":value in a flat JSON object
+static bool jsonField(const char *json, size_t length, const char *key, std::string &value) {
+  std::string pattern = std::string("\"") + key + "\"";
+  std::string text(json, length);
+  size_t at = text.find(pattern);
+  if (at == std::string::npos) return false;
+  at = text.find(':', at + pattern.size());
+  if (at == std::string::npos) return false;
+  at = text.find_first_not_of(" \t", at + 1);
+  if (at == std::string::npos) return false;
+
+  if (text[at] == '"') {
+    size_t end = text.find('"', at + 1);
+    if (end == std::string::npos) return false;
+    value = text.substr(at + 1, end - at - 1);
+  } else {
+    size_t end = text.find_first_of(",} \t", at);
+    value = text.substr(at, end == std::string::npos ? std::string::npos : end - at);
+  }
+  return true;
+}
+
+static void handleDeviceCommand(Device &d, const MqttMessage &message, double now) {
+  std::string cmd, id, duration, sent;
+  int64_t rxMs = wallClockMs();
+  jsonField(message.payload, message.payloadLength, "id", id);
+  const char *status = "ok";
+  char detail[48];
+  detail[0] = '\0';
+
+  advanceModel(d, now);
+  if (!jsonField(message.payload, message.payloadLength, "cmd", cmd)) {
+    status = "bad_request";
+    strcpy(detail, "missing cmd");
+  } else if (cmd == "pump_on") {
+    int seconds = jsonField(message.payload, message.payloadLength, "duration", duration)
+                  ? atoi(duration.c_str()) : 60;
+    if (seconds <= 0) {
+      status = "bad_request";
+      strcpy(detail, "duration must be > 0");
+    } else {
+      seconds = std::min(seconds, 60);
+      d.model.startPump(seconds);
+      snprintf(detail, sizeof(detail), "running for %ds", seconds);
+    }
+  } else if (cmd == "pump_off") {
+    d.model.stopPump();
+    strcpy(detail, "stopped");
+  } else if (cmd == "sample") {
+    strcpy(detail, "sampling all sensors");
+  } else if (cmd == "config_set") {
+    strcpy(detail, "updated");
+  } else {
+    status = "unknown_command";
+    cmd.clear();
+  }
+
+  std::uniform_int_distribution<int> handleUs(250, 600);
+  char payload[320];
+  int length = snprintf(payload, sizeof(payload),
+                        "{\"id\":\"%s\",\"cmd\":\"%s\",\"status\":\"%s\",\"detail\":\"%s\",\"us\":%d",
+                        id.c_str(), cmd.c_str(), status, detail, handleUs(rng));
+
+  // Pump acks carry the ActuationTracker stages like the firmware's
+  if (strcmp(status, "ok") == 0 && cmd.compare(0, 5, "pump_") == 0) {
+    char transit[40] = "";
+    if (jsonField(message.payload, message.payloadLength, "ts", sent)) {
+      long long us = std::max(0LL, (long long)(rxMs - atoll(sent.c_str())) * 1000);
+      snprintf(transit, sizeof(transit), "\"transit\":%lld,", us);
+    }
+    length += snprintf(payload + length, sizeof(payload) - length,
+                       ",\"rx\":%lld,\"lat\":{%s\"dispatch\":%d,\"actuate\":%d,\"total\":%d,\"ack\":%d},"
+                       "\"edge\":true,\"slo\":true",
+                       (long long)rxMs, transit, handleUs(rng), 20, 400, 1500);
+  }
+  if ((size_t)length + 1 >= sizeof(payload)) return;
+  payload[length++] = '}';
+  publish(d, TOPIC_COMMAND_RESPONSE, payload, length);
+  if (strcmp(status, "ok") == 0 && cmd.compare(0, 5, "pump_") == 0) {
+    publishText(d, TOPIC_PUMP_STATUS, d.model.isPumpActive() ? "ON" : "OFF");
+  }
+}
+
+static void handleDeviceMessage(Device &d, const MqttMessage &message, double now) {
+  std::string text(message.payload, message.payloadLength);
+
+  if (message.topicIs(d.prefix, TOPIC_COMMAND)) {
+    handleDeviceCommand(d, message, now);
+  } else if (message.topicIs(d.prefix, TOPIC_PUMP_COMMAND)) {
+    // CommandDispatcher::dispatchLegacy()
+    bool on = text == "ON" || text == "on" || text == "1" || text == "true";
+    bool off = text == "OFF" || text == "off" || text == "0" || text == "false";
+    if (!on && !off) return;
+    advanceModel(d, now);
+    if (on) {
+      d.model.startPump(60);
+    } else {
+      d.model.stopPump();
+    }
+    publishText(d, TOPIC_PUMP_STATUS, d.model.isPumpActive() ? "ON" : "OFF");
+    publishText(d, TOPIC_LOGS, on ? "Pump started via MQTT" : "Pump stopped via MQTT");
+  } else if (message.topicIs(d.prefix, TOPIC_CONFIG_SET)) {
+    publishText(d, TOPIC_LOGS, "Config updated via MQTT");
+  }
+}
+
+static void publishSensors(Device &d, double now, char *payload, size_t size) {
+  size_t length = d.model.sensorJson(payload, size, d.id, wallClockMs(), uptime(d, now), options.payload);
+  if (!length) return;
+  publish(d, TOPIC_SENSORS, payload, length);
+  count(&Counters::sensors);
+}
+
+static void serviceDevice(int index, double now) {
+  Device &d = *devices[index];
+
+  if (d.state == CONN_IDLE) {
+    if (now < d.reconnectAt) {
+      wakeAt(index, d.reconnectAt);
+      return;
+    }
+    // Ramp limit: wait for a token
+    rampTokens = std::min(options.ramp, rampTokens + (now - rampUpdated) * options.ramp);
+    rampUpdated = now;
+    if (rampTokens < 1) {
+      wakeAt(index, now + (1 - rampTokens) / options.ramp);
+      return;
+    }
+    rampTokens -= 1;
+    if (!startConnect(d, index, now)) {
+      count(&Counters::connectFailures);
+      dropDevice(index, now, true);
+      return;
+    }
+    wakeAt(index, now + CONNACK_TIMEOUT_S);
+    return;
+  }
+
+  if (d.state != CONN_UP) {
+    if (now - d.stateSince >= CONNACK_TIMEOUT_S) {
+      count(&Counters::connectFailures);
+      dropDevice(index, now, true);
+    } else {
+      wakeAt(index, d.stateSince + CONNACK_TIMEOUT_S);
+    }
+    return;
+  }
+
+  if (d.churnAt > 0 && now >= d.churnAt) {
+    if (!options.churnAbort) {
+      // MQTTManager::disconnect(); an aborted session leaves it to the will
+      publishText(d, TOPIC_PRESENCE, "offline", true);
+      mqttDisconnect(d.out);
+      flush(d, index);
+    }
+    count(&Counters::churned);
+    dropDevice(index, now, true);
+    return;
+  }
+
+  char payload[PAYLOAD_MAX];
+  if (options.raw && now >= d.nextPublish) {
+    advanceModel(d, now);
+    publishSensors(d, now, payload, sizeof(payload));
+    d.nextPublish += options.interval;
+    if (d.nextPublish < now) d.nextPublish = now + options.interval;
+  }
+  if (now >= d.nextWindow) {
+    // publishStats(): one message per group, then the window's snapshot
+    advanceModel(d, now);
+    for (int group = 0; group < STATS_GROUP_COUNT; group++) {
+      size_t length = d.model.statsJson(payload, sizeof(payload), d.id, d.windowStartMs,
+                                        (uint32_t)options.window, (StatsGroup)group);
+      if (!length) continue;
+      publish(d, TOPIC_STATS, payload, length);
+      count(&Counters::stats);
+    }
+    if (!options.raw) publishSensors(d, now, payload, sizeof(payload));
+    d.model.startWindow();
+    scheduleWindow(d, now);
+  }
+  if (options.health && now >= d.nextHealth) {
+    size_t length = d.model.healthJson(payload, sizeof(payload), d.id, wallClockMs(), uptime(d, now));
+    if (length) publish(d, TOPIC_SYSTEM_STATUS, payload, length);
+    d.nextHealth += HEALTH_INTERVAL_S;
+    if (d.nextHealth < now) d.nextHealth = now + HEALTH_INTERVAL_S;
+  }
+  if (!d.out.empty()) {
+    d.lastTx = now;
+  } else if (now - d.lastTx >= KEEPALIVE_S) {
+    mqttPing(d.out);
+    d.lastTx = now;
+  }
+  if (!flush(d, index)) {
+    count(&Counters::lost);
+    dropDevice(index, now, true);
+    return;
+  }
+
+  double next = std::min(d.nextWindow, d.lastTx + KEEPALIVE_S);
+  if (options.raw) next = std::min(next, d.nextPublish);
+  if (options.health) next = std::min(next, d.nextHealth);
+  if (d.churnAt > 0) next = std::min(next, d.churnAt);
+  wakeAt(index, next);
+}
+
+// ========== CONTROLLER ==========
+
+struct PendingCommand {
+  uint32_t sequence;
+  double sentAt;
+  uint32_t expected;
+};
+
+static std::deque<PendingCommand> pending;
+static uint32_t commandSequence = 0;
+static double nextCommand = 0;
+static double controllerRetryAt = 0;
+
+static void recordReply(uint32_t sequence, double now) {
+  for (const PendingCommand &command : pending) {
+    if (command.sequence != sequence) continue;
+    uint32_t us = (uint32_t)((now - command.sentAt) * 1e6);
+    total.rtt.push_back(us);
+    window.rtt.push_back(us);
+    count(&Counters::replies);
+    return;
+  }
+}
+
+// Subscriptions are agrohygra/+/<suffix>, so the suffix identifies the stream.
+// Check /pump/status before /status: both end the same way.
+static void handleControllerMessage(const MqttMessage &message, double now) {
+  if (message.topicEndsWith(TOPIC_SENSORS) || message.topicEndsWith(TOPIC_STATS)) {
+    count(&Counters::ingested);
+  } else if (message.topicEndsWith(TOPIC_COMMAND_RESPONSE)) {
+    std::string id;
+    if (!options.cmdLegacy && jsonField(message.payload, message.payloadLength, "id", id) &&
+        id.compare(0, 2, "lg") == 0) {
+      recordReply((uint32_t)strtoul(id.c_str() + 2, nullptr, 10), now);
+    }
+  } else if (message.topicEndsWith(TOPIC_PUMP_STATUS)) {
+    // Plain-text replies carry no id: attribute them to the newest command
+    if (options.cmdLegacy && !pending.empty()) recordReply(pending.back().sequence, now);
+  } else if (message.topicEndsWith(TOPIC_PRESENCE) && !message.retained) {
+    // Retained states replayed on subscribe are history, not events
+    bool online = message.payloadLength == 6 && memcmp(message.payload, "online", 6) == 0;
+    count(online ? &Counters::online : &Counters::offline);
+  }
+}
+
+static void sendCommand(double now) {
+  uint32_t sequence = ++commandSequence;
+  bool on = sequence % 2 == 1;
+  char payload[128];
+  int length;
+  if (options.cmdLegacy) {
+    length = snprintf(payload, sizeof(payload), "%s", on ? "ON" : "OFF");
+  } else {
+    length = on
+      ? snprintf(payload, sizeof(payload), "{\"cmd\":\"pump_on\",\"id\":\"lg%u\",\"ts\":%lld,\"duration\":5}",
+                 sequence, (long long)wallClockMs())
+      : snprintf(payload, sizeof(payload), "{\"cmd\":\"pump_off\",\"id\":\"lg%u\",\"ts\":%lld}",
+                 sequence, (long long)wallClockMs());
+  }
+
+  // Device-scoped topics: each addressed node gets its own publish, starting
+  // from a random node so every command lands somewhere different
+  std::uniform_int_distribution<size_t> pick(0, devices.size() - 1);
+  size_t start = pick(rng);
+  uint32_t addressed = 0;
+  char topic[TOPIC_MAX];
+  for (size_t i = 0; i < devices.size() && addressed < (uint32_t)options.cmdTargets; i++) {
+    const Device &d = *devices[(start + i) % devices.size()];
+    if (d.state != CONN_UP) continue;
+    deviceTopic(d, options.cmdLegacy ? TOPIC_PUMP_COMMAND : TOPIC_COMMAND, topic);
+    mqttPublish(controller.out, topic, payload, length);
+    addressed++;
+  }
+
+  PendingCommand command = {sequence, now, addressed};
+  pending.push_back(command);
+  count(&Counters::commands);
+  count(&Counters::expected, addressed);
+}
+
+static void serviceController(double now) {
+  if (controller.state == CONN_IDLE) {
+    if (now >= controllerRetryAt && !startConnect(controller, -1, now)) {
+      controllerRetryAt = now + options.reconnect;
+    }
+    return;
+  }
+  if (controller.state != CONN_UP) {
+    if (now - controller.stateSince >= CONNACK_TIMEOUT_S) {
+      closeConnection(controller, -1);
+      controllerRetryAt = now + options.reconnect;
+    }
+    return;
+  }
+
+  // Replies that never came are counted as missing in the report
+  while (!pending.empty() && now - pending.front().sentAt > COMMAND_TIMEOUT_S) {
+    pending.pop_front();
+  }
+
+  // One command per interval, once the fleet has had a chance to connect
+  if (options.cmdInterval > 0 && connectedDevices > 0 && now >= nextCommand) {
+    sendCommand(now);
+    nextCommand = now + options.cmdInterval;
+  }
+  if (controller.out.empty() && now - controller.lastTx >= KEEPALIVE_S) {
+    mqttPing(controller.out);
+  }
+  if (!controller.out.empty()) controller.lastTx = now;
+  if (!flush(controller, -1)) {
+    closeConnection(controller, -1);
+    controllerRetryAt = now + options.reconnect;
+  }
+}
+
+// ========== SOCKET EVENTS ==========
+
+static void onControllerPacket(const MqttPacket &packet, double now) {
+  if (packet.type == MQTT_CONNACK) {
+    if (packet.length < 2 || packet.body[1] != 0) {
+      fprintf(stderr, "controller: broker refused connection (code %d)\n", packet.length >= 2 ? packet.body[1] : -1);
+      closeConnection(controller, -1);
+      controllerRetryAt = now + options.reconnect;
+      return;
+    }
+    controller.state = CONN_UP;
+    const char *streams[] = {TOPIC_COMMAND_RESPONSE, TOPIC_PUMP_STATUS, TOPIC_PRESENCE, TOPIC_SENSORS,
+                             TOPIC_STATS};
+    char topic[TOPIC_MAX];
+    for (const char *suffix : streams) {
+      if ((suffix == TOPIC_SENSORS || suffix == TOPIC_STATS) && !options.ingest) continue;
+      snprintf(topic, sizeof(topic), "%s/+%s", FLEET_ROOT, suffix);
+      subscribe(controller, topic);
+    }
+    nextCommand = now + options.cmdInterval;
+    return;
+  }
+
+  MqttMessage message;
+  if (mqttParsePublish(packet, message)) handleControllerMessage(message, now);
+}
+
+static void onDevicePacket(int index, const MqttPacket &packet, double now) {
+  Device &d = *devices[index];
+  if (packet.type == MQTT_CONNACK) {
+    if (packet.length < 2 || packet.body[1] != 0) {
+      count(&Counters::connectFailures);
+      dropDevice(index, now, true);
+      return;
+    }
+    onDeviceConnected(index, now);
+    d.wake = -1;
+    serviceDevice(index, now);
+    return;
+  }
+
+  MqttMessage message;
+  if (mqttParsePublish(packet, message)) handleDeviceMessage(d, message, now);
+}
+
+static void onSocketEvent(int64_t tag, uint32_t events, double now) {
+  Connection &c = connectionFor(tag);
+  if (c.fd < 0) return;
+
+  if (c.state == CONN_TCP && (events & (EPOLLOUT | EPOLLERR | EPOLLHUP))) {
+    int error = 0;
+    socklen_t length = sizeof(error);
+    getsockopt(c.fd, SOL_SOCKET, SO_ERROR, &error, &length);
+    if (error != 0) {
+      if (tag < 0) {
+        closeConnection(controller, -1);
+        controllerRetryAt = now + options.reconnect;
+      } else {
+        count(&Counters::connectFailures);
+        dropDevice(tag, now, true);
+      }
+      return;
+    }
+    if (tag < 0) {
+      sendConnect(c, "agrohygra-loadgen-ctl", nullptr, now);
+    } else {
+      // Same will as MQTTManager::connect()
+      char presence[TOPIC_MAX];
+      deviceTopic(*devices[tag], TOPIC_PRESENCE, presence);
+      MqttWill will = {presence, "offline", 1, true};
+      sendConnect(c, devices[tag]->id, &will, now);
+    }
+    c.wantWrite = true;   // Forces an epoll update dropping the connect-time EPOLLOUT
+    flush(c, tag);
+    return;
+  }
+
+  bool closed = (events & (EPOLLERR | EPOLLHUP)) != 0;
+  if (events & EPOLLIN) {
+    uint8_t buffer[16384];
+    while (true) {
+      ssize_t received = recv(c.fd, buffer, sizeof(buffer), 0);
+      if (received > 0) {
+        c.reader.feed(buffer, received);
+        continue;
+      }
+      if (received == 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) closed = true;
+      break;
+    }
+
+    MqttPacket packet;
+    while (c.fd >= 0 && c.reader.next(packet)) {
+      if (tag < 0) {
+        onControllerPacket(packet, now);
+      } else {
+        onDevicePacket(tag, packet, now);
+      }
+    }
+    if (c.reader.isMalformed()) closed = true;
+  }
+
+  if (c.fd >= 0 && !closed && !flush(c, tag)) closed = true;
+  if (closed && c.fd >= 0) {
+    if (tag < 0) {
+      fprintf(stderr, "controller: connection lost\n");
+      closeConnection(controller, -1);
+      controllerRetryAt = now + options.reconnect;
+    } else {
+      count(&Counters::lost);
+      dropDevice(tag, now, true);
+    }
+  }
+}
+
+// ========== REPORTING ==========
+
+static void report(double elapsed, double span, Counters &c, const char *label) {
+  uint32_t p50 = percentile(c.rtt, 0.50);
+  uint32_t p99 = percentile(c.rtt, 0.99);
+  uint32_t worst = c.rtt.empty() ? 0 : *std::max_element(c.rtt.begin(), c.rtt.end());
+
+  printf("[%s%6.1fs] conn %d/%d | stats %.0f sensors %.0f msg/s | pub %.0f msg/s %.1f kB/s drop %llu",
+         label, elapsed, connectedDevices, options.devices, c.stats / span, c.sensors / span,
+         c.published / span, c.bytes / span / 1e3, (unsigned long long)c.dropped);
+  if (options.ingest) printf(" | ingest %.0f msg/s", c.ingested / span);
+  if (c.commands) {
+    printf(" | cmd %llu rtt p50 %.1f p99 %.1f max %.1f ms replies %llu/%llu",
+           (unsigned long long)c.commands, p50 / 1000.0, p99 / 1000.0, worst / 1000.0,
+           (unsigned long long)c.replies, (unsigned long long)c.expected);
+  }
+  printf(" | presence +%llu -%llu", (unsigned long long)c.online, (unsigned long long)c.offline);
+  printf(" | +conn %llu churn %llu lost %llu fail %llu\n",
+         (unsigned long long)c.connects, (unsigned long long)c.churned,
+         (unsigned long long)c.lost, (unsigned long long)c.connectFailures);
+  fflush(stdout);
+}
+
+// ========== SETUP ==========
+
+static void usage(const char *name) {
+  printf("Usage: %s [options]\n"
+         "  --host H            broker address (127.0.0.1)\n"
+         "  --port P            broker port (1883)\n"
+         "  --user U --pass P   broker credentials\n"
+         "  --devices N         emulated nodes (100)\n"
+         "  --window S          stats window, one ~/stats per group and snapshot each (60, STATS_WINDOW)\n"
+         "  --raw               also publish every snapshot to ~/sensors (MQTT_RAW_SAMPLES)\n"
+         "  --interval MS       raw sensor publish interval per node (2000, MQTT_SENSOR_INTERVAL)\n"
+         "  --rate R            total raw sensor msg/s across the fleet (overrides --interval)\n"
+         "  --duration S        run time, 0 = until Ctrl-C (60)\n"
+         "  --ramp R            new connections per second (200)\n"
+         "  --churn F           fraction of nodes dropping per minute (0)\n"
+         "  --churn-abort       drop without DISCONNECT, like a power cut\n"
+         "  --reconnect MS      delay before reconnecting (5000)\n"
+         "  --payload MODE      full | basic (no NPK block) (full)\n"
+         "  --no-health         skip <prefix>/system/status every 30 s\n"
+         "  --speed X           simulated seconds per real second (1)\n"
+         "  --cmd-interval MS   controller command period, 0 = none (1000)\n"
+         "  --cmd-targets N     nodes addressed per command (1)\n"
+         "  --cmd-mode MODE     json (<prefix>/command) | legacy (<prefix>/pump/command)\n"
+         "  --ingest            controller also subscribes to agrohygra/+/stats and +/sensors\n"
+         "  --report S          report period (5)\n"
+         "  --seed N            random seed (1)\n", name);
+}
+
+static bool parseOptions(int argc, char **argv) {
+  static const option longOptions[] = {
+    {"host", required_argument, nullptr, 'h'},
+    {"port", required_argument, nullptr, 'p'},
+    {"user", required_argument, nullptr, 'u'},
+    {"pass", required_argument, nullptr, 'P'},
+    {"devices", required_argument, nullptr, 'n'},
+    {"window", required_argument, nullptr, 'w'},
+    {"raw", no_argument, nullptr, 'W'},
+    {"interval", required_argument, nullptr, 'i'},
+    {"rate", required_argument, nullptr, 'r'},
+    {"duration", required_argument, nullptr, 'd'},
+    {"ramp", required_argument, nullptr, 'R'},
+    {"churn", required_argument, nullptr, 'c'},
+    {"churn-abort", no_argument, nullptr, 'A'},
+    {"reconnect", required_argument, nullptr, 'x'},
+    {"payload", required_argument, nullptr, 'm'},
+    {"no-health", no_argument, nullptr, 'H'},
+    {"speed", required_argument, nullptr, 's'},
+    {"cmd-interval", required_argument, nullptr, 'C'},
+    {"cmd-targets", required_argument, nullptr, 'T'},
+    {"cmd-mode", required_argument, nullptr, 'M'},
+    {"ingest", no_argument, nullptr, 'I'},
+    {"report", required_argument, nullptr, 'o'},
+    {"seed", required_argument, nullptr, 'S'},
+    {"help", no_argument, nullptr, '?'},
+    {nullptr, 0, nullptr, 0}
+  };
+
+  int option;
+  while ((option = getopt_long(argc, argv, "", longOptions, nullptr)) != -1) {
+    switch (option) {
+      case 'h': options.host = optarg; break;
+      case 'p': options.port = atoi(optarg); break;
+      case 'u': options.user = optarg; break;
+      case 'P': options.password = optarg; break;
+      case 'n': options.devices = atoi(optarg); break;
+      case 'w': options.window = atof(optarg); break;
+      case 'W': options.raw = true; break;
+      case 'i': options.interval = atof(optarg) / 1000; break;
+      case 'r': options.rate = atof(optarg); break;
+      case 'd': options.duration = atof(optarg); break;
+      case 'R': options.ramp = atof(optarg); break;
+      case 'c': options.churn = atof(optarg); break;
+      case 'A': options.churnAbort = true; break;
+      case 'x': options.reconnect = atof(optarg) / 1000; break;
+      case 'm':
+        if (strcmp(optarg, "full") == 0) options.payload = PAYLOAD_FULL;
+        else if (strcmp(optarg, "basic") == 0) options.payload = PAYLOAD_BASIC;
+        else return false;
+        break;
+      case 'H': options.health = false; break;
+      case 's': options.speed = atof(optarg); break;
+      case 'C': options.cmdInterval = atof(optarg) / 1000; break;
+      case 'T': options.cmdTargets = atoi(optarg); break;
+      case 'M':
+        if (strcmp(optarg, "json") == 0) options.cmdLegacy = false;
+        else if (strcmp(optarg, "legacy") == 0) options.cmdLegacy = true;
+        else return false;
+        break;
+      case 'I': options.ingest = true; break;
+      case 'o': options.report = atof(optarg); break;
+      case 'S': options.seed = (uint32_t)strtoul(optarg, nullptr, 10); break;
+      default: return false;
+    }
+  }
+
+  if (options.devices <= 0 || options.ramp <= 0 || options.report <= 0 || options.cmdTargets <= 0 ||
+      options.window < 1) {
+    return false;
+  }
+  if (options.rate > 0) options.interval = options.devices / options.rate;
+  return options.interval > 0;
+}
+
+static bool resolveBroker() {
+  addrinfo hints;
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_socktype = SOCK_STREAM;
+  addrinfo *result;
+  char port[8];
+  snprintf(port, sizeof(port), "%d", options.port);
+  if (getaddrinfo(options.host, port, &hints, &result) != 0) return false;
+  memcpy(&brokerAddress, result->ai_addr, result->ai_addrlen);
+  brokerAddressLength = result->ai_addrlen;
+  freeaddrinfo(result);
+  return true;
+}
+
+static void raiseFileLimit() {
+  // One socket per node plus the controller and stdio
+  rlimit limit;
+  if (getrlimit(RLIMIT_NOFILE, &limit) != 0) return;
+  rlim_t wanted = (rlim_t)options.devices + 64;
+  if (limit.rlim_cur >= wanted) return;
+  limit.rlim_cur = std::min(wanted, limit.rlim_max);
+  setrlimit(RLIMIT_NOFILE, &limit);
+  if (limit.rlim_cur < wanted) {
+    fprintf(stderr, "warning: open file limit %llu is below %llu, raise it with ulimit -n\n",
+            (unsigned long long)limit.rlim_cur, (unsigned long long)wanted);
+  }
+}
+
+static void onSignal(int) {
+  stopRequested = 1;
+}
+
+int main(int argc, char **argv) {
+  if (!parseOptions(argc, argv)) {
+    usage(argv[0]);
+    return 1;
+  }
+  if (!resolveBroker()) {
+    fprintf(stderr, "cannot resolve %s\n", options.host);
+    return 1;
+  }
+  raiseFileLimit();
+  signal(SIGINT, onSignal);
+  signal(SIGTERM, onSignal);
+
+  epollFd = epoll_create1(EPOLL_CLOEXEC);
+  rng.seed(options.seed);
+  startTime = nowSeconds();
+  rampUpdated = startTime;
+  time_t wall = time(nullptr);
+  tm local;
+  localtime_r(&wall, &local);
+  startTimeOfDay = local.tm_hour * 3600 + local.tm_min * 60 + local.tm_sec;
+
+  std::uniform_real_distribution<double> bootSpread(0, 86400);
+  for (int i = 0; i < options.devices; i++) {
+    Device *d = new Device(options.seed * 7919u + i);
+    // Locally administered MAC so emulated nodes never collide with real ones
+    char mac[13];
+    snprintf(mac, sizeof(mac), "024c47%06x", i & 0xFFFFFF);
+    snprintf(d->id, sizeof(d->id), "%s-%s", FLEET_ROOT, mac);
+    snprintf(d->prefix, sizeof(d->prefix), "%s/%s", FLEET_ROOT, mac);
+    d->bootAt = startTime - bootSpread(rng);
+    d->lastStep = startTime;
+    devices.push_back(d);
+    wakeAt(i, startTime);
+  }
+
+  printf("loadgen: %d nodes -> %s:%d, %.0f sensor msg/s, payload %s, ",
+         options.devices, options.host, options.port, options.devices / options.interval,
+         options.payload == PAYLOAD_FULL ? "full" : "basic");
+  if (options.cmdInterval > 0) {
+    printf("%s commands every %.1fs to %d node(s)\n", options.cmdLegacy ? "legacy" : "json", options.cmdInterval,
+           options.cmdTargets);
+  } else {
+    printf("no commands\n");
+  }
+
+  double nextReport = startTime + options.report;
+  double lastReport = startTime;
+  epoll_event events[256];
+
+  while (!stopRequested) {
+    double now = nowSeconds();
+    if (options.duration > 0 && now - startTime >= options.duration) break;
+
+    // Sleep until the earliest timer, at most 10 ms for the controller and reports
+    double next = now + 0.01;
+    if (!timers.empty()) next = std::min(next, timers.top().first);
+    int timeout = (int)std::max(0.0, (next - now) * 1000);
+
+    int ready = epoll_wait(epollFd, events, 256, timeout);
+    now = nowSeconds();
+    for (int i = 0; i < ready; i++) {
+      onSocketEvent((int64_t)events[i].data.u64, events[i].events, now);
+    }
+
+    while (!timers.empty() && timers.top().first <= now) {
+      TimerEntry entry = timers.top();
+      timers.pop();
+      Device &d = *devices[entry.second];
+      if (d.wake != entry.first) continue;
+      d.wake = -1;
+      serviceDevice(entry.second, now);
+    }
+    serviceController(now);
+
+    if (now >= nextReport) {
+      report(now - startTime, now - lastReport, window, "");
+      window = Counters();
+      lastReport = now;
+      nextReport += options.report;
+    }
+  }
+
+  double elapsed = nowSeconds() - startTime;
+  report(elapsed, elapsed, total, "total ");
+
+  for (size_t i = 0; i < devices.size(); i++) {
+    if (devices[i]->state == CONN_UP) {
+      mqttDisconnect(devices[i]->out);
+      flush(*devices[i], i);
+    }
+    closeConnection(*devices[i], i);
+    delete devices[i];
+  }
+  closeConnection(controller, -1);
+  close(epollFd);
+  return 0;
+}
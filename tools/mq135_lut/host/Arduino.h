@@ -0,0 +1,41 @@
+// Host stand-in for the parts of the Arduino core that MQ135Sensor and
+// Config use. Pins read as zero and the clock stands still.
+#ifndef MQ135_LUT_ARDUINO_H
+#define MQ135_LUT_ARDUINO_H
+
+#include <algorithm>
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+using std::max;
+using std::min;
+
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+#define LOW 0x0
+#define HIGH 0x1
+#define INPUT 0x01
+
+typedef uint8_t byte;
+
+inline unsigned long millis() { return 0; }
+inline void delay(unsigned long) {}
+inline void pinMode(uint8_t, uint8_t) {}
+inline int analogRead(uint8_t) { return 0; }
+inline int digitalRead(uint8_t) { return LOW; }
+
+inline long map(long x, long inMin, long inMax, long outMin, long outMax) {
+  return (x - inMin) * (outMax - outMin) / (inMax - inMin) + outMin;
+}
+
+class HostSerial {
+public:
+  void println(const char *text) { puts(text); }
+};
+
+extern HostSerial Serial;
+
+#endif // MQ135_LUT_ARDUINO_H
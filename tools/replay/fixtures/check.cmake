@@ -0,0 +1,15 @@
+# Replays a fixture trace and compares stdout with the expected output:
+#   cmake -DREPLAY=<replay> -DTRACE=<name>.bin -DEXPECTED=<name>.txt [-DARGS=...] -P check.cmake
+# Run from the fixtures directory, since the trace path is part of the output.
+separate_arguments(ARGS)
+execute_process(COMMAND ${REPLAY} ${ARGS} ${TRACE}
+                OUTPUT_VARIABLE actual
+                ERROR_QUIET
+                RESULT_VARIABLE status)
+if(NOT status EQUAL 0)
+  message(FATAL_ERROR "replay exited with ${status}:\n${actual}")
+endif()
+file(READ ${EXPECTED} expected)
+if(NOT actual STREQUAL expected)
+  message(FATAL_ERROR "replay output differs from ${EXPECTED}:\n${actual}")
+endif()
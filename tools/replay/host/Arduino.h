@@ -0,0 +1,55 @@
+// Host stand-in for the parts of the Arduino core that PumpController and
+// Config use. Time comes from the replay's virtual clock, which only moves
+// when the replay advances it; pins go nowhere.
+#ifndef REPLAY_ARDUINO_H
+#define REPLAY_ARDUINO_H
+
+#include <algorithm>
+#include <math.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+using std::max;
+using std::min;
+
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+#define LOW 0x0
+#define HIGH 0x1
+#define OUTPUT 0x03
+
+typedef uint8_t byte;
+
+extern uint64_t virtualClockUs;
+
+// 32-bit like the ESP32's, so they wrap where the device's do
+inline unsigned long millis() { return (uint32_t)(virtualClockUs / 1000); }
+inline unsigned long micros() { return (uint32_t)virtualClockUs; }
+
+inline void pinMode(uint8_t, uint8_t) {}
+inline void digitalWrite(uint8_t, uint8_t) {}
+
+// Firmware log lines, shown with --log
+class HostSerial {
+public:
+  bool echo = false;
+
+  void printf(const char *format, ...) {
+    if (!echo) return;
+    va_list args;
+    va_start(args, format);
+    vfprintf(stderr, format, args);
+    va_end(args);
+  }
+
+  void println(const char *text) {
+    if (echo) fprintf(stderr, "%s\n", text);
+  }
+};
+
+extern HostSerial Serial;
+
+#endif // REPLAY_ARDUINO_H
@@ -0,0 +1,7 @@
+#ifndef REPLAY_ARDUINO_JSON_H
+#define REPLAY_ARDUINO_JSON_H
+
+// Only named in declarations the replay never calls
+class JsonVariant {};
+
+#endif // REPLAY_ARDUINO_JSON_H
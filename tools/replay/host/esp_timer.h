@@ -0,0 +1,8 @@
+#ifndef REPLAY_ESP_TIMER_H
+#define REPLAY_ESP_TIMER_H
+
+#include "Arduino.h"
+
+inline int64_t esp_timer_get_time() { return (int64_t)virtualClockUs; }
+
+#endif // REPLAY_ESP_TIMER_H
@@ -0,0 +1,474 @@
+// Replays a pump controller trace (GET /trace) through the firmware's own
+// PumpController on a virtual clock and prints what it decides.
+//
+//   replay [--set key=value]... [--tick ms] [--samples] [--log] trace.bin
+//
+// stdout is one line per relay edge and irrigation phase change, identical
+// from run to run, so replays diff against each other or a golden file.
+// Each relay edge the device recorded is checked against the replay; at the
+// start of every block the replayed state is compared with the device's
+// keyframe and resynced on a mismatch. Exit status is 1 on any divergence.
+//
+// --set changes a controller setting (registry key, e.g. moisture_thr=35)
+// for the whole replay, to see what a different configuration would have
+// done with the same inputs. Verification is off then. The trace leaves out
+// the loop's autoIrrigate() calls that repeated the last soil value and
+// changed nothing on the device; with other settings they might, so the
+// replay makes one every --tick ms (default 100, 0 = none) in between.
+
+#include <chrono>
+#include <cmath>
+#include <cstdarg>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "controllers/PumpController.h"
+#include "storage/TraceFormat.h"
+
+uint64_t virtualClockUs = 0;
+HostSerial Serial;
+
+TimeStamp TimeService::stamp() { return {0, TIME_UNSYNCED}; }
+
+static const char *const phaseNames[] = {"idle", "pulse", "soak"};
+
+struct SnapshotField {
+  const char *name;
+  size_t offset;
+  size_t size;
+  bool isFloat;
+};
+
+#define FIELD(f) {#f, offsetof(PumpSnapshot, f), sizeof(PumpSnapshot::f), false}
+#define FLOAT_FIELD(f) {#f, offsetof(PumpSnapshot, f), sizeof(PumpSnapshot::f), true}
+
+static const SnapshotField snapshotFields[] = {
+  FIELD(isActive), FIELD(phase), FIELD(wateringCount), FIELD(totalWateringTime),
+  FIELD(consecutiveDryCount), FIELD(startTime), FIELD(runLimit), FIELD(phaseStart),
+  FIELD(pulseDuration), FIELD(soakDuration), FIELD(pulseMoisture), FIELD(soakPeak),
+  FIELD(soakPeakTime), FIELD(pulsesInCycle), FIELD(trackingOvershoot), FIELD(overshootStart),
+  FIELD(overshootPeak), FIELD(lastOvershoot), FIELD(lastHistory), FIELD(historyHead),
+  FIELD(historyCount), FIELD(historyTime), FIELD(historyMoisture), FIELD(currentHour),
+  FIELD(onSecondsByHour), FIELD(cyclesByHour),
+  FLOAT_FIELD(dryingRate), FLOAT_FIELD(pulseGain), FLOAT_FIELD(infiltrationLag),
+  FLOAT_FIELD(avgOvershoot),
+};
+
+// Single-precision results may differ in the last bits from the device (fused
+// multiply-add on the ESP32), so learned values compare with a tolerance
+static bool sameField(const PumpSnapshot &a, const PumpSnapshot &b, const SnapshotField &field) {
+  const uint8_t *pa = (const uint8_t *)&a + field.offset;
+  const uint8_t *pb = (const uint8_t *)&b + field.offset;
+  if (!field.isFloat) return memcmp(pa, pb, field.size) == 0;
+  float fa, fb;
+  memcpy(&fa, pa, sizeof(float));
+  memcpy(&fb, pb, sizeof(float));
+  return fabsf(fa - fb) <= 1e-3f * fmaxf(1.0f, fmaxf(fabsf(fa), fabsf(fb)));
+}
+
+static void formatTime(char *out, size_t size, uint64_t us) {
+  uint64_t ms = us / 1000;
+  snprintf(out, size, "%4llu:%02u:%02u.%03u", (unsigned long long)(ms / 3600000),
+           (unsigned)(ms / 60000 % 60), (unsigned)(ms / 1000 % 60), (unsigned)(ms % 1000));
+}
+
+class Replay : public PumpTracer {
+private:
+  PumpController controller;
+  std::vector<std::pair<uint8_t, int32_t>> overrides;
+  std::vector<std::string> metricNames;
+  bool showSamples;
+
+  int32_t soil;
+  uint8_t lastCall;           // Type and spacing of the last payload-less call, for TRACE_REPEAT
+  uint64_t lastCallDelta;
+  const char *cause;          // Call being replayed, for the output lines
+  std::deque<bool> pending;   // Edges the replay made that the trace has not confirmed yet
+  uint64_t lastOnUs;
+  bool seenOn;
+  uint8_t lastPhase;
+  bool started;
+  uint32_t tickMs;
+  uint64_t nextTickUs;
+
+  void applyConfig(const uint8_t *&p, const uint8_t *end);
+  bool call(uint8_t type, int32_t arg);
+  void confirmEdge(bool on);
+  void checkPending();
+  void advanceTo(uint64_t us);
+  void report(const char *format, ...);
+
+public:
+  uint64_t firstUs;
+  uint32_t calls;
+  uint32_t edges;
+  uint32_t mismatches;
+  uint32_t resyncs;
+
+  Replay()
+    : controller(RELAY_PIN, RELAY_ACTIVE_LOW), showSamples(false), soil(0), lastCall(0),
+      lastCallDelta(0), cause(""), lastOnUs(0), seenOn(false), lastPhase(PHASE_IDLE),
+      started(false), tickMs(100), nextTickUs(0), firstUs(0), calls(0), edges(0), mismatches(0), resyncs(0) {
+    controller.setTracer(this);
+  }
+
+  void setSamples(bool on) { showSamples = on; }
+  void setTick(uint32_t ms) { tickMs = ms; }
+  void setMetricNames(const std::vector<std::string> &names) { metricNames = names; }
+  void addOverride(uint8_t field, int32_t value) { overrides.push_back({field, value}); }
+  bool verifying() const { return overrides.empty(); }
+  const PumpController &getController() const { return controller; }
+
+  bool replayBlock(const uint8_t *p, const uint8_t *end, unsigned index);
+
+  void onCall(uint8_t, int32_t) override {}
+  void onEdge(bool on) override;
+  void onReturn() override {}
+};
+
+void Replay::report(const char *format, ...) {
+  char time[24];
+  formatTime(time, sizeof(time), virtualClockUs);
+  printf("%s  ", time);
+  va_list args;
+  va_start(args, format);
+  vprintf(format, args);
+  va_end(args);
+  putchar('\n');
+}
+
+void Replay::onEdge(bool on) {
+  edges++;
+  pending.push_back(on);
+  if (on) {
+    report("pump ON   %-12s soil=%d", cause, soil);
+    lastOnUs = virtualClockUs;
+    seenOn = true;
+  } else if (seenOn) {
+    report("pump OFF  %-12s soil=%d ran=%.1fs", cause, soil, (virtualClockUs - lastOnUs) / 1e6);
+  } else {
+    report("pump OFF  %-12s soil=%d", cause, soil);
+  }
+}
+
+void Replay::confirmEdge(bool on) {
+  if (!pending.empty() && pending.front() == on) {
+    pending.pop_front();
+    return;
+  }
+  if (!verifying()) return;
+  mismatches++;
+  report("! device switched %s here, replay did not", on ? "ON" : "OFF");
+}
+
+// Called before every record that is not an edge: the last call is complete
+void Replay::checkPending() {
+  if (verifying()) {
+    for (bool on : pending) {
+      mismatches++;
+      report("! replay switched %s, device did not", on ? "ON" : "OFF");
+    }
+  }
+  pending.clear();
+}
+
+void Replay::applyConfig(const uint8_t *&p, const uint8_t *end) {
+  for (uint8_t i = 0; i < TRACE_CONFIG_COUNT; i++) {
+    uint64_t v;
+    if (traceReadVarint(p, end, v)) traceConfigSet(i, traceUnzigzag((uint32_t)v));
+  }
+  for (const auto &o : overrides) {
+    traceConfigSet(o.first, o.second);
+  }
+}
+
+// Moves the virtual clock forward, making the loop's left-out calls on the
+// way when settings are overridden
+void Replay::advanceTo(uint64_t us) {
+  if (!verifying() && tickMs) {
+    while (nextTickUs < us) {
+      virtualClockUs = nextTickUs;
+      nextTickUs += tickMs * 1000ULL;
+      checkPending();
+      call(TRACE_AUTO_SAME, 0);
+    }
+  }
+  virtualClockUs = us;
+}
+
+bool Replay::call(uint8_t type, int32_t arg) {
+  static char label[16];
+  switch (type) {
+    case TRACE_AUTO:
+    case TRACE_AUTO_SAME:
+      cause = "auto";
+      controller.autoIrrigate(soil);
+      break;
+    case TRACE_SAFETY:
+      cause = "safety";
+      controller.checkSafety();
+      break;
+    case TRACE_START:
+      cause = "start";
+      controller.start();
+      break;
+    case TRACE_START_FOR:
+      snprintf(label, sizeof(label), "start_for %d", (int)arg);
+      cause = label;
+      controller.startFor(arg);
+      break;
+    case TRACE_STOP:
+      cause = "stop";
+      controller.stop();
+      break;
+    case TRACE_DRY_COUNT:
+      cause = "dry_count";
+      controller.setConsecutiveDryCount(arg);
+      break;
+    default:
+      return false;
+  }
+  calls++;
+  if (controller.getPhase() != lastPhase) {
+    lastPhase = controller.getPhase();
+    report("phase %-5s %-12s soil=%d", phaseNames[lastPhase], cause, soil);
+  }
+  return true;
+}
+
+bool Replay::replayBlock(const uint8_t *p, const uint8_t *end, unsigned index) {
+  // Keyframe: where the device was when this block began
+  uint64_t at, soilZ;
+  if (p >= end || (*p++ >> 4) != TRACE_KEYFRAME || !traceReadVarint(p, end, at) ||
+      !traceReadVarint(p, end, soilZ)) {
+    fprintf(stderr, "block %u: bad keyframe\n", index);
+    return false;
+  }
+  if (started) {
+    advanceTo(at * 1000);
+  } else {
+    virtualClockUs = at * 1000;
+    nextTickUs = virtualClockUs + tickMs * 1000ULL;
+  }
+  soil = traceUnzigzag((uint32_t)soilZ);
+  applyConfig(p, end);
+  if (end - p < (ptrdiff_t)sizeof(PumpSnapshot)) {
+    fprintf(stderr, "block %u: truncated keyframe\n", index);
+    return false;
+  }
+  PumpSnapshot recorded;
+  memcpy(&recorded, p, sizeof(recorded));
+  p += sizeof(recorded);
+
+  if (!started) {
+    controller.loadState(recorded);
+    lastPhase = recorded.phase;
+    firstUs = virtualClockUs;
+    started = true;
+  } else if (verifying()) {
+    PumpSnapshot replayed;
+    controller.saveState(replayed);
+    std::string differing;
+    for (const SnapshotField &field : snapshotFields) {
+      if (sameField(replayed, recorded, field)) continue;
+      if (!differing.empty()) differing += ",";
+      differing += field.name;
+    }
+    if (!differing.empty()) {
+      mismatches++;
+      resyncs++;
+      report("! block %u: state differs from the device (%s), resynced", index, differing.c_str());
+      controller.loadState(recorded);
+      lastPhase = recorded.phase;
+    }
+  }
+  lastCall = 0;
+
+  while (p < end) {
+    uint8_t header = *p++;
+    uint8_t type = header >> 4;
+    uint64_t delta = header & 0x0F;
+    if (delta == TRACE_SMALL_DELTA && !traceReadVarint(p, end, delta)) break;
+    if (type != TRACE_EDGE_ON && type != TRACE_EDGE_OFF) checkPending();
+    advanceTo(virtualClockUs + delta * 1000);
+
+    uint64_t v = 0;
+    switch (type) {
+      case TRACE_AUTO:
+        if (!traceReadVarint(p, end, v)) return false;
+        soil += traceUnzigzag((uint32_t)v);
+        call(type, 0);
+        break;
+      case TRACE_START_FOR:
+        if (!traceReadVarint(p, end, v)) return false;
+        call(type, (int32_t)v);
+        break;
+      case TRACE_DRY_COUNT:
+        if (!traceReadVarint(p, end, v)) return false;
+        call(type, traceUnzigzag((uint32_t)v));
+        break;
+      case TRACE_AUTO_SAME:
+      case TRACE_SAFETY:
+      case TRACE_START:
+      case TRACE_STOP:
+        call(type, 0);
+        lastCall = type;
+        lastCallDelta = delta;
+        continue;
+      case TRACE_EDGE_ON:
+      case TRACE_EDGE_OFF:
+        confirmEdge(type == TRACE_EDGE_ON);
+        break;
+      case TRACE_REPEAT:
+        if (!traceReadVarint(p, end, v) || !lastCall) return false;
+        for (uint64_t i = 0; i < v; i++) {
+          checkPending();
+          advanceTo(virtualClockUs + lastCallDelta * 1000);
+          call(lastCall, 0);
+        }
+        continue;
+      case TRACE_SAMPLE: {
+        if (end - p < 5) return false;
+        uint8_t metric = *p++;
+        float value;
+        memcpy(&value, p, sizeof(float));
+        p += sizeof(float);
+        if (showSamples) {
+          report("sample %s %g", metric < metricNames.size() ? metricNames[metric].c_str() : "?", value);
+        }
+        break;
+      }
+      case TRACE_CONFIG:
+        applyConfig(p, end);
+        report("config changed");
+        break;
+      default:
+        fprintf(stderr, "block %u: unknown record type %u\n", index, type);
+        return false;
+    }
+    lastCall = 0;     // Only a record without payload can be repeated
+  }
+  checkPending();
+  return true;
+}
+
+static bool readFile(const char *path, std::vector<uint8_t> &data) {
+  FILE *file = fopen(path, "rb");
+  if (!file) {
+    perror(path);
+    return false;
+  }
+  uint8_t chunk[4096];
+  size_t n;
+  while ((n = fread(chunk, 1, sizeof(chunk), file)) > 0) {
+    data.insert(data.end(), chunk, chunk + n);
+  }
+  fclose(file);
+  return true;
+}
+
+static int usage(const char *self) {
+  fprintf(stderr, "usage: %s [--set key=value]... [--tick ms] [--samples] [--log] trace.bin\n", self);
+  fprintf(stderr, "settings:");
+  for (uint8_t i = 0; i < TRACE_CONFIG_COUNT; i++) {
+    fprintf(stderr, " %s", TRACE_CONFIG_FIELDS[i].name);
+  }
+  fprintf(stderr, "\n");
+  return 2;
+}
+
+int main(int argc, char **argv) {
+  Replay replay;
+  const char *path = nullptr;
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--set") == 0 && i + 1 < argc) {
+      const char *arg = argv[++i];
+      const char *eq = strchr(arg, '=');
+      int8_t field = -1;
+      for (uint8_t f = 0; eq && f < TRACE_CONFIG_COUNT; f++) {
+        const char *name = TRACE_CONFIG_FIELDS[f].name;
+        if (strlen(name) == (size_t)(eq - arg) && strncmp(arg, name, eq - arg) == 0) field = f;
+      }
+      if (field < 0) return usage(argv[0]);
+      replay.addOverride(field, atoi(eq + 1));
+    } else if (strcmp(argv[i], "--tick") == 0 && i + 1 < argc) {
+      replay.setTick(atoi(argv[++i]));
+    } else if (strcmp(argv[i], "--samples") == 0) {
+      replay.setSamples(true);
+    } else if (strcmp(argv[i], "--log") == 0) {
+      Serial.echo = true;
+    } else if (argv[i][0] == '-' || path) {
+      return usage(argv[0]);
+    } else {
+      path = argv[i];
+    }
+  }
+  if (!path) return usage(argv[0]);
+
+  std::vector<uint8_t> data;
+  if (!readFile(path, data)) return 2;
+  const uint8_t *p = data.data();
+  const uint8_t *end = p + data.size();
+
+  // Header
+  if (end - p < 9 || memcmp(p, TRACE_MAGIC, 4) != 0) {
+    fprintf(stderr, "%s: not a controller trace\n", path);
+    return 2;
+  }
+  uint8_t version = p[4];
+  uint8_t blocks = p[5];
+  uint16_t snapshotSize = p[6] | (p[7] << 8);
+  if (version != TRACE_VERSION || snapshotSize != sizeof(PumpSnapshot)) {
+    fprintf(stderr, "%s: trace version %u / snapshot %u bytes, this build reads %u / %u\n",
+            path, version, snapshotSize, TRACE_VERSION, (unsigned)sizeof(PumpSnapshot));
+    return 2;
+  }
+  uint8_t namesLength = p[8];
+  p += 9;
+  if (end - p < namesLength) return 2;
+  std::vector<std::string> names;
+  std::string list((const char *)p, namesLength);
+  for (size_t start = 0, comma; start <= list.size(); start = comma + 1) {
+    comma = list.find(',', start);
+    if (comma == std::string::npos) comma = list.size();
+    names.push_back(list.substr(start, comma - start));
+  }
+  replay.setMetricNames(names);
+  p += namesLength;
+
+  printf("# %s: %u block(s)%s\n", path, blocks, replay.verifying() ? "" : ", settings overridden, not verified");
+  auto wallStart = std::chrono::steady_clock::now();
+  bool ok = true;
+  for (unsigned i = 0; i < blocks && ok; i++) {
+    if (end - p < 2) {
+      fprintf(stderr, "%s: truncated\n", path);
+      return 2;
+    }
+    uint16_t length = p[0] | (p[1] << 8);
+    p += 2;
+    if (end - p < length) {
+      fprintf(stderr, "%s: truncated\n", path);
+      return 2;
+    }
+    ok = replay.replayBlock(p, p + length, i);
+    p += length;
+  }
+  double wallS = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+  if (!ok) return 2;
+
+  const PumpController &controller = replay.getController();
+  double spanS = (virtualClockUs - replay.firstUs) / 1e6;
+  printf("# %u calls, %u edges over %.0f s; %d runs, %lu s watered in total; %u mismatch(es), %u resync(s)\n",
+         replay.calls, replay.edges, spanS, controller.getWateringCount(),
+         controller.getTotalWateringTime(), replay.mismatches, replay.resyncs);
+  fprintf(stderr, "replayed %.0f s of controller time in %.1f ms (%.0fx real time)\n",
+          spanS, wallS * 1e3, wallS > 0 ? spanS / wallS : 0);
+  return replay.mismatches ? 1 : 0;
+}
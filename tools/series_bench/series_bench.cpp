@@ -0,0 +1,216 @@
+// Host benchmark for src/storage/SeriesCodec: compression ratio and
+// encode/decode throughput per metric, with a round-trip check.
+//
+//   series_bench [recording.csv]
+//
+// The CSV has one reading per line: "time_ms,metric,value" (see README).
+// Without a file a synthetic day of AgroHygra readings is generated.
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "storage/SeriesCodec.h"
+
+struct Sample {
+  uint32_t time;
+  float value;
+};
+
+struct Block {
+  uint8_t data[SERIES_BLOCK_SIZE];
+  size_t size;
+};
+
+// Resolution of each reading as published (decimals for SERIES_FIXED)
+static int decimalsFor(const std::string &metric) {
+  static const std::map<std::string, int> table = {
+    {"soil", 0}, {"temp", 1}, {"hum", 1}, {"air", 0}, {"tds", 0}, {"ppm", 0},
+    {"n", 0}, {"p", 0}, {"k", 0}, {"ph", 1}, {"ec", 3}, {"soilTemp", 1},
+  };
+  auto it = table.find(metric);
+  return it == table.end() ? 2 : it->second;
+}
+
+static bool loadCsv(const char *path, std::map<std::string, std::vector<Sample>> &series) {
+  FILE *file = fopen(path, "r");
+  if (!file) {
+    perror(path);
+    return false;
+  }
+
+  char line[256];
+  while (fgets(line, sizeof(line), file)) {
+    char metric[64];
+    unsigned long time;
+    float value;
+    if (sscanf(line, "%lu,%63[^,],%f", &time, metric, &value) == 3) {
+      series[metric].push_back({(uint32_t)time, value});
+    }
+  }
+  fclose(file);
+  return true;
+}
+
+static float quantizeTo(float value, int decimals) {
+  float scale = powf(10.0f, decimals);
+  return roundf(value * scale) / scale;
+}
+
+// 24 h at the default intervals: soil via NPK every 2 s, ambient every 5 s,
+// with scheduling jitter, a diurnal cycle, sensor noise and two irrigations
+static void generate(std::map<std::string, std::vector<Sample>> &series) {
+  std::mt19937 rng(42);
+  std::normal_distribution<float> noise(0.0f, 1.0f);
+  std::uniform_int_distribution<int> jitter(-3, 3);
+
+  float soil = 55.0f;
+  float ec = 0.85f;
+  for (uint32_t t = 0; t < 86400000UL; t += 2000) {
+    uint32_t time = t + jitter(rng);
+    float hours = t / 3600000.0f;
+    soil -= 0.0004f;
+    if (fabsf(hours - 7.0f) < 0.01f || fabsf(hours - 19.0f) < 0.01f) soil = 70.0f;
+    ec = 0.85f + (soil - 55.0f) * 0.004f;
+
+    series["soil"].push_back({time, quantizeTo(soil + noise(rng) * 0.3f, 0)});
+    series["soilTemp"].push_back({time, quantizeTo(18.0f + 3.0f * sinf(hours / 24.0f * 6.283f), 1)});
+    series["ph"].push_back({time, quantizeTo(6.5f + noise(rng) * 0.03f, 1)});
+    series["ec"].push_back({time, quantizeTo(ec + noise(rng) * 0.002f, 3)});
+    series["n"].push_back({time, quantizeTo(42.0f + noise(rng) * 0.4f, 0)});
+  }
+
+  float filtered = 22.0f;
+  for (uint32_t t = 0; t < 86400000UL; t += 5000) {
+    uint32_t time = t + jitter(rng);
+    float hours = t / 3600000.0f;
+    float temp = 22.0f + 6.0f * sinf((hours - 9.0f) / 24.0f * 6.283f);
+    float temp01 = quantizeTo(temp + noise(rng) * 0.1f, 1);
+
+    series["temp"].push_back({time, temp01});
+    series["hum"].push_back({time, quantizeTo(60.0f - (temp - 22.0f) * 2.5f + noise(rng) * 0.3f, 1)});
+    series["air"].push_back({time, quantizeTo(30.0f + noise(rng) * 2.0f, 0)});
+    series["tds"].push_back({time, quantizeTo(740.0f + noise(rng) * 4.0f, 0)});
+
+    // EMA output as published when filtering is on: full float precision
+    filtered += 0.2f * (temp01 - filtered);
+    series["tempEma"].push_back({time, filtered});
+  }
+}
+
+static std::vector<Block> encode(const std::vector<Sample> &samples, SeriesFormat format, int decimals) {
+  std::vector<Block> blocks;
+  SeriesEncoder encoder;
+  Block block;
+  encoder.begin(block.data, sizeof(block.data), format, decimals);
+
+  for (const Sample &sample : samples) {
+    if (!encoder.append(sample.time, sample.value)) {
+      block.size = encoder.getSize();
+      blocks.push_back(block);
+      encoder.begin(block.data, sizeof(block.data), format, decimals);
+      encoder.append(sample.time, sample.value);
+    }
+  }
+  if (!encoder.isEmpty()) {
+    block.size = encoder.getSize();
+    blocks.push_back(block);
+  }
+  return blocks;
+}
+
+static size_t decode(const std::vector<Block> &blocks, std::vector<Sample> &out) {
+  out.clear();
+  SeriesDecoder decoder;
+  for (const Block &block : blocks) {
+    if (!decoder.begin(block.data, block.size)) break;
+    Sample sample;
+    while (decoder.next(sample.time, sample.value)) out.push_back(sample);
+  }
+  return out.size();
+}
+
+static bool matches(const std::vector<Sample> &original, const std::vector<Sample> &decoded,
+                    SeriesFormat format, int decimals) {
+  if (original.size() != decoded.size()) return false;
+  float tolerance = format == SERIES_FIXED ? 0.5f / powf(10.0f, decimals) * 1.001f : 0.0f;
+  for (size_t i = 0; i < original.size(); i++) {
+    if (original[i].time != decoded[i].time) return false;
+    if (std::isnan(original[i].value)) {
+      if (!std::isnan(decoded[i].value)) return false;
+      continue;
+    }
+    if (format == SERIES_FLOAT && memcmp(&original[i].value, &decoded[i].value, sizeof(float)) != 0) {
+      return false;
+    }
+    if (fabsf(original[i].value - decoded[i].value) > tolerance + fabsf(original[i].value) * 1e-6f) {
+      return false;
+    }
+  }
+  return true;
+}
+
+template <typename F>
+static double bestSeconds(F &&run) {
+  double best = 1e9;
+  for (int i = 0; i < 5; i++) {
+    auto start = std::chrono::steady_clock::now();
+    run();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (seconds < best) best = seconds;
+  }
+  return best;
+}
+
+int main(int argc, char **argv) {
+  std::map<std::string, std::vector<Sample>> series;
+  if (argc > 1) {
+    if (!loadCsv(argv[1], series)) return 1;
+  } else {
+    generate(series);
+  }
+
+  printf("%-9s %-6s %8s %8s %7s %7s %10s %10s %s\n",
+         "metric", "format", "samples", "bytes", "B/smp", "ratio", "enc Msmp/s", "dec Msmp/s", "check");
+
+  bool allOk = true;
+  size_t totalRaw = 0, totalBest = 0;
+  for (const auto &entry : series) {
+    const std::vector<Sample> &samples = entry.second;
+    int decimals = decimalsFor(entry.first);
+    size_t raw = samples.size() * 8;    // uint32 time + float32 value
+    size_t best = raw;
+
+    for (SeriesFormat format : {SERIES_FLOAT, SERIES_FIXED}) {
+      std::vector<Block> blocks;
+      double encodeSeconds = bestSeconds([&] { blocks = encode(samples, format, decimals); });
+
+      std::vector<Sample> decoded;
+      double decodeSeconds = bestSeconds([&] { decode(blocks, decoded); });
+
+      size_t bytes = 0;
+      for (const Block &block : blocks) bytes += block.size;
+      bool ok = matches(samples, decoded, format, decimals);
+      allOk = allOk && ok;
+      if (bytes < best) best = bytes;
+
+      printf("%-9s %-6s %8zu %8zu %7.2f %6.1fx %10.1f %10.1f %s\n",
+             entry.first.c_str(), format == SERIES_FLOAT ? "xor" : "fixed",
+             samples.size(), bytes, (double)bytes / samples.size(), (double)raw / bytes,
+             samples.size() / encodeSeconds / 1e6, samples.size() / decodeSeconds / 1e6,
+             ok ? "ok" : "MISMATCH");
+    }
+    totalRaw += raw;
+    totalBest += best;
+  }
+
+  printf("\nraw %zu bytes, best per metric %zu bytes (%.1fx)\n",
+         totalRaw, totalBest, (double)totalRaw / totalBest);
+  return allOk ? 0 : 1;
+}